@@ -0,0 +1,790 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+/**
+ * This program measures the throughput of the bulk algorithms on large,
+ * randomly generated inputs. It does not need a window or OpenGL.
+ *
+ * Usage: VectorsAndMatricesBenchmark [threads] [scale]
+ *
+ *  - threads: number of threads (0 = number of hardware threads, default)
+ *  - scale:   factor for all problem sizes (default 1.0)
+ */
+
+// Include IO utilities and math functions:
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+// Include time measurement and random numbers:
+#include <chrono>
+#include <random>
+
+// Include std::vector, std::string and std::shuffle:
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Include the thread pool:
+#include "src/math/Parallel.h"
+
+// Include the algorithms we want to measure:
+#include "src/geometry/ConvexHull.h"
+#include "src/math/Svd3.h"
+#include "src/geometry/MeshSimplification.h"
+#include "src/geometry/MeshOptimization.h"
+#include "src/geometry/MeshNormals.h"
+#include "src/geometry/Subdivision.h"
+#include "src/math/ConjugateGradient.h"
+#include "src/math/MatrixXf.h"
+#include "src/math/DenseSolvers.h"
+#include "src/geometry/PoseEstimation.h"
+#include "src/geometry/IcpRegistration.h"
+#include "src/geometry/PointCloudNormals.h"
+#include "src/math/Sorting.h"
+#include "src/math/Distances.h"
+#include "src/geometry/KMeans.h"
+#include "src/geometry/SignedDistanceField.h"
+#include "src/geometry/MarchingCubes.h"
+#include "src/geometry/SparseVoxelOctree.h"
+#include "src/geometry/Delaunay.h"
+#include "src/geometry/PoissonDisk.h"
+#include "src/math/Random.h"
+#include "src/simulation/NBody.h"
+#include "src/simulation/Sph.h"
+#include "src/simulation/Xpbd.h"
+
+/**
+ * Measures the time of the given function in seconds (the best of the given
+ * number of runs is returned, which hides warm up effects).
+ */
+template<typename Function>
+double measure(int runs, const Function& function){
+    double best = 1e30;
+    for(int run=0; run < runs; ++run){
+        auto start = std::chrono::steady_clock::now();
+        function();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = seconds < best ? seconds : best;
+    }
+    return best;
+}
+
+/**
+ * Prints one result line.
+ */
+void report(const std::string& name, size_t elements, const char* unit, double seconds){
+    printf("%-40s %12zu %-10s %10.2f ms %12.2f M%s/s\n",
+           name.c_str(), elements, unit, seconds * 1000.0, elements / seconds / 1e6, unit);
+}
+
+/**
+ * Returns 'count' points which are normally distributed around the origin.
+ */
+std::vector<Vec4f> createGaussianPoints(size_t count, unsigned int seed){
+    std::mt19937 random(seed);
+    std::normal_distribution<float> normal(0.f, 1.f);
+
+    std::vector<Vec4f> points(count);
+    for(Vec4f& p : points)
+        p = Vec4f(normal(random), normal(random), normal(random));
+    return points;
+}
+
+/**
+ * Returns 'count' points which lie on the unit sphere (so that every point is
+ * a corner of the convex hull).
+ */
+std::vector<Vec4f> createSpherePoints(size_t count, unsigned int seed){
+    std::vector<Vec4f> points = createGaussianPoints(count, seed);
+    for(Vec4f& p : points){
+        float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        p = Vec4f(p.x / length, p.y / length, p.z / length);
+    }
+    return points;
+}
+
+/**
+ * Returns a closed torus mesh with 2 * rings * segments triangles, whose
+ * surface is slightly wavy (so that it is not trivial to simplify).
+ */
+TriangleMesh createTorusMesh(uint32_t rings, uint32_t segments){
+    TriangleMesh mesh;
+    const float pi = 3.14159265f;
+    for(uint32_t i=0; i < rings; ++i){
+        for(uint32_t j=0; j < segments; ++j){
+            float u = 2.f * pi * i / rings, v = 2.f * pi * j / segments;
+            float r = 0.3f + 0.02f * std::sin(13.f * u) * std::sin(7.f * v);
+            mesh.positions.push_back(Vec4f((1.f + r * std::cos(v)) * std::cos(u),
+                                           (1.f + r * std::cos(v)) * std::sin(u),
+                                           r * std::sin(v)));
+        }
+    }
+    for(uint32_t i=0; i < rings; ++i){
+        for(uint32_t j=0; j < segments; ++j){
+            uint32_t a = i * segments + j;
+            uint32_t b = ((i + 1) % rings) * segments + j;
+            uint32_t c = ((i + 1) % rings) * segments + (j + 1) % segments;
+            uint32_t d = i * segments + (j + 1) % segments;
+            uint32_t triangles[6] = {a, b, c, a, c, d};
+            mesh.indices.insert(mesh.indices.end(), triangles, triangles + 6);
+        }
+    }
+    return mesh;
+}
+
+void benchmarkConvexHull(double scale){
+    size_t counts[] = {size_t(1000000 * scale), size_t(10000000 * scale)};
+    for(size_t count : counts){
+        std::vector<Vec4f> points = createGaussianPoints(count, 1);
+        size_t triangles = 0;
+        double seconds = measure(3, [&]{ triangles = computeConvexHull(points.data(), points.size()).getTriangleCount(); });
+        report("convex hull (gaussian, " + std::to_string(triangles) + " tris)", count, "points", seconds);
+    }
+
+    // Worst case: all points are on the hull:
+    std::vector<Vec4f> points = createSpherePoints(size_t(100000 * scale), 2);
+    double seconds = measure(1, [&]{ computeConvexHull(points.data(), points.size()); });
+    report("convex hull (sphere surface)", points.size(), "points", seconds);
+}
+
+void benchmarkSvd(double scale){
+    size_t count = size_t(4000000 * scale);
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+    std::vector<Mat4f> matrices(count);
+    for(Mat4f& m : matrices)
+        for(int col=0; col < 3; ++col)
+            for(int row=0; row < 3; ++row)
+                m.data[col * 4 + row] = uniform(random);
+
+    std::vector<Mat4f> u(count), v(count);
+    std::vector<Vec4f> sigma(count);
+    double seconds = measure(3, [&]{ computeSvdBatch(matrices.data(), u.data(), sigma.data(), v.data(), count); });
+    report("svd 3x3 (" + std::to_string(SVD3_SWEEPS) + " sweeps)", count, "matrices", seconds);
+
+    seconds = measure(3, [&]{ computePolarDecompositionBatch(matrices.data(), u.data(), v.data(), count); });
+    report("polar decomposition 3x3", count, "matrices", seconds);
+
+    // Make the matrices symmetric:
+    for(Mat4f& m : matrices)
+        for(int col=0; col < 3; ++col)
+            for(int row=col + 1; row < 3; ++row)
+                m.data[col * 4 + row] = m.data[row * 4 + col];
+
+    seconds = measure(3, [&]{ computeSymmetricEigenBatch(matrices.data(), sigma.data(), v.data(), count); });
+    report("symmetric eigen 3x3", count, "matrices", seconds);
+}
+
+void benchmarkSimplification(double scale){
+    uint32_t rings = uint32_t(1000 * std::sqrt(scale)) + 8;
+    TriangleMesh mesh = createTorusMesh(rings, rings / 2 + 4);
+
+    SimplificationSettings settings;
+    settings.targetTriangleCount = mesh.getTriangleCount() / 100;
+
+    double seconds = measure(1, [&]{ simplifyMesh(mesh, settings); });
+    report("mesh simplification (1%)", mesh.getTriangleCount(), "tris", seconds);
+
+    settings.clusterCount = 0;
+    seconds = measure(1, [&]{ simplifyMesh(mesh, settings); });
+    report("mesh simplification (1%, clusters)", mesh.getTriangleCount(), "tris", seconds);
+}
+
+void benchmarkMeshOptimization(double scale){
+    uint32_t rings = uint32_t(1000 * std::sqrt(scale)) + 8;
+    TriangleMesh mesh = createTorusMesh(rings, rings / 2 + 4);
+
+    // Shuffle the triangles and store every triangle with its own vertices:
+    std::mt19937 random(4);
+    std::vector<uint32_t> order(mesh.getTriangleCount());
+    for(size_t t=0; t < order.size(); ++t)
+        order[t] = uint32_t(t);
+    std::shuffle(order.begin(), order.end(), random);
+
+    TriangleMesh soup;
+    for(uint32_t t : order){
+        for(int c=0; c < 3; ++c){
+            soup.indices.push_back(uint32_t(soup.positions.size()));
+            soup.positions.push_back(mesh.positions[mesh.indices[3 * t + c]]);
+        }
+    }
+
+    TriangleMesh welded;
+    double seconds = measure(3, [&]{ welded = soup; weldVertices(welded); });
+    report("weld vertices", soup.getVertexCount(), "verts", seconds);
+
+    float acmr = computeACMR(welded);
+    TriangleMesh optimized;
+    seconds = measure(3, [&]{ optimized = welded; optimizeVertexCache(optimized); });
+    report("vertex cache (ACMR " + std::to_string(acmr).substr(0, 4) + " -> " +
+           std::to_string(computeACMR(optimized)).substr(0, 4) + ")", welded.getTriangleCount(), "tris", seconds);
+
+    seconds = measure(3, [&]{ optimized = welded; optimizeOverdraw(optimized); });
+    report("overdraw (ACMR " + std::to_string(computeACMR(optimized)).substr(0, 4) + ")", welded.getTriangleCount(), "tris", seconds);
+
+    seconds = measure(3, [&]{ optimizeVertexFetch(optimized); });
+    report("vertex fetch", optimized.getVertexCount(), "verts", seconds);
+}
+
+void benchmarkNormals(double scale){
+    uint32_t rings = uint32_t(2000 * std::sqrt(scale)) + 8;
+    uint32_t segments = rings / 2 + 4;
+    TriangleMesh mesh = createTorusMesh(rings, segments);
+
+    // Texture coordinates which wrap once around the torus in both directions:
+    std::vector<Vec4f> texCoords(mesh.getVertexCount());
+    for(size_t v=0; v < texCoords.size(); ++v)
+        texCoords[v] = Vec4f(float(v / segments) / rings, float(v % segments) / segments, 0.f, 0.f);
+
+    VertexAdjacency adjacency;
+    double seconds = measure(3, [&]{
+        adjacency = VertexAdjacency(mesh.indices.data(), mesh.getTriangleCount(), mesh.getVertexCount());
+    });
+    report("vertex adjacency", mesh.getTriangleCount(), "tris", seconds);
+
+    mesh.normals.resize(mesh.getVertexCount());
+    seconds = measure(3, [&]{
+        computeVertexNormals(mesh.positions.data(), mesh.indices.data(), mesh.getTriangleCount(),
+                             adjacency, mesh.normals.data(), NormalWeighting::Area);
+    });
+    report("area weighted normals", mesh.getTriangleCount(), "tris", seconds);
+
+    seconds = measure(3, [&]{
+        computeVertexNormals(mesh.positions.data(), mesh.indices.data(), mesh.getTriangleCount(),
+                             adjacency, mesh.normals.data(), NormalWeighting::Angle);
+    });
+    report("angle weighted normals", mesh.getTriangleCount(), "tris", seconds);
+
+    std::vector<Vec4f> tangents(mesh.getVertexCount());
+    seconds = measure(3, [&]{
+        computeTangents(mesh.positions.data(), mesh.normals.data(), texCoords.data(), mesh.indices.data(),
+                        mesh.getTriangleCount(), adjacency, tangents.data());
+    });
+    report("tangents", mesh.getTriangleCount(), "tris", seconds);
+}
+
+void benchmarkSubdivision(double scale){
+    uint32_t rings = uint32_t(200 * std::sqrt(scale)) + 8;
+    TriangleMesh control = createTorusMesh(rings, rings / 2 + 4);
+    HalfEdgeMesh controlMesh(control);
+
+    const SubdivisionScheme schemes[2] = {SubdivisionScheme::Loop, SubdivisionScheme::CatmullClark};
+    const char* names[2] = {"Loop", "Catmull-Clark"};
+    for(int s=0; s < 2; ++s){
+        SubdivisionSurface surface(controlMesh, schemes[s], 0);
+        double seconds = measure(1, [&]{ surface = SubdivisionSurface(controlMesh, schemes[s], 3); });
+        const HalfEdgeMesh& finest = surface.getFinestMesh();
+        report(std::string(names[s]) + " stencils (3 levels)", finest.getFaceCount(), "faces", seconds);
+
+        std::vector<Vec4f> positions;
+        seconds = measure(3, [&]{ surface.evaluate(control.positions, positions); });
+        report(std::string(names[s]) + " evaluation", finest.getVertexCount(), "verts", seconds);
+    }
+}
+
+/**
+ * Returns the triplets of the 7-point Laplacian (with Dirichlet borders) on a
+ * grid of n^3 cells, where every cell has 'components' unknowns. Neighbouring
+ * components of a cell are slightly coupled, so the blocks are not diagonal;
+ * 'shift' is added to the diagonal (like the mass term of an implicit time
+ * step), which keeps the coupled matrix positive definite.
+ */
+std::vector<Triplet> createGridLaplacian(uint32_t n, uint32_t components, float shift){
+    std::vector<Triplet> triplets;
+    triplets.reserve(size_t(n) * n * n * components * 9);
+    for(uint32_t i=0; i < n; ++i){
+        for(uint32_t j=0; j < n; ++j){
+            for(uint32_t k=0; k < n; ++k){
+                uint32_t cell = (i * n + j) * n + k;
+                uint32_t neighbours[6] = {cell - n * n, cell + n * n, cell - n, cell + n, cell - 1, cell + 1};
+                bool inside[6] = {i > 0, i + 1 < n, j > 0, j + 1 < n, k > 0, k + 1 < n};
+                for(uint32_t c=0; c < components; ++c){
+                    uint32_t row = cell * components + c;
+                    triplets.push_back(Triplet(row, row, 6.f + shift));
+                    if(c + 1 < components){
+                        triplets.push_back(Triplet(row, row + 1, 0.5f));
+                        triplets.push_back(Triplet(row + 1, row, 0.5f));
+                    }
+                    for(int d=0; d < 6; ++d){
+                        if(inside[d])
+                            triplets.push_back(Triplet(row, neighbours[d] * components + c, -1.f));
+                    }
+                }
+            }
+        }
+    }
+    return triplets;
+}
+
+void benchmarkConjugateGradient(double scale){
+    SolverSettings settings;
+    const Preconditioner preconditioners[2] = {Preconditioner::Jacobi, Preconditioner::IncompleteCholesky};
+    const char* names[2] = {"Jacobi", "IC(0)"};
+
+    // A scalar system with about one million unknowns (at scale 1):
+    uint32_t n = uint32_t(100 * std::cbrt(scale)) + 4;
+    std::vector<Triplet> triplets = createGridLaplacian(n, 1, 0.f);
+    SparseMatrix A;
+    double seconds = measure(1, [&]{ A = SparseMatrix(size_t(n) * n * n, size_t(n) * n * n, triplets); });
+    report("CSR from triplets", triplets.size(), "trips", seconds);
+
+    std::vector<float> x(A.rowCount), b(A.rowCount, 1.f), y(A.rowCount);
+    seconds = measure(10, [&]{ A.multiply(b.data(), y.data()); });
+    report("CSR SpMV", A.getNonZeroCount(), "nnz", seconds);
+
+    for(int p=0; p < 2; ++p){
+        SolverResult result;
+        settings.preconditioner = preconditioners[p];
+        seconds = measure(1, [&]{ x.assign(A.rowCount, 0.f); result = solveConjugateGradient(A, b, x, settings); });
+        report(std::string("CG ") + names[p] + " (" + std::to_string(result.iterations) + " it)", A.rowCount, "unkn", seconds);
+    }
+
+    // A block system with about one million unknowns (at scale 1):
+    n = uint32_t(69 * std::cbrt(scale)) + 3;
+    triplets = createGridLaplacian(n, 3, 1.f);
+    BlockSparseMatrix B;
+    seconds = measure(1, [&]{ B = BlockSparseMatrix(size_t(n) * n * n, size_t(n) * n * n, triplets); });
+    report("BSR from triplets", triplets.size(), "trips", seconds);
+
+    std::vector<Vec4f> xBlocks, bBlocks(B.blockRowCount, Vec4f(1.f, 1.f, 1.f, 0.f)), yBlocks(B.blockRowCount);
+    seconds = measure(10, [&]{ B.multiply(bBlocks.data(), yBlocks.data()); });
+    report("BSR SpMV", 9 * B.getBlockCount(), "nnz", seconds);
+
+    for(int p=0; p < 2; ++p){
+        SolverResult result;
+        settings.preconditioner = preconditioners[p];
+        seconds = measure(1, [&]{ xBlocks.clear(); result = solveConjugateGradient(B, bBlocks, xBlocks, settings); });
+        report(std::string("block CG ") + names[p] + " (" + std::to_string(result.iterations) + " it)",
+               3 * B.blockRowCount, "unkn", seconds);
+    }
+}
+
+void benchmarkMatrixMultiplication(double scale){
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+
+    // The number of floating point operations is 2 n^3:
+    size_t sizes[3] = {64, 256, size_t(1024 * std::cbrt(scale)) / 16 * 16 + 16};
+    for(size_t n : sizes){
+        MatrixXf A(n, n), B(n, n), C(n, n);
+        for(size_t j=0; j < n; ++j){
+            for(size_t i=0; i < n; ++i){
+                A(i, j) = distribution(random);
+                B(i, j) = distribution(random);
+            }
+        }
+
+        int runs = n < 512 ? 20 : 3;
+        double seconds = measure(runs, [&]{ multiply(A, B, C); });
+        report("GEMM " + std::to_string(n) + "^2", 2 * n * n * n, "flop", seconds);
+    }
+}
+
+void benchmarkDenseSolvers(double scale){
+    std::mt19937 random(6);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+
+    // A random matrix for LU (2/3 n^3 flops) and A * A^T + n I for Cholesky
+    // (1/3 n^3 flops):
+    size_t n = size_t(1024 * std::cbrt(scale)) / 16 * 16 + 16;
+    MatrixXf A(n, n);
+    for(size_t j=0; j < n; ++j){
+        for(size_t i=0; i < n; ++i)
+            A(i, j) = distribution(random);
+    }
+    MatrixXf spd = A * A.transposed() + MatrixXf::identity(n) * float(n);
+
+    double seconds = measure(3, [&]{ LUFactorization lu(A); });
+    report("LU " + std::to_string(n) + "^2", 2 * n * n * n / 3, "flop", seconds);
+
+    seconds = measure(3, [&]{ CholeskyFactorization cholesky(spd); });
+    report("Cholesky " + std::to_string(n) + "^2", n * n * n / 3, "flop", seconds);
+
+    // Many small systems:
+    size_t count = size_t(1000000 * scale) + 1;
+    std::vector<Mat4f> matrices(count);
+    std::vector<Vec4f> rightSides(count), solutions(count);
+    for(size_t i=0; i < count; ++i){
+        for(size_t k=0; k < 16; ++k)
+            matrices[i].data[k] = distribution(random);
+        rightSides[i] = Vec4f(distribution(random), distribution(random), distribution(random), distribution(random));
+    }
+
+    seconds = measure(5, [&]{ solveBatch4x4(matrices.data(), rightSides.data(), solutions.data(), count); });
+    report("Batched 4x4 solves", count, "systems", seconds);
+}
+
+void benchmarkPoseEstimation(double scale){
+    // Rotate by 0.2 radians around z and translate; every tenth target is an
+    // outlier:
+    float c = std::cos(0.2f), s = std::sin(0.2f);
+    size_t count = size_t(1000000 * scale) + 1;
+    std::vector<Vec4f> sources = createGaussianPoints(count, 9);
+    std::vector<Vec4f> normals = createSpherePoints(count, 10);
+    std::vector<Vec4f> outliers = createGaussianPoints(count, 11);
+    std::vector<Vec4f> targets(count);
+    for(size_t i=0; i < count; ++i){
+        const Vec4f& p = sources[i];
+        targets[i] = i % 10 == 0 ? outliers[i] : Vec4f(c * p.x - s * p.y + 0.1f, s * p.x + c * p.y - 0.2f, p.z + 0.3f);
+    }
+
+    PoseSettings settings;
+    PoseResult result;
+    double seconds = measure(3, [&]{ result = estimateRigidPose(sources.data(), targets.data(), nullptr, count, settings); });
+    report("Pose point-to-point (" + std::to_string(result.iterations) + " it)", count, "corr", seconds);
+
+    seconds = measure(3, [&]{ result = estimateRigidPose(sources.data(), targets.data(), normals.data(), count, settings); });
+    report("Pose point-to-plane (" + std::to_string(result.iterations) + " it)", count, "corr", seconds);
+
+    // Many small problems with 100 correspondences each:
+    size_t problemCount = count / 100;
+    std::vector<PoseProblem> problems(problemCount);
+    std::vector<PoseResult> results(problemCount);
+    for(size_t i=0; i < problemCount; ++i){
+        problems[i].sources = sources.data() + i * 100;
+        problems[i].targets = targets.data() + i * 100;
+        problems[i].targetNormals = nullptr;
+        problems[i].count = 100;
+    }
+
+    seconds = measure(3, [&]{ estimateRigidPoses(problems.data(), results.data(), problemCount, settings); });
+    report("Pose batch (100 corr per problem)", problemCount, "problems", seconds);
+}
+
+void benchmarkIcp(double scale){
+    // The target and the source are two differently tessellated tori (so
+    // no point has an exact partner), the source is rotated by 0.1 radians
+    // around z and translated:
+    uint32_t rings = uint32_t(1400 * std::sqrt(scale)) + 8;
+    TriangleMesh target = createTorusMesh(rings, rings / 2 + 4);
+    TriangleMesh source = createTorusMesh(rings + 7, rings / 2 + 1);
+    computeVertexNormals(target);
+
+    float c = std::cos(0.1f), s = std::sin(0.1f);
+    for(Vec4f& p : source.positions)
+        p = Vec4f(c * p.x - s * p.y + 0.02f, s * p.x + c * p.y - 0.03f, p.z + 0.01f);
+
+    size_t count = target.getVertexCount();
+    IcpRegistration registration(target.positions.data(), target.normals.data(), count);
+    double seconds = measure(3, [&]{
+        registration = IcpRegistration(target.positions.data(), target.normals.data(), count);
+    });
+    report("ICP k-d tree", count, "points", seconds);
+
+    IcpSettings settings;
+    settings.maxCorrespondenceDistance = 0.2f;
+    IcpResult result;
+    seconds = measure(3, [&]{ result = registration.align(source.positions.data(), source.getVertexCount(), settings); });
+    report("ICP point-to-plane (" + std::to_string(result.iterations) + " it)", source.getVertexCount(), "points", seconds);
+}
+
+void benchmarkPointCloudNormals(double scale){
+    // The vertices of a torus in random order (like an unorganized scan):
+    uint32_t rings = uint32_t(1400 * std::sqrt(scale)) + 8;
+    std::vector<Vec4f> points = createTorusMesh(rings, rings / 2 + 4).positions;
+    std::shuffle(points.begin(), points.end(), std::mt19937(11));
+
+    double seconds = measure(3, [&]{ computeMortonOrder(points.data(), points.size()); });
+    report("Morton order (radix sort)", points.size(), "points", seconds);
+
+    std::vector<Vec4f> normals(points.size());
+    std::vector<float> curvatures(points.size());
+    PointCloudNormalSettings settings;
+    settings.orient = false;
+    seconds = measure(3, [&]{
+        estimatePointCloudNormals(points.data(), points.size(), normals.data(), curvatures.data(), settings);
+    });
+    report("Point cloud normals (k = 16)", points.size(), "points", seconds);
+
+    settings.orient = true;
+    seconds = measure(3, [&]{
+        estimatePointCloudNormals(points.data(), points.size(), normals.data(), curvatures.data(), settings);
+    });
+    report("Point cloud normals, oriented", points.size(), "points", seconds);
+}
+
+void benchmarkKMeans(double scale){
+    size_t count = size_t(4096 * std::sqrt(scale)) + 16;
+    std::vector<Vec4f> points = createGaussianPoints(count, 13);
+    MatrixXf distances;
+    double seconds = measure(3, [&]{ computeSquaredDistances(points.data(), count, points.data(), count, distances); });
+    report("All-pairs distances (dense)", count * count, "pairs", seconds);
+
+    // 64 clusters of a mixture of 32 Gaussian blobs:
+    count = size_t(2000000 * scale) + 1000;
+    points = createGaussianPoints(count, 14);
+    std::vector<Vec4f> blobs = createGaussianPoints(32, 15);
+    for(size_t i=0; i < count; ++i){
+        const Vec4f& blob = blobs[i % blobs.size()];
+        points[i] = Vec4f(0.1f * points[i].x + blob.x, 0.1f * points[i].y + blob.y, 0.1f * points[i].z + blob.z);
+    }
+
+    KMeansSettings settings;
+    settings.maxIterations = 20;
+    KMeansResult result;
+    seconds = measure(1, [&]{ result = computeKMeans(points.data(), count, 64, settings); });
+    report("k-means, k = 64 (" + std::to_string(result.iterations) + " it)", count, "points", seconds);
+}
+
+void benchmarkSignedDistanceField(double scale){
+    TriangleMesh mesh = createTorusMesh(1000, 500);
+    SignedDistanceSettings settings;
+    settings.resolution = size_t(512 * std::cbrt(scale)) + 8;
+
+    SignedDistanceField field;
+    double seconds = measure(1, [&]{ field = bakeSignedDistanceField(mesh, settings); });
+    report("SDF bake (" + std::to_string(field.sizeX) + "x" + std::to_string(field.sizeY) + "x"
+           + std::to_string(field.sizeZ) + ")", field.values.size(), "voxels", seconds);
+
+    SparseSignedDistanceField sparse;
+    seconds = measure(3, [&]{ sparse = createSparseSignedDistanceField(field, 2.f * field.voxelSize); });
+    report("SDF sparse bricks (" + std::to_string(sparse.brickValues.size() / (SDF_BRICK_SIZE * SDF_BRICK_SIZE * SDF_BRICK_SIZE))
+           + " stored)", field.values.size(), "voxels", seconds);
+}
+
+void benchmarkMarchingCubes(double scale){
+    // A wavy torus on a cubic grid over [-1, 1]^3:
+    size_t size = size_t(384 * std::cbrt(scale)) + 8;
+    float voxelSize = 2.f / float(size - 1);
+    std::vector<float> values(size * size * size);
+    parallelFor(0, size, 1, [&](size_t begin, size_t end){
+        for(size_t z=begin; z < end; ++z){
+            for(size_t y=0; y < size; ++y){
+                for(size_t x=0; x < size; ++x){
+                    float px = -1.f + x * voxelSize, py = -1.f + y * voxelSize, pz = -1.f + z * voxelSize;
+                    float ring = std::sqrt(px * px + py * py) - 0.6f;
+                    float wave = 0.05f * std::sin(12.f * std::atan2(py, px));
+                    values[(z * size + y) * size + x] = std::sqrt(ring * ring + pz * pz) - 0.25f - wave;
+                }
+            }
+        }
+    });
+
+    TriangleMesh mesh;
+    double seconds = measure(3, [&]{ mesh = extractIsoSurface(values.data(), size, size, size, Vec4f(-1.f, -1.f, -1.f), voxelSize); });
+    report("Marching cubes (" + std::to_string(size) + "^3, " + std::to_string(mesh.indices.size() / 3) + " triangles)",
+           values.size(), "voxels", seconds);
+}
+
+void benchmarkSparseVoxelOctree(double scale){
+    // Samples on the surface of a sphere, like a scan:
+    size_t count = size_t(10000000 * scale) + 1000;
+    std::vector<Vec4f> samples = createGaussianPoints(count, 16);
+    for(Vec4f& p : samples){
+        float inverse = 1.f / std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        p = Vec4f(p.x * inverse, p.y * inverse, p.z * inverse);
+    }
+
+    SparseVoxelOctree octree;
+    double seconds = measure(1, [&]{ octree = SparseVoxelOctree(samples.data(), count, 12); });
+    report("SVO build (depth 12, " + std::to_string(octree.getMemorySize() >> 20) + " MB)", count, "samples", seconds);
+
+    size_t found = 0;
+    seconds = measure(1, [&]{
+        found = 0;
+        for(size_t i=0; i < count; ++i)
+            found += octree.findNode(samples[i], 12) != SparseVoxelOctree::INVALID;
+    });
+    report("SVO point queries", found, "points", seconds);
+
+    // Rays from a sphere around the samples to random points inside:
+    size_t rayCount = size_t(1000000 * scale) + 1000;
+    std::vector<Vec4f> origins = createGaussianPoints(rayCount, 17), directions = createGaussianPoints(rayCount, 18);
+    for(size_t i=0; i < rayCount; ++i){
+        const Vec4f& o = origins[i];
+        float inverse = 3.f / std::sqrt(o.x * o.x + o.y * o.y + o.z * o.z);
+        origins[i] = Vec4f(o.x * inverse, o.y * inverse, o.z * inverse);
+        directions[i] = Vec4f(0.3f * directions[i].x - origins[i].x, 0.3f * directions[i].y - origins[i].y,
+                              0.3f * directions[i].z - origins[i].z, 0.f);
+    }
+    std::vector<uint32_t> nodes(rayCount);
+    std::vector<float> distances(rayCount);
+    seconds = measure(3, [&]{ octree.intersectRayBatch(origins.data(), directions.data(), rayCount, 1.f, 12,
+                                                       nodes.data(), distances.data()); });
+    report("SVO ray queries", rayCount, "rays", seconds);
+
+    std::vector<Vec4f> centers;
+    seconds = measure(3, [&]{ centers = octree.getNodeCenters(8); });
+    report("SVO level of detail (level 8)", centers.size(), "nodes", seconds);
+}
+
+void benchmarkDelaunay(double scale){
+    size_t count2D = size_t(2000000 * scale) + 1000, count3D = size_t(500000 * scale) + 1000;
+    std::vector<Vec4f> points2D = createGaussianPoints(count2D, 19), points3D = createGaussianPoints(count3D, 20);
+
+    DelaunaySettings serial;
+    serial.parallel = false;
+    DelaunayTriangulation triangulation;
+    double seconds = measure(1, [&]{ triangulation = computeDelaunay2D(points2D.data(), count2D, serial); });
+    report("Delaunay 2D serial (" + std::to_string(triangulation.getSimplexCount()) + " triangles)",
+           count2D, "points", seconds);
+    seconds = measure(1, [&]{ triangulation = computeDelaunay2D(points2D.data(), count2D); });
+    report("Delaunay 2D parallel", count2D, "points", seconds);
+
+    seconds = measure(1, [&]{ triangulation = computeDelaunay3D(points3D.data(), count3D, serial); });
+    report("Delaunay 3D serial (" + std::to_string(triangulation.getSimplexCount()) + " tetrahedra)",
+           count3D, "points", seconds);
+    seconds = measure(1, [&]{ triangulation = computeDelaunay3D(points3D.data(), count3D); });
+    report("Delaunay 3D parallel", count3D, "points", seconds);
+}
+
+void benchmarkPoissonDisk(double scale){
+    // The radii are chosen for about 1M samples at scale 1 (a sampling with
+    // 30 attempts per cell has about 0.6 samples per r^3 or 0.63 per r^2):
+    size_t count = size_t(1000000 * scale) + 1000;
+    std::vector<Vec4f> samples;
+    float radius = std::cbrt(0.6f / float(count));
+    double seconds = measure(1, [&]{ samples = samplePoissonDiskBox(AABB(Vec4f(0.f, 0.f, 0.f), Vec4f(1.f, 1.f, 1.f)), radius); });
+    report("Poisson-disk box", samples.size(), "samples", seconds);
+
+    // The area of the torus is about 4 pi^2 * 0.3:
+    TriangleMesh mesh = createTorusMesh(1000, 500);
+    radius = std::sqrt(0.63f * 11.84f / float(count));
+    seconds = measure(1, [&]{ samples = samplePoissonDiskSurface(mesh, radius); });
+    report("Poisson-disk surface (1M triangles)", samples.size(), "samples", seconds);
+
+    // The volume of the torus is about 2 pi^2 * 0.3^2:
+    SignedDistanceSettings settings;
+    settings.resolution = 128;
+    SignedDistanceField field = bakeSignedDistanceField(mesh, settings);
+    radius = std::cbrt(0.6f * 1.78f / float(count));
+    seconds = measure(1, [&]{ samples = samplePoissonDiskVolume(field, radius); });
+    report("Poisson-disk volume", samples.size(), "samples", seconds);
+}
+
+void benchmarkRandom(double scale){
+    size_t count = size_t(50000000 * scale) + 1000;
+    std::vector<float> values(count);
+    double seconds = measure(3, [&]{
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> uniform(0.f, 1.f);
+        for(float& value : values)
+            value = uniform(random);
+    });
+    report("random uniform (std::mt19937, serial)", count, "floats", seconds);
+    seconds = measure(3, [&]{ generateUniform(values.data(), count, 1); });
+    report("random uniform (xoshiro128** lanes)", count, "floats", seconds);
+
+    std::vector<Vec4f> vectors(count / 4);
+    seconds = measure(3, [&]{ generatePointsInSphere(vectors.data(), vectors.size(), 1); });
+    report("random points in sphere", vectors.size(), "points", seconds);
+    seconds = measure(3, [&]{ generatePointsInTriangle(vectors.data(), vectors.size(), Vec4f(0.f, 0.f, 0.f),
+                                                      Vec4f(1.f, 0.f, 0.f), Vec4f(0.f, 1.f, 0.f), 1); });
+    report("random points in triangle", vectors.size(), "points", seconds);
+    seconds = measure(3, [&]{ generateCosineHemisphere(vectors.data(), vectors.size(), Vec4f(0.f, 0.f, 1.f, 0.f), 1); });
+    report("random cosine hemisphere", vectors.size(), "directions", seconds);
+}
+
+void benchmarkNBody(double scale){
+    // A uniform sphere of unit mass:
+    size_t count = size_t(1000000 * scale) + 1000;
+    std::vector<Vec4f> bodies(count), velocities(count, Vec4f(0.f, 0.f, 0.f, 0.f)), accelerations(count);
+    generatePointsInSphere(bodies.data(), count, 1);
+    for(Vec4f& body : bodies)
+        body.w = 1.f / float(count);
+
+    computeGravity(bodies.data(), count, accelerations.data());
+    double seconds = measure(3, [&]{
+        stepLeapfrog(bodies.data(), velocities.data(), accelerations.data(), count, 0.001f);
+    });
+    report("n-body leapfrog step (Barnes-Hut)", count, "bodies", seconds);
+
+    size_t directCount = size_t(20000 * scale) + 1000;
+    seconds = measure(3, [&]{ computeGravityDirect(bodies.data(), directCount, accelerations.data()); });
+    report("n-body gravity (direct sum)", directCount, "bodies", seconds);
+}
+
+void benchmarkSph(double scale){
+    // A block of water in the corner of the unit box (a dam break), with the
+    // particle spacing chosen for the particle count:
+    const size_t counts[3] = {100000, 1000000, 10000000};
+    for(size_t c=0; c < 3; ++c){
+        size_t target = size_t(counts[c] * scale) + 1000;
+        float spacing = std::cbrt(0.5f * 0.8f * 0.5f / float(target));
+        std::vector<Vec4f> positions, velocities;
+        for(float z=0.5f * spacing; z < 0.5f; z += spacing)
+            for(float y=0.5f * spacing; y < 0.8f; y += spacing)
+                for(float x=0.5f * spacing; x < 0.5f; x += spacing)
+                    positions.push_back(Vec4f(x, y, z));
+        velocities.resize(positions.size(), Vec4f(0.f, 0.f, 0.f, 0.f));
+
+        SphSettings settings;
+        settings.smoothingLength = 2.f * spacing;
+        settings.particleMass = settings.restDensity * spacing * spacing * spacing;
+        SphSolver solver(settings);
+        float timeStep = solver.getMaximumTimeStep();
+        double seconds = measure(3, [&]{
+            solver.step(positions.data(), velocities.data(), positions.size(), timeStep);
+        });
+        report("sph step (WCSPH, cell-linked list)", positions.size(), "particles", seconds);
+    }
+}
+
+void benchmarkXpbd(double scale){
+    // A batch of square garments of 64 x 64 particles side by side, pinned at
+    // two corners and falling onto a floor, simulated by one solver:
+    const size_t size = 64;
+    size_t garments = size_t(256 * scale) + 1;
+    std::vector<Vec4f> positions, velocities;
+    std::vector<uint32_t> indices;
+    for(size_t g=0; g < garments; ++g){
+        uint32_t base = uint32_t(positions.size());
+        for(size_t j=0; j < size; ++j)
+            for(size_t i=0; i < size; ++i)
+                positions.push_back(Vec4f(1.5f * float(g) + float(i) / float(size - 1), 1.f,
+                                          float(j) / float(size - 1), i == 0 && (j == 0 || j == size - 1) ? 0.f : 1.f));
+        for(uint32_t j=0; j + 1 < size; ++j){
+            for(uint32_t i=0; i + 1 < size; ++i){
+                uint32_t a = base + j * uint32_t(size) + i, b = a + 1, c = a + uint32_t(size), d = c + 1;
+                uint32_t quad[6] = {a, b, d, a, d, c};
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+    }
+    velocities.resize(positions.size(), Vec4f(0.f, 0.f, 0.f, 0.f));
+
+    XpbdSolver solver;
+    solver.addCloth(positions.data(), indices.data(), indices.size() / 3, 0.f, 0.01f);
+    solver.addCollisionPlane(Vec4f(0.f, 1.f, 0.f, 0.f), 0.f);
+    solver.step(positions.data(), velocities.data(), positions.size(), 1.f / 60.f);
+    double seconds = measure(3, [&]{
+        solver.step(positions.data(), velocities.data(), positions.size(), 1.f / 60.f);
+    });
+    report("xpbd cloth step (10 substeps, colored)", positions.size(), "particles", seconds);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int threads = argc > 1 ? (unsigned int)atoi(argv[1]) : 0;
+    double scale = argc > 2 ? atof(argv[2]) : 1.0;
+
+    setThreadCount(threads);
+    printf("Running benchmarks with %u threads (scale %.2f)\n\n", getThreadCount(), scale);
+
+    benchmarkConvexHull(scale);
+    benchmarkSvd(scale);
+    benchmarkSimplification(scale);
+    benchmarkMeshOptimization(scale);
+    benchmarkNormals(scale);
+    benchmarkSubdivision(scale);
+    benchmarkConjugateGradient(scale);
+    benchmarkMatrixMultiplication(scale);
+    benchmarkDenseSolvers(scale);
+    benchmarkPoseEstimation(scale);
+    benchmarkIcp(scale);
+    benchmarkPointCloudNormals(scale);
+    benchmarkKMeans(scale);
+    benchmarkSignedDistanceField(scale);
+    benchmarkMarchingCubes(scale);
+    benchmarkSparseVoxelOctree(scale);
+    benchmarkDelaunay(scale);
+    benchmarkPoissonDisk(scale);
+    benchmarkRandom(scale);
+    benchmarkNBody(scale);
+    benchmarkSph(scale);
+    benchmarkXpbd(scale);
+
+    return 0;
+}
@@ -0,0 +1,371 @@
+#include "BoundingVolumes.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+#include "../math/SymmetricEigen.h"
+
+#include <stdexcept>
+
+namespace {
+
+/* Result of a farthest point search: */
+struct FarthestPoint {
+    size_t index;
+    float squaredDistance;
+};
+
+/**
+ * Returns the point which has the largest distance to the given center. If
+ * several points have the same distance, the one with the smallest index is
+ * returned (so the result does not depend on the number of threads).
+ */
+FarthestPoint findFarthestPoint(const Vec4f* points, size_t count, const Vec4f center){
+    FarthestPoint none = {0, -1.f};
+
+    return parallelReduce(size_t(0), count, REDUCTION_GRAIN_SIZE, none,
+        [&](size_t begin, size_t end){
+            float laneDistance[REDUCTION_LANES];
+            size_t laneIndex[REDUCTION_LANES];
+            for(int l=0; l < REDUCTION_LANES; ++l){
+                laneDistance[l] = -1.f;
+                laneIndex[l] = begin;
+            }
+
+            for(size_t i=begin; i < end; i += REDUCTION_LANES){
+                int lanes = end - i < REDUCTION_LANES ? int(end - i) : REDUCTION_LANES;
+                for(int l=0; l < lanes; ++l){
+                    float dx = points[i + l].x - center.x;
+                    float dy = points[i + l].y - center.y;
+                    float dz = points[i + l].z - center.z;
+                    float d = dx * dx + dy * dy + dz * dz;
+
+                    if(d > laneDistance[l]){
+                        laneDistance[l] = d;
+                        laneIndex[l] = i + l;
+                    }
+                }
+            }
+
+            FarthestPoint chunk = none;
+            for(int l=0; l < REDUCTION_LANES; ++l){
+                if(laneDistance[l] > chunk.squaredDistance
+                   || (laneDistance[l] == chunk.squaredDistance && laneIndex[l] < chunk.index)){
+                    chunk.squaredDistance = laneDistance[l];
+                    chunk.index = laneIndex[l];
+                }
+            }
+            return chunk;
+        },
+        [](const FarthestPoint& a, const FarthestPoint& b){
+            // 'a' always belongs to smaller indices than 'b':
+            return b.squaredDistance > a.squaredDistance ? b : a;
+        });
+}
+
+/* A point in double precision (used for the small support sets): */
+struct Point3d {
+    double x, y, z;
+};
+
+/* A sphere in double precision: */
+struct Sphere3d {
+    Point3d center;
+    double squaredRadius;
+};
+
+/**
+ * Computes the smallest sphere which passes through all of the given 1 to 4
+ * points. Returns false if the points are degenerate (collinear or coplanar).
+ */
+bool computeCircumsphere(const Point3d* p, int n, Sphere3d& sphere){
+    if(n == 1){
+        sphere.center = p[0];
+        sphere.squaredRadius = 0.0;
+        return true;
+    }
+
+    // Vectors from the first point to all other points:
+    double a[3] = {p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z};
+    double aa = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+    double offset[3];
+
+    if(n == 2){
+        offset[0] = a[0] * 0.5; offset[1] = a[1] * 0.5; offset[2] = a[2] * 0.5;
+    } else {
+        double b[3] = {p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z};
+        double bb = b[0] * b[0] + b[1] * b[1] + b[2] * b[2];
+        double axb[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+        double axbLength2 = axb[0] * axb[0] + axb[1] * axb[1] + axb[2] * axb[2];
+
+        if(n == 3){
+            // The points are collinear if the triangle has no area:
+            if(axbLength2 <= 1e-24 * aa * bb)
+                return false;
+
+            // offset = ((|a|^2 * b - |b|^2 * a) x (a x b)) / (2 * |a x b|^2)
+            double t[3] = {aa * b[0] - bb * a[0], aa * b[1] - bb * a[1], aa * b[2] - bb * a[2]};
+            offset[0] = (t[1] * axb[2] - t[2] * axb[1]) / (2.0 * axbLength2);
+            offset[1] = (t[2] * axb[0] - t[0] * axb[2]) / (2.0 * axbLength2);
+            offset[2] = (t[0] * axb[1] - t[1] * axb[0]) / (2.0 * axbLength2);
+        } else {
+            double c[3] = {p[3].x - p[0].x, p[3].y - p[0].y, p[3].z - p[0].z};
+            double cc = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+            double bxc[3] = {b[1] * c[2] - b[2] * c[1], b[2] * c[0] - b[0] * c[2], b[0] * c[1] - b[1] * c[0]};
+            double cxa[3] = {c[1] * a[2] - c[2] * a[1], c[2] * a[0] - c[0] * a[2], c[0] * a[1] - c[1] * a[0]};
+            double volume = a[0] * bxc[0] + a[1] * bxc[1] + a[2] * bxc[2];
+
+            // The points are coplanar if the tetrahedron has no volume:
+            double scale = std::sqrt(aa * bb * cc);
+            if(std::fabs(volume) <= 1e-12 * scale)
+                return false;
+
+            // offset = (|a|^2 (b x c) + |b|^2 (c x a) + |c|^2 (a x b)) / (2 a.(b x c))
+            for(int k=0; k < 3; ++k)
+                offset[k] = (aa * bxc[k] + bb * cxa[k] + cc * axb[k]) / (2.0 * volume);
+        }
+    }
+
+    sphere.center.x = p[0].x + offset[0];
+    sphere.center.y = p[0].y + offset[1];
+    sphere.center.z = p[0].z + offset[2];
+    sphere.squaredRadius = offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2];
+    return true;
+}
+
+/**
+ * Computes the minimal sphere of at most five points by testing the
+ * circumspheres of all subsets with one to four points (which is exactly
+ * what Welzl's recursion boils down to for such tiny sets). The points which
+ * define the resulting sphere are moved to the front of 'points' and their
+ * number is returned.
+ */
+int computeSmallMinimalSphere(Point3d* points, int n, Sphere3d& result){
+    int bestSubset = 0;
+    result.squaredRadius = -1.0;
+
+    for(int subset=1; subset < (1 << n); ++subset){
+        Point3d boundary[4];
+        int boundaryCount = 0;
+        for(int i=0; i < n; ++i){
+            if(subset & (1 << i)){
+                if(boundaryCount == 4){
+                    boundaryCount = 5;
+                    break;
+                }
+                boundary[boundaryCount++] = points[i];
+            }
+        }
+
+        Sphere3d sphere;
+        if(boundaryCount > 4 || !computeCircumsphere(boundary, boundaryCount, sphere))
+            continue;
+
+        if(result.squaredRadius >= 0.0 && sphere.squaredRadius >= result.squaredRadius)
+            continue;
+
+        // Only accept spheres which contain all points (with a small tolerance):
+        bool containsAll = true;
+        for(int i=0; i < n && containsAll; ++i){
+            double dx = points[i].x - sphere.center.x;
+            double dy = points[i].y - sphere.center.y;
+            double dz = points[i].z - sphere.center.z;
+            containsAll = dx * dx + dy * dy + dz * dz <= sphere.squaredRadius * (1.0 + 1e-9) + 1e-18;
+        }
+
+        if(containsAll){
+            result = sphere;
+            bestSubset = subset;
+        }
+    }
+
+    // Move the support points to the front:
+    int supportCount = 0;
+    for(int i=0; i < n; ++i){
+        if(bestSubset & (1 << i))
+            points[supportCount++] = points[i];
+    }
+    return supportCount;
+}
+
+}
+
+BoundingSphere::BoundingSphere()
+    : center(0.f, 0.f, 0.f, 1.f), radius(0.f){}
+
+BoundingSphere::BoundingSphere(const Vec4f pCenter, float pRadius)
+    : center(pCenter.x, pCenter.y, pCenter.z, 1.f), radius(pRadius){}
+
+bool BoundingSphere::contains(const Vec4f p) const{
+    float dx = p.x - center.x;
+    float dy = p.y - center.y;
+    float dz = p.z - center.z;
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+BoundingSphere computeRitterSphere(const Vec4f* points, size_t count){
+    if(count == 0)
+        throw std::invalid_argument("The bounding sphere of zero points is undefined!");
+
+    // Find two distant points: y is the farthest point from an arbitrary
+    // point and z is the farthest point from y:
+    const Vec4f& y = points[findFarthestPoint(points, count, points[0]).index];
+    const Vec4f& z = points[findFarthestPoint(points, count, y).index];
+
+    Vec4f center((y.x + z.x) * 0.5f, (y.y + z.y) * 0.5f, (y.z + z.z) * 0.5f, 1.f);
+    float dx = z.x - y.x, dy = z.y - y.y, dz = z.z - y.z;
+    float radius = std::sqrt(dx * dx + dy * dy + dz * dz) * 0.5f;
+
+    // Grow the sphere towards the farthest outside point until all points are
+    // inside. Instead of growing it in one sequential pass over all points,
+    // each step grows it by the farthest point, which is found in parallel:
+    for(int iteration=0; iteration < 64; ++iteration){
+        FarthestPoint farthest = findFarthestPoint(points, count, center);
+        float distance = std::sqrt(farthest.squaredDistance);
+
+        if(distance <= radius)
+            break;
+
+        // The new sphere touches the old sphere on the opposite side and
+        // passes through the farthest point:
+        const Vec4f& p = points[farthest.index];
+        float newRadius = (radius + distance) * 0.5f;
+        float shift = (newRadius - radius) / distance;
+        center = Vec4f(center.x + (p.x - center.x) * shift,
+                       center.y + (p.y - center.y) * shift,
+                       center.z + (p.z - center.z) * shift, 1.f);
+        radius = newRadius;
+    }
+
+    // Make sure that rounding errors never leave a point outside:
+    float maxDistance = std::sqrt(findFarthestPoint(points, count, center).squaredDistance);
+    return BoundingSphere(center, std::fmax(radius, maxDistance));
+}
+
+BoundingSphere computeMinimalSphere(const Vec4f* points, size_t count){
+    if(count == 0)
+        throw std::invalid_argument("The bounding sphere of zero points is undefined!");
+
+    // Start with two distant points as support set:
+    Point3d support[5];
+    size_t first = findFarthestPoint(points, count, points[0]).index;
+    size_t second = findFarthestPoint(points, count, points[first]).index;
+    support[0].x = points[first].x; support[0].y = points[first].y; support[0].z = points[first].z;
+    support[1].x = points[second].x; support[1].y = points[second].y; support[1].z = points[second].z;
+
+    Sphere3d sphere = {{0.0, 0.0, 0.0}, 0.0};
+    int supportCount = computeSmallMinimalSphere(support, 2, sphere);
+
+    // Pivoting: add the farthest point to the support set until no point is
+    // outside anymore. The radius grows strictly in every step, so this
+    // terminates after a few iterations:
+    for(int iteration=0; iteration < 1000; ++iteration){
+        Vec4f center(float(sphere.center.x), float(sphere.center.y), float(sphere.center.z), 1.f);
+        FarthestPoint farthest = findFarthestPoint(points, count, center);
+
+        // Recompute the distance of the candidate in double precision:
+        const Vec4f& p = points[farthest.index];
+        double dx = p.x - sphere.center.x, dy = p.y - sphere.center.y, dz = p.z - sphere.center.z;
+        if(dx * dx + dy * dy + dz * dz <= sphere.squaredRadius * (1.0 + 1e-6))
+            break;
+
+        double previousSquaredRadius = sphere.squaredRadius;
+        support[supportCount].x = p.x; support[supportCount].y = p.y; support[supportCount].z = p.z;
+        supportCount = computeSmallMinimalSphere(support, supportCount + 1, sphere);
+
+        // Stop if rounding errors prevent any further progress:
+        if(sphere.squaredRadius <= previousSquaredRadius)
+            break;
+    }
+
+    // Make sure that rounding errors never leave a point outside:
+    Vec4f center(float(sphere.center.x), float(sphere.center.y), float(sphere.center.z), 1.f);
+    float maxDistance = std::sqrt(findFarthestPoint(points, count, center).squaredDistance);
+    return BoundingSphere(center, std::fmax(float(std::sqrt(sphere.squaredRadius)), maxDistance));
+}
+
+OrientedBoundingBox computePCABoundingBox(const Vec4f* points, size_t count){
+    if(count == 0)
+        throw std::invalid_argument("The bounding box of zero points is undefined!");
+
+    // The principal axes are the eigenvectors of the covariance matrix:
+    Vec4f mean = computeCentroid(points, count);
+    Vec4f eigenvalues;
+    Mat4f axes;
+    computeSymmetricEigen(computeCovariance(points, count, mean), eigenvalues, axes);
+
+    // Project all points onto the axes (relative to the mean) and find the
+    // smallest and largest coordinate along each axis:
+    struct Interval { float min[3]; float max[3]; };
+    Interval empty = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+
+    Interval bounds = parallelReduce(size_t(0), count, REDUCTION_GRAIN_SIZE, empty,
+        [&](size_t begin, size_t end){
+            Interval chunk = empty;
+            for(size_t i=begin; i < end; ++i){
+                float dx = points[i].x - mean.x;
+                float dy = points[i].y - mean.y;
+                float dz = points[i].z - mean.z;
+
+                for(int a=0; a < 3; ++a){
+                    float t = dx * axes.data[a * 4] + dy * axes.data[a * 4 + 1] + dz * axes.data[a * 4 + 2];
+                    chunk.min[a] = std::fmin(chunk.min[a], t);
+                    chunk.max[a] = std::fmax(chunk.max[a], t);
+                }
+            }
+            return chunk;
+        },
+        [](const Interval& a, const Interval& b){
+            Interval combined;
+            for(int k=0; k < 3; ++k){
+                combined.min[k] = std::fmin(a.min[k], b.min[k]);
+                combined.max[k] = std::fmax(a.max[k], b.max[k]);
+            }
+            return combined;
+        });
+
+    // The center of the box lies in the middle of each interval:
+    float center[3] = {mean.x, mean.y, mean.z};
+    for(int a=0; a < 3; ++a){
+        float mid = (bounds.min[a] + bounds.max[a]) * 0.5f;
+        for(int k=0; k < 3; ++k)
+            center[k] += axes.data[a * 4 + k] * mid;
+    }
+
+    OrientedBoundingBox box;
+    box.frame = Mat4f(Vec4f(axes.data[0], axes.data[1], axes.data[2], 0.f),
+                      Vec4f(axes.data[4], axes.data[5], axes.data[6], 0.f),
+                      Vec4f(axes.data[8], axes.data[9], axes.data[10], 0.f),
+                      Vec4f(center[0], center[1], center[2], 1.f));
+    box.extents = Vec4f((bounds.max[0] - bounds.min[0]) * 0.5f,
+                        (bounds.max[1] - bounds.min[1]) * 0.5f,
+                        (bounds.max[2] - bounds.min[2]) * 0.5f, 0.f);
+    return box;
+}
+
+AABB transformAABB(const Mat4f& m, const AABB& box){
+    if(box.isEmpty())
+        return AABB();
+
+    // Start with the translation and add the smaller (or larger) of the two
+    // products m_ij * min_j and m_ij * max_j for every cell of the 3x3 block:
+    float resultMin[3] = {m.data[12], m.data[13], m.data[14]};
+    float resultMax[3] = {m.data[12], m.data[13], m.data[14]};
+
+    for(int col=0; col < 3; ++col){
+        for(int row=0; row < 3; ++row){
+            float a = m.data[col * 4 + row] * box.min[col];
+            float b = m.data[col * 4 + row] * box.max[col];
+            resultMin[row] += std::fmin(a, b);
+            resultMax[row] += std::fmax(a, b);
+        }
+    }
+
+    return AABB(Vec4f(resultMin[0], resultMin[1], resultMin[2]),
+                Vec4f(resultMax[0], resultMax[1], resultMax[2]));
+}
+
+void transformAABBs(const Mat4f& matrix, const AABB* boxes, AABB* result, size_t count){
+    parallelFor(0, count, REDUCTION_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i)
+            result[i] = transformAABB(matrix, boxes[i]);
+    });
+}
@@ -0,0 +1,109 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our math classes: */
+#include "../math/Vec4f.h"
+#include "../math/Mat4f.h"
+#include "../math/AABB.h"
+
+/**
+ * A sphere which is defined by its center (a point, w = 1) and its radius.
+ */
+
+class BoundingSphere
+{
+public:
+    /** The center of the sphere */
+    Vec4f center;
+
+    /** The radius of the sphere */
+    float radius;
+
+    /**
+     * Constructs a sphere with radius 0 at (0,0,0).
+     */
+    BoundingSphere();
+
+    /**
+     * Constructs a sphere with the given center and radius.
+     */
+    BoundingSphere(const Vec4f center, float radius);
+
+    /**
+     * Returns whether the given point lies inside of this sphere (points on
+     * the surface are inside).
+     */
+    bool contains(const Vec4f point) const;
+};
+
+/**
+ * An oriented bounding box (OBB).
+ *
+ * The first three columns of 'frame' are the (normalized) axes of the box and
+ * the fourth column is its center, so 'frame' transforms the local coordinates
+ * of the box into world coordinates. The box covers the local coordinates in
+ * [-extents.x, extents.x] x [-extents.y, extents.y] x [-extents.z, extents.z].
+ */
+
+class OrientedBoundingBox
+{
+public:
+    /** Transformation from local box coordinates into world coordinates */
+    Mat4f frame;
+
+    /** Half size of the box along each of its axes (w = 0) */
+    Vec4f extents;
+};
+
+/**
+ * Computes a bounding sphere of the given points with Ritter's method: the
+ * initial sphere is spanned by two distant points, afterwards it is grown
+ * until it contains every point.
+ *
+ * The sphere is usually 5-20% larger than the minimal one, but it only needs
+ * a few parallel passes over the points. Throws std::invalid_argument if
+ * count == 0.
+ */
+BoundingSphere computeRitterSphere(const Vec4f* points, size_t count);
+
+/**
+ * Computes the minimal bounding sphere of the given points.
+ *
+ * Welzl's algorithm is only applied to a tiny support set (at most five
+ * points). The support set is updated by pivoting: the point which is
+ * farthest away from the current sphere is searched in parallel and added
+ * to the support set, until no point lies outside anymore. Therefore the
+ * large point set is only touched by parallel, vectorized distance scans.
+ *
+ * Throws std::invalid_argument if count == 0.
+ */
+BoundingSphere computeMinimalSphere(const Vec4f* points, size_t count);
+
+/**
+ * Computes an oriented bounding box of the given points, whose axes are the
+ * principal axes of the point set (the eigenvectors of its covariance matrix,
+ * sorted by decreasing variance).
+ *
+ * Throws std::invalid_argument if count == 0.
+ */
+OrientedBoundingBox computePCABoundingBox(const Vec4f* points, size_t count);
+
+/**
+ * Returns the axis aligned bounding box of the given box after transforming
+ * it with the given (affine) matrix, using Arvo's method. This is exact for
+ * the transformed corners, but needs no corner transformations at all.
+ */
+AABB transformAABB(const Mat4f& matrix, const AABB& box);
+
+/**
+ * Transforms all given boxes with transformAABB(...) in parallel and stores
+ * the results in 'result' (which has to provide space for 'count' boxes and
+ * may be the same array as 'boxes').
+ */
+void transformAABBs(const Mat4f& matrix, const AABB* boxes, AABB* result, size_t count);
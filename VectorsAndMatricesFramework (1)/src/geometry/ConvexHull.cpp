@@ -0,0 +1,468 @@
+#include "ConvexHull.h"
+#include "../math/Parallel.h"
+#include "../math/Predicates.h"
+#include "../math/Reductions.h"
+
+#include <utility>
+
+namespace {
+
+/* The number of point indices which are stored in one conflict block: */
+const uint32_t CONFLICT_BLOCK_SIZE = 30;
+
+/* Conflict lists with more points than this are reassigned in parallel: */
+const size_t PARALLEL_REASSIGN_THRESHOLD = 16384;
+
+/* The number of points which are classified by one task: */
+const size_t CLASSIFY_GRAIN_SIZE = 8192;
+
+/**
+ * A block of a conflict list. The conflict list of a face is a linked list
+ * of such blocks, and all blocks live in one ConflictPool.
+ */
+struct ConflictBlock {
+    uint32_t points[CONFLICT_BLOCK_SIZE];
+    uint32_t count;
+    int next;
+};
+
+/**
+ * Stores the conflict lists of all faces. Blocks of deleted faces are put into
+ * a free list and reused, so after the first iterations no more memory is
+ * allocated.
+ */
+class ConflictPool
+{
+public:
+    ConflictPool() : freeList(-1){}
+
+    /* Adds the point to the list which starts at block 'head': */
+    void push(int& head, uint32_t point){
+        if(head < 0 || blocks[head].count == CONFLICT_BLOCK_SIZE){
+            int block = allocate();
+            blocks[block].next = head;
+            head = block;
+        }
+        blocks[head].points[blocks[head].count++] = point;
+    }
+
+    /* Appends all points of the list to 'result' and releases its blocks: */
+    void take(int& head, std::vector<uint32_t>& result){
+        while(head >= 0){
+            ConflictBlock& block = blocks[head];
+            result.insert(result.end(), block.points, block.points + block.count);
+
+            int next = block.next;
+            block.next = freeList;
+            freeList = head;
+            head = next;
+        }
+    }
+
+private:
+    int allocate(){
+        if(freeList >= 0){
+            int block = freeList;
+            freeList = blocks[block].next;
+            blocks[block].count = 0;
+            blocks[block].next = -1;
+            return block;
+        }
+
+        ConflictBlock block;
+        block.count = 0;
+        block.next = -1;
+        blocks.push_back(block);
+        return int(blocks.size()) - 1;
+    }
+
+    std::vector<ConflictBlock> blocks;
+    int freeList;
+};
+
+/**
+ * A triangle of the hull. Edge i goes from v[i] to v[(i+1)%3] and neighbor[i]
+ * is the face on the other side of this edge.
+ */
+struct Face {
+    uint32_t v[3];
+    int neighbor[3];
+
+    /* Unnormalized plane (n.p - offset), only used to find the farthest point: */
+    double normal[3];
+    double offset;
+
+    /* First block of the conflict list and its farthest point: */
+    int conflicts;
+    uint32_t farthestPoint;
+    double farthestDistance;
+
+    bool alive;
+    bool visible;
+    unsigned int visitIteration;
+};
+
+class QuickHull
+{
+public:
+    QuickHull(const Vec4f* pPoints, size_t pCount)
+        : points(pPoints), count(pCount), iteration(0){}
+
+    bool build(){
+        if(!createInitialTetrahedron())
+            return false;
+
+        horizonStart.assign(count, -1);
+
+        // Process faces until no face has points in front of it:
+        while(!pending.empty()){
+            int faceIndex = pending.back();
+            pending.pop_back();
+
+            if(faces[faceIndex].alive && faces[faceIndex].conflicts >= 0)
+                addPoint(faceIndex);
+        }
+        return true;
+    }
+
+    TriangleMesh createMesh(std::vector<uint32_t>* hullPointIndices) const{
+        TriangleMesh mesh;
+        std::vector<uint32_t> remap(count, UINT32_MAX);
+        std::vector<uint32_t> usedPoints;
+
+        for(const Face& face : faces){
+            if(!face.alive)
+                continue;
+
+            for(int k=0; k < 3; ++k){
+                // Assign mesh vertex indices in order of first use:
+                if(remap[face.v[k]] == UINT32_MAX){
+                    remap[face.v[k]] = uint32_t(usedPoints.size());
+                    usedPoints.push_back(face.v[k]);
+                    mesh.positions.push_back(Vec4f(points[face.v[k]].x, points[face.v[k]].y, points[face.v[k]].z, 1.f));
+                }
+                mesh.indices.push_back(remap[face.v[k]]);
+            }
+        }
+
+        if(hullPointIndices)
+            *hullPointIndices = usedPoints;
+
+        return mesh;
+    }
+
+private:
+    /* Returns whether the point lies strictly in front of (outside) the face: */
+    bool isInFront(const Face& face, uint32_t point) const{
+        return orient3d(points[face.v[0]], points[face.v[1]], points[face.v[2]], points[point]) < 0.0;
+    }
+
+    /* Returns the (unnormalized) distance of the point to the plane of the face: */
+    double getDistance(const Face& face, uint32_t point) const{
+        const Vec4f& p = points[point];
+        return face.normal[0] * p.x + face.normal[1] * p.y + face.normal[2] * p.z - face.offset;
+    }
+
+    int createFace(uint32_t a, uint32_t b, uint32_t c){
+        Face face;
+        face.v[0] = a; face.v[1] = b; face.v[2] = c;
+        face.neighbor[0] = face.neighbor[1] = face.neighbor[2] = -1;
+
+        const Vec4f& pa = points[a];
+        const Vec4f& pb = points[b];
+        const Vec4f& pc = points[c];
+        double ab[3] = {double(pb.x) - pa.x, double(pb.y) - pa.y, double(pb.z) - pa.z};
+        double ac[3] = {double(pc.x) - pa.x, double(pc.y) - pa.y, double(pc.z) - pa.z};
+        face.normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+        face.normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+        face.normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+        face.offset = face.normal[0] * pa.x + face.normal[1] * pa.y + face.normal[2] * pa.z;
+
+        face.conflicts = -1;
+        face.farthestPoint = 0;
+        face.farthestDistance = -HUGE_VAL;
+        face.alive = true;
+        face.visible = false;
+        face.visitIteration = 0;
+
+        // Reuse the slot of a deleted face if possible:
+        if(!freeFaces.empty()){
+            int index = freeFaces.back();
+            freeFaces.pop_back();
+            faces[index] = face;
+            return index;
+        }
+
+        faces.push_back(face);
+        return int(faces.size()) - 1;
+    }
+
+    void addConflict(int faceIndex, uint32_t point){
+        Face& face = faces[faceIndex];
+        pool.push(face.conflicts, point);
+
+        double distance = getDistance(face, point);
+        if(distance > face.farthestDistance){
+            face.farthestDistance = distance;
+            face.farthestPoint = point;
+        }
+    }
+
+    /**
+     * Assigns every given point to the first of the given faces it lies in
+     * front of. Points which are behind all faces are inside of the hull and
+     * are dropped. The classification runs in parallel for large lists.
+     */
+    void assignPoints(const uint32_t* candidates, size_t candidateCount, const std::vector<int>& newFaces, uint32_t skipPoint){
+        std::vector<int> assignment(candidateCount);
+
+        auto classify = [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i){
+                assignment[i] = -1;
+                if(candidates[i] == skipPoint)
+                    continue;
+
+                for(size_t f=0; f < newFaces.size(); ++f){
+                    if(isInFront(faces[newFaces[f]], candidates[i])){
+                        assignment[i] = newFaces[f];
+                        break;
+                    }
+                }
+            }
+        };
+
+        if(candidateCount >= PARALLEL_REASSIGN_THRESHOLD)
+            parallelFor(0, candidateCount, CLASSIFY_GRAIN_SIZE, classify);
+        else
+            classify(0, candidateCount);
+
+        // Append the points in their original order, so that the result does
+        // not depend on the number of threads:
+        for(size_t i=0; i < candidateCount; ++i){
+            if(assignment[i] >= 0)
+                addConflict(assignment[i], candidates[i]);
+        }
+
+        for(size_t f=0; f < newFaces.size(); ++f){
+            if(faces[newFaces[f]].conflicts >= 0)
+                pending.push_back(newFaces[f]);
+        }
+    }
+
+    /**
+     * Returns the index of the point with the highest score. If several points
+     * have the same score, the one with the smallest index is returned.
+     */
+    template<typename Score>
+    std::pair<double, size_t> findBestPoint(const Score& score) const{
+        std::pair<double, size_t> none(-HUGE_VAL, 0);
+
+        return parallelReduce(size_t(0), count, REDUCTION_GRAIN_SIZE, none,
+            [&](size_t begin, size_t end){
+                std::pair<double, size_t> best = none;
+                for(size_t i=begin; i < end; ++i){
+                    double s = score(points[i]);
+                    if(s > best.first){
+                        best.first = s;
+                        best.second = i;
+                    }
+                }
+                return best;
+            },
+            [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b){
+                return b.first > a.first ? b : a;
+            });
+    }
+
+    bool createInitialTetrahedron(){
+        if(count < 4)
+            return false;
+
+        // The first two points are the extreme points of the axis along which
+        // the points are spread the most:
+        size_t extremes[6];
+        for(int axis=0; axis < 3; ++axis){
+            extremes[2 * axis] = findBestPoint([&](const Vec4f& p){ return -double(p[axis]); }).second;
+            extremes[2 * axis + 1] = findBestPoint([&](const Vec4f& p){ return double(p[axis]); }).second;
+        }
+
+        size_t i0 = 0, i1 = 0;
+        double bestSpread = 0.0;
+        for(int axis=0; axis < 3; ++axis){
+            double spread = double(points[extremes[2 * axis + 1]][axis]) - points[extremes[2 * axis]][axis];
+            if(spread > bestSpread){
+                bestSpread = spread;
+                i0 = extremes[2 * axis];
+                i1 = extremes[2 * axis + 1];
+            }
+        }
+
+        // All points are equal:
+        if(bestSpread <= 0.0)
+            return false;
+
+        // The third point is the farthest one from the line through i0 and i1:
+        const Vec4f p0 = points[i0], p1 = points[i1];
+        double d[3] = {double(p1.x) - p0.x, double(p1.y) - p0.y, double(p1.z) - p0.z};
+        std::pair<double, size_t> third = findBestPoint([&](const Vec4f& p){
+            double e[3] = {double(p.x) - p0.x, double(p.y) - p0.y, double(p.z) - p0.z};
+            double c[3] = {d[1] * e[2] - d[2] * e[1], d[2] * e[0] - d[0] * e[2], d[0] * e[1] - d[1] * e[0]};
+            return c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+        });
+
+        // All points are collinear:
+        if(third.first <= 0.0)
+            return false;
+
+        size_t i2 = third.second;
+
+        // The fourth point is the farthest one from the plane through i0, i1 and i2:
+        const Vec4f p2 = points[i2];
+        double e[3] = {double(p2.x) - p0.x, double(p2.y) - p0.y, double(p2.z) - p0.z};
+        double n[3] = {d[1] * e[2] - d[2] * e[1], d[2] * e[0] - d[0] * e[2], d[0] * e[1] - d[1] * e[0]};
+        size_t i3 = findBestPoint([&](const Vec4f& p){
+            return std::fabs(n[0] * (double(p.x) - p0.x) + n[1] * (double(p.y) - p0.y) + n[2] * (double(p.z) - p0.z));
+        }).second;
+
+        // All points are coplanar:
+        double orientation = orient3d(points[i0], points[i1], points[i2], points[i3]);
+        if(orientation == 0.0)
+            return false;
+
+        // Order the base triangle so that i3 lies behind it:
+        if(orientation < 0.0){
+            size_t tmp = i1;
+            i1 = i2;
+            i2 = tmp;
+        }
+
+        uint32_t v[4] = {uint32_t(i0), uint32_t(i1), uint32_t(i2), uint32_t(i3)};
+        std::vector<int> initialFaces;
+        initialFaces.push_back(createFace(v[0], v[1], v[2]));
+        initialFaces.push_back(createFace(v[0], v[3], v[1]));
+        initialFaces.push_back(createFace(v[1], v[3], v[2]));
+        initialFaces.push_back(createFace(v[2], v[3], v[0]));
+
+        // Connect the faces (edge a->b of one face is edge b->a of its neighbor):
+        for(int f : initialFaces){
+            for(int k=0; k < 3; ++k){
+                uint32_t a = faces[f].v[k], b = faces[f].v[(k + 1) % 3];
+                for(int g : initialFaces){
+                    for(int l=0; l < 3; ++l){
+                        if(faces[g].v[l] == b && faces[g].v[(l + 1) % 3] == a)
+                            faces[f].neighbor[k] = g;
+                    }
+                }
+            }
+        }
+
+        // Distribute all points among the four faces in parallel:
+        std::vector<uint32_t> all(count);
+        parallelFor(0, count, CLASSIFY_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i)
+                all[i] = uint32_t(i);
+        });
+        assignPoints(all.data(), count, initialFaces, UINT32_MAX);
+        return true;
+    }
+
+    void addPoint(int startFace){
+        uint32_t eye = faces[startFace].farthestPoint;
+        ++iteration;
+
+        // Find all faces which are visible from the eye point:
+        std::vector<int> visibleFaces;
+        std::vector<int> stack(1, startFace);
+        faces[startFace].visitIteration = iteration;
+        faces[startFace].visible = true;
+
+        while(!stack.empty()){
+            int f = stack.back();
+            stack.pop_back();
+            visibleFaces.push_back(f);
+
+            for(int k=0; k < 3; ++k){
+                Face& neighbor = faces[faces[f].neighbor[k]];
+                if(neighbor.visitIteration == iteration)
+                    continue;
+
+                neighbor.visitIteration = iteration;
+                neighbor.visible = isInFront(neighbor, eye);
+                if(neighbor.visible)
+                    stack.push_back(faces[f].neighbor[k]);
+            }
+        }
+
+        // Collect the horizon edges (edges between a visible and a hidden face)
+        // and create a new face for each of them:
+        std::vector<int> newFaces;
+        for(int f : visibleFaces){
+            for(int k=0; k < 3; ++k){
+                int neighborIndex = faces[f].neighbor[k];
+                if(faces[neighborIndex].visible)
+                    continue;
+
+                uint32_t a = faces[f].v[k], b = faces[f].v[(k + 1) % 3];
+                int newFace = createFace(a, b, eye);
+                newFaces.push_back(newFace);
+
+                // Connect the new face with the hidden face:
+                faces[newFace].neighbor[0] = neighborIndex;
+                for(int l=0; l < 3; ++l){
+                    if(faces[neighborIndex].v[l] == b && faces[neighborIndex].v[(l + 1) % 3] == a)
+                        faces[neighborIndex].neighbor[l] = newFace;
+                }
+
+                horizonStart[a] = newFace;
+            }
+        }
+
+        // Connect the new faces with each other: edge b->eye of face (a, b, eye)
+        // is edge eye->b of the face which starts at b:
+        for(int f : newFaces){
+            int next = horizonStart[faces[f].v[1]];
+            faces[f].neighbor[1] = next;
+            faces[next].neighbor[2] = f;
+        }
+
+        // Delete the visible faces and collect their conflict points:
+        orphans.clear();
+        for(int f : visibleFaces){
+            pool.take(faces[f].conflicts, orphans);
+            faces[f].alive = false;
+            faces[f].visible = false;
+            freeFaces.push_back(f);
+        }
+
+        // Reassign the points to the new faces:
+        assignPoints(orphans.data(), orphans.size(), newFaces, eye);
+    }
+
+    const Vec4f* points;
+    size_t count;
+
+    std::vector<Face> faces;
+    std::vector<int> freeFaces;
+    std::vector<int> pending;
+    ConflictPool pool;
+
+    /* Maps a horizon vertex to the new face whose horizon edge starts there: */
+    std::vector<int> horizonStart;
+
+    std::vector<uint32_t> orphans;
+    unsigned int iteration;
+};
+
+}
+
+TriangleMesh computeConvexHull(const Vec4f* points, size_t count, std::vector<uint32_t>* hullPointIndices){
+    QuickHull hull(points, count);
+
+    if(!hull.build()){
+        if(hullPointIndices)
+            hullPointIndices->clear();
+        return TriangleMesh();
+    }
+
+    return hull.createMesh(hullPointIndices);
+}
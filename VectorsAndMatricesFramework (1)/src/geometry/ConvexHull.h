@@ -0,0 +1,39 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our Vec4f and the mesh class which is used for the result: */
+#include "../math/Vec4f.h"
+#include "TriangleMesh.h"
+
+/**
+ * Computes the convex hull of the given points with the QuickHull algorithm
+ * and returns it as an indexed triangle mesh (with counterclockwise triangles
+ * when viewed from the outside). Only x, y and z of the points are used.
+ *
+ * All decisions (is a point in front of a face?) are made with the exact
+ * orient3d(...) predicate (see Predicates.h), so the result is a valid convex
+ * polyhedron even for nearly degenerate input. Points which lie exactly on
+ * the hull but are not needed as corners are skipped. If all points are
+ * coplanar (so the hull has no volume), an empty mesh is returned.
+ *
+ * The initial assignment of all points to the faces of the first tetrahedron
+ * (which usually discards most of them) runs in parallel, as well as the
+ * reassignment of large conflict lists. The conflict lists are stored in
+ * blocks which are recycled through a pool, so the algorithm does not need
+ * a memory allocation per face.
+ *
+ * If 'hullPointIndices' is not null, it receives the index of the input point
+ * of every vertex of the resulting mesh.
+ */
+TriangleMesh computeConvexHull(const Vec4f* points, size_t count,
+                               std::vector<uint32_t>* hullPointIndices = nullptr);
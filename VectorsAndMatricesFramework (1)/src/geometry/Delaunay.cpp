@@ -0,0 +1,835 @@
+#include "Delaunay.h"
+#include "../math/AABB.h"
+#include "../math/Morton.h"
+#include "../math/Parallel.h"
+#include "../math/Predicates.h"
+#include "../math/Reductions.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+/* The vertex at infinity of the ghost simplices: */
+const uint32_t GHOST = 0xfffffffeu;
+
+/* Marks unused cells (as their first vertex): */
+const uint32_t DEAD = 0xfffffffdu;
+
+/* Marks cells without reservation, points without cell, etc.: */
+const uint32_t NONE = 0xffffffffu;
+
+/* The number of points of a batch which are processed by one task: */
+const size_t BATCH_GRAIN_SIZE = 8;
+
+/* The number of points or cells which are processed by one task: */
+const size_t DELAUNAY_GRAIN_SIZE = 65536;
+
+/* The size of the first round of the insertion order (the following rounds
+   double in size): */
+const size_t MIN_ROUND_SIZE = 256;
+
+/* A batch inserts at most (number of inserted points) / BATCH_DIVISOR points,
+   which keeps the share of points with overlapping cavities small, and at
+   most MAX_LANES (more lanes than fit into the cache slow down every lane): */
+const size_t BATCH_DIVISOR = 256;
+const size_t MAX_LANES = 256;
+
+/* The orientation of D + 1 points (positive for the simplices): */
+template<int D> double orientSimplex(const Vec4f* const* corners);
+
+template<> double orientSimplex<2>(const Vec4f* const* corners){
+    return orient2d(*corners[0], *corners[1], *corners[2]);
+}
+
+template<> double orientSimplex<3>(const Vec4f* const* corners){
+    return orient3d(*corners[0], *corners[1], *corners[2], *corners[3]);
+}
+
+/* Positive if the point lies inside of the circumsphere of the (positive)
+   simplex: */
+template<int D> double inSphere(const Vec4f* const* corners, const Vec4f& point);
+
+template<> double inSphere<2>(const Vec4f* const* corners, const Vec4f& point){
+    return incircle(*corners[0], *corners[1], *corners[2], point);
+}
+
+template<> double inSphere<3>(const Vec4f* const* corners, const Vec4f& point){
+    return insphere(*corners[0], *corners[1], *corners[2], *corners[3], point);
+}
+
+/* Returns whether two points coincide (in the used coordinates): */
+template<int D> bool coincide(const Vec4f& a, const Vec4f& b){
+    return a.x == b.x && a.y == b.y && (D == 2 || a.z == b.z);
+}
+
+/**
+ * A small hash map from cells to a flag (whether the cell is in conflict),
+ * which remembers the cells that were tested while a cavity is grown.
+ */
+class CellSet {
+public:
+    CellSet()
+        : keys(64, NONE), values(64)
+    {}
+
+    /* Removes all cells: */
+    void clear(){
+        for(uint32_t slot : used)
+            keys[slot] = NONE;
+        used.clear();
+    }
+
+    /* Returns whether the cell is contained (and its flag): */
+    bool find(uint32_t cell, bool& value) const {
+        for(size_t slot=getSlot(cell); keys[slot] != NONE; slot = (slot + 1) & (keys.size() - 1)){
+            if(keys[slot] == cell){
+                value = values[slot] != 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Adds a cell which is not contained yet: */
+    void insert(uint32_t cell, bool value){
+        if(2 * (used.size() + 1) > keys.size())
+            grow();
+        size_t slot = getSlot(cell);
+        while(keys[slot] != NONE)
+            slot = (slot + 1) & (keys.size() - 1);
+        keys[slot] = cell;
+        values[slot] = value;
+        used.push_back(uint32_t(slot));
+    }
+
+private:
+    std::vector<uint32_t> keys;
+    std::vector<uint8_t> values;
+    std::vector<uint32_t> used;
+
+    size_t getSlot(uint32_t cell) const {
+        return ((cell * 2654435761u) >> 8) & (keys.size() - 1);
+    }
+
+    void grow(){
+        std::vector<uint32_t> oldKeys, oldSlots;
+        std::vector<uint8_t> oldValues;
+        for(uint32_t slot : used){
+            oldKeys.push_back(keys[slot]);
+            oldValues.push_back(values[slot]);
+        }
+        keys.assign(2 * keys.size(), NONE);
+        values.assign(keys.size(), 0);
+        used.clear();
+        for(size_t i=0; i < oldKeys.size(); ++i)
+            insert(oldKeys[i], oldValues[i] != 0);
+    }
+};
+
+/**
+ * A face on the boundary of a cavity, which becomes a new cell together with
+ * the inserted point.
+ */
+struct CavityFace {
+    /** The vertices of the new cell (the cavity cell with the point at 'slot') */
+    uint32_t vertices[4];
+
+    /** The slot of the point */
+    uint32_t slot;
+
+    /** The cell outside of the cavity, and its slot which points to the face */
+    uint32_t neighbour;
+    uint32_t neighbourSlot;
+};
+
+/**
+ * The insertion of one point of a batch.
+ */
+struct Insertion {
+    uint32_t point;
+    uint32_t hint;
+    bool duplicate;
+    bool winner;
+    std::vector<uint32_t> cavity;
+    std::vector<CavityFace> faces;
+    std::vector<uint32_t> newCells;
+};
+
+/* A face through the inserted point, which is shared by two new cells: */
+struct SharedFace {
+    uint64_t key;
+    uint32_t cell;
+    uint32_t slot;
+
+    bool operator<(const SharedFace& other) const {
+        return key < other.key;
+    }
+};
+
+/**
+ * The triangulation of dimension D during the construction. Every cell has
+ * K = D + 1 vertices (GHOST for the vertex at infinity) and K neighbours.
+ */
+template<int D>
+class Triangulator {
+public:
+    static const int K = D + 1;
+
+    Triangulator(const Vec4f* points)
+        : points(points), cellCount(0)
+    {}
+
+    /**
+     * Creates the first simplex (which is made positive) and its ghosts.
+     */
+    void initialize(uint32_t* vertices){
+        const Vec4f* corners[K];
+        for(int k=0; k < K; ++k)
+            corners[k] = &points[vertices[k]];
+        if(orientSimplex<D>(corners) < 0.0)
+            std::swap(vertices[0], vertices[1]);
+
+        cellCount = K + 1;
+        cells.resize(K * cellCount);
+        neighbours.assign(K * cellCount, NONE);
+        std::copy(vertices, vertices + K, &cells[0]);
+
+        // The ghost behind the face opposite to vertex i replaces it by the
+        // vertex at infinity (which lies on the other side of the face, so
+        // two other vertices are swapped to keep the orientation):
+        for(int i=0; i < K; ++i){
+            uint32_t* ghost = &cells[K * (i + 1)];
+            std::copy(vertices, vertices + K, ghost);
+            ghost[i] = GHOST;
+            std::swap(ghost[(i + 1) % K], ghost[(i + 2) % K]);
+        }
+
+        // Link the cells which share a face:
+        for(uint32_t a=0; a < cellCount; ++a){
+            for(uint32_t b=0; b < cellCount; ++b){
+                if(a == b)
+                    continue;
+                for(int k=0; k < K; ++k){
+                    // The face opposite to slot k of a is shared, if b
+                    // contains all of its vertices:
+                    int shared = 0;
+                    for(int j=0; j < K; ++j){
+                        if(j != k && std::find(&cells[K * b], &cells[K * b] + K, cells[K * a + j]) != &cells[K * b] + K)
+                            ++shared;
+                    }
+                    if(shared == D)
+                        neighbours[K * a + k] = b;
+                }
+            }
+        }
+        reservations.reset(new std::atomic<uint32_t>[cellCount]);
+        reservationCount = cellCount;
+        for(size_t c=0; c < cellCount; ++c)
+            reservations[c].store(NONE);
+    }
+
+    /* Returns whether the cell is unused: */
+    bool isDead(uint32_t cell) const {
+        return cell >= cellCount || cells[K * cell] == DEAD;
+    }
+
+    /**
+     * Returns whether the point lies inside of the circumsphere of the cell.
+     * For ghosts, this is the open half space beyond their face (the
+     * circumsphere of a ghost is the limit of the spheres through its face
+     * whose centers move to infinity), plus the open circumcircle of the
+     * face itself, which is tested with the circumsphere of the cell on the
+     * other side.
+     */
+    bool conflicts(uint32_t cell, const Vec4f& point) const {
+        const uint32_t* vertices = &cells[K * cell];
+        const Vec4f* corners[K];
+        int ghost = -1;
+        for(int k=0; k < K; ++k){
+            if(vertices[k] == GHOST){
+                ghost = k;
+                corners[k] = &point;
+            } else {
+                corners[k] = &points[vertices[k]];
+            }
+        }
+        if(ghost < 0)
+            return inSphere<D>(corners, point) > 0.0;
+
+        double side = orientSimplex<D>(corners);
+        if(side != 0.0)
+            return side > 0.0;
+        return conflicts(neighbours[K * cell + ghost], point);
+    }
+
+    /**
+     * Walks from the given cell towards the point (by crossing faces which
+     * separate the current cell from the point, starting at a random face)
+     * and returns the first cell which conflicts with the point: the real
+     * cell which contains it, or the ghost beyond the hull.
+     */
+    uint32_t locate(const Vec4f& point, uint32_t cell, uint32_t random, bool& duplicate) const {
+        duplicate = false;
+        while(true){
+            const uint32_t* vertices = &cells[K * cell];
+            const Vec4f* corners[K];
+            int ghost = -1;
+            for(int k=0; k < K; ++k){
+                if(vertices[k] == GHOST)
+                    ghost = k;
+                else
+                    corners[k] = &points[vertices[k]];
+            }
+            if(ghost >= 0){
+                if(conflicts(cell, point))
+                    return cell;
+                cell = neighbours[K * cell + ghost];
+                continue;
+            }
+
+            random = random * 1103515245u + 12345u;
+            int first = int((random >> 16) % K);
+            bool moved = false;
+            for(int i=0; i < K && !moved; ++i){
+                int k = (first + i) % K;
+                const Vec4f* corner = corners[k];
+                corners[k] = &point;
+                if(orientSimplex<D>(corners) < 0.0){
+                    cell = neighbours[K * cell + k];
+                    moved = true;
+                }
+                corners[k] = corner;
+            }
+            if(moved)
+                continue;
+
+            for(int k=0; k < K; ++k)
+                duplicate = duplicate || coincide<D>(*corners[k], point);
+            return cell;
+        }
+    }
+
+    /**
+     * Finds the cavity of the point of the insertion (all cells which
+     * conflict with it, which are connected) and the faces on its boundary.
+     */
+    void findCavity(Insertion& insertion, CellSet& tested) const {
+        const Vec4f& point = points[insertion.point];
+        insertion.cavity.clear();
+        insertion.faces.clear();
+        uint32_t start = locate(point, insertion.hint, insertion.point, insertion.duplicate);
+        if(insertion.duplicate)
+            return;
+
+        tested.clear();
+        tested.insert(start, true);
+        insertion.cavity.push_back(start);
+        for(size_t i=0; i < insertion.cavity.size(); ++i){
+            uint32_t cell = insertion.cavity[i];
+            for(int k=0; k < K; ++k){
+                uint32_t neighbour = neighbours[K * cell + k];
+                bool inside;
+                if(!tested.find(neighbour, inside)){
+                    inside = conflicts(neighbour, point);
+                    tested.insert(neighbour, inside);
+                    if(inside)
+                        insertion.cavity.push_back(neighbour);
+                }
+                if(inside)
+                    continue;
+
+                CavityFace face;
+                std::copy(&cells[K * cell], &cells[K * cell] + K, face.vertices);
+                face.vertices[k] = insertion.point;
+                face.slot = uint32_t(k);
+                face.neighbour = neighbour;
+                face.neighbourSlot = 0;
+                while(neighbours[K * neighbour + face.neighbourSlot] != cell)
+                    ++face.neighbourSlot;
+                insertion.faces.push_back(face);
+            }
+        }
+    }
+
+    /**
+     * Reserves the cavity of the insertion and the cells around it for the
+     * given priority (the smallest priority wins).
+     */
+    void reserve(const Insertion& insertion, uint32_t priority){
+        for(uint32_t cell : insertion.cavity)
+            reserveCell(cell, priority);
+        for(const CavityFace& face : insertion.faces)
+            reserveCell(face.neighbour, priority);
+    }
+
+    /* Returns whether all reservations of the insertion succeeded: */
+    bool isReserved(const Insertion& insertion, uint32_t priority) const {
+        for(uint32_t cell : insertion.cavity){
+            if(reservations[cell].load(std::memory_order_relaxed) != priority)
+                return false;
+        }
+        for(const CavityFace& face : insertion.faces){
+            if(reservations[face.neighbour].load(std::memory_order_relaxed) != priority)
+                return false;
+        }
+        return true;
+    }
+
+    /* Removes the reservations of the insertion: */
+    void release(const Insertion& insertion){
+        for(uint32_t cell : insertion.cavity)
+            reservations[cell].store(NONE, std::memory_order_relaxed);
+        for(const CavityFace& face : insertion.faces)
+            reservations[face.neighbour].store(NONE, std::memory_order_relaxed);
+    }
+
+    /**
+     * Assigns the cells for the new cells of the insertion: the cells of its
+     * cavity first, then unused cells and finally new ones. Cavity cells
+     * which are left over are appended to 'released'.
+     */
+    void allocate(Insertion& insertion, std::vector<uint32_t>& released){
+        size_t count = insertion.faces.size();
+        size_t reused = std::min(count, insertion.cavity.size());
+        insertion.newCells.assign(insertion.cavity.begin(), insertion.cavity.begin() + reused);
+        while(insertion.newCells.size() < count){
+            if(!freeCells.empty()){
+                insertion.newCells.push_back(freeCells.back());
+                freeCells.pop_back();
+            } else {
+                if(cellCount >= DEAD)
+                    throw std::invalid_argument("computeDelaunay: too many simplices.");
+                insertion.newCells.push_back(uint32_t(cellCount++));
+            }
+        }
+        released.insert(released.end(), insertion.cavity.begin() + reused, insertion.cavity.end());
+    }
+
+    /**
+     * Grows the arrays of the cells to the current number of cells (must not
+     * be called while cells are reserved).
+     */
+    void growCells(){
+        cells.resize(K * cellCount, DEAD);
+        neighbours.resize(K * cellCount, NONE);
+        if(reservationCount < cellCount){
+            reservationCount = std::max(cellCount, 2 * reservationCount);
+            reservations.reset(new std::atomic<uint32_t>[reservationCount]);
+            for(size_t c=0; c < reservationCount; ++c)
+                reservations[c].store(NONE, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Replaces the cavity of the insertion by the new cells (which connect
+     * the faces of its boundary to the point).
+     */
+    void insert(const Insertion& insertion, std::vector<SharedFace>& shared){
+        shared.clear();
+        for(size_t j=0; j < insertion.faces.size(); ++j){
+            const CavityFace& face = insertion.faces[j];
+            uint32_t cell = insertion.newCells[j];
+            std::copy(face.vertices, face.vertices + K, &cells[K * cell]);
+            neighbours[K * cell + face.slot] = face.neighbour;
+            neighbours[K * face.neighbour + face.neighbourSlot] = cell;
+
+            // The other faces of the cell contain the point, and are shared
+            // with other new cells: they are identified by their vertices
+            // besides the point.
+            for(uint32_t k=0; k < uint32_t(K); ++k){
+                if(k == face.slot)
+                    continue;
+                uint32_t others[2];
+                int otherCount = 0;
+                for(uint32_t j2=0; j2 < uint32_t(K); ++j2){
+                    if(j2 != k && j2 != face.slot)
+                        others[otherCount++] = face.vertices[j2];
+                }
+                uint64_t key = others[0];
+                if(otherCount == 2)
+                    key = uint64_t(std::min(others[0], others[1])) << 32 | std::max(others[0], others[1]);
+                SharedFace entry = {key, cell, k};
+                shared.push_back(entry);
+            }
+        }
+
+        std::sort(shared.begin(), shared.end());
+        for(size_t i=0; i + 1 < shared.size(); i += 2){
+            neighbours[K * shared[i].cell + shared[i].slot] = shared[i + 1].cell;
+            neighbours[K * shared[i + 1].cell + shared[i + 1].slot] = shared[i].cell;
+        }
+
+        for(size_t j=insertion.faces.size(); j < insertion.cavity.size(); ++j)
+            cells[K * insertion.cavity[j]] = DEAD;
+    }
+
+    /**
+     * Returns the real cells (without ghosts) as a triangulation, whose
+     * vertices are mapped to the input points by 'order'.
+     */
+    DelaunayTriangulation getTriangulation(const std::vector<uint32_t>& order) const {
+        DelaunayTriangulation result;
+        result.dimension = D;
+
+        // Number the real cells in parallel chunks:
+        size_t chunkCount = getChunkCount(cellCount, DELAUNAY_GRAIN_SIZE);
+        std::vector<size_t> offsets(chunkCount + 1, 0);
+        std::vector<uint32_t> indices(cellCount, NONE);
+        parallelFor(0, cellCount, DELAUNAY_GRAIN_SIZE, [&](size_t begin, size_t end){
+            size_t real = 0;
+            for(size_t c=begin; c < end; ++c)
+                real += isReal(uint32_t(c));
+            offsets[begin / DELAUNAY_GRAIN_SIZE + 1] = real;
+        });
+        for(size_t chunk=0; chunk < chunkCount; ++chunk)
+            offsets[chunk + 1] += offsets[chunk];
+
+        parallelFor(0, cellCount, DELAUNAY_GRAIN_SIZE, [&](size_t begin, size_t end){
+            size_t index = offsets[begin / DELAUNAY_GRAIN_SIZE];
+            for(size_t c=begin; c < end; ++c){
+                if(isReal(uint32_t(c)))
+                    indices[c] = uint32_t(index++);
+            }
+        });
+
+        size_t count = offsets[chunkCount];
+        result.simplices.resize(K * count);
+        result.neighbours.resize(K * count);
+        parallelFor(0, cellCount, DELAUNAY_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t c=begin; c < end; ++c){
+                if(indices[c] == NONE)
+                    continue;
+                size_t s = indices[c];
+                for(int k=0; k < K; ++k){
+                    result.simplices[K * s + k] = order[cells[K * c + k]];
+                    result.neighbours[K * s + k] = indices[neighbours[K * c + k]];
+                }
+            }
+        });
+        return result;
+    }
+
+    const Vec4f* points;
+    size_t cellCount;
+    std::vector<uint32_t> cells;
+    std::vector<uint32_t> neighbours;
+    std::vector<uint32_t> freeCells;
+
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> reservations;
+    size_t reservationCount;
+
+    void reserveCell(uint32_t cell, uint32_t priority){
+        uint32_t current = reservations[cell].load(std::memory_order_relaxed);
+        while(priority < current && !reservations[cell].compare_exchange_weak(current, priority, std::memory_order_relaxed))
+            ;
+    }
+
+    bool isReal(uint32_t cell) const {
+        if(cells[K * cell] == DEAD)
+            return false;
+        for(int k=0; k < K; ++k){
+            if(cells[K * cell + k] == GHOST)
+                return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Returns the insertion order (see computeDelaunay3D(...)) and the bounds of
+ * its rounds. Every round is sorted by the Morton codes, which are returned
+ * as well.
+ */
+void computeInsertionOrder(const Vec4f* points, size_t count, bool planar, uint32_t seed,
+                           std::vector<uint32_t>& order, std::vector<uint64_t>& codes,
+                           std::vector<size_t>& roundEnds){
+    // A random permutation (with a generator which is the same for every
+    // standard library):
+    order.resize(count);
+    for(size_t i=0; i < count; ++i)
+        order[i] = uint32_t(i);
+    std::mt19937_64 generator(seed);
+    for(size_t i=count; i > 1; --i)
+        std::swap(order[i - 1], order[generator() % i]);
+
+    // Rounds of doubling size:
+    roundEnds.clear();
+    for(size_t end=count; end > 0; end /= 2){
+        roundEnds.push_back(end);
+        if(end <= MIN_ROUND_SIZE)
+            break;
+    }
+    std::reverse(roundEnds.begin(), roundEnds.end());
+
+    AABB bounds = computeAABB(points, count);
+    if(planar)
+        bounds.min.z = bounds.max.z = 0.f;
+    codes.resize(count);
+    size_t begin = 0;
+    for(size_t end : roundEnds){
+        std::vector<uint64_t> roundCodes(end - begin);
+        std::vector<uint32_t> roundOrder(order.begin() + begin, order.begin() + end);
+        parallelFor(0, end - begin, DELAUNAY_GRAIN_SIZE, [&](size_t chunkBegin, size_t chunkEnd){
+            for(size_t i=chunkBegin; i < chunkEnd; ++i)
+                roundCodes[i] = computeMortonCode63(points[roundOrder[i]], bounds);
+        });
+        radixSort(roundCodes, roundOrder, 63);
+        std::copy(roundOrder.begin(), roundOrder.end(), order.begin() + begin);
+        std::copy(roundCodes.begin(), roundCodes.end(), codes.begin() + begin);
+        begin = end;
+    }
+}
+
+/**
+ * Finds D + 1 points (the first ones in the array which are possible) which
+ * span a simplex. Returns false
+ * if the points are degenerate.
+ */
+template<int D>
+bool findFirstSimplex(const Vec4f* points, size_t count, uint32_t* vertices){
+    if(count == 0)
+        return false;
+    vertices[0] = 0;
+    const Vec4f& a = points[vertices[0]];
+
+    size_t i = 1;
+    while(i < count && coincide<D>(points[i], a))
+        ++i;
+    if(i == count)
+        return false;
+    vertices[1] = uint32_t(i);
+    const Vec4f& b = points[vertices[1]];
+
+    // The third point must not be collinear (in 3D in none of the three
+    // projections to the coordinate planes):
+    for(++i; i < count; ++i){
+        const Vec4f& c = points[i];
+        if(orient2d(a, b, c) != 0.0)
+            break;
+        if(D == 3 && (orient2d(Vec4f(a.y, a.z, 0.f), Vec4f(b.y, b.z, 0.f), Vec4f(c.y, c.z, 0.f)) != 0.0
+                      || orient2d(Vec4f(a.z, a.x, 0.f), Vec4f(b.z, b.x, 0.f), Vec4f(c.z, c.x, 0.f)) != 0.0))
+            break;
+    }
+    if(i == count)
+        return false;
+    vertices[2] = uint32_t(i);
+    if(D == 2)
+        return true;
+
+    const Vec4f& c = points[vertices[2]];
+    for(++i; i < count; ++i){
+        if(orient3d(a, b, c, points[i]) != 0.0)
+            break;
+    }
+    if(i == count)
+        return false;
+    vertices[3] = uint32_t(i);
+    return true;
+}
+
+template<int D>
+DelaunayTriangulation computeDelaunay(const Vec4f* points, size_t count, const DelaunaySettings& settings){
+    if(count >= size_t(DEAD))
+        throw std::invalid_argument("computeDelaunay: too many points.");
+
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> codes;
+    std::vector<size_t> roundEnds;
+    computeInsertionOrder(points, count, D == 2, settings.seed, order, codes, roundEnds);
+
+    // The points are copied in insertion order, so that points which are
+    // close in space are mostly close in memory as well (their index in the
+    // copy is their vertex index during the construction):
+    std::vector<Vec4f> sorted(count);
+    parallelFor(0, count, DELAUNAY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i)
+            sorted[i] = points[order[i]];
+    });
+
+    uint32_t first[4];
+    if(!findFirstSimplex<D>(sorted.data(), count, first)){
+        DelaunayTriangulation empty;
+        empty.dimension = D;
+        return empty;
+    }
+
+    Triangulator<D> triangulation(sorted.data());
+    triangulation.initialize(first);
+
+    // A cell of every inserted point (which may have been replaced since, but
+    // is still a good start for walks to the points around it):
+    std::vector<uint32_t> pointCells(count, NONE);
+    for(int k=0; k < D + 1; ++k)
+        pointCells[first[k]] = 0;
+    uint32_t lastCell = 0;
+    size_t insertedCount = D + 1;
+
+    std::vector<Insertion> insertions(1);
+    std::vector<uint32_t> released;
+    std::vector<SharedFace> shared;
+    CellSet tested;
+
+    size_t roundBegin = 0;
+    for(size_t round=0; round < roundEnds.size(); ++round){
+        size_t roundEnd = roundEnds[round];
+
+        // Insert the points one after another, each walk starting at the
+        // previous point:
+        if(!settings.parallel){
+            Insertion& insertion = insertions[0];
+            for(size_t i=roundBegin; i < roundEnd; ++i){
+                insertion.point = uint32_t(i);
+                insertion.hint = lastCell;
+                if(pointCells[insertion.point] != NONE)
+                    continue;
+
+                triangulation.findCavity(insertion, tested);
+                if(insertion.duplicate)
+                    continue;
+
+                released.clear();
+                triangulation.allocate(insertion, released);
+                triangulation.growCells();
+                triangulation.insert(insertion, shared);
+                triangulation.freeCells.insert(triangulation.freeCells.end(), released.begin(), released.end());
+                lastCell = pointCells[insertion.point] = insertion.newCells[0];
+                ++insertedCount;
+            }
+            roundBegin = roundEnd;
+            continue;
+        }
+
+        // Split the round into lanes (consecutive ranges on the Morton curve)
+        // and insert the next point of every lane in each batch, so that the
+        // points of a batch are far apart, while every lane walks along the
+        // curve with short walks and warm caches. The first walk of a lane
+        // starts at the point of the previous round which is next to it on the
+        // curve, the others at the previous point of the lane.
+        size_t roundSize = roundEnd - roundBegin;
+        size_t laneCount = std::min(std::max(size_t(1), insertedCount / BATCH_DIVISOR), std::min(MAX_LANES, roundSize));
+        std::vector<size_t> laneNext(laneCount), laneEnd(laneCount);
+        std::vector<uint32_t> laneHints(laneCount, lastCell);
+        size_t previousBegin = round > 1 ? roundEnds[round - 2] : 0;
+        parallelFor(0, laneCount, BATCH_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t lane=begin; lane < end; ++lane){
+                laneNext[lane] = roundBegin + lane * roundSize / laneCount;
+                laneEnd[lane] = roundBegin + (lane + 1) * roundSize / laneCount;
+                if(round == 0)
+                    continue;
+                size_t position = std::lower_bound(codes.begin() + previousBegin, codes.begin() + roundBegin,
+                                                   codes[laneNext[lane]]) - codes.begin();
+                position = std::min(position, roundBegin - 1);
+                if(pointCells[position] != NONE)
+                    laneHints[lane] = pointCells[position];
+            }
+        });
+
+        std::vector<uint32_t> lanes;
+        while(true){
+            // The lanes which still have points (the first points of the
+            // round may already be inserted):
+            lanes.clear();
+            for(size_t lane=0; lane < laneCount; ++lane){
+                while(laneNext[lane] < laneEnd[lane] && pointCells[laneNext[lane]] != NONE)
+                    ++laneNext[lane];
+                if(laneNext[lane] < laneEnd[lane])
+                    lanes.push_back(uint32_t(lane));
+            }
+            if(lanes.empty())
+                break;
+
+            size_t batchSize = lanes.size();
+            if(insertions.size() < batchSize)
+                insertions.resize(batchSize);
+            for(size_t j=0; j < batchSize; ++j){
+                insertions[j].point = uint32_t(laneNext[lanes[j]]);
+                insertions[j].hint = triangulation.isDead(laneHints[lanes[j]]) ? lastCell : laneHints[lanes[j]];
+            }
+
+            parallelFor(0, batchSize, BATCH_GRAIN_SIZE, [&](size_t begin, size_t end){
+                CellSet localTested;
+                for(size_t j=begin; j < end; ++j){
+                    triangulation.findCavity(insertions[j], localTested);
+                    if(!insertions[j].duplicate)
+                        triangulation.reserve(insertions[j], uint32_t(j));
+                }
+            });
+            parallelFor(0, batchSize, BATCH_GRAIN_SIZE, [&](size_t begin, size_t end){
+                for(size_t j=begin; j < end; ++j){
+                    insertions[j].winner = !insertions[j].duplicate
+                                           && triangulation.isReserved(insertions[j], uint32_t(j));
+                }
+            });
+            parallelFor(0, batchSize, BATCH_GRAIN_SIZE, [&](size_t begin, size_t end){
+                for(size_t j=begin; j < end; ++j)
+                    triangulation.release(insertions[j]);
+            });
+
+            // Assign the new cells in the order of the batch, then insert the
+            // winners:
+            released.clear();
+            for(size_t j=0; j < batchSize; ++j){
+                if(insertions[j].winner)
+                    triangulation.allocate(insertions[j], released);
+            }
+            triangulation.growCells();
+            parallelFor(0, batchSize, BATCH_GRAIN_SIZE, [&](size_t begin, size_t end){
+                std::vector<SharedFace> localShared;
+                for(size_t j=begin; j < end; ++j){
+                    if(insertions[j].winner)
+                        triangulation.insert(insertions[j], localShared);
+                }
+            });
+            triangulation.freeCells.insert(triangulation.freeCells.end(), released.begin(), released.end());
+
+            // Advance the lanes whose point was inserted or skipped; the
+            // others retry it in the next batch, starting at the cell where
+            // its cavity was found:
+            for(size_t j=0; j < batchSize; ++j){
+                const Insertion& insertion = insertions[j];
+                uint32_t lane = lanes[j];
+                if(insertion.winner){
+                    lastCell = laneHints[lane] = pointCells[insertion.point] = insertion.newCells[0];
+                    ++insertedCount;
+                } else if(!insertion.duplicate){
+                    laneHints[lane] = insertion.cavity[0];
+                    continue;
+                }
+                ++laneNext[lane];
+            }
+        }
+        roundBegin = roundEnd;
+    }
+
+    return triangulation.getTriangulation(order);
+}
+
+}
+
+DelaunaySettings::DelaunaySettings()
+    : parallel(true), seed(1)
+{
+}
+
+DelaunayTriangulation::DelaunayTriangulation()
+    : dimension(0)
+{
+}
+
+size_t DelaunayTriangulation::getSimplexCount() const {
+    return dimension > 0 ? simplices.size() / (dimension + 1) : 0;
+}
+
+DelaunayTriangulation computeDelaunay2D(const Vec4f* points, size_t count, const DelaunaySettings& settings){
+    return computeDelaunay<2>(points, count, settings);
+}
+
+DelaunayTriangulation computeDelaunay3D(const Vec4f* points, size_t count, const DelaunaySettings& settings){
+    return computeDelaunay<3>(points, count, settings);
+}
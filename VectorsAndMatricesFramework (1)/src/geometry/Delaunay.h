@@ -0,0 +1,128 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors: */
+#include "../math/Vec4f.h"
+
+/**
+ * The parameters of computeDelaunay2D(...) and computeDelaunay3D(...).
+ */
+
+class DelaunaySettings
+{
+public:
+    /**
+     * Whether the points are inserted in parallel batches (default true, see
+     * computeDelaunay3D(...)). Otherwise they are inserted one after another,
+     * which is faster on a single thread.
+     */
+    bool parallel;
+
+    /**
+     * The seed of the random rounds of the insertion order (default 1). The
+     * same seed always gives the same triangulation.
+     */
+    uint32_t seed;
+
+    /**
+     * Constructs the default settings.
+     */
+    DelaunaySettings();
+};
+
+/**
+ * A Delaunay triangulation in 2D (triangles) or 3D (tetrahedra), whose
+ * simplices are stored as indices into the array of input points.
+ */
+
+class DelaunayTriangulation
+{
+public:
+    /**
+     * The neighbour of simplices on the convex hull.
+     */
+    static const uint32_t INVALID = 0xffffffffu;
+
+    /** The dimension (2 or 3), so every simplex has dimension + 1 vertices */
+    size_t dimension;
+
+    /**
+     * The vertex indices of all simplices. Triangles are counterclockwise in
+     * the xy-plane (orient2d(...) > 0) and tetrahedra have a positive
+     * orientation (orient3d(...) > 0, see Predicates.h).
+     */
+    std::vector<uint32_t> simplices;
+
+    /**
+     * The neighbours of all simplices: neighbours[s * (dimension + 1) + k] is
+     * the simplex which shares the face opposite to vertex k of simplex s, or
+     * INVALID if this face lies on the convex hull.
+     */
+    std::vector<uint32_t> neighbours;
+
+    /**
+     * Constructs an empty triangulation.
+     */
+    DelaunayTriangulation();
+
+    /**
+     * Returns the number of simplices.
+     */
+    size_t getSimplexCount() const;
+};
+
+/**
+ * Computes the Delaunay triangulation of the given points in the xy-plane
+ * (z and w are ignored): no point lies strictly inside the circumcircle of a
+ * triangle. See computeDelaunay3D(...) for the algorithm.
+ *
+ * Points which coincide with an earlier point (in x and y) are skipped. If
+ * all points are collinear, the triangulation is empty. Throws
+ * std::invalid_argument for 2^32 - 3 or more points.
+ */
+DelaunayTriangulation computeDelaunay2D(const Vec4f* points, size_t count,
+                                        const DelaunaySettings& settings = DelaunaySettings());
+
+/**
+ * Computes the Delaunay tetrahedralization of the given points (only x, y
+ * and z are used): no point lies strictly inside the circumsphere of a
+ * tetrahedron.
+ *
+ * The points are inserted incrementally (Bowyer-Watson): every point removes
+ * the simplices whose circumspheres contain it (its cavity) and connects
+ * itself to the boundary of the cavity. The space outside of the convex hull
+ * is covered by 'ghost' simplices which share a vertex at infinity, so no
+ * bounding simplex distorts the triangulation near the hull. All decisions
+ * are made with the exact predicates of Predicates.h, so nearly degenerate
+ * input (like points on a grid) cannot break the triangulation.
+ *
+ * The insertion order is a biased randomized insertion order (BRIO, Amenta
+ * et al., "Incremental constructions con BRIO", 2003): the points are split
+ * into random rounds of doubling size, and every round is sorted along the
+ * Morton curve (see Sorting.h). The randomness keeps the expected number of
+ * changes small, and the Morton order lets the walk which finds the simplex
+ * of the next point start close to it.
+ *
+ * In the parallel mode, space is partitioned by splitting every round into
+ * lanes (consecutive ranges on the Morton curve), and each batch takes the
+ * next point of every lane, so the points of a batch are mostly far apart.
+ * They find their cavities in parallel and reserve them (together with the
+ * simplices around them) for the first lane which needs them; then all
+ * points whose reservations succeeded insert themselves in parallel, and the
+ * others are retried in the next batch. Since disjoint cavities do not
+ * influence each other, the lanes grow into one Delaunay triangulation
+ * without any seams to merge, and since the batches only depend on the
+ * number of points, the result does not depend on the number of threads.
+ */
+DelaunayTriangulation computeDelaunay3D(const Vec4f* points, size_t count,
+                                        const DelaunaySettings& settings = DelaunaySettings());
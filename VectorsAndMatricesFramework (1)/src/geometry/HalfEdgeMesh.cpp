@@ -0,0 +1,177 @@
+#include "HalfEdgeMesh.h"
+#include "../math/Parallel.h"
+
+#include <stdexcept>
+
+namespace {
+
+/* The number of half-edges or vertices which are processed by one task: */
+const size_t HALF_EDGE_GRAIN_SIZE = 16384;
+
+}
+
+const uint32_t HalfEdgeMesh::INVALID;
+
+HalfEdgeMesh::HalfEdgeMesh()
+    : faceStart(1, 0), edgeCount(0)
+{}
+
+HalfEdgeMesh::HalfEdgeMesh(const uint32_t* indices, size_t faceCount, unsigned int faceSize, size_t vertexCount)
+    : faceStart(faceCount + 1), origins(indices, indices + faceCount * faceSize),
+      twins(faceCount * faceSize), edges(faceCount * faceSize), faces(faceCount * faceSize),
+      vertexHalfEdges(vertexCount, INVALID), edgeCount(0)
+{
+    if(faceSize < 3)
+        throw std::invalid_argument("HalfEdgeMesh: a face needs at least three vertices.");
+
+    size_t halfEdgeCount = origins.size();
+    if(halfEdgeCount >= INVALID)
+        throw std::invalid_argument("HalfEdgeMesh: too many half-edges.");
+
+    for(size_t f=0; f <= faceCount; ++f)
+        faceStart[f] = uint32_t(f * faceSize);
+
+    for(size_t f=0; f < faceCount; ++f){
+        for(unsigned int k=0; k < faceSize; ++k){
+            uint32_t vertex = indices[f * faceSize + k];
+            if(vertex >= vertexCount)
+                throw std::invalid_argument("HalfEdgeMesh: index out of range.");
+            for(unsigned int j=0; j < k; ++j){
+                if(indices[f * faceSize + j] == vertex)
+                    throw std::invalid_argument("HalfEdgeMesh: a face uses a vertex twice.");
+            }
+            faces[f * faceSize + k] = uint32_t(f);
+        }
+    }
+
+    // Sort the half-edges by their origin (counting sort), so that all
+    // half-edges starting at a vertex can be found:
+    std::vector<uint32_t> outgoingStart(vertexCount + 1, 0);
+    for(size_t h=0; h < halfEdgeCount; ++h)
+        ++outgoingStart[origins[h] + 1];
+    for(size_t v=0; v < vertexCount; ++v)
+        outgoingStart[v + 1] += outgoingStart[v];
+
+    std::vector<uint32_t> outgoing(halfEdgeCount);
+    std::vector<uint32_t> fill(outgoingStart.begin(), outgoingStart.end() - 1);
+    for(size_t h=0; h < halfEdgeCount; ++h)
+        outgoing[fill[origins[h]]++] = uint32_t(h);
+
+    // The twin of a half-edge a -> b is the half-edge b -> a, which must be
+    // unique, and there must be no second half-edge a -> b:
+    parallelFor(0, halfEdgeCount, HALF_EDGE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t h=begin; h < end; ++h){
+            uint32_t a = origins[h], b = target(uint32_t(h));
+
+            for(uint32_t k=outgoingStart[a]; k < outgoingStart[a + 1]; ++k){
+                if(outgoing[k] != h && target(outgoing[k]) == b)
+                    throw std::invalid_argument("HalfEdgeMesh: the mesh is not manifold or not consistently oriented.");
+            }
+
+            uint32_t twin = INVALID;
+            for(uint32_t k=outgoingStart[b]; k < outgoingStart[b + 1]; ++k){
+                if(target(outgoing[k]) == a){
+                    if(twin != INVALID)
+                        throw std::invalid_argument("HalfEdgeMesh: the mesh is not manifold.");
+                    twin = outgoing[k];
+                }
+            }
+            twins[h] = twin;
+        }
+    });
+
+    // Number the edges in the order of their first half-edge:
+    std::vector<uint32_t> edgeOfFirst(halfEdgeCount);
+    for(size_t h=0; h < halfEdgeCount; ++h){
+        if(twins[h] == INVALID || h < twins[h])
+            edgeOfFirst[h] = uint32_t(edgeCount++);
+    }
+    parallelFor(0, halfEdgeCount, HALF_EDGE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t h=begin; h < end; ++h)
+            edges[h] = (twins[h] == INVALID || h < twins[h]) ? edgeOfFirst[h] : edgeOfFirst[twins[h]];
+    });
+
+    // Every vertex starts at its outgoing border half-edge (if it has one),
+    // and all of its half-edges must be reachable by rotating around it:
+    parallelFor(0, vertexCount, HALF_EDGE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t v=begin; v < end; ++v){
+            uint32_t count = outgoingStart[v + 1] - outgoingStart[v];
+            if(count == 0)
+                continue;
+
+            uint32_t first = outgoing[outgoingStart[v]];
+            for(uint32_t k=outgoingStart[v]; k < outgoingStart[v + 1]; ++k){
+                if(twins[outgoing[k]] == INVALID){
+                    first = outgoing[k];
+                    break;
+                }
+            }
+            vertexHalfEdges[v] = first;
+
+            uint32_t reached = 0, h = first;
+            do {
+                ++reached;
+                h = rotateAroundOrigin(h);
+            } while(h != INVALID && h != first && reached <= count);
+
+            if(reached != count)
+                throw std::invalid_argument("HalfEdgeMesh: the mesh is not manifold at a vertex.");
+        }
+    });
+}
+
+HalfEdgeMesh::HalfEdgeMesh(const TriangleMesh& mesh)
+    : HalfEdgeMesh(mesh.indices.data(), mesh.getTriangleCount(), 3, mesh.getVertexCount())
+{}
+
+size_t HalfEdgeMesh::getVertexCount() const{
+    return vertexHalfEdges.size();
+}
+
+size_t HalfEdgeMesh::getFaceCount() const{
+    return faceStart.size() - 1;
+}
+
+size_t HalfEdgeMesh::getHalfEdgeCount() const{
+    return origins.size();
+}
+
+unsigned int HalfEdgeMesh::getValence(uint32_t vertex) const{
+    uint32_t first = vertexHalfEdges[vertex];
+    if(first == INVALID)
+        return 0;
+
+    // A border vertex has one more edge than faces:
+    unsigned int valence = 0;
+    uint32_t h = first;
+    do {
+        ++valence;
+        h = rotateAroundOrigin(h);
+    } while(h != INVALID && h != first);
+
+    return h == INVALID ? valence + 1 : valence;
+}
+
+bool HalfEdgeMesh::isTriangleMesh() const{
+    for(size_t f=0; f < getFaceCount(); ++f){
+        if(getFaceSize(uint32_t(f)) != 3)
+            return false;
+    }
+    return true;
+}
+
+TriangleMesh HalfEdgeMesh::toTriangleMesh(const std::vector<Vec4f>& positions) const{
+    if(positions.size() != getVertexCount())
+        throw std::invalid_argument("HalfEdgeMesh::toTriangleMesh: one position per vertex is needed.");
+
+    TriangleMesh mesh;
+    mesh.positions = positions;
+    mesh.indices.reserve(3 * (getHalfEdgeCount() - 2 * getFaceCount()));
+    for(size_t f=0; f < getFaceCount(); ++f){
+        for(uint32_t h=faceStart[f] + 1; h + 1 < faceStart[f + 1]; ++h){
+            uint32_t triangle[3] = {origins[faceStart[f]], origins[h], origins[h + 1]};
+            mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,163 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include the triangle mesh (which can be converted to and from half-edges): */
+#include "TriangleMesh.h"
+
+/**
+ * The topology of a manifold polygon mesh (with or without borders) as
+ * half-edges: every face is a cycle of directed half-edges, and the two
+ * half-edges of an inner edge (one of each neighbouring face) are 'twins'.
+ * This answers all neighbourhood queries (the faces around a vertex, the two
+ * faces of an edge, the vertices on a border, ...) in constant time per
+ * neighbour.
+ *
+ * The structure uses indices instead of pointers, and the half-edges of a
+ * face are stored consecutively: the half-edges of face f are faceStart[f],
+ * ..., faceStart[f + 1] - 1, and half-edge h starts at the vertex
+ * origins[h] (so 'origins' is simply the index buffer of the faces). The
+ * next and previous half-edge of a face therefore need no arrays, and a
+ * half-edge costs four indices (origin, twin, edge, face).
+ *
+ * The mesh only stores topology; the positions are kept in a separate array
+ * (one per vertex), so they can change without rebuilding the structure.
+ */
+
+class HalfEdgeMesh
+{
+public:
+    /** Marks a missing twin (border) or a vertex without half-edges */
+    static const uint32_t INVALID = 0xffffffffu;
+
+    /** The first half-edge of every face (faceCount + 1 entries) */
+    std::vector<uint32_t> faceStart;
+
+    /** The vertex at which every half-edge starts */
+    std::vector<uint32_t> origins;
+
+    /** The opposite half-edge of every half-edge (INVALID on a border) */
+    std::vector<uint32_t> twins;
+
+    /** The (undirected) edge of every half-edge */
+    std::vector<uint32_t> edges;
+
+    /** The face of every half-edge */
+    std::vector<uint32_t> faces;
+
+    /**
+     * One half-edge starting at every vertex (INVALID for unused vertices).
+     * For a vertex on a border this is the outgoing border half-edge, so
+     * rotateAroundOrigin(...) starting here visits all neighbours.
+     */
+    std::vector<uint32_t> vertexHalfEdges;
+
+    /** The number of undirected edges */
+    size_t edgeCount;
+
+    /**
+     * Constructs an empty mesh.
+     */
+    HalfEdgeMesh();
+
+    /**
+     * Builds the half-edges of a mesh whose faces all have 'faceSize'
+     * vertices (3 for triangles, 4 for quads), given counterclockwise by
+     * 'faceSize' consecutive entries of 'indices'.
+     *
+     * Throws std::invalid_argument if an index is out of range, if a face
+     * uses a vertex twice, or if the mesh is not manifold (an edge with more
+     * than two faces, two neighbouring faces with opposite orientation, or a
+     * vertex at which two separate fans of faces meet).
+     */
+    HalfEdgeMesh(const uint32_t* indices, size_t faceCount, unsigned int faceSize, size_t vertexCount);
+
+    /**
+     * Builds the half-edges of the triangles of the given mesh.
+     */
+    explicit HalfEdgeMesh(const TriangleMesh& mesh);
+
+    /**
+     * Returns the number of vertices.
+     */
+    size_t getVertexCount() const;
+
+    /**
+     * Returns the number of faces.
+     */
+    size_t getFaceCount() const;
+
+    /**
+     * Returns the number of half-edges.
+     */
+    size_t getHalfEdgeCount() const;
+
+    /**
+     * Returns the number of vertices of the given face.
+     */
+    unsigned int getFaceSize(uint32_t face) const {
+        return faceStart[face + 1] - faceStart[face];
+    }
+
+    /**
+     * Returns the next half-edge of the same face.
+     */
+    uint32_t next(uint32_t halfEdge) const {
+        uint32_t following = halfEdge + 1;
+        return following == faceStart[faces[halfEdge] + 1] ? faceStart[faces[halfEdge]] : following;
+    }
+
+    /**
+     * Returns the previous half-edge of the same face.
+     */
+    uint32_t previous(uint32_t halfEdge) const {
+        return halfEdge == faceStart[faces[halfEdge]] ? faceStart[faces[halfEdge] + 1] - 1 : halfEdge - 1;
+    }
+
+    /**
+     * Returns the vertex at which the half-edge ends.
+     */
+    uint32_t target(uint32_t halfEdge) const {
+        return origins[next(halfEdge)];
+    }
+
+    /**
+     * Returns the next half-edge starting at the same vertex (one face
+     * further around the vertex), or INVALID if a border is reached.
+     */
+    uint32_t rotateAroundOrigin(uint32_t halfEdge) const {
+        return twins[previous(halfEdge)];
+    }
+
+    /**
+     * Returns whether the vertex is on a border (or unused).
+     */
+    bool isBorderVertex(uint32_t vertex) const {
+        return vertexHalfEdges[vertex] == INVALID || twins[vertexHalfEdges[vertex]] == INVALID;
+    }
+
+    /**
+     * Returns the number of edges at the vertex.
+     */
+    unsigned int getValence(uint32_t vertex) const;
+
+    /**
+     * Returns whether all faces are triangles.
+     */
+    bool isTriangleMesh() const;
+
+    /**
+     * Returns a triangle mesh with the given positions (one per vertex), in
+     * which every face is split into a fan of triangles.
+     */
+    TriangleMesh toTriangleMesh(const std::vector<Vec4f>& positions) const;
+};
@@ -0,0 +1,194 @@
+#include "IcpRegistration.h"
+#include "../math/Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of points which are processed by one task: */
+const size_t ICP_GRAIN_SIZE = 4096;
+
+/* The sum of squared distances and the number of correspondences: */
+struct DistanceSum {
+    double sum;
+    size_t count;
+};
+
+/* Transforms a point with the rigid transformation m (column-major): */
+inline Vec4f transformPoint(const float* m, const Vec4f& p){
+    return Vec4f(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                 m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                 m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+}
+
+/* Returns the largest change of a cell of the rotation or translation: */
+float getPoseChange(const Mat4f& a, const Mat4f& b){
+    float change = 0.f;
+    for(int i=0; i < 15; ++i){
+        if(i % 4 != 3)
+            change = std::max(change, std::fabs(a.data[i] - b.data[i]));
+    }
+    return change;
+}
+
+}
+
+IcpSettings::IcpSettings()
+    : metric(IcpMetric::PointToPlane), loss(RobustLoss::Huber), levelCount(3), levelFactor(4),
+      maxIterations(20), maxCorrespondenceDistance(0.1f), rejectionFactor(3.f), tolerance(1e-5f)
+{}
+
+IcpRegistration::IcpRegistration(const Vec4f* targetPoints, const Vec4f* targetNormals, size_t count)
+    : points(targetPoints, targetPoints + count), tree(targetPoints, count)
+{
+    if(count == 0)
+        throw std::invalid_argument("IcpRegistration: the target has no points.");
+    if(targetNormals)
+        normals.assign(targetNormals, targetNormals + count);
+}
+
+const KdTree& IcpRegistration::getTree() const{
+    return tree;
+}
+
+IcpResult IcpRegistration::align(const Vec4f* sources, size_t count, const IcpSettings& settings,
+                                 const Mat4f& initialPose) const{
+    if(count == 0)
+        throw std::invalid_argument("IcpRegistration::align: there are no source points.");
+    bool pointToPlane = settings.metric == IcpMetric::PointToPlane;
+    if(pointToPlane && normals.empty())
+        throw std::invalid_argument("IcpRegistration::align: point-to-plane needs target normals.");
+
+    IcpResult result;
+    result.pose = initialPose;
+    result.iterations = 0;
+    result.correspondenceCount = 0;
+    result.rmsError = 0.f;
+    result.converged = false;
+
+    float maxSquaredDistance = settings.maxCorrespondenceDistance * settings.maxCorrespondenceDistance;
+    std::vector<Vec4f> levelSources, transformed, matchedSources, matchedTargets, matchedNormals;
+    std::vector<uint32_t> nearest;
+    std::vector<float> squaredDistances;
+
+    for(size_t level=std::max(settings.levelCount, size_t(1)); level-- > 0;){
+        // Every stride-th source point is used on this level:
+        size_t stride = 1;
+        for(size_t l=0; l < level && stride < count; ++l)
+            stride *= std::max(settings.levelFactor, size_t(1));
+        if(level > 0 && stride >= count)
+            continue;
+
+        size_t levelCount = (count + stride - 1) / stride;
+        levelSources.resize(levelCount);
+        parallelFor(0, levelCount, ICP_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i)
+                levelSources[i] = sources[i * stride];
+        });
+
+        transformed.resize(levelCount);
+        nearest.resize(levelCount);
+        squaredDistances.resize(levelCount);
+        size_t chunkCount = getChunkCount(levelCount, ICP_GRAIN_SIZE);
+        std::vector<size_t> offsets(chunkCount + 1);
+
+        result.converged = false;
+        for(size_t iteration=0; iteration < settings.maxIterations; ++iteration){
+            ++result.iterations;
+
+            // Find the closest target points of the transformed sources:
+            const float* pose = result.pose.data;
+            parallelFor(0, levelCount, ICP_GRAIN_SIZE, [&](size_t begin, size_t end){
+                for(size_t i=begin; i < end; ++i)
+                    transformed[i] = transformPoint(pose, levelSources[i]);
+            });
+            tree.findNearestBatch(transformed.data(), levelCount, settings.maxCorrespondenceDistance,
+                                  nearest.data(), squaredDistances.data());
+
+            // Reject outliers (relative to the RMS distance):
+            auto sumDistances = [&](float limit){
+                DistanceSum zero = {0.0, 0};
+                return parallelReduce(size_t(0), levelCount, ICP_GRAIN_SIZE, zero,
+                    [&](size_t begin, size_t end){
+                        DistanceSum chunk = {0.0, 0};
+                        for(size_t i=begin; i < end; ++i){
+                            if(nearest[i] != KdTree::INVALID && squaredDistances[i] <= limit){
+                                chunk.sum += squaredDistances[i];
+                                ++chunk.count;
+                            }
+                        }
+                        return chunk;
+                    },
+                    [](const DistanceSum& a, const DistanceSum& b){
+                        DistanceSum sum = {a.sum + b.sum, a.count + b.count};
+                        return sum;
+                    });
+            };
+
+            DistanceSum all = sumDistances(maxSquaredDistance);
+            if(all.count == 0)
+                break;
+            float limit = std::min(maxSquaredDistance, float(settings.rejectionFactor * settings.rejectionFactor
+                                                             * all.sum / all.count));
+            DistanceSum inliers = sumDistances(limit);
+            if(inliers.count == 0)
+                break;
+
+            // Compact the inliers (the offsets of the chunks are a prefix
+            // sum of their counts):
+            parallelFor(0, levelCount, ICP_GRAIN_SIZE, [&](size_t begin, size_t end){
+                size_t inlierCount = 0;
+                for(size_t i=begin; i < end; ++i){
+                    if(nearest[i] != KdTree::INVALID && squaredDistances[i] <= limit)
+                        ++inlierCount;
+                }
+                offsets[begin / ICP_GRAIN_SIZE + 1] = inlierCount;
+            });
+            for(size_t c=0; c < chunkCount; ++c)
+                offsets[c + 1] += offsets[c];
+
+            matchedSources.resize(inliers.count);
+            matchedTargets.resize(inliers.count);
+            matchedNormals.resize(pointToPlane ? inliers.count : 0);
+            parallelFor(0, levelCount, ICP_GRAIN_SIZE, [&](size_t begin, size_t end){
+                size_t target = offsets[begin / ICP_GRAIN_SIZE];
+                for(size_t i=begin; i < end; ++i){
+                    if(nearest[i] != KdTree::INVALID && squaredDistances[i] <= limit){
+                        matchedSources[target] = levelSources[i];
+                        matchedTargets[target] = points[nearest[i]];
+                        if(pointToPlane)
+                            matchedNormals[target] = normals[nearest[i]];
+                        ++target;
+                    }
+                }
+            });
+
+            // One Gauss-Newton step (the correspondences change after it):
+            float rms = float(std::sqrt(inliers.sum / inliers.count));
+            PoseSettings poseSettings;
+            poseSettings.optimizer = PoseOptimizer::GaussNewton;
+            poseSettings.loss = settings.loss;
+            poseSettings.lossScale = std::max(rms, FLT_MIN);
+            poseSettings.maxIterations = 1;
+
+            PoseResult step = estimateRigidPose(matchedSources.data(), matchedTargets.data(),
+                                                pointToPlane ? matchedNormals.data() : nullptr, inliers.count,
+                                                poseSettings, result.pose);
+
+            float change = getPoseChange(result.pose, step.pose);
+            result.pose = step.pose;
+            result.correspondenceCount = inliers.count;
+            result.rmsError = rms;
+
+            if(change < settings.tolerance){
+                result.converged = true;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,167 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our matrices, vectors, the k-d tree and the pose solver: */
+#include "../math/Mat4f.h"
+#include "../math/Vec4f.h"
+#include "KdTree.h"
+#include "PoseEstimation.h"
+
+/**
+ * The error metrics of the iterative closest point algorithm.
+ */
+enum class IcpMetric {
+    /**
+     * Minimizes the distances between the points and their closest target
+     * points. Needs no normals, but converges slowly on flat surfaces.
+     */
+    PointToPoint,
+
+    /**
+     * Minimizes the distances between the points and the tangent planes of
+     * their closest target points, so points may slide along the surface.
+     * Usually needs far fewer iterations, but requires target normals.
+     */
+    PointToPlane
+};
+
+/**
+ * The parameters of IcpRegistration::align(...).
+ */
+
+class IcpSettings
+{
+public:
+    /** The error metric (default PointToPlane) */
+    IcpMetric metric;
+
+    /** The robust loss of the pose estimation (default Huber) */
+    RobustLoss loss;
+
+    /**
+     * The number of levels of the coarse-to-fine scheme (default 3). Level l
+     * (counted from the finest level 0) only uses every levelFactor^l-th
+     * source point.
+     */
+    size_t levelCount;
+
+    /** The subsampling factor between two levels (default 4) */
+    size_t levelFactor;
+
+    /** The maximum number of iterations per level (default 20) */
+    size_t maxIterations;
+
+    /**
+     * Correspondences whose points are farther apart than this distance are
+     * never used (default 0.1, in the units of the points). This should be
+     * about the largest expected misalignment, and it also bounds the search
+     * in the k-d tree.
+     */
+    float maxCorrespondenceDistance;
+
+    /**
+     * Correspondences whose distance is larger than rejectionFactor times
+     * the RMS distance of all correspondences are rejected as outliers
+     * (default 3).
+     */
+    float rejectionFactor;
+
+    /**
+     * A level is finished when an iteration changes no cell of the rotation
+     * by more than 'tolerance' and no component of the translation by more
+     * than 'tolerance' (default 1e-5).
+     */
+    float tolerance;
+
+    /**
+     * Constructs the default settings.
+     */
+    IcpSettings();
+};
+
+/**
+ * The outcome of IcpRegistration::align(...).
+ */
+
+class IcpResult
+{
+public:
+    /** The transformation which maps the source points onto the target */
+    Mat4f pose;
+
+    /** The number of iterations over all levels */
+    size_t iterations;
+
+    /** The number of correspondences which were used in the last iteration */
+    size_t correspondenceCount;
+
+    /** The RMS distance of these correspondences */
+    float rmsError;
+
+    /** Whether the finest level converged */
+    bool converged;
+};
+
+/**
+ * Aligns point clouds (scans) to a fixed target point cloud with the
+ * iterative closest point algorithm (ICP; Besl and McKay, 1992, and Chen and
+ * Medioni, 1992, for point-to-plane). The target is prepared once by the
+ * constructor (which builds a KdTree), so many scans can be aligned to it.
+ *
+ * Every iteration of align(...)
+ *
+ *  1. transforms the source points of the current level with the current
+ *     pose and finds their closest target points (in parallel),
+ *  2. rejects correspondences which are farther apart than
+ *     maxCorrespondenceDistance or rejectionFactor times their RMS distance,
+ *     and compacts the remaining ones with a parallel prefix sum,
+ *  3. estimates a new pose from the correspondences with one Gauss-Newton
+ *     step of estimateRigidPose(...), whose parallel accumulation uses the
+ *     robust loss with the RMS distance as scale.
+ *
+ * The coarse levels only use a subset of the source points, so most of the
+ * misalignment is removed cheaply before the finest level uses all points.
+ * All steps are deterministic, so the result does not depend on the number
+ * of threads. The closest point queries are the most expensive step; they
+ * are fastest if neighbouring source points are stored close to each other
+ * (like the scan lines of a scanner), since consecutive queries then visit
+ * the same nodes of the tree, which are already in the cache.
+ */
+
+class IcpRegistration
+{
+public:
+    /**
+     * Prepares the given target points and (optional, normalized) normals.
+     * The normals are needed for IcpMetric::PointToPlane. Throws
+     * std::invalid_argument if count == 0.
+     */
+    IcpRegistration(const Vec4f* targetPoints, const Vec4f* targetNormals, size_t count);
+
+    /**
+     * Returns the k-d tree of the target points.
+     */
+    const KdTree& getTree() const;
+
+    /**
+     * Aligns the given source points to the target, starting at the given
+     * (rigid) initial pose. Throws std::invalid_argument if count == 0, or if
+     * point-to-plane is requested without target normals.
+     */
+    IcpResult align(const Vec4f* sources, size_t count, const IcpSettings& settings,
+                    const Mat4f& initialPose = Mat4f()) const;
+
+private:
+    std::vector<Vec4f> points;
+    std::vector<Vec4f> normals;
+    KdTree tree;
+};
@@ -0,0 +1,297 @@
+#include "KMeans.h"
+#include "../math/Distances.h"
+#include "../math/Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+/* The number of points which are assigned by one task: */
+const size_t KMEANS_GRAIN_SIZE = 16384;
+
+/* The maximum number of chunks whose partial sums of the centers are stored
+   (each needs 4 doubles per cluster): */
+const size_t KMEANS_MAX_SUM_CHUNKS = 256;
+
+/* The number of clusters whose partial sums are combined by one task: */
+const size_t KMEANS_CENTER_GRAIN_SIZE = 64;
+
+/* Returns the distance between a and b (only x, y and z): */
+float distance(const Vec4f& a, const Vec4f& b){
+    float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/* Returns a uniformly distributed random number in [0, 1), which (unlike
+   std::uniform_real_distribution) is the same for every standard library: */
+double random01(std::mt19937_64& generator){
+    return double(generator() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Chooses the initial centers with k-means++ (see computeKMeans(...)).
+ */
+std::vector<Vec4f> seedCenters(const Vec4f* points, size_t count, size_t clusterCount, uint32_t seed){
+    std::mt19937_64 generator(seed);
+    std::vector<Vec4f> centers;
+    centers.reserve(clusterCount);
+
+    // The squared distance of every point to its closest center so far, and
+    // the sum of these distances per chunk:
+    std::vector<float> squared(count, FLT_MAX);
+    size_t chunkCount = getChunkCount(count, KMEANS_GRAIN_SIZE);
+    std::vector<double> chunkSums(chunkCount);
+
+    size_t next = std::min(size_t(random01(generator) * count), count - 1);
+    while(true){
+        Vec4f center(points[next].x, points[next].y, points[next].z);
+        centers.push_back(center);
+        if(centers.size() == clusterCount)
+            break;
+
+        parallelFor(0, count, KMEANS_GRAIN_SIZE, [&](size_t begin, size_t end){
+            double sum = 0.0;
+            for(size_t i=begin; i < end; ++i){
+                float dx = points[i].x - center.x, dy = points[i].y - center.y, dz = points[i].z - center.z;
+                squared[i] = std::min(squared[i], dx * dx + dy * dy + dz * dz);
+                sum += squared[i];
+            }
+            chunkSums[begin / KMEANS_GRAIN_SIZE] = sum;
+        });
+
+        double total = 0.0;
+        for(double sum : chunkSums)
+            total += sum;
+
+        // If all points coincide with centers, the remaining centers are
+        // duplicates (and their clusters stay empty):
+        if(!(total > 0.0)){
+            next = centers.size();
+            continue;
+        }
+
+        // Find the chunk and then the point at which the prefix sum of the
+        // squared distances reaches the random target (rounding errors fall
+        // back to the last chunk and point with a positive distance):
+        double target = random01(generator) * total;
+        size_t chunk = 0;
+        for(; chunk < chunkCount; ++chunk){
+            if(target < chunkSums[chunk])
+                break;
+            target -= chunkSums[chunk];
+        }
+        if(chunk == chunkCount){
+            do {
+                --chunk;
+            } while(!(chunkSums[chunk] > 0.0));
+            target = chunkSums[chunk];
+        }
+
+        size_t end = std::min((chunk + 1) * KMEANS_GRAIN_SIZE, count);
+        for(size_t i=chunk * KMEANS_GRAIN_SIZE; i < end; ++i){
+            if(squared[i] > 0.f){
+                next = i;
+                if(target < squared[i])
+                    break;
+                target -= squared[i];
+            }
+        }
+    }
+
+    return centers;
+}
+
+/**
+ * Computes half of the distance of every center to its closest other center.
+ */
+void computeHalfSeparations(const std::vector<Vec4f>& centers, std::vector<float>& halfSeparations){
+    std::vector<float> closest(centers.size(), FLT_MAX);
+    computeSquaredDistances(centers.data(), centers.size(), centers.data(), centers.size(),
+        [&](size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd, const float* tile, size_t stride){
+            for(size_t j=columnBegin; j < columnEnd; ++j){
+                const float* column = tile + (j - columnBegin) * stride;
+                for(size_t r=rowBegin; r < rowEnd; ++r){
+                    if(r != j)
+                        closest[r] = std::min(closest[r], column[r - rowBegin]);
+                }
+            }
+        });
+
+    for(size_t c=0; c < centers.size(); ++c)
+        halfSeparations[c] = 0.5f * std::sqrt(closest[c]);
+}
+
+}
+
+KMeansSettings::KMeansSettings()
+    : maxIterations(100), seed(1)
+{
+}
+
+KMeansResult computeKMeans(const Vec4f* points, size_t count, size_t clusterCount, const KMeansSettings& settings){
+    if(clusterCount == 0 || clusterCount > count)
+        throw std::invalid_argument("computeKMeans: the number of clusters must be in [1, count].");
+    if(count >= size_t(0xffffffffu))
+        throw std::invalid_argument("computeKMeans: too many points.");
+
+    KMeansResult result;
+    result.centers = seedCenters(points, count, clusterCount, settings.seed);
+    result.assignments.assign(count, 0);
+    result.iterations = 0;
+    result.distanceCount = 0;
+    result.converged = false;
+
+    std::vector<Vec4f>& centers = result.centers;
+    std::vector<uint32_t>& assignments = result.assignments;
+
+    // The bounds of every point (see Hamerly) and the state of the centers:
+    std::vector<float> upper(count, FLT_MAX), lower(count, 0.f);
+    std::vector<float> halfSeparations(clusterCount, 0.f), movements(clusterCount, 0.f);
+    float largestMovement = 0.f, secondMovement = 0.f;
+    uint32_t mostMoved = 0;
+
+    size_t chunkCount = getChunkCount(count, KMEANS_GRAIN_SIZE);
+    std::vector<size_t> changes(chunkCount), evaluations(chunkCount);
+
+    // The partial sums (x, y, z, count) of the clusters per chunk; the number
+    // of chunks only depends on the number of points:
+    size_t sumGrainSize = std::max(KMEANS_GRAIN_SIZE, (count + KMEANS_MAX_SUM_CHUNKS - 1) / KMEANS_MAX_SUM_CHUNKS);
+    std::vector<double> sums(getChunkCount(count, sumGrainSize) * clusterCount * 4);
+
+    for(size_t iteration=0; iteration < settings.maxIterations; ++iteration){
+        bool first = iteration == 0;
+        if(!first)
+            computeHalfSeparations(centers, halfSeparations);
+
+        // Assign the points whose bounds do not exclude a change:
+        parallelFor(0, count, KMEANS_GRAIN_SIZE, [&](size_t begin, size_t end){
+            std::vector<uint32_t> candidates;
+            std::vector<Vec4f> candidatePoints;
+            size_t evaluated = 0;
+            for(size_t i=begin; i < end; ++i){
+                if(!first){
+                    uint32_t a = assignments[i];
+                    upper[i] += movements[a];
+                    lower[i] -= a == mostMoved ? secondMovement : largestMovement;
+                    float bound = std::max(halfSeparations[a], lower[i]);
+                    if(upper[i] <= bound)
+                        continue;
+
+                    upper[i] = distance(points[i], centers[a]);
+                    ++evaluated;
+                    if(upper[i] <= bound)
+                        continue;
+                }
+                candidates.push_back(uint32_t(i));
+                candidatePoints.push_back(points[i]);
+            }
+
+            // Find the closest and second closest center of the candidates
+            // (serially, since this is inside of a parallelFor):
+            size_t candidateCount = candidates.size();
+            std::vector<float> nearest(candidateCount, FLT_MAX), second(candidateCount, FLT_MAX);
+            std::vector<uint32_t> nearestCenters(candidateCount, 0);
+            computeSquaredDistances(candidatePoints.data(), candidateCount, centers.data(), clusterCount,
+                [&](size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd, const float* tile, size_t stride){
+                    for(size_t j=columnBegin; j < columnEnd; ++j){
+                        const float* column = tile + (j - columnBegin) * stride;
+                        for(size_t r=rowBegin; r < rowEnd; ++r){
+                            float d = column[r - rowBegin];
+                            if(d < nearest[r]){
+                                second[r] = nearest[r];
+                                nearest[r] = d;
+                                nearestCenters[r] = uint32_t(j);
+                            } else {
+                                second[r] = std::min(second[r], d);
+                            }
+                        }
+                    }
+                });
+
+            size_t changed = 0;
+            for(size_t c=0; c < candidateCount; ++c){
+                uint32_t i = candidates[c];
+                if(first || assignments[i] != nearestCenters[c])
+                    ++changed;
+                assignments[i] = nearestCenters[c];
+                upper[i] = std::sqrt(nearest[c]);
+                lower[i] = std::sqrt(second[c]);
+            }
+
+            size_t chunk = begin / KMEANS_GRAIN_SIZE;
+            changes[chunk] = changed;
+            evaluations[chunk] = evaluated + candidateCount * clusterCount;
+        });
+
+        size_t changedCount = 0;
+        for(size_t chunk=0; chunk < chunkCount; ++chunk){
+            changedCount += changes[chunk];
+            result.distanceCount += evaluations[chunk];
+        }
+        result.iterations = iteration + 1;
+        if(changedCount == 0){
+            result.converged = true;
+            break;
+        }
+
+        // Move the centers to the means of their points:
+        parallelFor(0, count, sumGrainSize, [&](size_t begin, size_t end){
+            double* chunkSums = &sums[(begin / sumGrainSize) * clusterCount * 4];
+            std::fill(chunkSums, chunkSums + clusterCount * 4, 0.0);
+            for(size_t i=begin; i < end; ++i){
+                double* sum = chunkSums + assignments[i] * 4;
+                sum[0] += points[i].x;
+                sum[1] += points[i].y;
+                sum[2] += points[i].z;
+                sum[3] += 1.0;
+            }
+        });
+
+        size_t sumChunkCount = sums.size() / (clusterCount * 4);
+        parallelFor(0, clusterCount, KMEANS_CENTER_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t c=begin; c < end; ++c){
+                double total[4] = {0.0, 0.0, 0.0, 0.0};
+                for(size_t chunk=0; chunk < sumChunkCount; ++chunk){
+                    for(int d=0; d < 4; ++d)
+                        total[d] += sums[(chunk * clusterCount + c) * 4 + d];
+                }
+
+                movements[c] = 0.f;
+                if(total[3] > 0.0){
+                    Vec4f center(float(total[0] / total[3]), float(total[1] / total[3]), float(total[2] / total[3]));
+                    movements[c] = distance(centers[c], center);
+                    centers[c] = center;
+                }
+            }
+        });
+
+        largestMovement = secondMovement = 0.f;
+        mostMoved = 0;
+        for(size_t c=0; c < clusterCount; ++c){
+            if(movements[c] > largestMovement){
+                secondMovement = largestMovement;
+                largestMovement = movements[c];
+                mostMoved = uint32_t(c);
+            } else {
+                secondMovement = std::max(secondMovement, movements[c]);
+            }
+        }
+    }
+
+    result.inertia = parallelReduce(size_t(0), count, KMEANS_GRAIN_SIZE, 0.0,
+        [&](size_t begin, size_t end){
+            double sum = 0.0;
+            for(size_t i=begin; i < end; ++i){
+                float d = distance(points[i], centers[assignments[i]]);
+                sum += d * d;
+            }
+            return sum;
+        },
+        [](double a, double b){ return a + b; });
+
+    return result;
+}
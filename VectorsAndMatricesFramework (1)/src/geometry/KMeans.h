@@ -0,0 +1,99 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors: */
+#include "../math/Vec4f.h"
+
+/**
+ * The parameters of computeKMeans(...).
+ */
+
+class KMeansSettings
+{
+public:
+    /** The maximum number of iterations (default 100) */
+    size_t maxIterations;
+
+    /**
+     * The seed of the random numbers of the k-means++ seeding (default 1).
+     * The same seed always gives the same clusters.
+     */
+    uint32_t seed;
+
+    /**
+     * Constructs the default settings.
+     */
+    KMeansSettings();
+};
+
+/**
+ * The outcome of computeKMeans(...).
+ */
+
+class KMeansResult
+{
+public:
+    /** The centers of the clusters (w = 1) */
+    std::vector<Vec4f> centers;
+
+    /** The index of the cluster of every point */
+    std::vector<uint32_t> assignments;
+
+    /** The number of iterations */
+    size_t iterations;
+
+    /** The sum of the squared distances of all points to their centers */
+    double inertia;
+
+    /**
+     * The number of point-center distances which were computed after the
+     * seeding (count * clusters * iterations without the bounds).
+     */
+    size_t distanceCount;
+
+    /** Whether the last iteration did not change any assignment */
+    bool converged;
+};
+
+/**
+ * Partitions the given points into 'clusterCount' clusters so that the sum of
+ * the squared distances of the points to the centers of their clusters is
+ * (locally) minimal (Lloyd's algorithm), for example to build levels of
+ * detail or to find instances of repeated geometry.
+ *
+ * The initial centers are chosen with k-means++ (Arthur and Vassilvitskii,
+ * 2007): every further center is a random point, chosen with a probability
+ * proportional to its squared distance to the closest center so far. Each of
+ * these clusterCount passes over the points is parallel.
+ *
+ * The iterations use the bounds of Hamerly ("Making k-means even faster",
+ * 2010) to skip most distance computations: every point keeps an upper bound
+ * of the distance to its center and a lower bound of the distance to every
+ * other center. If the upper bound is below the lower bound and below half of
+ * the distance between its center and the closest other center, the point
+ * cannot change its cluster. When the centers move, the bounds are only
+ * loosened by the distances they moved. Only the remaining points are
+ * compared with all centers, with the blocked kernel of
+ * computeSquaredDistances(...) (see Distances.h), which also computes the
+ * distances between the centers.
+ *
+ * The points are assigned in parallel chunks, and the new centers are summed
+ * per chunk (in double precision) and then combined in a fixed order, so the
+ * result does not depend on the number of threads. Clusters which lose all
+ * their points keep their old center.
+ *
+ * Throws std::invalid_argument if clusterCount is 0 or larger than count, or
+ * if count does not fit into 32 bits.
+ */
+KMeansResult computeKMeans(const Vec4f* points, size_t count, size_t clusterCount,
+                           const KMeansSettings& settings = KMeansSettings());
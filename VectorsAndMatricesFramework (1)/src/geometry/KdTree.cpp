@@ -0,0 +1,261 @@
+#include "KdTree.h"
+#include "../math/Parallel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/* The number of queries which are processed by one task: */
+const size_t QUERY_GRAIN_SIZE = 1024;
+
+/* The maximum depth of the traversal stack (the tree of 2^32 points has a
+   depth of less than 32): */
+const int STACK_SIZE = 64;
+
+/* A point during the construction (with its original index): */
+struct Entry {
+    float coordinates[3];
+    uint32_t index;
+};
+
+/* A subtree which still has to be visited by a query, with a lower bound of
+   its squared distance to the query: */
+struct StackEntry {
+    uint32_t node;
+    uint32_t begin;
+    uint32_t end;
+    float bound;
+};
+
+/* Returns the range [begin, end) of points of the given node: */
+void getNodeRange(uint32_t node, uint32_t count, uint32_t& begin, uint32_t& end){
+    begin = 0;
+    end = count;
+
+    // The bits of node + 1 below the highest one describe the path from the
+    // root (0 = left, 1 = right):
+    uint64_t path = uint64_t(node) + 1;
+    int depth = 0;
+    while((path >> (depth + 1)) != 0)
+        ++depth;
+
+    for(int bit=depth - 1; bit >= 0; --bit){
+        uint32_t middle = begin + (end - begin) / 2;
+        if((path >> bit) & 1)
+            begin = middle;
+        else
+            end = middle;
+    }
+}
+
+}
+
+KdTree::KdTree()
+{}
+
+KdTree::KdTree(const Vec4f* inputPoints, size_t count){
+    if(count >= INVALID)
+        throw std::invalid_argument("KdTree: too many points.");
+
+    std::vector<Entry> entries(count);
+    parallelFor(0, count, QUERY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            Entry entry = {{inputPoints[i].x, inputPoints[i].y, inputPoints[i].z}, uint32_t(i)};
+            entries[i] = entry;
+        }
+    });
+
+    // The number of levels of inner nodes (the largest range is halved until
+    // it fits into a leaf):
+    int depth = 0;
+    for(size_t size=count; size > KD_TREE_LEAF_SIZE; size = (size + 1) / 2)
+        ++depth;
+
+    size_t nodeCount = (size_t(1) << depth) - 1;
+    splits.resize(nodeCount);
+    axes.resize(nodeCount);
+
+    for(int level=0; level < depth; ++level){
+        size_t first = (size_t(1) << level) - 1;
+        parallelFor(first, 2 * first + 1, 1, [&](size_t begin, size_t end){
+            for(size_t node=begin; node < end; ++node){
+                uint32_t rangeBegin, rangeEnd;
+                getNodeRange(uint32_t(node), uint32_t(count), rangeBegin, rangeEnd);
+                if(rangeEnd - rangeBegin <= KD_TREE_LEAF_SIZE)
+                    continue;
+
+                // Split along the axis of the largest extent:
+                float min[3] = {entries[rangeBegin].coordinates[0], entries[rangeBegin].coordinates[1],
+                                entries[rangeBegin].coordinates[2]};
+                float max[3] = {min[0], min[1], min[2]};
+                for(uint32_t i=rangeBegin + 1; i < rangeEnd; ++i){
+                    for(int a=0; a < 3; ++a){
+                        min[a] = std::min(min[a], entries[i].coordinates[a]);
+                        max[a] = std::max(max[a], entries[i].coordinates[a]);
+                    }
+                }
+                int axis = 0;
+                for(int a=1; a < 3; ++a){
+                    if(max[a] - min[a] > max[axis] - min[axis])
+                        axis = a;
+                }
+
+                uint32_t middle = rangeBegin + (rangeEnd - rangeBegin) / 2;
+                std::nth_element(entries.begin() + rangeBegin, entries.begin() + middle, entries.begin() + rangeEnd,
+                    [axis](const Entry& a, const Entry& b){ return a.coordinates[axis] < b.coordinates[axis]; });
+                splits[node] = entries[middle].coordinates[axis];
+                axes[node] = uint8_t(axis);
+            }
+        });
+    }
+
+    points.resize(count);
+    indices.resize(count);
+    parallelFor(0, count, QUERY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            points[i] = Vec4f(entries[i].coordinates[0], entries[i].coordinates[1], entries[i].coordinates[2]);
+            indices[i] = entries[i].index;
+        }
+    });
+}
+
+size_t KdTree::getPointCount() const{
+    return points.size();
+}
+
+uint32_t KdTree::findNearest(const Vec4f& query, float maxDistance, float* squaredDistance) const{
+    float best = maxDistance * maxDistance;
+    uint32_t bestIndex = INVALID;
+    float q[3] = {query.x, query.y, query.z};
+
+    StackEntry stack[STACK_SIZE];
+    int top = 0;
+    StackEntry root = {0, 0, uint32_t(points.size()), 0.f};
+    stack[top++] = root;
+
+    while(top > 0){
+        StackEntry entry = stack[--top];
+        if(entry.bound >= best)
+            continue;
+
+        // Descend into the closer child and remember the other one:
+        uint32_t node = entry.node, begin = entry.begin, end = entry.end;
+        while(end - begin > KD_TREE_LEAF_SIZE){
+            uint32_t middle = begin + (end - begin) / 2;
+            float difference = q[axes[node]] - splits[node];
+            float bound = difference * difference;
+            if(difference < 0.f){
+                if(bound < best){
+                    StackEntry far = {2 * node + 2, middle, end, bound};
+                    stack[top++] = far;
+                }
+                node = 2 * node + 1;
+                end = middle;
+            } else {
+                if(bound < best){
+                    StackEntry far = {2 * node + 1, begin, middle, bound};
+                    stack[top++] = far;
+                }
+                node = 2 * node + 2;
+                begin = middle;
+            }
+        }
+
+        for(uint32_t i=begin; i < end; ++i){
+            float dx = points[i].x - q[0], dy = points[i].y - q[1], dz = points[i].z - q[2];
+            float distance = dx * dx + dy * dy + dz * dz;
+            if(distance < best){
+                best = distance;
+                bestIndex = i;
+            }
+        }
+    }
+
+    if(bestIndex == INVALID)
+        return INVALID;
+
+    if(squaredDistance)
+        *squaredDistance = best;
+    return indices[bestIndex];
+}
+
+size_t KdTree::findNearest(const Vec4f& query, size_t k, float maxDistance, uint32_t* resultIndices,
+                           float* squaredDistances) const{
+    if(k == 0)
+        return 0;
+
+    // The found points are kept sorted in the output arrays (with tree
+    // indices, which are converted at the end):
+    size_t found = 0;
+    float limit = maxDistance * maxDistance;
+    float q[3] = {query.x, query.y, query.z};
+
+    StackEntry stack[STACK_SIZE];
+    int top = 0;
+    StackEntry root = {0, 0, uint32_t(points.size()), 0.f};
+    stack[top++] = root;
+
+    while(top > 0){
+        StackEntry entry = stack[--top];
+        float best = found == k ? squaredDistances[k - 1] : limit;
+        if(entry.bound >= best)
+            continue;
+
+        uint32_t node = entry.node, begin = entry.begin, end = entry.end;
+        while(end - begin > KD_TREE_LEAF_SIZE){
+            uint32_t middle = begin + (end - begin) / 2;
+            float difference = q[axes[node]] - splits[node];
+            float bound = difference * difference;
+            if(difference < 0.f){
+                if(bound < best){
+                    StackEntry far = {2 * node + 2, middle, end, bound};
+                    stack[top++] = far;
+                }
+                node = 2 * node + 1;
+                end = middle;
+            } else {
+                if(bound < best){
+                    StackEntry far = {2 * node + 1, begin, middle, bound};
+                    stack[top++] = far;
+                }
+                node = 2 * node + 2;
+                begin = middle;
+            }
+        }
+
+        for(uint32_t i=begin; i < end; ++i){
+            float dx = points[i].x - q[0], dy = points[i].y - q[1], dz = points[i].z - q[2];
+            float distance = dx * dx + dy * dy + dz * dz;
+            if(distance >= best)
+                continue;
+
+            // Insert the point into the sorted list (dropping the farthest
+            // one if it is full):
+            size_t position = found < k ? found++ : k - 1;
+            while(position > 0 && squaredDistances[position - 1] > distance){
+                squaredDistances[position] = squaredDistances[position - 1];
+                resultIndices[position] = resultIndices[position - 1];
+                --position;
+            }
+            squaredDistances[position] = distance;
+            resultIndices[position] = i;
+            best = found == k ? squaredDistances[k - 1] : limit;
+        }
+    }
+
+    for(size_t i=0; i < found; ++i)
+        resultIndices[i] = indices[resultIndices[i]];
+    return found;
+}
+
+void KdTree::findNearestBatch(const Vec4f* queries, size_t count, float maxDistance, uint32_t* resultIndices,
+                              float* squaredDistances) const{
+    parallelFor(0, count, QUERY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            resultIndices[i] = findNearest(queries[i], maxDistance, squaredDistances + i);
+            if(resultIndices[i] == INVALID)
+                squaredDistances[i] = maxDistance * maxDistance;
+        }
+    });
+}
@@ -0,0 +1,103 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors: */
+#include "../math/Vec4f.h"
+
+/**
+ * The maximum number of points in a leaf of a KdTree.
+ */
+#define KD_TREE_LEAF_SIZE 8
+
+/**
+ * A k-d tree for nearest neighbour queries on a static point set (for example
+ * the target scan of ICP, see IcpRegistration.h). Only x, y and z of the
+ * points are used.
+ *
+ * The tree is balanced and implicit: every node splits its range of points
+ * at the median along the axis of the largest extent, so the ranges (and the
+ * children 2 * i + 1 and 2 * i + 2 of node i) follow from the number of
+ * points alone, and a node only stores its split value and axis. The points
+ * are stored in tree order, so the points of a leaf are contiguous in memory.
+ * The levels of the tree are built one after another, with the nodes of a
+ * level in parallel.
+ *
+ * All queries are read-only, so any number of threads may query the tree at
+ * the same time.
+ */
+
+class KdTree
+{
+public:
+    /**
+     * The index which is returned if no point was found.
+     */
+    static const uint32_t INVALID = 0xffffffffu;
+
+    /**
+     * Constructs an empty tree.
+     */
+    KdTree();
+
+    /**
+     * Builds the tree for the given points (which are copied).
+     */
+    KdTree(const Vec4f* points, size_t count);
+
+    /**
+     * Returns the number of points.
+     */
+    size_t getPointCount() const;
+
+    /**
+     * Returns the index (in the array which was given to the constructor) of
+     * the point which is closest to 'query' and closer than 'maxDistance',
+     * or INVALID if there is no such point. If 'squaredDistance' is not
+     * nullptr, it receives the squared distance to the point.
+     *
+     * A small maxDistance makes the query much faster, since fewer branches
+     * of the tree need to be visited.
+     */
+    uint32_t findNearest(const Vec4f& query, float maxDistance, float* squaredDistance = nullptr) const;
+
+    /**
+     * Finds the (at most) k points which are closest to 'query' and closer
+     * than 'maxDistance'. Their indices and squared distances are written
+     * into 'indices' and 'squaredDistances' (which must provide space for k
+     * elements), sorted from the closest one. Returns the number of found
+     * points.
+     */
+    size_t findNearest(const Vec4f& query, size_t k, float maxDistance, uint32_t* indices,
+                       float* squaredDistances) const;
+
+    /**
+     * Calls findNearest(...) for all given queries in parallel. 'indices' and
+     * 'squaredDistances' must provide space for 'count' elements (queries
+     * without a point get INVALID and maxDistance^2).
+     */
+    void findNearestBatch(const Vec4f* queries, size_t count, float maxDistance, uint32_t* indices,
+                          float* squaredDistances) const;
+
+private:
+    /** The points in tree order */
+    std::vector<Vec4f> points;
+
+    /** The original index of every point in tree order */
+    std::vector<uint32_t> indices;
+
+    /** The split value of every inner node */
+    std::vector<float> splits;
+
+    /** The split axis (0, 1 or 2) of every inner node */
+    std::vector<uint8_t> axes;
+};
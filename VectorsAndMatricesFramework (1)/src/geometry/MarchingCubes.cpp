@@ -0,0 +1,365 @@
+#include "MarchingCubes.h"
+#include "../math/Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/* The number of z-layers which are processed by one task: */
+const size_t MC_SLAB_SIZE = 4;
+
+/* The maximum number of triangles of one cube (a loop through k of the 12
+   edges has k - 2 triangles): */
+const int MC_MAX_TRIANGLES = 10;
+
+/* The two corners of every edge of a cube; the corner i lies at
+   (i & 1, (i >> 1) & 1, (i >> 2) & 1). The edges 0-3 point along x, 4-7
+   along y and 8-11 along z: */
+const int EDGE_CORNERS[12][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7},
+    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
+/* The corners of the six faces in cyclic order, and the outer normals: */
+const int FACE_CORNERS[6][4] = {
+    {0, 2, 6, 4}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 5, 7, 6}
+};
+const int FACE_NORMALS[6][3] = {
+    {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
+};
+
+/**
+ * The triangles of all 256 cases (bit i of the case is set if corner i is
+ * inside), as edge indices.
+ */
+struct MarchingCubesTables {
+    int triangleCounts[256];
+    int triangles[256][3 * MC_MAX_TRIANGLES];
+};
+
+/* Returns the edge between two corners of a cube: */
+int getEdge(int a, int b){
+    for(int e=0; e < 12; ++e){
+        if((EDGE_CORNERS[e][0] == a && EDGE_CORNERS[e][1] == b) || (EDGE_CORNERS[e][0] == b && EDGE_CORNERS[e][1] == a))
+            return e;
+    }
+    return -1;
+}
+
+/* Returns whether two edges of a cube lie in the same face: */
+bool shareFace(int a, int b){
+    for(int f=0; f < 6; ++f){
+        int found = 0;
+        for(int k=0; k < 4; ++k){
+            int e = getEdge(FACE_CORNERS[f][k], FACE_CORNERS[f][(k + 1) % 4]);
+            found += (e == a) + (e == b);
+        }
+        if(found == 2)
+            return true;
+    }
+    return false;
+}
+
+/* Returns coordinate d of the corner (times 2, so that midpoints of edges
+   are integers): */
+int getCoordinate(int corner, int d){
+    return 2 * ((corner >> d) & 1);
+}
+
+/**
+ * Generates the triangles of one case: on every face, each run of
+ * consecutive inside corners is cut off by a segment between its two cut
+ * edges, directed so that the inside corners lie on its right (seen from the
+ * outside of the cube). These segments form closed loops through the cut
+ * edges, which are triangulated as fans; the triangles are then
+ * counterclockwise seen from the outside of the surface.
+ */
+void generateCase(int index, MarchingCubesTables& tables){
+    int next[12];
+    std::fill(next, next + 12, -1);
+
+    for(int f=0; f < 6; ++f){
+        const int* corners = FACE_CORNERS[f];
+        for(int k=0; k < 4; ++k){
+            // Find the runs which start at corner k:
+            bool inside = (index >> corners[k]) & 1;
+            bool previousInside = (index >> corners[(k + 3) % 4]) & 1;
+            if(!inside || previousInside)
+                continue;
+            int last = k;
+            while(((index >> corners[(last + 1) % 4]) & 1) && (last + 1) % 4 != k)
+                last = (last + 1) % 4;
+            if((last + 1) % 4 == k)
+                continue;
+
+            int p = getEdge(corners[(k + 3) % 4], corners[k]);
+            int q = getEdge(corners[last], corners[(last + 1) % 4]);
+
+            // Direct the segment p -> q so that the corner k lies on its
+            // right: ((Q - P) x (C - P)) . n < 0.
+            int P[3], Q[3], C[3];
+            for(int d=0; d < 3; ++d){
+                P[d] = (getCoordinate(EDGE_CORNERS[p][0], d) + getCoordinate(EDGE_CORNERS[p][1], d)) / 2;
+                Q[d] = (getCoordinate(EDGE_CORNERS[q][0], d) + getCoordinate(EDGE_CORNERS[q][1], d)) / 2;
+                C[d] = getCoordinate(corners[k], d);
+            }
+            int u[3] = {Q[0] - P[0], Q[1] - P[1], Q[2] - P[2]};
+            int v[3] = {C[0] - P[0], C[1] - P[1], C[2] - P[2]};
+            int cross[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+            int side = cross[0] * FACE_NORMALS[f][0] + cross[1] * FACE_NORMALS[f][1] + cross[2] * FACE_NORMALS[f][2];
+            if(side < 0)
+                next[p] = q;
+            else
+                next[q] = p;
+        }
+    }
+
+    int count = 0;
+    bool visited[12] = {};
+    for(int start=0; start < 12; ++start){
+        if(next[start] < 0 || visited[start])
+            continue;
+
+        int loop[12];
+        int length = 0;
+        for(int e=start; !visited[e]; e=next[e]){
+            visited[e] = true;
+            loop[length++] = e;
+        }
+
+        // Start the fan at an edge whose diagonals do not lie in a face of the
+        // cube (they would coincide with those of the neighbouring cube):
+        int first = 0;
+        for(int s=0; s < length; ++s){
+            bool inFace = false;
+            for(int i=2; i + 1 < length; ++i)
+                inFace = inFace || shareFace(loop[s], loop[(s + i) % length]);
+            if(!inFace){
+                first = s;
+                break;
+            }
+        }
+        for(int i=1; i + 1 < length; ++i){
+            tables.triangles[index][3 * count] = loop[first];
+            tables.triangles[index][3 * count + 1] = loop[(first + i) % length];
+            tables.triangles[index][3 * count + 2] = loop[(first + i + 1) % length];
+            ++count;
+        }
+    }
+    tables.triangleCounts[index] = count;
+}
+
+/* Returns the tables (which are generated on the first call): */
+const MarchingCubesTables& getTables(){
+    static const MarchingCubesTables tables = []{
+        MarchingCubesTables result;
+        for(int index=0; index < 256; ++index)
+            generateCase(index, result);
+        return result;
+    }();
+    return tables;
+}
+
+/**
+ * The grid and the state of one extraction.
+ */
+struct Extraction {
+    const float* values;
+    size_t size[3];
+    Vec4f origin;
+    float voxelSize;
+    float isoValue;
+    bool computeNormals;
+
+    float getValue(size_t x, size_t y, size_t z) const {
+        return values[(z * size[1] + y) * size[0] + x];
+    }
+
+    /* Returns the case of the cube at (x, y, z): */
+    int getCase(size_t x, size_t y, size_t z) const {
+        const float* v = values + (z * size[1] + y) * size[0] + x;
+        size_t dy = size[0], dz = size[0] * size[1];
+        return (v[0] < isoValue) | (v[1] < isoValue) << 1 | (v[dy] < isoValue) << 2 | (v[dy + 1] < isoValue) << 3
+             | (v[dz] < isoValue) << 4 | (v[dz + 1] < isoValue) << 5 | (v[dz + dy] < isoValue) << 6
+             | (v[dz + dy + 1] < isoValue) << 7;
+    }
+
+    /* Returns the gradient at a grid point (central differences, one-sided
+       at the border): */
+    void getGradient(size_t x, size_t y, size_t z, float gradient[3]) const {
+        size_t p[3] = {x, y, z};
+        for(int d=0; d < 3; ++d){
+            size_t low[3] = {x, y, z}, high[3] = {x, y, z};
+            low[d] = p[d] > 0 ? p[d] - 1 : p[d];
+            high[d] = p[d] + 1 < size[d] ? p[d] + 1 : p[d];
+            float span = float(high[d] - low[d]);
+            gradient[d] = span > 0.f ? (getValue(high[0], high[1], high[2]) - getValue(low[0], low[1], low[2])) / span
+                                     : 0.f;
+        }
+    }
+
+    /**
+     * Numbers the cut edges of layer z (x-, y- and z-edge of every grid
+     * point, in this order, row by row), starting at 'first'. If 'emit' is
+     * set, their vertices are also written into the mesh. Returns the
+     * number of cut edges.
+     */
+    uint32_t processLayer(size_t z, uint32_t first, bool emit, uint32_t* edgeIndices, TriangleMesh& mesh) const {
+        uint32_t index = first;
+        for(size_t y=0; y < size[1]; ++y){
+            for(size_t x=0; x < size[0]; ++x){
+                float value = getValue(x, y, z);
+                bool inside = value < isoValue;
+                size_t neighbours[3][3] = {{x + 1, y, z}, {x, y + 1, z}, {x, y, z + 1}};
+                for(int d=0; d < 3; ++d){
+                    uint32_t& edgeIndex = edgeIndices[3 * (y * size[0] + x) + d];
+                    const size_t* n = neighbours[d];
+                    if(n[d] >= size[d]){
+                        edgeIndex = 0;
+                        continue;
+                    }
+                    float other = getValue(n[0], n[1], n[2]);
+                    if((other < isoValue) == inside){
+                        edgeIndex = 0;
+                        continue;
+                    }
+
+                    edgeIndex = index;
+                    if(emit)
+                        emitVertex(index, x, y, z, n, value, other, mesh);
+                    ++index;
+                }
+            }
+        }
+        return index - first;
+    }
+
+    void emitVertex(uint32_t index, size_t x, size_t y, size_t z, const size_t* n, float value, float other,
+                    TriangleMesh& mesh) const {
+        float t = (isoValue - value) / (other - value);
+        mesh.positions[index] = Vec4f(origin.x + (float(x) + t * float(n[0] - x)) * voxelSize,
+                                      origin.y + (float(y) + t * float(n[1] - y)) * voxelSize,
+                                      origin.z + (float(z) + t * float(n[2] - z)) * voxelSize);
+        if(!computeNormals)
+            return;
+
+        float g0[3], g1[3];
+        getGradient(x, y, z, g0);
+        getGradient(n[0], n[1], n[2], g1);
+        float g[3];
+        for(int d=0; d < 3; ++d)
+            g[d] = g0[d] + t * (g1[d] - g0[d]);
+        float length = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+        float inverse = length > 0.f ? 1.f / length : 0.f;
+        mesh.normals[index] = Vec4f(g[0] * inverse, g[1] * inverse, g[2] * inverse, 0.f);
+    }
+
+    /**
+     * Writes the triangles of the cubes of layer z, whose edges are numbered
+     * in the two given layers, starting at triangle 'first'.
+     */
+    void emitTriangles(size_t z, const uint32_t* lower, const uint32_t* upper, size_t first, TriangleMesh& mesh) const {
+        const MarchingCubesTables& tables = getTables();
+        uint32_t* out = &mesh.indices[3 * first];
+        for(size_t y=0; y + 1 < size[1]; ++y){
+            for(size_t x=0; x + 1 < size[0]; ++x){
+                int cubeCase = getCase(x, y, z);
+                int count = tables.triangleCounts[cubeCase];
+                if(count == 0)
+                    continue;
+
+                // The vertex indices of the 12 edges of the cube:
+                size_t row = y * size[0] + x, nextRow = row + size[0];
+                uint32_t edges[12] = {
+                    lower[3 * row], lower[3 * nextRow], upper[3 * row], upper[3 * nextRow],
+                    lower[3 * row + 1], lower[3 * (row + 1) + 1], upper[3 * row + 1], upper[3 * (row + 1) + 1],
+                    lower[3 * row + 2], lower[3 * (row + 1) + 2], lower[3 * nextRow + 2], lower[3 * (nextRow + 1) + 2]
+                };
+                const int* triangles = tables.triangles[cubeCase];
+                for(int i=0; i < 3 * count; ++i)
+                    *out++ = edges[triangles[i]];
+            }
+        }
+    }
+
+    /* Returns the number of triangles of the cubes of layer z: */
+    size_t countTriangles(size_t z) const {
+        const MarchingCubesTables& tables = getTables();
+        size_t count = 0;
+        for(size_t y=0; y + 1 < size[1]; ++y){
+            for(size_t x=0; x + 1 < size[0]; ++x)
+                count += tables.triangleCounts[getCase(x, y, z)];
+        }
+        return count;
+    }
+};
+
+}
+
+IsoSurfaceSettings::IsoSurfaceSettings()
+    : isoValue(0.f), computeNormals(true)
+{
+}
+
+TriangleMesh extractIsoSurface(const float* values, size_t sizeX, size_t sizeY, size_t sizeZ, const Vec4f& origin,
+                               float voxelSize, const IsoSurfaceSettings& settings){
+    TriangleMesh mesh;
+    if(sizeX < 2 || sizeY < 2 || sizeZ < 2)
+        return mesh;
+
+    Extraction extraction;
+    extraction.values = values;
+    extraction.size[0] = sizeX;
+    extraction.size[1] = sizeY;
+    extraction.size[2] = sizeZ;
+    extraction.origin = origin;
+    extraction.voxelSize = voxelSize;
+    extraction.isoValue = settings.isoValue;
+    extraction.computeNormals = settings.computeNormals;
+    getTables();
+
+    // 1. Count the vertices and triangles of every layer:
+    std::vector<size_t> vertexOffsets(sizeZ + 1, 0), triangleOffsets(sizeZ + 1, 0);
+    parallelFor(0, sizeZ, MC_SLAB_SIZE, [&](size_t begin, size_t end){
+        std::vector<uint32_t> edgeIndices(3 * sizeX * sizeY);
+        for(size_t z=begin; z < end; ++z){
+            vertexOffsets[z + 1] = extraction.processLayer(z, 0, false, edgeIndices.data(), mesh);
+            triangleOffsets[z + 1] = z + 1 < sizeZ ? extraction.countTriangles(z) : 0;
+        }
+    });
+    for(size_t z=0; z < sizeZ; ++z){
+        vertexOffsets[z + 1] += vertexOffsets[z];
+        triangleOffsets[z + 1] += triangleOffsets[z];
+    }
+    if(vertexOffsets[sizeZ] >= size_t(0xffffffffu))
+        throw std::invalid_argument("extractIsoSurface: the mesh has too many vertices.");
+
+    mesh.positions.resize(vertexOffsets[sizeZ]);
+    if(settings.computeNormals)
+        mesh.normals.resize(vertexOffsets[sizeZ]);
+    mesh.indices.resize(3 * triangleOffsets[sizeZ]);
+
+    // 2. Create the vertices of every layer, and the triangles from the edge
+    //    indices of the layer and the one above (which belongs to the next
+    //    slab at the end of a slab, but is numbered the same way there):
+    parallelFor(0, sizeZ, MC_SLAB_SIZE, [&](size_t begin, size_t end){
+        std::vector<uint32_t> lower(3 * sizeX * sizeY), upper(3 * sizeX * sizeY);
+        extraction.processLayer(begin, uint32_t(vertexOffsets[begin]), true, lower.data(), mesh);
+        for(size_t z=begin; z < end && z + 1 < sizeZ; ++z){
+            extraction.processLayer(z + 1, uint32_t(vertexOffsets[z + 1]), z + 1 < end, upper.data(), mesh);
+            extraction.emitTriangles(z, lower.data(), upper.data(), triangleOffsets[z], mesh);
+            lower.swap(upper);
+        }
+    });
+
+    return mesh;
+}
+
+TriangleMesh extractIsoSurface(const SignedDistanceField& field, const IsoSurfaceSettings& settings){
+    return extractIsoSurface(field.values.data(), field.sizeX, field.sizeY, field.sizeZ, field.origin, field.voxelSize,
+                             settings);
+}
@@ -0,0 +1,72 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our vectors, meshes and distance fields: */
+#include "../math/Vec4f.h"
+#include "TriangleMesh.h"
+#include "SignedDistanceField.h"
+
+/**
+ * The parameters of extractIsoSurface(...).
+ */
+
+class IsoSurfaceSettings
+{
+public:
+    /** The value of the surface (default 0) */
+    float isoValue;
+
+    /**
+     * Whether the vertices get normals (default true), which are the
+     * normalized gradients of the grid (by central differences), interpolated
+     * along the edges. They point towards the larger values.
+     */
+    bool computeNormals;
+
+    /**
+     * Constructs the default settings.
+     */
+    IsoSurfaceSettings();
+};
+
+/**
+ * Extracts the iso-surface of a scalar grid as an indexed triangle mesh with
+ * marching cubes (Lorensen and Cline, 1987).
+ *
+ * The grid point (x, y, z) lies at origin + (x, y, z) * voxelSize and its
+ * value is values[(z * sizeY + y) * sizeX + x] (like SignedDistanceField).
+ * Values below the iso-value are inside. The triangles are counterclockwise
+ * when seen from the outside (the larger values), like TriangleMesh expects.
+ *
+ * The triangles of every case are generated once from the geometry of the
+ * cube (by connecting the cut edges of each face around the inside corners
+ * and closing the loops) instead of being typed in, and faces with two
+ * diagonal inside corners always separate them, so neighbouring cubes agree
+ * on every face and the mesh has no cracks.
+ *
+ * Every vertex lies on one edge of the grid, and every edge belongs to the
+ * grid point at its lower end. The grid is processed in parallel slabs of
+ * z-layers in two passes: the first one counts the vertices and triangles
+ * per layer, whose prefix sums give every layer a fixed range of the output.
+ * The second one numbers the cut edges of each layer in a fixed order, so the
+ * index of a shared vertex is known to all cubes (even to those in the slab
+ * below) from two layers of edge indices, without any hash map or
+ * synchronization. Therefore every vertex is created exactly once, and the
+ * mesh does not depend on the number of threads.
+ *
+ * Throws std::invalid_argument if the mesh would have 2^32 or more vertices.
+ */
+TriangleMesh extractIsoSurface(const float* values, size_t sizeX, size_t sizeY, size_t sizeZ, const Vec4f& origin,
+                               float voxelSize, const IsoSurfaceSettings& settings = IsoSurfaceSettings());
+
+/**
+ * Extracts the iso-surface of the given signed distance field (see above).
+ */
+TriangleMesh extractIsoSurface(const SignedDistanceField& field,
+                               const IsoSurfaceSettings& settings = IsoSurfaceSettings());
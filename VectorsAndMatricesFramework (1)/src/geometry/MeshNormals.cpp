@@ -0,0 +1,291 @@
+#include "MeshNormals.h"
+#include "../math/FloatLanes.h"
+#include "../math/Parallel.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of triangles or vertices which are processed by one task (a
+   multiple of FLOAT_LANES): */
+const size_t NORMALS_GRAIN_SIZE = 8192;
+
+const float PI = 3.14159265358979f;
+
+/* Three FloatLanes which hold x, y and z of FLOAT_LANES vectors: */
+struct Vector3Lanes {
+    FloatLanes x, y, z;
+};
+
+inline Vector3Lanes operator-(const Vector3Lanes& a, const Vector3Lanes& b){
+    Vector3Lanes r = {a.x - b.x, a.y - b.y, a.z - b.z};
+    return r;
+}
+
+inline Vector3Lanes cross(const Vector3Lanes& a, const Vector3Lanes& b){
+    Vector3Lanes r = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    return r;
+}
+
+inline FloatLanes dot(const Vector3Lanes& a, const Vector3Lanes& b){
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/* Returns 1 / length of the vectors, or 0 for vectors of length 0: */
+inline FloatLanes inverseLength(const Vector3Lanes& a){
+    FloatLanes lengthSquared = dot(a, a);
+    FloatLanes zero = broadcast(0.f);
+    return select(zero < lengthSquared, rsqrt(select(zero < lengthSquared, lengthSquared, broadcast(1.f))), zero);
+}
+
+/**
+ * Loads corner k of the triangles first, ..., first + FLOAT_LANES - 1. Lanes
+ * beyond 'count' repeat the first triangle.
+ */
+inline Vector3Lanes loadCorner(const Vec4f* vectors, const uint32_t* indices, size_t first, size_t count, int k){
+    Vector3Lanes r;
+    for(int l=0; l < FLOAT_LANES; ++l){
+        const Vec4f& v = vectors[indices[3 * (first + (size_t(l) < count ? l : 0)) + k]];
+        r.x.v[l] = v.x;
+        r.y.v[l] = v.y;
+        r.z.v[l] = v.z;
+    }
+    return r;
+}
+
+/* A simple 3D vector for the per-vertex gathering: */
+struct Vector3 {
+    float x, y, z;
+};
+
+inline Vector3 subtract(const Vec4f& a, const Vec4f& b){
+    Vector3 r = {a.x - b.x, a.y - b.y, a.z - b.z};
+    return r;
+}
+
+inline float dot(const Vector3& a, const Vector3& b){
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/* Removes the component along the unit vector n and normalizes the result
+   (returns false if nothing is left): */
+inline bool projectAndNormalize(Vector3& a, const Vector3& n){
+    float d = dot(a, n);
+    a.x -= d * n.x; a.y -= d * n.y; a.z -= d * n.z;
+
+    float lengthSquared = dot(a, a);
+    if(!(lengthSquared > 0.f))
+        return false;
+
+    float inverse = 1.f / std::sqrt(lengthSquared);
+    a.x *= inverse; a.y *= inverse; a.z *= inverse;
+    return true;
+}
+
+/* Returns a unit vector orthogonal to the given unit vector: */
+Vector3 computeOrthogonal(const Vector3& n){
+    Vector3 axis = std::fabs(n.x) < 0.9f ? Vector3{1.f, 0.f, 0.f} : Vector3{0.f, 1.f, 0.f};
+    if(!projectAndNormalize(axis, n))
+        axis = Vector3{0.f, 0.f, 1.f};
+    return axis;
+}
+
+}
+
+void computeVertexNormals(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                          const VertexAdjacency& adjacency, Vec4f* normals, NormalWeighting weighting){
+    if(adjacency.corners.size() != 3 * triangleCount)
+        throw std::invalid_argument("computeVertexNormals: the adjacency does not belong to the index buffer.");
+
+    // Pass 1: the normal of every triangle and the weights of its corners:
+    bool angleWeighted = weighting == NormalWeighting::Angle;
+    std::vector<float> normalX(triangleCount), normalY(triangleCount), normalZ(triangleCount);
+    std::vector<float> cornerWeights(angleWeighted ? 3 * triangleCount : 0);
+
+    parallelFor(0, triangleCount, NORMALS_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t first=begin; first < end; first += FLOAT_LANES){
+            size_t count = end - first < size_t(FLOAT_LANES) ? end - first : size_t(FLOAT_LANES);
+
+            Vector3Lanes p0 = loadCorner(positions, indices, first, count, 0);
+            Vector3Lanes p1 = loadCorner(positions, indices, first, count, 1);
+            Vector3Lanes p2 = loadCorner(positions, indices, first, count, 2);
+
+            Vector3Lanes e01 = p1 - p0, e02 = p2 - p0, e12 = p2 - p1;
+            Vector3Lanes normal = cross(e01, e02);
+
+            if(angleWeighted){
+                // All corners share |e01 x e02| (twice the area), so the angles
+                // follow from atan2(|cross|, dot):
+                FloatLanes inverse = inverseLength(normal);
+                FloatLanes doubleArea = sqrt(dot(normal, normal));
+                FloatLanes angle0 = atan2(doubleArea, dot(e01, e02));
+                FloatLanes angle1 = atan2(doubleArea, -dot(e01, e12));
+                FloatLanes angle2 = PI - (angle0 + angle1);
+
+                normal.x = normal.x * inverse;
+                normal.y = normal.y * inverse;
+                normal.z = normal.z * inverse;
+
+                for(size_t l=0; l < count; ++l){
+                    cornerWeights[3 * (first + l)] = angle0.v[l];
+                    cornerWeights[3 * (first + l) + 1] = angle1.v[l];
+                    cornerWeights[3 * (first + l) + 2] = angle2.v[l];
+                }
+            }
+
+            for(size_t l=0; l < count; ++l){
+                normalX[first + l] = normal.x.v[l];
+                normalY[first + l] = normal.y.v[l];
+                normalZ[first + l] = normal.z.v[l];
+            }
+        }
+    });
+
+    // Pass 2: every vertex gathers the normals of its triangles:
+    size_t vertexCount = adjacency.getVertexCount();
+    parallelFor(0, vertexCount, NORMALS_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t first=begin; first < end; first += FLOAT_LANES){
+            size_t count = end - first < size_t(FLOAT_LANES) ? end - first : size_t(FLOAT_LANES);
+
+            Vector3Lanes sum = {broadcast(0.f), broadcast(0.f), broadcast(0.f)};
+            for(size_t l=0; l < count; ++l){
+                for(uint32_t k=adjacency.start[first + l]; k < adjacency.start[first + l + 1]; ++k){
+                    uint32_t corner = adjacency.corners[k];
+                    uint32_t triangle = corner / 3;
+                    float weight = angleWeighted ? cornerWeights[corner] : 1.f;
+                    sum.x.v[l] += weight * normalX[triangle];
+                    sum.y.v[l] += weight * normalY[triangle];
+                    sum.z.v[l] += weight * normalZ[triangle];
+                }
+            }
+
+            FloatLanes inverse = inverseLength(sum);
+            sum.x = sum.x * inverse;
+            sum.y = sum.y * inverse;
+            sum.z = sum.z * inverse;
+
+            for(size_t l=0; l < count; ++l)
+                normals[first + l] = Vec4f(sum.x.v[l], sum.y.v[l], sum.z.v[l], 0.f);
+        }
+    });
+}
+
+void computeVertexNormals(TriangleMesh& mesh, NormalWeighting weighting){
+    VertexAdjacency adjacency(mesh.indices.data(), mesh.getTriangleCount(), mesh.getVertexCount());
+    mesh.normals.resize(mesh.getVertexCount());
+    computeVertexNormals(mesh.positions.data(), mesh.indices.data(), mesh.getTriangleCount(),
+                         adjacency, mesh.normals.data(), weighting);
+}
+
+void computeTangents(const Vec4f* positions, const Vec4f* normals, const Vec4f* texCoords,
+                     const uint32_t* indices, size_t triangleCount,
+                     const VertexAdjacency& adjacency, Vec4f* tangents){
+    if(adjacency.corners.size() != 3 * triangleCount)
+        throw std::invalid_argument("computeTangents: the adjacency does not belong to the index buffer.");
+
+    // Pass 1: the direction of increasing u of every triangle and whether its
+    // texture is mirrored (+1 = not mirrored, -1 = mirrored, 0 = degenerate):
+    std::vector<float> tangentX(triangleCount), tangentY(triangleCount), tangentZ(triangleCount);
+    std::vector<float> orientations(triangleCount);
+
+    parallelFor(0, triangleCount, NORMALS_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t first=begin; first < end; first += FLOAT_LANES){
+            size_t count = end - first < size_t(FLOAT_LANES) ? end - first : size_t(FLOAT_LANES);
+
+            Vector3Lanes p0 = loadCorner(positions, indices, first, count, 0);
+            Vector3Lanes p1 = loadCorner(positions, indices, first, count, 1);
+            Vector3Lanes p2 = loadCorner(positions, indices, first, count, 2);
+            Vector3Lanes t0 = loadCorner(texCoords, indices, first, count, 0);
+            Vector3Lanes t1 = loadCorner(texCoords, indices, first, count, 1);
+            Vector3Lanes t2 = loadCorner(texCoords, indices, first, count, 2);
+
+            Vector3Lanes d1 = p1 - p0, d2 = p2 - p0;
+            Vector3Lanes t10 = t1 - t0, t20 = t2 - t0;
+
+            // Twice the signed area in texture space and the (unnormalized)
+            // derivative of the position along u, as in MikkTSpace:
+            FloatLanes signedArea = t10.x * t20.y - t10.y * t20.x;
+            Vector3Lanes direction = {t20.y * d1.x - t10.y * d2.x,
+                                      t20.y * d1.y - t10.y * d2.y,
+                                      t20.y * d1.z - t10.y * d2.z};
+
+            FloatLanes zero = broadcast(0.f);
+            FloatLanes sign = select(zero < signedArea, broadcast(1.f), broadcast(-1.f));
+            FloatLanes inverse = inverseLength(direction) * sign;
+            LaneMask usable = zero < abs(signedArea) * inverseLength(direction);
+            FloatLanes orientation = select(usable, sign, zero);
+
+            for(size_t l=0; l < count; ++l){
+                tangentX[first + l] = direction.x.v[l] * inverse.v[l];
+                tangentY[first + l] = direction.y.v[l] * inverse.v[l];
+                tangentZ[first + l] = direction.z.v[l] * inverse.v[l];
+                orientations[first + l] = orientation.v[l];
+            }
+        }
+    });
+
+    // Pass 2: every vertex projects the tangents of its triangles into its
+    // tangent plane and averages them weighted by the corner angles:
+    size_t vertexCount = adjacency.getVertexCount();
+    parallelFor(0, vertexCount, NORMALS_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t v=begin; v < end; ++v){
+            Vector3 normal = {normals[v].x, normals[v].y, normals[v].z};
+            float normalLength = std::sqrt(dot(normal, normal));
+            if(normalLength > 0.f){
+                normal.x /= normalLength; normal.y /= normalLength; normal.z /= normalLength;
+            }
+
+            // One sum per orientation (index 0 = mirrored, 1 = not mirrored):
+            Vector3 sums[2] = {{0.f, 0.f, 0.f}, {0.f, 0.f, 0.f}};
+            float weights[2] = {0.f, 0.f};
+
+            for(uint32_t k=adjacency.start[v]; k < adjacency.start[v + 1]; ++k){
+                uint32_t corner = adjacency.corners[k];
+                uint32_t triangle = corner / 3;
+                if(orientations[triangle] == 0.f)
+                    continue;
+
+                Vector3 tangent = {tangentX[triangle], tangentY[triangle], tangentZ[triangle]};
+                if(!projectAndNormalize(tangent, normal))
+                    continue;
+
+                // The corner angle, measured in the tangent plane:
+                uint32_t base = corner - corner % 3;
+                const Vec4f& p = positions[v];
+                Vector3 toNext = subtract(positions[indices[base + (corner + 1) % 3]], p);
+                Vector3 toPrevious = subtract(positions[indices[base + (corner + 2) % 3]], p);
+                if(!projectAndNormalize(toNext, normal) || !projectAndNormalize(toPrevious, normal))
+                    continue;
+
+                float cosine = dot(toNext, toPrevious);
+                float angle = std::acos(cosine < -1.f ? -1.f : (cosine > 1.f ? 1.f : cosine));
+
+                int side = orientations[triangle] > 0.f ? 1 : 0;
+                sums[side].x += angle * tangent.x;
+                sums[side].y += angle * tangent.y;
+                sums[side].z += angle * tangent.z;
+                weights[side] += angle;
+            }
+
+            int side = weights[1] >= weights[0] ? 1 : 0;
+            Vector3 tangent = sums[side];
+            if(!projectAndNormalize(tangent, normal))
+                tangent = computeOrthogonal(normal);
+
+            tangents[v] = Vec4f(tangent.x, tangent.y, tangent.z, side == 1 ? 1.f : -1.f);
+        }
+    });
+}
+
+void computeTangents(const TriangleMesh& mesh, const std::vector<Vec4f>& texCoords, std::vector<Vec4f>& tangents){
+    if(!mesh.hasNormals())
+        throw std::invalid_argument("computeTangents: the mesh has no normals.");
+    if(texCoords.size() != mesh.getVertexCount())
+        throw std::invalid_argument("computeTangents: one texture coordinate per vertex is needed.");
+
+    VertexAdjacency adjacency(mesh.indices.data(), mesh.getTriangleCount(), mesh.getVertexCount());
+    tangents.resize(mesh.getVertexCount());
+    computeTangents(mesh.positions.data(), mesh.normals.data(), texCoords.data(),
+                    mesh.indices.data(), mesh.getTriangleCount(), adjacency, tangents.data());
+}
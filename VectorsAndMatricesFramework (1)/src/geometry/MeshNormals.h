@@ -0,0 +1,90 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our Vec4f, the mesh class and the vertex adjacency: */
+#include "../math/Vec4f.h"
+#include "TriangleMesh.h"
+#include "VertexAdjacency.h"
+
+/**
+ * How the normals of the triangles around a vertex are weighted when they are
+ * averaged into the vertex normal.
+ */
+enum class NormalWeighting {
+    /** Weighted by the triangle area (large triangles dominate) */
+    Area,
+
+    /**
+     * Weighted by the angle of the triangle at the vertex, which does not
+     * depend on how the surface around the vertex is triangulated
+     */
+    Angle
+};
+
+/**
+ * Computes smooth vertex normals (normalized, w = 0) of an indexed triangle
+ * mesh with counterclockwise triangles.
+ *
+ * The computation runs in two parallel passes and needs no atomics:
+ *  1. The normal (cross product) and the corner weights of all triangles are
+ *     computed, FLOAT_LANES triangles at once (see FloatLanes.h), and stored
+ *     as a structure of arrays.
+ *  2. Every vertex gathers the weighted normals of its triangles through the
+ *     given adjacency and normalizes the sum, again FLOAT_LANES vertices at
+ *     once.
+ *
+ * Vertices which are not used by any triangle (or only by degenerate ones)
+ * get the normal (0, 0, 0, 0). The adjacency must have been built from the
+ * same index buffer.
+ */
+void computeVertexNormals(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                          const VertexAdjacency& adjacency, Vec4f* normals,
+                          NormalWeighting weighting = NormalWeighting::Angle);
+
+/**
+ * Computes the vertex normals of the mesh (see above) and stores them into
+ * mesh.normals.
+ */
+void computeVertexNormals(TriangleMesh& mesh, NormalWeighting weighting = NormalWeighting::Angle);
+
+/**
+ * Computes a tangent per vertex for normal mapping, following the conventions
+ * of MikkTSpace (Mikkelsen, "Simulation of Wrinkled Surfaces Revisited",
+ * 2008), which is the standard of most modeling tools and engines. The
+ * texture coordinates are read from x (u) and y (v) of 'texCoords'.
+ *
+ * The result is (tx, ty, tz, sign): (tx, ty, tz) is the normalized direction
+ * of increasing u, orthogonal to the vertex normal, and the bitangent is
+ * sign * cross(normal, tangent) with sign = +1 or -1 (mirrored texture).
+ *
+ * Like in MikkTSpace, the tangent of a triangle is projected into the tangent
+ * plane of every corner and weighted by the corner angle (measured in this
+ * plane). MikkTSpace keeps separate tangents for the triangles of a vertex
+ * whose texture is mirrored; here a vertex has only one tangent, so the
+ * orientation with the larger total angle wins. For exactly the same results
+ * as MikkTSpace, the vertices on a mirror seam must therefore be split (which
+ * is the case if the mesh is welded by position, normal and texture
+ * coordinates). Vertices without any usable triangle get an arbitrary tangent
+ * orthogonal to their normal.
+ *
+ * The computation runs in parallel like computeVertexNormals(...).
+ */
+void computeTangents(const Vec4f* positions, const Vec4f* normals, const Vec4f* texCoords,
+                     const uint32_t* indices, size_t triangleCount,
+                     const VertexAdjacency& adjacency, Vec4f* tangents);
+
+/**
+ * Computes the tangents of the mesh (see above), which must have normals,
+ * from the given texture coordinates (one per vertex) into 'tangents'.
+ */
+void computeTangents(const TriangleMesh& mesh, const std::vector<Vec4f>& texCoords, std::vector<Vec4f>& tangents);
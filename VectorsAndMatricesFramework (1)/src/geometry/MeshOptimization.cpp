@@ -0,0 +1,437 @@
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/* Marks a missing vertex: */
+const uint32_t NO_VERTEX = 0xffffffffu;
+
+/* Throws if the index buffer of the mesh is invalid: */
+void validateMesh(const TriangleMesh& mesh, const char* function){
+    if(mesh.indices.size() % 3 != 0)
+        throw std::invalid_argument(std::string(function) + ": the number of indices must be a multiple of three.");
+
+    for(uint32_t index : mesh.indices)
+        if(index >= mesh.positions.size())
+            throw std::invalid_argument(std::string(function) + ": index out of range.");
+
+    if(!mesh.normals.empty() && mesh.normals.size() != mesh.positions.size())
+        throw std::invalid_argument(std::string(function) + ": the mesh must have one normal per vertex.");
+}
+
+/**
+ * Builds the list of triangles of every vertex: the triangles of vertex v
+ * are triangles[start[v]] ... triangles[start[v + 1] - 1].
+ */
+void buildVertexTriangles(const std::vector<uint32_t>& indices, size_t vertexCount,
+                          std::vector<uint32_t>& start, std::vector<uint32_t>& triangles){
+    start.assign(vertexCount + 1, 0);
+    for(uint32_t index : indices)
+        ++start[index + 1];
+    for(size_t v=0; v < vertexCount; ++v)
+        start[v + 1] += start[v];
+
+    triangles.resize(indices.size());
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    for(size_t i=0; i < indices.size(); ++i)
+        triangles[fill[indices[i]]++] = uint32_t(i / 3);
+}
+
+/**
+ * Computes the Tipsify triangle order. The cache is simulated with time
+ * stamps: a vertex is in the FIFO cache if it was inserted less than
+ * 'cacheSize' insertions ago.
+ */
+std::vector<uint32_t> computeTipsifyOrder(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize){
+    std::vector<uint32_t> start, adjacency;
+    buildVertexTriangles(indices, vertexCount, start, adjacency);
+
+    // The number of not yet emitted triangles per vertex:
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for(size_t v=0; v < vertexCount; ++v)
+        liveTriangles[v] = start[v + 1] - start[v];
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(indices.size() / 3, 0);
+    std::vector<uint32_t> deadEnds, candidates, order;
+    deadEnds.reserve(indices.size());
+    order.reserve(indices.size() / 3);
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    // Start with the first vertex which is used by a triangle:
+    while(cursor < vertexCount && liveTriangles[cursor] == 0)
+        ++cursor;
+    uint32_t fanning = cursor < vertexCount ? uint32_t(cursor) : NO_VERTEX;
+
+    while(fanning != NO_VERTEX){
+        // Emit all remaining triangles around the fanning vertex:
+        candidates.clear();
+        for(uint32_t k=start[fanning]; k < start[fanning + 1]; ++k){
+            uint32_t triangle = adjacency[k];
+            if(emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+            order.push_back(triangle);
+
+            for(int c=0; c < 3; ++c){
+                uint32_t vertex = indices[3 * triangle + c];
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+
+                if(time - cacheTime[vertex] > cacheSize){
+                    cacheTime[vertex] = time;
+                    ++time;
+                }
+            }
+        }
+
+        // Choose the oldest vertex which will still be in the cache after
+        // its remaining triangles have been emitted:
+        uint32_t next = NO_VERTEX;
+        int64_t bestPriority = -1;
+        for(uint32_t vertex : candidates){
+            if(liveTriangles[vertex] == 0)
+                continue;
+
+            int64_t priority = 0;
+            if(time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = time - cacheTime[vertex];
+
+            if(priority > bestPriority){
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        // Dead end: continue with the most recently used vertex which still
+        // has triangles, or with the next such vertex in input order:
+        while(next == NO_VERTEX && !deadEnds.empty()){
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if(liveTriangles[vertex] > 0)
+                next = vertex;
+        }
+        while(next == NO_VERTEX && cursor < vertexCount){
+            if(liveTriangles[cursor] > 0)
+                next = uint32_t(cursor);
+            ++cursor;
+        }
+
+        fanning = next;
+    }
+
+    return order;
+}
+
+/* Reorders the triangles of the mesh (order[i] = old index of triangle i): */
+void applyTriangleOrder(TriangleMesh& mesh, const std::vector<uint32_t>& order){
+    std::vector<uint32_t> indices(3 * order.size());
+    for(size_t i=0; i < order.size(); ++i)
+        for(int c=0; c < 3; ++c)
+            indices[3 * i + c] = mesh.indices[3 * order[i] + c];
+    mesh.indices.swap(indices);
+}
+
+/**
+ * Moves every vertex v to newIndex[v] (or removes it if newIndex[v] is
+ * NO_VERTEX) and updates the index buffer.
+ */
+void remapVertices(TriangleMesh& mesh, const std::vector<uint32_t>& newIndex, size_t newVertexCount){
+    std::vector<Vec4f> positions(newVertexCount);
+    std::vector<Vec4f> normals(mesh.hasNormals() ? newVertexCount : 0);
+    for(size_t v=0; v < newIndex.size(); ++v){
+        if(newIndex[v] == NO_VERTEX)
+            continue;
+        positions[newIndex[v]] = mesh.positions[v];
+        if(!normals.empty())
+            normals[newIndex[v]] = mesh.normals[v];
+    }
+    mesh.positions.swap(positions);
+    mesh.normals.swap(normals);
+
+    for(uint32_t& index : mesh.indices)
+        index = newIndex[index];
+}
+
+/* A cell of the welding grid: */
+struct Cell {
+    int64_t x, y, z;
+
+    bool operator==(const Cell& cell) const{
+        return x == cell.x && y == cell.y && z == cell.z;
+    }
+};
+
+/* Returns the grid coordinate of the value (or its bits if cellSize is 0): */
+int64_t computeCellCoordinate(float value, float cellSize){
+    if(cellSize == 0.f){
+        // -0 and +0 have different bits, but are the same position:
+        float normalized = value == 0.f ? 0.f : value;
+        int32_t bits;
+        std::memcpy(&bits, &normalized, sizeof(bits));
+        return bits;
+    }
+
+    double cell = std::floor(double(value) / cellSize);
+    const double limit = 4.6e18;
+    return int64_t(cell < -limit ? -limit : (cell > limit ? limit : cell));
+}
+
+uint64_t hashCell(const Cell& cell){
+    uint64_t hash = uint64_t(cell.x) * 0x9e3779b97f4a7c15ull
+                  ^ uint64_t(cell.y) * 0xc2b2ae3d27d4eb4full
+                  ^ uint64_t(cell.z) * 0x165667b19e3779f9ull;
+    hash ^= hash >> 31;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+/* Returns whether the vectors differ by at most 'tolerance' in x, y and z: */
+bool isClose(const Vec4f& a, const Vec4f& b, float tolerance){
+    return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance && std::fabs(a.z - b.z) <= tolerance;
+}
+
+/**
+ * Counts the cache misses of every triangle in the current order with a FIFO
+ * cache of the given size.
+ */
+std::vector<uint8_t> simulateCache(const TriangleMesh& mesh, unsigned int cacheSize){
+    std::vector<uint32_t> cacheTime(mesh.positions.size(), 0);
+    std::vector<uint8_t> misses(mesh.getTriangleCount(), 0);
+    uint32_t time = cacheSize + 1;
+
+    for(size_t t=0; t < misses.size(); ++t){
+        for(int c=0; c < 3; ++c){
+            uint32_t vertex = mesh.indices[3 * t + c];
+            if(time - cacheTime[vertex] > cacheSize){
+                cacheTime[vertex] = time;
+                ++time;
+                ++misses[t];
+            }
+        }
+    }
+
+    return misses;
+}
+
+}
+
+void weldVertices(TriangleMesh& mesh, float positionTolerance, float normalTolerance){
+    validateMesh(mesh, "weldVertices");
+
+    size_t vertexCount = mesh.positions.size();
+    bool hasNormals = mesh.hasNormals();
+    float cellSize = positionTolerance > 0.f ? positionTolerance : 0.f;
+
+    std::vector<Cell> cells(vertexCount);
+    for(size_t v=0; v < vertexCount; ++v){
+        const Vec4f& p = mesh.positions[v];
+        Cell cell = {computeCellCoordinate(p.x, cellSize), computeCellCoordinate(p.y, cellSize), computeCellCoordinate(p.z, cellSize)};
+        cells[v] = cell;
+    }
+
+    // Open addressing hash table of the vertices which are kept (linear probing):
+    size_t capacity = 16;
+    while(capacity < 2 * vertexCount)
+        capacity *= 2;
+    std::vector<uint32_t> table(capacity, NO_VERTEX);
+    size_t mask = capacity - 1;
+
+    // With a tolerance, a matching vertex can also be in a neighbouring cell:
+    int range = cellSize > 0.f ? 1 : 0;
+
+    std::vector<uint32_t> representative(vertexCount);
+    for(size_t v=0; v < vertexCount; ++v){
+        uint32_t found = NO_VERTEX;
+
+        for(int dx=-range; dx <= range && found == NO_VERTEX; ++dx){
+            for(int dy=-range; dy <= range && found == NO_VERTEX; ++dy){
+                for(int dz=-range; dz <= range && found == NO_VERTEX; ++dz){
+                    Cell cell = {cells[v].x + dx, cells[v].y + dy, cells[v].z + dz};
+                    for(size_t slot=hashCell(cell) & mask; table[slot] != NO_VERTEX; slot = (slot + 1) & mask){
+                        uint32_t other = table[slot];
+                        if(cells[other] == cell && isClose(mesh.positions[v], mesh.positions[other], positionTolerance) &&
+                           (!hasNormals || isClose(mesh.normals[v], mesh.normals[other], normalTolerance))){
+                            found = other;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if(found == NO_VERTEX){
+            size_t slot = hashCell(cells[v]) & mask;
+            while(table[slot] != NO_VERTEX)
+                slot = (slot + 1) & mask;
+            table[slot] = uint32_t(v);
+            found = uint32_t(v);
+        }
+
+        representative[v] = found;
+    }
+
+    // Redirect the indices and remove the degenerate triangles:
+    size_t triangleCount = 0;
+    for(size_t t=0; t < mesh.getTriangleCount(); ++t){
+        uint32_t a = representative[mesh.indices[3 * t]];
+        uint32_t b = representative[mesh.indices[3 * t + 1]];
+        uint32_t c = representative[mesh.indices[3 * t + 2]];
+        if(a == b || b == c || c == a)
+            continue;
+
+        mesh.indices[3 * triangleCount] = a;
+        mesh.indices[3 * triangleCount + 1] = b;
+        mesh.indices[3 * triangleCount + 2] = c;
+        ++triangleCount;
+    }
+    mesh.indices.resize(3 * triangleCount);
+
+    // Remove the unused vertices (keeping the order of the others):
+    std::vector<uint32_t> newIndex(vertexCount, NO_VERTEX);
+    for(uint32_t index : mesh.indices)
+        newIndex[index] = 0;
+
+    size_t newVertexCount = 0;
+    for(size_t v=0; v < vertexCount; ++v)
+        if(newIndex[v] != NO_VERTEX)
+            newIndex[v] = uint32_t(newVertexCount++);
+
+    remapVertices(mesh, newIndex, newVertexCount);
+}
+
+void optimizeVertexCache(TriangleMesh& mesh, unsigned int cacheSize){
+    validateMesh(mesh, "optimizeVertexCache");
+    if(cacheSize < 3)
+        throw std::invalid_argument("optimizeVertexCache: the cache must hold at least three vertices.");
+
+    applyTriangleOrder(mesh, computeTipsifyOrder(mesh.indices, mesh.positions.size(), cacheSize));
+}
+
+void optimizeOverdraw(TriangleMesh& mesh, float threshold, unsigned int cacheSize){
+    optimizeVertexCache(mesh, cacheSize);
+
+    size_t triangleCount = mesh.getTriangleCount();
+    if(triangleCount == 0)
+        return;
+
+    // Cluster boundaries where the cache optimization jumped to a new region
+    // (all three vertices of the triangle miss the cache):
+    std::vector<uint8_t> misses = simulateCache(mesh, cacheSize);
+    size_t totalMisses = 0;
+    for(uint8_t m : misses)
+        totalMisses += m;
+    double limit = threshold * double(totalMisses) / double(triangleCount);
+
+    // Additional boundaries wherever the current cluster (which starts with an
+    // empty cache after reordering) is already good enough:
+    std::vector<size_t> clusterStarts(1, 0);
+    std::vector<uint32_t> cacheTime(mesh.positions.size(), 0);
+    uint32_t time = cacheSize + 1;
+    size_t clusterMisses = 0;
+    for(size_t t=0; t < triangleCount; ++t){
+        size_t clusterSize = t - clusterStarts.back();
+        if(clusterSize > 0 && (misses[t] == 3 || clusterMisses <= limit * clusterSize)){
+            clusterStarts.push_back(t);
+            clusterMisses = 0;
+            time += cacheSize + 1;
+        }
+
+        for(int c=0; c < 3; ++c){
+            uint32_t vertex = mesh.indices[3 * t + c];
+            if(time - cacheTime[vertex] > cacheSize){
+                cacheTime[vertex] = time;
+                ++time;
+                ++clusterMisses;
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+
+    // Area weighted centroid and normal of every cluster and of the mesh:
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<double> centroids(3 * clusterCount, 0.0), normals(3 * clusterCount, 0.0), areas(clusterCount, 0.0);
+    double center[3] = {0.0, 0.0, 0.0}, totalArea = 0.0;
+
+    for(size_t cluster=0; cluster < clusterCount; ++cluster){
+        for(size_t t=clusterStarts[cluster]; t < clusterStarts[cluster + 1]; ++t){
+            const Vec4f& a = mesh.positions[mesh.indices[3 * t]];
+            const Vec4f& b = mesh.positions[mesh.indices[3 * t + 1]];
+            const Vec4f& c = mesh.positions[mesh.indices[3 * t + 2]];
+
+            double ab[3] = {double(b.x) - a.x, double(b.y) - a.y, double(b.z) - a.z};
+            double ac[3] = {double(c.x) - a.x, double(c.y) - a.y, double(c.z) - a.z};
+            double normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+            double area = 0.5 * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            double centroid[3] = {(double(a.x) + b.x + c.x) / 3.0, (double(a.y) + b.y + c.y) / 3.0, (double(a.z) + b.z + c.z) / 3.0};
+
+            for(int i=0; i < 3; ++i){
+                centroids[3 * cluster + i] += area * centroid[i];
+                normals[3 * cluster + i] += normal[i];
+                center[i] += area * centroid[i];
+            }
+            areas[cluster] += area;
+            totalArea += area;
+        }
+    }
+
+    // Clusters which face away from the center are drawn first:
+    std::vector<double> keys(clusterCount, 0.0);
+    for(size_t cluster=0; cluster < clusterCount; ++cluster){
+        const double* n = &normals[3 * cluster];
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if(length == 0.0 || areas[cluster] == 0.0 || totalArea == 0.0)
+            continue;
+
+        for(int i=0; i < 3; ++i)
+            keys[cluster] += (centroids[3 * cluster + i] / areas[cluster] - center[i] / totalArea) * n[i] / length;
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for(size_t cluster=0; cluster < clusterCount; ++cluster)
+        clusterOrder[cluster] = uint32_t(cluster);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b){
+        return keys[a] > keys[b];
+    });
+
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    for(uint32_t cluster : clusterOrder)
+        for(size_t t=clusterStarts[cluster]; t < clusterStarts[cluster + 1]; ++t)
+            order.push_back(uint32_t(t));
+
+    applyTriangleOrder(mesh, order);
+}
+
+void optimizeVertexFetch(TriangleMesh& mesh){
+    validateMesh(mesh, "optimizeVertexFetch");
+
+    std::vector<uint32_t> newIndex(mesh.positions.size(), NO_VERTEX);
+    size_t newVertexCount = 0;
+    for(uint32_t index : mesh.indices)
+        if(newIndex[index] == NO_VERTEX)
+            newIndex[index] = uint32_t(newVertexCount++);
+
+    remapVertices(mesh, newIndex, newVertexCount);
+}
+
+float computeACMR(const TriangleMesh& mesh, unsigned int cacheSize){
+    validateMesh(mesh, "computeACMR");
+    if(mesh.indices.empty())
+        return 0.f;
+
+    std::vector<uint8_t> misses = simulateCache(mesh, cacheSize);
+    size_t totalMisses = 0;
+    for(uint8_t m : misses)
+        totalMisses += m;
+    return float(double(totalMisses) / double(misses.size()));
+}
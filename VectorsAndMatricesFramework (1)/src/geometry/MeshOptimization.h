@@ -0,0 +1,84 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Include the mesh class which is optimized: */
+#include "TriangleMesh.h"
+
+/**
+ * This file contains passes which reorder the triangles and vertices of a
+ * mesh without changing its shape. They reduce the work of everything which
+ * processes the mesh vertex by vertex:
+ *
+ *  - A GPU transforms a vertex (Mat4f * Vec4f in the vertex shader) only if
+ *    it is not in the small post-transform cache of recently used vertices.
+ *    The average number of transformed vertices per triangle is called ACMR
+ *    (average cache miss ratio). It is between 0.5 (every vertex of a large
+ *    regular mesh is transformed once) and 3.0 (no reuse at all); meshes from
+ *    modeling tools or scanners are often at 1.5 - 2.5, a cache optimized
+ *    mesh at about 0.6 - 0.7.
+ *  - If the vertices are stored in the order in which the triangles use them,
+ *    consecutive triangles read neighbouring memory, which helps the vertex
+ *    fetch on the GPU as well as every CPU pass which walks the triangles.
+ *
+ * The recommended order is: weldVertices(...), then optimizeVertexCache(...)
+ * or optimizeOverdraw(...), and finally optimizeVertexFetch(...).
+ */
+
+/**
+ * Merges vertices with equal positions (and equal normals, if the mesh has
+ * normals), so that neighbouring triangles share their vertices. This is
+ * needed for meshes which were loaded from formats that store every triangle
+ * separately.
+ *
+ * Two vertices are merged if no coordinate differs by more than
+ * 'positionTolerance' and no normal component by more than
+ * 'normalTolerance'. The vertices are found through a hash table over a
+ * grid with the cell size 'positionTolerance' (or over the exact float values
+ * if the tolerance is 0), so welding takes linear time.
+ *
+ * Triangles which become degenerate (two equal indices) are removed, and the
+ * vertices which are no longer used are removed as well. The remaining
+ * vertices keep their relative order.
+ */
+void weldVertices(TriangleMesh& mesh, float positionTolerance = 0.f, float normalTolerance = 0.f);
+
+/**
+ * Reorders the triangles for the post-transform vertex cache with the Tipsify
+ * algorithm (Sander et al., "Fast Triangle Reordering for Vertex Locality and
+ * Reduced Overdraw", 2007). The algorithm walks over the mesh fanning around
+ * one vertex at a time and chooses the next vertex among those which are
+ * still in a simulated FIFO cache of size 'cacheSize'. It runs in linear time.
+ */
+void optimizeVertexCache(TriangleMesh& mesh, unsigned int cacheSize = 16);
+
+/**
+ * Reorders the triangles like optimizeVertexCache(...), but additionally
+ * tries to draw the triangles which face outwards first, so that hidden
+ * triangles fail the depth test and less pixels are shaded more than once
+ * (overdraw).
+ *
+ * The cache optimized triangle order is split into clusters (wherever the
+ * cache optimization jumps to a new region, and wherever the ACMR of the
+ * current cluster is at most 'threshold' times the ACMR of the whole mesh).
+ * The clusters are then sorted by how much they face away from the center of
+ * the mesh. A higher threshold allows more clusters (less overdraw), but
+ * increases the ACMR by up to this factor.
+ */
+void optimizeOverdraw(TriangleMesh& mesh, float threshold = 1.05f, unsigned int cacheSize = 16);
+
+/**
+ * Reorders the vertices (positions and normals) in the order of their first
+ * use by the triangles, and removes the vertices which are not used at all.
+ * Call this after the triangles have been reordered.
+ */
+void optimizeVertexFetch(TriangleMesh& mesh);
+
+/**
+ * Returns the average number of cache misses per triangle (ACMR) when the
+ * triangles are processed in order with a FIFO vertex cache of the given
+ * size (see above). Returns 0 for a mesh without triangles.
+ */
+float computeACMR(const TriangleMesh& mesh, unsigned int cacheSize = 16);
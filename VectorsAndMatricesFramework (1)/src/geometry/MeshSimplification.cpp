@@ -0,0 +1,651 @@
+#include "MeshSimplification.h"
+#include "../math/Morton.h"
+#include "../math/Parallel.h"
+#include "../math/Quadric.h"
+#include "../math/Reductions.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/* Marks a missing vertex: */
+const uint32_t NO_VERTEX = 0xffffffffu;
+
+/* Clusters are only used if each of them gets at least this many triangles: */
+const size_t MIN_CLUSTER_TRIANGLES = 4096;
+
+/**
+ * The clusters stop at this multiple of their share of the target, so that
+ * the final pass can still choose the best collapses between the clusters
+ * (otherwise the interior of the clusters is simplified too much to make up
+ * for the locked vertices at their borders).
+ */
+const double CLUSTER_TARGET_FACTOR = 1.5;
+
+/* The number of triangles whose initial collapses are computed by one task: */
+const size_t CANDIDATE_GRAIN_SIZE = 4096;
+
+/* A collapse is rejected if it rotates a triangle normal by more than ~78 degrees: */
+const double MIN_NORMAL_COSINE = 0.2;
+
+/**
+ * A candidate edge collapse: the vertex 'remove' is merged into the vertex
+ * 'keep', which is moved to 'target'. The versions of both vertices at the
+ * time the candidate was computed are used to detect outdated candidates.
+ */
+struct Collapse {
+    double error;
+    uint32_t keep, remove;
+    uint32_t keepVersion, removeVersion;
+    Vec4f target;
+};
+
+/* Orders the priority queue so that the smallest error is on top: */
+struct CollapseOrder {
+    bool operator()(const Collapse& a, const Collapse& b) const{
+        return a.error > b.error;
+    }
+};
+
+/* A small double precision 3D vector for the geometric tests: */
+struct Vector3d {
+    double x, y, z;
+};
+
+inline Vector3d subtract(const Vec4f& a, const Vec4f& b){
+    Vector3d r = {double(a.x) - b.x, double(a.y) - b.y, double(a.z) - b.z};
+    return r;
+}
+
+inline Vector3d cross(const Vector3d& a, const Vector3d& b){
+    Vector3d r = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    return r;
+}
+
+inline double dot(const Vector3d& a, const Vector3d& b){
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/* Returns u^T * Q * v for the homogeneous vectors u and v: */
+double evaluateBilinear(const Quadric& quadric, const double u[4], const double v[4]){
+    static const int cell[4][4] = {{0, 1, 2, 3}, {1, 4, 5, 6}, {2, 5, 7, 8}, {3, 6, 8, 9}};
+    double result = 0.0;
+    for(int row=0; row < 4; ++row)
+        for(int col=0; col < 4; ++col)
+            result += u[row] * quadric.data[cell[row][col]] * v[col];
+    return result;
+}
+
+/* Returns a - b as a vector (w = 0): */
+inline Vec4f difference(const Vec4f& a, const Vec4f& b){
+    return Vec4f(a.x - b.x, a.y - b.y, a.z - b.z, 0.f);
+}
+
+/**
+ * Simplifies an indexed triangle mesh in place. The triangles of a vertex are
+ * found through an adjacency array (CSR) which is built once and rebuilt
+ * whenever the number of triangles has halved. In between, every vertex has a
+ * 'chain' of the vertices which were merged into it, and its triangles are
+ * the living triangles of all vertices in its chain.
+ *
+ * The quadric of every vertex is stored relative to the position of the
+ * vertex (see Quadric::translate(...)), otherwise the tiny errors of the
+ * first collapses on a finely tessellated mesh would be lost in float
+ * rounding noise, which makes the collapse order almost random.
+ */
+class Simplifier
+{
+public:
+    Simplifier(std::vector<Vec4f>& positions, std::vector<uint32_t>& indices,
+               const std::vector<uint8_t>& locked, std::vector<Quadric>& quadrics)
+        : positions(positions), indices(indices), locked(locked), quadrics(quadrics), stamp(0)
+    {
+        size_t vertexCount = positions.size();
+        size_t triangleCount = indices.size() / 3;
+
+        triangleAlive.assign(triangleCount, 1);
+        liveTriangles = triangleCount;
+
+        vertexAlive.assign(vertexCount, 1);
+        versions.assign(vertexCount, 0);
+        border.assign(vertexCount, 0);
+        marks.assign(vertexCount, 0);
+
+        rebuildAdjacency();
+
+        for(size_t t=0; t < triangleCount; ++t){
+            for(int k=0; k < 3; ++k){
+                uint32_t a = indices[3 * t + k];
+                uint32_t b = indices[3 * t + (k + 1) % 3];
+                if(isBorderEdge(a, b))
+                    border[a] = border[b] = 1;
+            }
+        }
+    }
+
+    /**
+     * Adds the area weighted quadrics of the triangle planes and the quadrics
+     * of the border planes to the quadrics of the vertices.
+     */
+    void addPlaneQuadrics(float borderWeight){
+        for(size_t t=0; t < triangleAlive.size(); ++t){
+            const uint32_t* corners = &indices[3 * t];
+            const Vec4f& p0 = positions[corners[0]];
+
+            Vector3d normal = cross(subtract(positions[corners[1]], p0), subtract(positions[corners[2]], p0));
+            double length = std::sqrt(dot(normal, normal));
+            if(length == 0.0)
+                continue;
+
+            // The plane passes through every corner, so relative to the
+            // corners its distance to the origin is zero:
+            Vec4f plane(float(normal.x / length), float(normal.y / length), float(normal.z / length), 0.f);
+            Quadric quadric(plane, float(0.5 * length));
+            for(int k=0; k < 3; ++k)
+                quadrics[corners[k]] += quadric;
+
+            // Add a plane through each border edge which is perpendicular to the triangle:
+            for(int k=0; k < 3; ++k){
+                uint32_t a = corners[k], b = corners[(k + 1) % 3];
+                if(!isBorderEdge(a, b))
+                    continue;
+
+                Vector3d edge = subtract(positions[b], positions[a]);
+                Vector3d edgeNormal = cross(edge, normal);
+                double edgeNormalLength = std::sqrt(dot(edgeNormal, edgeNormal));
+                if(edgeNormalLength == 0.0)
+                    continue;
+
+                Vec4f borderPlane(float(edgeNormal.x / edgeNormalLength), float(edgeNormal.y / edgeNormalLength),
+                                  float(edgeNormal.z / edgeNormalLength), 0.f);
+                Quadric borderQuadric(borderPlane, float(borderWeight * dot(edge, edge)));
+                quadrics[a] += borderQuadric;
+                quadrics[b] += borderQuadric;
+            }
+        }
+    }
+
+    /**
+     * Collapses edges until at most targetTriangleCount triangles are left or
+     * the next collapse would exceed maxError. Afterwards 'indices' only
+     * contains the remaining triangles.
+     */
+    void run(size_t targetTriangleCount, double maxError){
+        std::priority_queue<Collapse, std::vector<Collapse>, CollapseOrder> queue(CollapseOrder(), computeInitialCollapses());
+
+        while(liveTriangles > targetTriangleCount && !queue.empty()){
+            Collapse collapse = queue.top();
+            queue.pop();
+
+            if(collapse.error > maxError)
+                break;
+
+            // Skip outdated candidates (lazy invalidation):
+            if(!vertexAlive[collapse.keep] || !vertexAlive[collapse.remove] ||
+               versions[collapse.keep] != collapse.keepVersion || versions[collapse.remove] != collapse.removeVersion)
+                continue;
+
+            if(!isCollapseValid(collapse))
+                continue;
+
+            applyCollapse(collapse);
+
+            // Push the new candidates of all edges around the merged vertex:
+            pushCollapses(collapse.keep, queue);
+
+            if(2 * liveTriangles < adjacencyTriangles)
+                rebuildAdjacency();
+        }
+
+        // Remove the collapsed triangles:
+        size_t count = 0;
+        for(size_t t=0; t < triangleAlive.size(); ++t){
+            if(!triangleAlive[t])
+                continue;
+            for(int k=0; k < 3; ++k)
+                indices[3 * count + k] = indices[3 * t + k];
+            ++count;
+        }
+        indices.resize(3 * count);
+    }
+
+private:
+    /* Calls function(triangle) for every living triangle of the given vertex: */
+    template<typename Function>
+    void forEachTriangle(uint32_t vertex, const Function& function) const{
+        for(uint32_t v=vertex; v != NO_VERTEX; v = chainNext[v]){
+            for(uint32_t k=adjacencyStart[v]; k < adjacencyStart[v + 1]; ++k){
+                uint32_t triangle = adjacency[k];
+                if(triangleAlive[triangle])
+                    function(triangle);
+            }
+        }
+    }
+
+    void rebuildAdjacency(){
+        size_t vertexCount = positions.size();
+
+        adjacencyStart.assign(vertexCount + 1, 0);
+        for(size_t t=0; t < triangleAlive.size(); ++t){
+            if(!triangleAlive[t])
+                continue;
+            for(int k=0; k < 3; ++k)
+                ++adjacencyStart[indices[3 * t + k] + 1];
+        }
+        for(size_t v=0; v < vertexCount; ++v)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+
+        adjacency.resize(adjacencyStart[vertexCount]);
+        std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for(size_t t=0; t < triangleAlive.size(); ++t){
+            if(!triangleAlive[t])
+                continue;
+            for(int k=0; k < 3; ++k)
+                adjacency[fill[indices[3 * t + k]]++] = uint32_t(t);
+        }
+
+        chainNext.assign(vertexCount, NO_VERTEX);
+        chainTail.resize(vertexCount);
+        for(size_t v=0; v < vertexCount; ++v)
+            chainTail[v] = uint32_t(v);
+
+        adjacencyTriangles = liveTriangles;
+    }
+
+    /* An edge a -> b is on the border if no triangle contains the edge b -> a: */
+    bool isBorderEdge(uint32_t a, uint32_t b) const{
+        bool opposite = false;
+        forEachTriangle(a, [&](uint32_t triangle){
+            for(int k=0; k < 3; ++k)
+                if(indices[3 * triangle + k] == b && indices[3 * triangle + (k + 1) % 3] == a)
+                    opposite = true;
+        });
+        return !opposite;
+    }
+
+    /**
+     * Computes the best collapse of the edge (a, b). Returns false if both
+     * vertices are locked.
+     */
+    bool computeCollapse(uint32_t a, uint32_t b, Collapse& collapse) const{
+        if(locked[a] && locked[b])
+            return false;
+
+        // A locked vertex is always kept:
+        uint32_t keep = locked[b] ? b : a;
+        uint32_t remove = keep == a ? b : a;
+
+        // Work relative to the position of 'keep':
+        const Vec4f& origin = positions[keep];
+        Vec4f edge = difference(positions[remove], origin);
+        Quadric quadric = quadrics[keep] + quadrics[remove].translate(edge);
+
+        Vec4f offset(0.f, 0.f, 0.f, 0.f);
+        bool found = locked[keep] != 0;
+
+        // Try the global minimum of the quadric, unless it is far away from the edge:
+        if(!found && quadric.findMinimum(offset)){
+            double dx = offset.x - 0.5 * edge.x, dy = offset.y - 0.5 * edge.y, dz = offset.z - 0.5 * edge.z;
+            found = dx * dx + dy * dy + dz * dz <= 4.0 * (double(edge.x) * edge.x + double(edge.y) * edge.y + double(edge.z) * edge.z);
+        }
+
+        // Otherwise minimize the error along the edge t * (p1 - p0):
+        if(!found){
+            double zero[4] = {0.0, 0.0, 0.0, 1.0};
+            double direction[4] = {edge.x, edge.y, edge.z, 0.0};
+            double quadratic = evaluateBilinear(quadric, direction, direction);
+            double linear = evaluateBilinear(quadric, direction, zero);
+
+            double t = quadratic > 0.0 ? -linear / quadratic : 0.5;
+            t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+            offset = Vec4f(float(t * edge.x), float(t * edge.y), float(t * edge.z), 0.f);
+        }
+
+        collapse.error = quadric.evaluate(offset);
+        collapse.keep = keep;
+        collapse.remove = remove;
+        collapse.keepVersion = versions[keep];
+        collapse.removeVersion = versions[remove];
+        collapse.target = locked[keep] ? origin : Vec4f(origin.x + offset.x, origin.y + offset.y, origin.z + offset.z, 1.f);
+        return true;
+    }
+
+    /* Computes the candidates of all edges (in parallel): */
+    std::vector<Collapse> computeInitialCollapses() const{
+        size_t triangleCount = triangleAlive.size();
+        std::vector<Collapse> candidates(3 * triangleCount);
+        std::vector<uint8_t> valid(3 * triangleCount, 0);
+
+        parallelFor(0, triangleCount, CANDIDATE_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t t=begin; t < end; ++t){
+                for(int k=0; k < 3; ++k){
+                    uint32_t a = indices[3 * t + k];
+                    uint32_t b = indices[3 * t + (k + 1) % 3];
+
+                    // Interior edges appear in two triangles, take each only once
+                    // (border edges are always taken):
+                    if(a > b && !(border[a] && border[b]))
+                        continue;
+
+                    valid[3 * t + k] = computeCollapse(a, b, candidates[3 * t + k]);
+                }
+            }
+        });
+
+        size_t count = 0;
+        for(size_t i=0; i < candidates.size(); ++i)
+            if(valid[i])
+                candidates[count++] = candidates[i];
+        candidates.resize(count);
+        return candidates;
+    }
+
+    /* Pushes the candidates of all edges around the given vertex: */
+    void pushCollapses(uint32_t vertex, std::priority_queue<Collapse, std::vector<Collapse>, CollapseOrder>& queue){
+        stamp += 2;
+        marks[vertex] = stamp;
+        forEachTriangle(vertex, [&](uint32_t triangle){
+            for(int k=0; k < 3; ++k){
+                uint32_t other = indices[3 * triangle + k];
+                if(marks[other] == stamp)
+                    continue;
+                marks[other] = stamp;
+
+                Collapse collapse;
+                if(computeCollapse(vertex, other, collapse))
+                    queue.push(collapse);
+            }
+        });
+    }
+
+    /**
+     * Checks whether the collapse keeps the mesh manifold and neither flips
+     * nor degenerates any of the remaining triangles.
+     */
+    bool isCollapseValid(const Collapse& collapse){
+        uint32_t keep = collapse.keep, remove = collapse.remove;
+
+        // Mark the neighbours of 'remove' with stamp + 1, and the common
+        // neighbours of both vertices with stamp + 2:
+        stamp += 2;
+        uint32_t neighbourMark = stamp - 1, commonMark = stamp;
+
+        forEachTriangle(remove, [&](uint32_t triangle){
+            for(int k=0; k < 3; ++k)
+                marks[indices[3 * triangle + k]] = neighbourMark;
+        });
+
+        int shared = 0, common = 0;
+        forEachTriangle(keep, [&](uint32_t triangle){
+            for(int k=0; k < 3; ++k){
+                uint32_t other = indices[3 * triangle + k];
+                if(other == remove){
+                    ++shared;
+                }else if(other != keep && marks[other] == neighbourMark){
+                    marks[other] = commonMark;
+                    ++common;
+                }
+            }
+        });
+
+        // Link condition: the only common neighbours are the opposite corners
+        // of the triangles of the edge:
+        if(shared == 0 || common != shared)
+            return false;
+
+        // An interior edge between two border vertices would pinch the mesh:
+        if(shared == 2 && border[keep] && border[remove])
+            return false;
+
+        // If 'keep' already has a triangle with two common neighbours, a triangle
+        // of 'remove' with the same two neighbours would become a duplicate
+        // (this happens when a tetrahedron collapses):
+        bool keepHasCommonPair = false;
+        forEachTriangle(keep, [&](uint32_t triangle){
+            int count = 0;
+            for(int k=0; k < 3; ++k)
+                count += marks[indices[3 * triangle + k]] == commonMark ? 1 : 0;
+            keepHasCommonPair = keepHasCommonPair || count == 2;
+        });
+
+        bool valid = true;
+        auto checkTriangle = [&](uint32_t triangle, uint32_t moved){
+            const uint32_t* corners = &indices[3 * triangle];
+            int k = corners[0] == moved ? 0 : (corners[1] == moved ? 1 : 2);
+            uint32_t b = corners[(k + 1) % 3], c = corners[(k + 2) % 3];
+
+            if(b == keep || b == remove || c == keep || c == remove)
+                return;
+
+            if(moved == remove && keepHasCommonPair && marks[b] == commonMark && marks[c] == commonMark){
+                valid = false;
+                return;
+            }
+
+            Vector3d oldNormal = cross(subtract(positions[b], positions[moved]), subtract(positions[c], positions[moved]));
+            Vector3d newNormal = cross(subtract(positions[b], collapse.target), subtract(positions[c], collapse.target));
+            double oldLength = std::sqrt(dot(oldNormal, oldNormal));
+            double newLength = std::sqrt(dot(newNormal, newNormal));
+            if(oldLength > 0.0 && dot(oldNormal, newNormal) <= MIN_NORMAL_COSINE * oldLength * newLength)
+                valid = false;
+        };
+
+        forEachTriangle(keep, [&](uint32_t triangle){ if(valid) checkTriangle(triangle, keep); });
+        forEachTriangle(remove, [&](uint32_t triangle){ if(valid) checkTriangle(triangle, remove); });
+        return valid;
+    }
+
+    void applyCollapse(const Collapse& collapse){
+        uint32_t keep = collapse.keep, remove = collapse.remove;
+
+        // Remove the triangles of the edge and reconnect the others to 'keep':
+        forEachTriangle(remove, [&](uint32_t triangle){
+            uint32_t* corners = &indices[3 * triangle];
+            if(corners[0] == keep || corners[1] == keep || corners[2] == keep){
+                triangleAlive[triangle] = 0;
+                --liveTriangles;
+                return;
+            }
+            for(int k=0; k < 3; ++k)
+                if(corners[k] == remove)
+                    corners[k] = keep;
+        });
+
+        // Append the chain of 'remove' to the one of 'keep':
+        chainNext[chainTail[keep]] = remove;
+        chainTail[keep] = chainTail[remove];
+
+        // Move both quadrics to the new position:
+        quadrics[keep] = quadrics[keep].translate(difference(positions[keep], collapse.target))
+                       + quadrics[remove].translate(difference(positions[remove], collapse.target));
+        positions[keep] = collapse.target;
+        border[keep] |= border[remove];
+        vertexAlive[remove] = 0;
+        ++versions[keep];
+    }
+
+    std::vector<Vec4f>& positions;
+    std::vector<uint32_t>& indices;
+    const std::vector<uint8_t>& locked;
+    std::vector<Quadric>& quadrics;
+
+    std::vector<uint8_t> triangleAlive, vertexAlive, border;
+    std::vector<uint32_t> versions, marks;
+    uint32_t stamp;
+    size_t liveTriangles;
+
+    std::vector<uint32_t> adjacencyStart, adjacency, chainNext, chainTail;
+    size_t adjacencyTriangles;
+};
+
+/**
+ * Simplifies the triangles in spatial clusters on separate threads. The
+ * vertices which are shared by different clusters are locked. On return,
+ * 'indices' contains the triangles of all clusters (with the original vertex
+ * indices), and 'positions' and 'quadrics' the merged vertices.
+ */
+void simplifyClusters(std::vector<Vec4f>& positions, std::vector<uint32_t>& indices, std::vector<Quadric>& quadrics,
+                      size_t clusterCount, const SimplificationSettings& settings){
+    size_t triangleCount = indices.size() / 3;
+
+    // Sort the triangles along a Morton curve through their centroids:
+    AABB bounds = computeAABB(positions.data(), positions.size());
+    std::vector<std::pair<uint32_t, uint32_t>> order(triangleCount);
+    parallelFor(0, triangleCount, CANDIDATE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t t=begin; t < end; ++t){
+            const Vec4f& a = positions[indices[3 * t]];
+            const Vec4f& b = positions[indices[3 * t + 1]];
+            const Vec4f& c = positions[indices[3 * t + 2]];
+            Vec4f centroid((a.x + b.x + c.x) / 3.f, (a.y + b.y + c.y) / 3.f, (a.z + b.z + c.z) / 3.f, 1.f);
+            order[t] = std::make_pair(computeMortonCode30(centroid, bounds), uint32_t(t));
+        }
+    });
+    std::sort(order.begin(), order.end());
+
+    // Lock all vertices which are used by more than one cluster:
+    std::vector<uint32_t> owner(positions.size(), NO_VERTEX);
+    std::vector<uint8_t> locked(positions.size(), 0);
+    for(size_t i=0; i < triangleCount; ++i){
+        uint32_t cluster = uint32_t(i * clusterCount / triangleCount);
+        for(int k=0; k < 3; ++k){
+            uint32_t vertex = indices[3 * order[i].second + k];
+            if(owner[vertex] == NO_VERTEX)
+                owner[vertex] = cluster;
+            else if(owner[vertex] != cluster)
+                locked[vertex] = 1;
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> clusterIndices(clusterCount);
+    std::vector<std::vector<std::pair<uint32_t, Quadric>>> lockedQuadrics(clusterCount);
+    parallelFor(0, clusterCount, 1, [&](size_t clusterBegin, size_t clusterEnd){
+        for(size_t cluster=clusterBegin; cluster < clusterEnd; ++cluster){
+            size_t begin = cluster * triangleCount / clusterCount;
+            size_t end = (cluster + 1) * triangleCount / clusterCount;
+
+            // Collect the vertices of the cluster (sorted by global index):
+            std::vector<uint32_t> vertices;
+            vertices.reserve(3 * (end - begin));
+            for(size_t i=begin; i < end; ++i)
+                for(int k=0; k < 3; ++k)
+                    vertices.push_back(indices[3 * order[i].second + k]);
+            std::sort(vertices.begin(), vertices.end());
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+            std::vector<Vec4f> localPositions(vertices.size());
+            std::vector<Quadric> localQuadrics(vertices.size());
+            std::vector<uint8_t> localLocked(vertices.size());
+            size_t lockedCount = 0;
+            for(size_t v=0; v < vertices.size(); ++v){
+                localPositions[v] = positions[vertices[v]];
+                localQuadrics[v] = quadrics[vertices[v]];
+                localLocked[v] = locked[vertices[v]];
+                lockedCount += localLocked[v];
+            }
+
+            std::vector<uint32_t> localIndices(3 * (end - begin));
+            for(size_t i=begin; i < end; ++i){
+                for(int k=0; k < 3; ++k){
+                    uint32_t vertex = indices[3 * order[i].second + k];
+                    localIndices[3 * (i - begin) + k] = uint32_t(std::lower_bound(vertices.begin(), vertices.end(), vertex) - vertices.begin());
+                }
+            }
+
+            // Simplify the cluster down to a bit more than its share of the
+            // target, plus about one triangle per locked vertex (which remain
+            // as a band of small triangles along the border of the cluster):
+            size_t target = size_t(CLUSTER_TARGET_FACTOR * settings.targetTriangleCount * (end - begin) / triangleCount) + lockedCount;
+            Simplifier simplifier(localPositions, localIndices, localLocked, localQuadrics);
+            simplifier.run(target, settings.maxError);
+
+            // Only this cluster may change its unlocked vertices. The locked
+            // vertices do not move, but they may have absorbed other vertices:
+            for(size_t v=0; v < vertices.size(); ++v){
+                if(!localLocked[v]){
+                    positions[vertices[v]] = localPositions[v];
+                    quadrics[vertices[v]] = localQuadrics[v];
+                }else{
+                    lockedQuadrics[cluster].push_back(std::make_pair(vertices[v], localQuadrics[v] - quadrics[vertices[v]]));
+                }
+            }
+
+            for(uint32_t& index : localIndices)
+                index = vertices[index];
+            clusterIndices[cluster].swap(localIndices);
+        }
+    });
+
+    // Stitch the clusters together (the locked vertices have the same index
+    // in all clusters):
+    indices.clear();
+    for(const std::vector<uint32_t>& cluster : clusterIndices)
+        indices.insert(indices.end(), cluster.begin(), cluster.end());
+
+    for(const std::vector<std::pair<uint32_t, Quadric>>& cluster : lockedQuadrics)
+        for(const std::pair<uint32_t, Quadric>& change : cluster)
+            quadrics[change.first] += change.second;
+}
+
+}
+
+SimplificationSettings::SimplificationSettings()
+    : targetTriangleCount(0), maxError(FLT_MAX), borderWeight(100.f), clusterCount(1)
+{}
+
+TriangleMesh simplifyMesh(const TriangleMesh& mesh, const SimplificationSettings& settings){
+    size_t vertexCount = mesh.getVertexCount();
+    if(mesh.indices.size() % 3 != 0)
+        throw std::invalid_argument("simplifyMesh: the number of indices must be a multiple of three.");
+    for(uint32_t index : mesh.indices)
+        if(index >= vertexCount)
+            throw std::invalid_argument("simplifyMesh: index out of range.");
+
+    if(mesh.indices.empty())
+        return TriangleMesh();
+
+    std::vector<Vec4f> positions = mesh.positions;
+    std::vector<uint32_t> indices = mesh.indices;
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<uint8_t> locked(vertexCount, 0);
+
+    size_t clusterCount = settings.clusterCount == 0 ? 4 * size_t(getThreadCount()) : settings.clusterCount;
+    size_t triangleCount = indices.size() / 3;
+    if(clusterCount > triangleCount / MIN_CLUSTER_TRIANGLES)
+        clusterCount = triangleCount / MIN_CLUSTER_TRIANGLES;
+
+    if(clusterCount > 1){
+        Simplifier(positions, indices, locked, quadrics).addPlaneQuadrics(settings.borderWeight);
+        simplifyClusters(positions, indices, quadrics, clusterCount, settings);
+
+        // Remove the remaining border vertices of the clusters:
+        Simplifier(positions, indices, locked, quadrics).run(settings.targetTriangleCount, settings.maxError);
+    }else{
+        Simplifier simplifier(positions, indices, locked, quadrics);
+        simplifier.addPlaneQuadrics(settings.borderWeight);
+        simplifier.run(settings.targetTriangleCount, settings.maxError);
+    }
+
+    // Remove the unused vertices (keeping the order of the others):
+    std::vector<uint32_t> remap(vertexCount, NO_VERTEX);
+    for(uint32_t index : indices)
+        remap[index] = 0;
+
+    TriangleMesh result;
+    for(size_t v=0; v < vertexCount; ++v){
+        if(remap[v] == NO_VERTEX)
+            continue;
+        remap[v] = uint32_t(result.positions.size());
+        result.positions.push_back(positions[v]);
+    }
+
+    result.indices.resize(indices.size());
+    for(size_t i=0; i < indices.size(); ++i)
+        result.indices[i] = remap[indices[i]];
+
+    return result;
+}
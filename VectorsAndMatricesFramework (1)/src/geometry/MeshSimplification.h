@@ -0,0 +1,87 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include the mesh class which is simplified: */
+#include "TriangleMesh.h"
+
+/**
+ * The parameters of simplifyMesh(...).
+ */
+
+class SimplificationSettings
+{
+public:
+    /**
+     * The simplification stops as soon as the mesh has at most this number of
+     * triangles (default 0, so only maxError stops it).
+     */
+    size_t targetTriangleCount;
+
+    /**
+     * The simplification stops before the first edge collapse whose error
+     * would exceed this value (default FLT_MAX). The error of a collapse is
+     * the area weighted sum of the squared distances of the new vertex to the
+     * planes of the original triangles around it, so its unit is length^4.
+     */
+    float maxError;
+
+    /**
+     * Weight of the additional planes which keep open borders in place (they
+     * are perpendicular to the border triangles and weighted by the squared
+     * border edge length times this factor). Default: 100.
+     */
+    float borderWeight;
+
+    /**
+     * The number of spatial clusters which are simplified in parallel. With
+     * 1 (the default) the whole mesh is simplified at once. With 0, four
+     * clusters per thread are used.
+     */
+    unsigned int clusterCount;
+
+    /**
+     * Constructs the default settings.
+     */
+    SimplificationSettings();
+};
+
+/**
+ * Simplifies the given mesh by repeatedly collapsing the edge with the
+ * smallest quadric error (Garland and Heckbert, "Surface Simplification Using
+ * Quadric Error Metrics", 1997) and returns the simplified mesh.
+ *
+ * How it works:
+ *  - Every vertex gets the Quadric (see Quadric.h) of the planes of its
+ *    triangles, weighted by their area. Collapsing an edge merges the two
+ *    vertices into one whose position minimizes the sum of both quadrics.
+ *  - The candidate collapses are kept in a priority queue. Instead of
+ *    removing or updating entries when a vertex changes, every entry stores
+ *    the 'version' of both vertices; outdated entries are simply skipped when
+ *    they are popped (lazy invalidation), and new entries are pushed for all
+ *    edges around the merged vertex.
+ *  - A collapse is rejected if it would make the mesh non-manifold, or flip
+ *    or degenerate one of the remaining triangles.
+ *
+ * The cluster-parallel mode (settings.clusterCount != 1) splits the triangles
+ * into spatially coherent clusters along a Morton curve. The vertices which
+ * are shared by different clusters are locked, so each cluster can be
+ * simplified on its own thread down to its share of the target. Afterwards
+ * the clusters are stitched together at the locked vertices (which still have
+ * their original indices) and a final pass over the combined, much smaller
+ * mesh removes the remaining border vertices until the target is reached.
+ * The quadrics of all vertices are carried over into the final pass, so the
+ * errors are the same as in a single pass.
+ *
+ * The input mesh should share vertices between neighbouring triangles (an
+ * indexed mesh in which every triangle has its own three vertices cannot be
+ * simplified). Unused vertices are removed from the result. The result has
+ * no normals, since they cannot be merged like positions (compute new ones
+ * for the simplified mesh instead).
+ */
+TriangleMesh simplifyMesh(const TriangleMesh& mesh, const SimplificationSettings& settings);
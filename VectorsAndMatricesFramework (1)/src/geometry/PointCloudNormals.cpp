@@ -0,0 +1,314 @@
+#include "PointCloudNormals.h"
+#include "KdTree.h"
+#include "../math/FloatLanes.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/* The number of (Morton ordered) points which are processed by one task: */
+const size_t NORMAL_BLOCK_SIZE = 1024;
+
+/* The number of nearest neighbours per point which are kept as edges of the
+   graph for the orientation: */
+const size_t ORIENTATION_NEIGHBOURS = 8;
+
+/* The number of buckets of the priority queue of the orientation: */
+const int ORIENTATION_BUCKETS = 64;
+
+/* Marks points which are not yet part of a component: */
+const uint32_t NO_COMPONENT = 0xffffffffu;
+
+/**
+ * Computes the eigenvector of the smallest eigenvalue (the normal) and the
+ * smallest eigenvalue itself of FLOAT_LANES symmetric, positive semidefinite
+ * 3x3 matrices with trace 1 (given by a = (xx, xy, xz, yy, yz, zz)).
+ */
+void solveSmallestEigenvector(const FloatLanes a[6], FloatLanes normal[3], FloatLanes& smallest){
+    const float tiny = 1e-30f;
+    FloatLanes zero = broadcast(0.f), one = broadcast(1.f);
+
+    // The eigenvalues are q + 2 p cos(phi + 2 pi k / 3) (Smith, 1961), where
+    // cos(3 phi) = det((A - q I) / p) / 2:
+    FloatLanes q = (a[0] + a[3] + a[5]) * (1.f / 3.f);
+    FloatLanes b0 = a[0] - q, b3 = a[3] - q, b5 = a[5] - q;
+    FloatLanes offDiagonal = a[1] * a[1] + a[2] * a[2] + a[4] * a[4];
+    FloatLanes p = sqrt((b0 * b0 + b3 * b3 + b5 * b5 + 2.f * offDiagonal) * (1.f / 6.f));
+    FloatLanes inverseP = one / maximum(p, broadcast(tiny));
+
+    FloatLanes c0 = b0 * inverseP, c1 = a[1] * inverseP, c2 = a[2] * inverseP;
+    FloatLanes c3 = b3 * inverseP, c4 = a[4] * inverseP, c5 = b5 * inverseP;
+    FloatLanes halfDeterminant = 0.5f * (c0 * (c3 * c5 - c4 * c4) - c1 * (c1 * c5 - c4 * c2)
+                                         + c2 * (c1 * c4 - c3 * c2));
+
+    // cos(phi) and sin(phi) (the only per-lane library calls):
+    FloatLanes cosine, sine;
+    for(int l=0; l < FLOAT_LANES; ++l){
+        float r = std::max(-1.f, std::min(1.f, halfDeterminant.v[l]));
+        float phi = std::acos(r) / 3.f;
+        cosine.v[l] = std::cos(phi);
+        sine.v[l] = std::sin(phi);
+    }
+
+    // The smallest one is k = 1: q + 2 p cos(phi + 2 pi / 3):
+    smallest = maximum(q - p * (cosine + 1.7320508f * sine), zero);
+
+    // The rows of A - smallest * I span the plane orthogonal to the
+    // eigenvector, so the largest cross product of two rows is parallel to it:
+    FloatLanes rows[3][3] = {{a[0] - smallest, a[1], a[2]},
+                             {a[1], a[3] - smallest, a[4]},
+                             {a[2], a[4], a[5] - smallest}};
+    FloatLanes best[3] = {zero, zero, zero}, bestLength = zero;
+    const int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for(int pair=0; pair < 3; ++pair){
+        const FloatLanes* u = rows[pairs[pair][0]];
+        const FloatLanes* v = rows[pairs[pair][1]];
+        FloatLanes cross[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        FloatLanes length = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+        LaneMask larger = length > bestLength;
+        for(int c=0; c < 3; ++c)
+            best[c] = select(larger, cross[c], best[c]);
+        bestLength = select(larger, length, bestLength);
+    }
+
+    // If the two smallest eigenvalues are (almost) equal (points on a line),
+    // every vector orthogonal to the largest row is an eigenvector; if all
+    // are equal, every vector is one:
+    FloatLanes largestRow[3] = {rows[0][0], rows[0][1], rows[0][2]};
+    FloatLanes rowLength = rows[0][0] * rows[0][0] + rows[0][1] * rows[0][1] + rows[0][2] * rows[0][2];
+    for(int r=1; r < 3; ++r){
+        FloatLanes length = rows[r][0] * rows[r][0] + rows[r][1] * rows[r][1] + rows[r][2] * rows[r][2];
+        LaneMask larger = length > rowLength;
+        for(int c=0; c < 3; ++c)
+            largestRow[c] = select(larger, rows[r][c], largestRow[c]);
+        rowLength = select(larger, length, rowLength);
+    }
+    LaneMask useX = abs(largestRow[0]) > abs(largestRow[2]);
+    FloatLanes orthogonal[3] = {select(useX, -largestRow[1], zero),
+                                select(useX, largestRow[0], -largestRow[2]),
+                                select(useX, zero, largestRow[1])};
+
+    LaneMask crossValid = bestLength > broadcast(1e-12f);
+    LaneMask rowValid = rowLength > broadcast(1e-12f);
+    FloatLanes fallbackZ = select(rowValid, orthogonal[2], one);
+    normal[0] = select(crossValid, best[0], select(rowValid, orthogonal[0], zero));
+    normal[1] = select(crossValid, best[1], select(rowValid, orthogonal[1], zero));
+    normal[2] = select(crossValid, best[2], fallbackZ);
+
+    FloatLanes inverseLength = rsqrt(maximum(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2],
+                                             broadcast(tiny)));
+    for(int c=0; c < 3; ++c)
+        normal[c] = normal[c] * inverseLength;
+}
+
+/* A point which waits for its orientation, and the oriented point whose
+   normal it should agree with: */
+struct OrientationEntry {
+    uint32_t point;
+    uint32_t from;
+};
+
+/**
+ * Orients the normals consistently along the graph of the nearest neighbours
+ * (see estimatePointCloudNormals(...)).
+ */
+void orientNormals(const Vec4f* points, size_t count, Vec4f* normals, const std::vector<uint32_t>& order,
+                   const std::vector<uint32_t>& graph, size_t edgeCount){
+    auto dot = [&](uint32_t i, uint32_t j){
+        return normals[i].x * normals[j].x + normals[i].y * normals[j].y + normals[i].z * normals[j].z;
+    };
+    auto orient = [&](uint32_t point, uint32_t from){
+        if(dot(point, from) < 0.f)
+            normals[point] = Vec4f(-normals[point].x, -normals[point].y, -normals[point].z, 0.f);
+    };
+
+    Vec4f centroid = computeCentroid(points, count);
+    std::vector<uint32_t> components(count, NO_COMPONENT);
+    std::vector<uint32_t> farthestPoints;
+    std::vector<float> farthestDistances;
+    std::vector<std::vector<OrientationEntry>> buckets(ORIENTATION_BUCKETS);
+
+    for(size_t s=0; s < count; ++s){
+        uint32_t seed = order[s];
+        if(components[seed] != NO_COMPONENT)
+            continue;
+
+        // Join the component of the most parallel oriented neighbour, or
+        // start a new component:
+        uint32_t component = uint32_t(farthestPoints.size());
+        float bestDot = -1.f;
+        uint32_t from = seed;
+        for(size_t e=0; e < edgeCount; ++e){
+            uint32_t neighbour = graph[seed * edgeCount + e];
+            if(components[neighbour] != NO_COMPONENT && std::fabs(dot(seed, neighbour)) > bestDot){
+                bestDot = std::fabs(dot(seed, neighbour));
+                component = components[neighbour];
+                from = neighbour;
+            }
+        }
+        if(component == farthestPoints.size()){
+            farthestPoints.push_back(seed);
+            farthestDistances.push_back(-1.f);
+        }
+
+        // Propagate the orientation along the most parallel normals first:
+        OrientationEntry start = {seed, from};
+        buckets[ORIENTATION_BUCKETS - 1].push_back(start);
+        int top = ORIENTATION_BUCKETS - 1;
+        while(top >= 0){
+            if(buckets[top].empty()){
+                --top;
+                continue;
+            }
+            OrientationEntry entry = buckets[top].back();
+            buckets[top].pop_back();
+            if(components[entry.point] != NO_COMPONENT)
+                continue;
+
+            orient(entry.point, entry.from);
+            components[entry.point] = component;
+
+            const Vec4f& p = points[entry.point];
+            float distance = (p.x - centroid.x) * (p.x - centroid.x) + (p.y - centroid.y) * (p.y - centroid.y)
+                           + (p.z - centroid.z) * (p.z - centroid.z);
+            if(distance > farthestDistances[component]){
+                farthestDistances[component] = distance;
+                farthestPoints[component] = entry.point;
+            }
+
+            for(size_t e=0; e < edgeCount; ++e){
+                uint32_t neighbour = graph[entry.point * edgeCount + e];
+                if(components[neighbour] != NO_COMPONENT)
+                    continue;
+                int bucket = std::min(ORIENTATION_BUCKETS - 1, int(std::fabs(dot(entry.point, neighbour))
+                                                                   * ORIENTATION_BUCKETS));
+                OrientationEntry next = {neighbour, entry.point};
+                buckets[bucket].push_back(next);
+                top = std::max(top, bucket);
+            }
+        }
+    }
+
+    // Flip every component whose farthest point has an inward normal:
+    std::vector<char> flip(farthestPoints.size());
+    for(size_t c=0; c < farthestPoints.size(); ++c){
+        const Vec4f& p = points[farthestPoints[c]];
+        const Vec4f& n = normals[farthestPoints[c]];
+        flip[c] = n.x * (p.x - centroid.x) + n.y * (p.y - centroid.y) + n.z * (p.z - centroid.z) < 0.f;
+    }
+
+    parallelFor(0, count, NORMAL_BLOCK_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            if(flip[components[i]])
+                normals[i] = Vec4f(-normals[i].x, -normals[i].y, -normals[i].z, 0.f);
+        }
+    });
+}
+
+}
+
+PointCloudNormalSettings::PointCloudNormalSettings()
+    : neighbourCount(16), orient(true)
+{}
+
+void estimatePointCloudNormals(const Vec4f* points, size_t count, Vec4f* normals, float* curvatures,
+                               const PointCloudNormalSettings& settings){
+    if(settings.neighbourCount < 3)
+        throw std::invalid_argument("estimatePointCloudNormals: at least 3 neighbours are needed.");
+    if(count == 0)
+        return;
+
+    std::vector<uint32_t> order = computeMortonOrder(points, count);
+    KdTree tree(points, count);
+
+    size_t k = std::min(settings.neighbourCount, count);
+    size_t edgeCount = settings.orient ? std::min(k, ORIENTATION_NEIGHBOURS) : 0;
+    std::vector<uint32_t> graph(count * edgeCount);
+
+    parallelFor(0, count, NORMAL_BLOCK_SIZE, [&](size_t begin, size_t end){
+        std::vector<uint32_t> neighbours(FLOAT_LANES * k);
+        std::vector<float> squaredDistances(k);
+
+        for(size_t i=begin; i < end; i += FLOAT_LANES){
+            int lanes = end - i < FLOAT_LANES ? int(end - i) : FLOAT_LANES;
+
+            // Find the neighbourhoods (unused lanes repeat the first one):
+            FloatLanes center[3];
+            for(int l=0; l < FLOAT_LANES; ++l){
+                uint32_t point = order[i + (l < lanes ? l : 0)];
+                center[0].v[l] = points[point].x;
+                center[1].v[l] = points[point].y;
+                center[2].v[l] = points[point].z;
+                if(l >= lanes){
+                    std::copy(neighbours.begin(), neighbours.begin() + k, neighbours.begin() + l * k);
+                    continue;
+                }
+
+                tree.findNearest(points[point], k, INFINITY, &neighbours[l * k], squaredDistances.data());
+                for(size_t e=0; e < edgeCount; ++e)
+                    graph[point * edgeCount + e] = neighbours[l * k + e];
+            }
+
+            // The covariance relative to the centers (which keeps the
+            // precision of far away points):
+            FloatLanes sums[3], products[6];
+            for(int c=0; c < 3; ++c)
+                sums[c] = broadcast(0.f);
+            for(int c=0; c < 6; ++c)
+                products[c] = broadcast(0.f);
+
+            for(size_t j=0; j < k; ++j){
+                FloatLanes d[3];
+                for(int l=0; l < FLOAT_LANES; ++l){
+                    const Vec4f& neighbour = points[neighbours[l * k + j]];
+                    d[0].v[l] = neighbour.x;
+                    d[1].v[l] = neighbour.y;
+                    d[2].v[l] = neighbour.z;
+                }
+                for(int c=0; c < 3; ++c){
+                    d[c] = d[c] - center[c];
+                    sums[c] = sums[c] + d[c];
+                }
+                products[0] = products[0] + d[0] * d[0];
+                products[1] = products[1] + d[0] * d[1];
+                products[2] = products[2] + d[0] * d[2];
+                products[3] = products[3] + d[1] * d[1];
+                products[4] = products[4] + d[1] * d[2];
+                products[5] = products[5] + d[2] * d[2];
+            }
+
+            float inverseK = 1.f / float(k);
+            FloatLanes mean[3] = {sums[0] * inverseK, sums[1] * inverseK, sums[2] * inverseK};
+            const int rows[6] = {0, 0, 0, 1, 1, 2}, columns[6] = {0, 1, 2, 1, 2, 2};
+            FloatLanes covariance[6];
+            for(int c=0; c < 6; ++c)
+                covariance[c] = products[c] * inverseK - mean[rows[c]] * mean[columns[c]];
+
+            // Normalize the trace to 1, so that the eigenvalue is the
+            // curvature and the thresholds of the solver are scale invariant:
+            FloatLanes inverseTrace = broadcast(1.f) / maximum(covariance[0] + covariance[3] + covariance[5],
+                                                               broadcast(1e-30f));
+            for(int c=0; c < 6; ++c)
+                covariance[c] = covariance[c] * inverseTrace;
+
+            FloatLanes normal[3], curvature;
+            solveSmallestEigenvector(covariance, normal, curvature);
+
+            for(int l=0; l < lanes; ++l){
+                uint32_t point = order[i + l];
+                normals[point] = Vec4f(normal[0].v[l], normal[1].v[l], normal[2].v[l], 0.f);
+                if(curvatures)
+                    curvatures[point] = curvature.v[l];
+            }
+        }
+    });
+
+    if(settings.orient)
+        orientNormals(points, count, normals, order, graph, edgeCount);
+}
@@ -0,0 +1,76 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our vectors: */
+#include "../math/Vec4f.h"
+
+/**
+ * The parameters of estimatePointCloudNormals(...).
+ */
+
+class PointCloudNormalSettings
+{
+public:
+    /**
+     * The number of nearest neighbours (including the point itself) which
+     * form the neighbourhood of a point (default 16). More neighbours give
+     * smoother normals, fewer ones preserve sharper features.
+     */
+    size_t neighbourCount;
+
+    /**
+     * Whether the normals are oriented consistently (default true).
+     * Otherwise every normal has an arbitrary sign.
+     */
+    bool orient;
+
+    /**
+     * Constructs the default settings.
+     */
+    PointCloudNormalSettings();
+};
+
+/**
+ * Estimates the normal and the curvature of every point of an unorganized
+ * point cloud (for example a laser scan) from its k nearest neighbours.
+ *
+ * The normal is the eigenvector of the smallest eigenvalue of the covariance
+ * matrix of the neighbourhood (principal component analysis; Hoppe et al.,
+ * "Surface reconstruction from unorganized points", 1992), and the curvature
+ * is the 'surface variation' lambda_0 / (lambda_0 + lambda_1 + lambda_2) of
+ * the eigenvalues lambda_0 <= lambda_1 <= lambda_2 (Pauly et al., 2002): 0
+ * for a plane and at most 1/3 for an isotropic neighbourhood.
+ *
+ * The points are processed in Morton order (see Sorting.h), in parallel
+ * blocks of consecutive points, so that neighbouring queries of the k-d tree
+ * (see KdTree.h) and the neighbourhoods of a block share the cache. Within a
+ * block, FLOAT_LANES neighbourhoods at once are reduced to their covariance
+ * matrices and solved in closed form (the smallest eigenvalue with the
+ * trigonometric solution of the characteristic polynomial, the eigenvector
+ * as the largest cross product of two rows of A - lambda_0 * I), without any
+ * iteration or branch.
+ *
+ * The orientation is propagated along the neighbourhood graph (like Hoppe et
+ * al.): starting at a seed, the normal of the unvisited neighbour which is
+ * most parallel to an already oriented normal is flipped to agree with it,
+ * so the orientation travels along smooth regions first. The priority queue
+ * uses a fixed number of buckets of |dot(n_i, n_j)| (which makes the
+ * propagation linear in the number of points). Every connected part of the
+ * graph is finally flipped so that the normal of its point which is farthest
+ * away from the centroid of the cloud points outwards (which is correct for
+ * closed surfaces). The propagation is serial, but visits the points in a
+ * deterministic order, so the result does not depend on the number of
+ * threads.
+ *
+ * 'normals' receives the normalized normals (w = 0) and 'curvatures' (if not
+ * nullptr) the curvatures; both must provide space for 'count' elements.
+ * Throws std::invalid_argument if settings.neighbourCount < 3.
+ */
+void estimatePointCloudNormals(const Vec4f* points, size_t count, Vec4f* normals, float* curvatures,
+                               const PointCloudNormalSettings& settings);
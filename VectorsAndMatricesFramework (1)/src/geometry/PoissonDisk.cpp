@@ -0,0 +1,743 @@
+#include "PoissonDisk.h"
+#include "../math/Morton.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The index of a missing cell or sample: */
+const uint32_t NONE = 0xffffffffu;
+
+/* The number of cells which are processed by one task: */
+const size_t POISSON_GRAIN_SIZE = 1024;
+
+/* The number of triangle rows (see createCellParts(...)) which are
+   processed by one task: */
+const size_t ROW_GRAIN_SIZE = 64;
+
+/* The number of cells along an axis must be smaller than this (so the cells
+   can be identified by their 63 bit Morton codes): */
+const uint64_t MAX_CELLS_PER_AXIS = 1ull << 21;
+
+/* The largest number of vertices of a triangle which is clipped by a box: */
+const int MAX_POLYGON_SIZE = 9;
+
+/* The 27 neighbours of a cell (including itself), roughly sorted by their
+   distance to a point in the cell: along every axis, 0 is the cell itself,
+   1 the neighbour on the nearer side and 2 the one on the farther side. */
+const uint8_t NEIGHBOUR_ORDER[27][3] = {
+    {0, 0, 0},
+    {1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+    {1, 1, 0}, {1, 0, 1}, {0, 1, 1}, {2, 0, 0}, {0, 2, 0}, {0, 0, 2},
+    {1, 1, 1}, {2, 1, 0}, {2, 0, 1}, {1, 2, 0}, {0, 2, 1}, {1, 0, 2}, {0, 1, 2},
+    {2, 1, 1}, {1, 2, 1}, {1, 1, 2}, {2, 2, 0}, {2, 0, 2}, {0, 2, 2},
+    {2, 2, 1}, {2, 1, 2}, {1, 2, 2},
+    {2, 2, 2}
+};
+
+/* Returns a well mixed hash of x (the finalizer of SplitMix64): */
+uint64_t mixBits(uint64_t x){
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Returns the k-th random number in [0, 1) of the dart with the given key: */
+float getRandom(uint64_t key, uint32_t k){
+    return float(mixBits(key + (uint64_t(k) + 1) * 0x9e3779b97f4a7c15ull) >> 40) * (1.f / 16777216.f);
+}
+
+/**
+ * A sample which was accepted by a task, before it is added to the grid.
+ */
+struct AcceptedSample {
+    uint32_t cell;
+    uint32_t tag;
+    Vec4f position;
+};
+
+/**
+ * An entry of the hash table from Morton codes to cells.
+ */
+struct HashEntry {
+    uint64_t code;
+    uint32_t cell;
+};
+
+/**
+ * The background grid of the samplers: the cells of edge length 'radius'
+ * which may receive samples (sorted by their phase groups and then along the
+ * Morton curve), and the samples of every cell as a linked list.
+ */
+class SampleGrid
+{
+public:
+    /** The minimum corner of the cell (0, 0, 0) */
+    float origin[3];
+
+    /** The edge length of the cells, which is the sampling radius */
+    float radius;
+
+    /** The number of cells along x, y and z */
+    uint64_t sizes[3];
+
+    /** The Morton codes of the cells */
+    std::vector<uint64_t> codes;
+
+    /** The cells of the phase group g are [phaseOffsets[g], phaseOffsets[g + 1]) */
+    size_t phaseOffsets[9];
+
+    /** The samples, their tags, and the next sample of the same cell */
+    std::vector<Vec4f> samples;
+    std::vector<uint32_t> tags;
+    std::vector<uint32_t> nexts;
+
+    /**
+     * Computes the number of cells along every axis for the given extent
+     * (and centers the cells on the extent if 'center' is set).
+     */
+    SampleGrid(const AABB& bounds, float radius, bool center){
+        this->radius = radius;
+        const float* min = &bounds.min.x;
+        const float* max = &bounds.max.x;
+        uint64_t total = 1;
+        for(int d=0; d < 3; ++d){
+            double extent = double(max[d]) - double(min[d]);
+            double cells = center ? std::floor(extent / radius) + 1.0 : std::max(1.0, std::ceil(extent / radius));
+            if(!(cells < double(MAX_CELLS_PER_AXIS)))
+                throw std::invalid_argument("samplePoissonDisk: the radius is too small.");
+            sizes[d] = uint64_t(cells);
+            origin[d] = center ? float(min[d] - 0.5 * (cells * radius - extent)) : min[d];
+            total *= sizes[d];
+        }
+        if(total >= NONE)
+            throw std::invalid_argument("samplePoissonDisk: the radius is too small.");
+    }
+
+    /**
+     * Returns the index of a cell in the dense grid.
+     */
+    size_t getGridIndex(uint32_t x, uint32_t y, uint32_t z) const {
+        return size_t((z * sizes[1] + y) * sizes[0] + x);
+    }
+
+    /**
+     * Sets the cells to the given Morton codes (sorted and unique). Returns
+     * the old index of every cell, since the cells are reordered by their
+     * phase groups. With 'dense', the neighbours of a cell are found with a
+     * dense array of all grid cells, otherwise they are found once with a
+     * hash table and stored per cell.
+     */
+    std::vector<uint32_t> setCells(const std::vector<uint64_t>& sortedCodes, bool dense){
+        size_t count = sortedCodes.size();
+
+        // The lowest three bits of a Morton code are the parities of x, y
+        // and z, so a stable counting sort of them groups the phases:
+        std::fill(phaseOffsets, phaseOffsets + 9, 0);
+        for(size_t i=0; i < count; ++i)
+            ++phaseOffsets[(sortedCodes[i] & 7) + 1];
+        for(int g=0; g < 8; ++g)
+            phaseOffsets[g + 1] += phaseOffsets[g];
+
+        size_t next[8];
+        std::copy(phaseOffsets, phaseOffsets + 8, next);
+        std::vector<uint32_t> order(count);
+        codes.resize(count);
+        for(size_t i=0; i < count; ++i){
+            size_t slot = next[sortedCodes[i] & 7]++;
+            codes[slot] = sortedCodes[i];
+            order[slot] = uint32_t(i);
+        }
+
+        heads.assign(count, NONE);
+        gridCells.clear();
+        if(dense){
+            gridCells.assign(size_t(sizes[0] * sizes[1] * sizes[2]), NONE);
+            parallelFor(0, count, POISSON_GRAIN_SIZE, [&](size_t begin, size_t end){
+                for(size_t cell=begin; cell < end; ++cell){
+                    uint32_t x, y, z;
+                    decodeMorton63(codes[cell], x, y, z);
+                    gridCells[getGridIndex(x, y, z)] = uint32_t(cell);
+                }
+            });
+            return order;
+        }
+
+        // Hash the cells by their codes (with Fibonacci hashing):
+        int hashShift = 60;
+        while((size_t(1) << (64 - hashShift)) < 2 * count)
+            --hashShift;
+        HashEntry empty = {~0ull, NONE};
+        std::vector<HashEntry> hashEntries(size_t(1) << (64 - hashShift), empty);
+        size_t mask = hashEntries.size() - 1;
+        for(size_t cell=0; cell < count; ++cell){
+            size_t slot = size_t((codes[cell] * 0x9e3779b97f4a7c15ull) >> hashShift);
+            while(hashEntries[slot].code != ~0ull)
+                slot = (slot + 1) & mask;
+            hashEntries[slot].code = codes[cell];
+            hashEntries[slot].cell = uint32_t(cell);
+        }
+
+        // Store the existing neighbours of every cell (roughly sorted by
+        // their distance), since looking them up in the hash table for every
+        // dart would miss the cache most of the time:
+        std::vector<std::vector<uint32_t> > chunkNeighbours(getChunkCount(count, POISSON_GRAIN_SIZE));
+        std::vector<uint32_t> neighbourCounts(count);
+        parallelFor(0, count, POISSON_GRAIN_SIZE, [&](size_t begin, size_t end){
+            std::vector<uint32_t>& local = chunkNeighbours[begin / POISSON_GRAIN_SIZE];
+            for(size_t cell=begin; cell < end; ++cell){
+                uint32_t c[3];
+                decodeMorton63(codes[cell], c[0], c[1], c[2]);
+                size_t first = local.size();
+                for(int k=1; k < 27; ++k){
+                    int64_t n[3];
+                    for(int d=0; d < 3; ++d)
+                        n[d] = int64_t(c[d]) + (NEIGHBOUR_ORDER[k][d] == 2 ? 1 : -int64_t(NEIGHBOUR_ORDER[k][d]));
+                    if(!isInside(n))
+                        continue;
+                    uint64_t code = encodeMorton63(uint32_t(n[0]), uint32_t(n[1]), uint32_t(n[2]));
+                    size_t slot = size_t((code * 0x9e3779b97f4a7c15ull) >> hashShift);
+                    for(; hashEntries[slot].code != ~0ull; slot = (slot + 1) & mask){
+                        if(hashEntries[slot].code == code){
+                            local.push_back(hashEntries[slot].cell);
+                            break;
+                        }
+                    }
+                }
+                neighbourCounts[cell] = uint32_t(local.size() - first);
+            }
+        });
+
+        neighbourOffsets.assign(count + 1, 0);
+        for(size_t cell=0; cell < count; ++cell)
+            neighbourOffsets[cell + 1] = neighbourOffsets[cell] + neighbourCounts[cell];
+        neighbours.clear();
+        neighbours.reserve(neighbourOffsets[count]);
+        for(const std::vector<uint32_t>& local : chunkNeighbours)
+            neighbours.insert(neighbours.end(), local.begin(), local.end());
+        return order;
+    }
+
+    /**
+     * Returns whether the grid cell n lies inside of the grid.
+     */
+    bool isInside(const int64_t n[3]) const {
+        return n[0] >= 0 && n[1] >= 0 && n[2] >= 0 && n[0] < int64_t(sizes[0]) && n[1] < int64_t(sizes[1])
+               && n[2] < int64_t(sizes[2]);
+    }
+
+    /**
+     * Returns whether no sample of the given cell is closer than the radius
+     * to the given point.
+     */
+    bool isFree(const Vec4f& point, uint32_t cell, float radiusSquared) const {
+        for(uint32_t s=heads[cell]; s != NONE; s = nexts[s]){
+            float dx = samples[s].x - point.x, dy = samples[s].y - point.y, dz = samples[s].z - point.z;
+            if(dx * dx + dy * dy + dz * dz < radiusSquared)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Returns whether no sample is closer than the radius to the given point
+     * in the given cell.
+     */
+    bool isFree(const Vec4f& point, uint32_t cell) const {
+        float radiusSquared = radius * radius;
+        if(!isFree(point, cell, radiusSquared))
+            return false;
+        if(gridCells.empty()){
+            for(size_t i=neighbourOffsets[cell]; i < neighbourOffsets[cell + 1]; ++i){
+                if(!isFree(point, neighbours[i], radiusSquared))
+                    return false;
+            }
+            return true;
+        }
+
+        // Visit the closest cells first, since they most likely contain a
+        // conflict:
+        uint32_t c[3];
+        decodeMorton63(codes[cell], c[0], c[1], c[2]);
+        const float* p = &point.x;
+        int64_t offsets[3][3];
+        for(int d=0; d < 3; ++d){
+            int64_t nearer = p[d] - origin[d] < (float(c[d]) + 0.5f) * radius ? -1 : 1;
+            offsets[d][0] = int64_t(c[d]);
+            offsets[d][1] = int64_t(c[d]) + nearer;
+            offsets[d][2] = int64_t(c[d]) - nearer;
+        }
+        for(int k=1; k < 27; ++k){
+            const uint8_t* order = NEIGHBOUR_ORDER[k];
+            int64_t n[3] = {offsets[0][order[0]], offsets[1][order[1]], offsets[2][order[2]]};
+            if(!isInside(n))
+                continue;
+            uint32_t neighbour = gridCells[getGridIndex(uint32_t(n[0]), uint32_t(n[1]), uint32_t(n[2]))];
+            if(neighbour != NONE && !isFree(point, neighbour, radiusSquared))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Throws the given number of darts into every cell. The function
+     * throwDart(cell, key, dart, tag) sets the dart of the given cell (and
+     * its tag) from the random numbers getRandom(key, k) and returns whether
+     * there is one.
+     */
+    template<typename ThrowDart>
+    void throwDarts(uint32_t attempts, uint32_t seed, const ThrowDart& throwDart){
+        for(uint32_t round=0; round < attempts; ++round){
+            uint64_t roundKey = mixBits((uint64_t(seed) << 32) | round);
+
+            // Visit the phase groups in a random order, since a fixed order
+            // would prefer the samples of the first groups:
+            int phases[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+            for(int i=7; i > 0; --i)
+                std::swap(phases[i], phases[mixBits(roundKey + uint64_t(i)) % uint64_t(i + 1)]);
+
+            for(int p=0; p < 8; ++p){
+                size_t begin = phaseOffsets[phases[p]], end = phaseOffsets[phases[p] + 1];
+                if(begin == end)
+                    continue;
+
+                std::vector<std::vector<AcceptedSample> > accepted(getChunkCount(end - begin, POISSON_GRAIN_SIZE));
+                parallelFor(begin, end, POISSON_GRAIN_SIZE, [&](size_t chunkBegin, size_t chunkEnd){
+                    std::vector<AcceptedSample>& local = accepted[(chunkBegin - begin) / POISSON_GRAIN_SIZE];
+                    for(size_t cell=chunkBegin; cell < chunkEnd; ++cell){
+                        AcceptedSample sample;
+                        sample.cell = uint32_t(cell);
+                        sample.tag = 0;
+                        if(throwDart(uint32_t(cell), mixBits(codes[cell] ^ roundKey), sample.position, sample.tag)
+                           && isFree(sample.position, uint32_t(cell)))
+                            local.push_back(sample);
+                    }
+                });
+
+                // The cells of a group cannot conflict, so all their samples
+                // are added (in the order of the cells):
+                for(const std::vector<AcceptedSample>& local : accepted){
+                    for(const AcceptedSample& sample : local){
+                        nexts.push_back(heads[sample.cell]);
+                        heads[sample.cell] = uint32_t(samples.size());
+                        samples.push_back(sample.position);
+                        tags.push_back(sample.tag);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Returns the minimum corner of the given cell.
+     */
+    void getCellMin(uint32_t cell, float min[3]) const {
+        uint32_t c[3];
+        decodeMorton63(codes[cell], c[0], c[1], c[2]);
+        for(int d=0; d < 3; ++d)
+            min[d] = origin[d] + float(c[d]) * radius;
+    }
+
+private:
+    /** The first sample of every cell */
+    std::vector<uint32_t> heads;
+
+    /** The cell of every grid position (if the grid is dense) */
+    std::vector<uint32_t> gridCells;
+
+    /** The neighbours of the cell i are neighbours[neighbourOffsets[i]...] (if the grid is sparse) */
+    std::vector<size_t> neighbourOffsets;
+    std::vector<uint32_t> neighbours;
+};
+
+/* Checks the parameters which all samplers share: */
+void checkParameters(float radius, const PoissonDiskSettings& settings){
+    if(!(radius > 0.f) || !std::isfinite(radius))
+        throw std::invalid_argument("samplePoissonDisk: the radius must be positive.");
+    if(settings.attempts == 0)
+        throw std::invalid_argument("samplePoissonDisk: at least one attempt is required.");
+}
+
+/* Sorts the given Morton codes (which are unique): */
+void sortCodes(std::vector<uint64_t>& codes){
+    std::vector<uint32_t> values(codes.size(), 0);
+    radixSort(codes, values, 63);
+}
+
+/* Returns the Morton codes of all cells of the dense grid for which
+   isUsed(x, y, z) returns true: */
+template<typename IsUsed>
+std::vector<uint64_t> collectCells(const SampleGrid& grid, const IsUsed& isUsed){
+    size_t cellCount = size_t(grid.sizes[0] * grid.sizes[1] * grid.sizes[2]);
+    std::vector<std::vector<uint64_t> > chunkCodes(getChunkCount(cellCount, POISSON_GRAIN_SIZE));
+    parallelFor(0, cellCount, POISSON_GRAIN_SIZE, [&](size_t begin, size_t end){
+        std::vector<uint64_t>& local = chunkCodes[begin / POISSON_GRAIN_SIZE];
+        for(size_t i=begin; i < end; ++i){
+            uint32_t x = uint32_t(i % grid.sizes[0]);
+            uint32_t y = uint32_t(i / grid.sizes[0] % grid.sizes[1]);
+            uint32_t z = uint32_t(i / grid.sizes[0] / grid.sizes[1]);
+            if(isUsed(x, y, z))
+                local.push_back(encodeMorton63(x, y, z));
+        }
+    });
+
+    std::vector<uint64_t> codes;
+    for(const std::vector<uint64_t>& local : chunkCodes)
+        codes.insert(codes.end(), local.begin(), local.end());
+    sortCodes(codes);
+    return codes;
+}
+
+/* A convex polygon (the part of a triangle inside of a box): */
+struct Polygon {
+    float vertices[MAX_POLYGON_SIZE][3];
+    int size;
+};
+
+/* Clips the polygon to the half space sign * (p[axis] - value) >= 0: */
+void clipPolygon(Polygon& polygon, int axis, float value, float sign){
+    Polygon result;
+    result.size = 0;
+    for(int i=0; i < polygon.size; ++i){
+        const float* a = polygon.vertices[i];
+        const float* b = polygon.vertices[(i + 1) % polygon.size];
+        float da = sign * (a[axis] - value), db = sign * (b[axis] - value);
+        if(da >= 0.f && result.size < MAX_POLYGON_SIZE){
+            std::copy(a, a + 3, result.vertices[result.size++]);
+        }
+        if(((da < 0.f && db > 0.f) || (da > 0.f && db < 0.f)) && result.size < MAX_POLYGON_SIZE){
+            float t = da / (da - db);
+            float* p = result.vertices[result.size++];
+            for(int d=0; d < 3; ++d)
+                p[d] = a[d] + t * (b[d] - a[d]);
+            p[axis] = value;
+        }
+    }
+    polygon = result;
+}
+
+/* Clips the polygon to the slab [min, min + size] along the given axis: */
+void clipPolygonToSlab(Polygon& polygon, int axis, float min, float size){
+    clipPolygon(polygon, axis, min, 1.f);
+    clipPolygon(polygon, axis, min + size, -1.f);
+}
+
+/* Returns twice the area of the triangle (a, b, c): */
+float getDoubleArea(const float* a, const float* b, const float* c){
+    float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float x = u[1] * v[2] - u[2] * v[1], y = u[2] * v[0] - u[0] * v[2], z = u[0] * v[1] - u[1] * v[0];
+    return std::sqrt(x * x + y * y + z * z);
+}
+
+/* Returns the area of the polygon: */
+float getArea(const Polygon& polygon){
+    float area = 0.f;
+    for(int i=2; i < polygon.size; ++i)
+        area += getDoubleArea(polygon.vertices[0], polygon.vertices[i - 1], polygon.vertices[i]);
+    return 0.5f * area;
+}
+
+/* Initializes the polygon with the given triangle: */
+void setTriangle(Polygon& polygon, const Vec4f* positions, const uint32_t* indices, uint32_t triangle){
+    for(int k=0; k < 3; ++k){
+        const Vec4f& p = positions[indices[3 * triangle + k]];
+        polygon.vertices[k][0] = p.x;
+        polygon.vertices[k][1] = p.y;
+        polygon.vertices[k][2] = p.z;
+    }
+    polygon.size = 3;
+}
+
+/* Returns the range of cells [first, last] of the polygon along the given
+   axis (false if it lies outside of the grid): */
+bool getCellRange(const Polygon& polygon, const SampleGrid& grid, int axis, uint32_t& first, uint32_t& last){
+    float min = polygon.vertices[0][axis], max = min;
+    for(int i=1; i < polygon.size; ++i){
+        min = std::min(min, polygon.vertices[i][axis]);
+        max = std::max(max, polygon.vertices[i][axis]);
+    }
+    double low = std::floor((double(min) - grid.origin[axis]) / grid.radius);
+    double high = std::floor((double(max) - grid.origin[axis]) / grid.radius);
+    if(high < 0.0 || low >= double(grid.sizes[axis]))
+        return false;
+    first = uint32_t(std::max(low, 0.0));
+    last = uint32_t(std::min(high, double(grid.sizes[axis] - 1)));
+    return true;
+}
+
+/**
+ * A part of a triangle inside of a cell.
+ */
+struct CellPart {
+    uint64_t code;
+    uint32_t triangle;
+    float area;
+};
+
+/**
+ * Clips all triangles against the cells of the grid which they touch and
+ * returns the parts with a positive area. Every triangle is cut into rows of
+ * cells along the axis u, the rows into cells along v, and the cells into
+ * cells along w, where w is the axis which is closest to its normal; so the
+ * work grows with the area of the triangle and not with its bounding box.
+ * The rows of all triangles are processed in parallel, so even a single large
+ * triangle is split between the threads.
+ */
+std::vector<CellPart> createCellParts(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                                      const SampleGrid& grid){
+    // Find the axes and rows of all triangles:
+    std::vector<uint8_t> normalAxes(triangleCount);
+    std::vector<uint32_t> firstRows(triangleCount);
+    std::vector<size_t> rowOffsets(triangleCount + 1, 0);
+    parallelFor(0, triangleCount, POISSON_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t t=begin; t < end; ++t){
+            Polygon polygon;
+            setTriangle(polygon, positions, indices, uint32_t(t));
+            const float* a = polygon.vertices[0];
+            const float* b = polygon.vertices[1];
+            const float* c = polygon.vertices[2];
+            float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float normal[3] = {std::fabs(u[1] * v[2] - u[2] * v[1]), std::fabs(u[2] * v[0] - u[0] * v[2]),
+                               std::fabs(u[0] * v[1] - u[1] * v[0])};
+            int w = normal[0] >= normal[1] ? (normal[0] >= normal[2] ? 0 : 2) : (normal[1] >= normal[2] ? 1 : 2);
+            normalAxes[t] = uint8_t(w);
+
+            uint32_t first = 0, last = 0;
+            bool valid = normal[w] > 0.f && getCellRange(polygon, grid, (w + 1) % 3, first, last);
+            firstRows[t] = first;
+            rowOffsets[t + 1] = valid ? last - first + 1 : 0;
+        }
+    });
+    for(size_t t=0; t < triangleCount; ++t)
+        rowOffsets[t + 1] += rowOffsets[t];
+
+    size_t rowCount = rowOffsets[triangleCount];
+    std::vector<std::vector<CellPart> > chunkParts(getChunkCount(rowCount, ROW_GRAIN_SIZE));
+    parallelFor(0, rowCount, ROW_GRAIN_SIZE, [&](size_t begin, size_t end){
+        std::vector<CellPart>& local = chunkParts[begin / ROW_GRAIN_SIZE];
+        size_t t = size_t(std::upper_bound(rowOffsets.begin(), rowOffsets.end(), begin) - rowOffsets.begin()) - 1;
+        for(size_t row=begin; row < end; ++row){
+            while(rowOffsets[t + 1] <= row)
+                ++t;
+            int w = normalAxes[t], u = (w + 1) % 3, v = (w + 2) % 3;
+            uint32_t cell[3];
+            cell[u] = firstRows[t] + uint32_t(row - rowOffsets[t]);
+
+            Polygon rowPolygon;
+            setTriangle(rowPolygon, positions, indices, uint32_t(t));
+            clipPolygonToSlab(rowPolygon, u, grid.origin[u] + float(cell[u]) * grid.radius, grid.radius);
+            uint32_t firstV, lastV;
+            if(rowPolygon.size < 3 || !getCellRange(rowPolygon, grid, v, firstV, lastV))
+                continue;
+
+            for(cell[v]=firstV; cell[v] <= lastV; ++cell[v]){
+                Polygon columnPolygon = rowPolygon;
+                clipPolygonToSlab(columnPolygon, v, grid.origin[v] + float(cell[v]) * grid.radius, grid.radius);
+                uint32_t firstW, lastW;
+                if(columnPolygon.size < 3 || !getCellRange(columnPolygon, grid, w, firstW, lastW))
+                    continue;
+
+                for(cell[w]=firstW; cell[w] <= lastW; ++cell[w]){
+                    Polygon cellPolygon = columnPolygon;
+                    clipPolygonToSlab(cellPolygon, w, grid.origin[w] + float(cell[w]) * grid.radius, grid.radius);
+                    float area = cellPolygon.size < 3 ? 0.f : getArea(cellPolygon);
+                    if(area > 0.f){
+                        CellPart part;
+                        part.code = encodeMorton63(cell[0], cell[1], cell[2]);
+                        part.triangle = uint32_t(t);
+                        part.area = area;
+                        local.push_back(part);
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<CellPart> parts;
+    for(const std::vector<CellPart>& local : chunkParts)
+        parts.insert(parts.end(), local.begin(), local.end());
+    return parts;
+}
+
+}
+
+PoissonDiskSettings::PoissonDiskSettings()
+    : attempts(30), seed(1)
+{
+}
+
+std::vector<Vec4f> samplePoissonDiskBox(const AABB& box, float radius, const PoissonDiskSettings& settings){
+    checkParameters(radius, settings);
+    if(box.isEmpty())
+        throw std::invalid_argument("samplePoissonDiskBox: the box is empty.");
+
+    SampleGrid grid(box, radius, false);
+    grid.setCells(collectCells(grid, [](uint32_t, uint32_t, uint32_t){ return true; }), true);
+
+    // The darts are uniformly distributed in the part of the cell inside of
+    // the box:
+    const float* max = &box.max.x;
+    grid.throwDarts(settings.attempts, settings.seed, [&](uint32_t cell, uint64_t key, Vec4f& dart, uint32_t&){
+        float min[3], p[3];
+        grid.getCellMin(cell, min);
+        for(int d=0; d < 3; ++d)
+            p[d] = min[d] + getRandom(key, uint32_t(d)) * std::max(0.f, std::min(radius, max[d] - min[d]));
+        dart = Vec4f(p[0], p[1], p[2]);
+        return true;
+    });
+    return grid.samples;
+}
+
+std::vector<Vec4f> samplePoissonDiskSurface(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                                           float radius, const PoissonDiskSettings& settings,
+                                           std::vector<uint32_t>* triangles){
+    checkParameters(radius, settings);
+    if(triangleCount == 0)
+        throw std::invalid_argument("samplePoissonDiskSurface: there are no triangles.");
+    if(triangleCount >= NONE)
+        throw std::invalid_argument("samplePoissonDiskSurface: too many triangles.");
+
+    AABB bounds;
+    for(size_t i=0; i < 3 * triangleCount; ++i)
+        bounds.extend(positions[indices[i]]);
+
+    // The cells are centered on the bounds, which keeps axis aligned faces
+    // of the mesh (like the sides of a box) away from the cell borders:
+    SampleGrid grid(bounds, radius, true);
+    std::vector<CellPart> parts = createCellParts(positions, indices, triangleCount, grid);
+    if(parts.size() >= NONE)
+        throw std::invalid_argument("samplePoissonDiskSurface: the radius is too small.");
+
+    // Sort the parts by their cells:
+    std::vector<uint64_t> partCodes(parts.size());
+    std::vector<uint32_t> partOrder(parts.size());
+    for(size_t i=0; i < parts.size(); ++i){
+        partCodes[i] = parts[i].code;
+        partOrder[i] = uint32_t(i);
+    }
+    radixSort(partCodes, partOrder, 63);
+
+    std::vector<uint64_t> codes;
+    std::vector<size_t> sortedOffsets;
+    for(size_t i=0; i < partCodes.size(); ++i){
+        if(i == 0 || partCodes[i] != partCodes[i - 1]){
+            codes.push_back(partCodes[i]);
+            sortedOffsets.push_back(i);
+        }
+    }
+    sortedOffsets.push_back(partCodes.size());
+    std::vector<uint32_t> cellOrder = grid.setCells(codes, false);
+
+    // Store the triangles of every cell with their accumulated areas:
+    std::vector<size_t> partOffsets(codes.size() + 1, 0);
+    for(size_t cell=0; cell < codes.size(); ++cell)
+        partOffsets[cell + 1] = partOffsets[cell] + sortedOffsets[cellOrder[cell] + 1] - sortedOffsets[cellOrder[cell]];
+    std::vector<uint32_t> partTriangles(parts.size());
+    std::vector<float> partAreas(parts.size());
+    parallelFor(0, codes.size(), POISSON_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t cell=begin; cell < end; ++cell){
+            float area = 0.f;
+            size_t source = sortedOffsets[cellOrder[cell]];
+            for(size_t i=partOffsets[cell]; i < partOffsets[cell + 1]; ++i, ++source){
+                const CellPart& part = parts[partOrder[source]];
+                area += part.area;
+                partTriangles[i] = part.triangle;
+                partAreas[i] = area;
+            }
+        }
+    });
+
+    grid.throwDarts(settings.attempts, settings.seed, [&](uint32_t cell, uint64_t key, Vec4f& dart, uint32_t& tag){
+        // Pick a triangle by its area in the cell:
+        const float* areas = partAreas.data() + partOffsets[cell];
+        size_t count = partOffsets[cell + 1] - partOffsets[cell];
+        float target = getRandom(key, 0) * areas[count - 1];
+        size_t index = std::min(size_t(std::upper_bound(areas, areas + count, target) - areas), count - 1);
+        tag = partTriangles[partOffsets[cell] + index];
+
+        // Clip it against the cell:
+        Polygon polygon;
+        setTriangle(polygon, positions, indices, tag);
+        float min[3];
+        grid.getCellMin(cell, min);
+        for(int d=0; d < 3; ++d)
+            clipPolygonToSlab(polygon, d, min[d], radius);
+        if(polygon.size < 3)
+            return false;
+
+        // Pick a triangle of the fan of the polygon by its area, and a
+        // uniformly distributed point on it:
+        float fanAreas[MAX_POLYGON_SIZE];
+        float total = 0.f;
+        for(int i=2; i < polygon.size; ++i){
+            total += getDoubleArea(polygon.vertices[0], polygon.vertices[i - 1], polygon.vertices[i]);
+            fanAreas[i] = total;
+        }
+        float fanTarget = getRandom(key, 1) * total;
+        int fan = 2;
+        while(fan + 1 < polygon.size && fanAreas[fan] <= fanTarget)
+            ++fan;
+
+        float s = std::sqrt(getRandom(key, 2)), t = getRandom(key, 3);
+        float weights[3] = {1.f - s, s * (1.f - t), s * t};
+        const float* corners[3] = {polygon.vertices[0], polygon.vertices[fan - 1], polygon.vertices[fan]};
+        float p[3];
+        for(int d=0; d < 3; ++d)
+            p[d] = weights[0] * corners[0][d] + weights[1] * corners[1][d] + weights[2] * corners[2][d];
+        dart = Vec4f(p[0], p[1], p[2]);
+        return true;
+    });
+
+    if(triangles)
+        *triangles = grid.tags;
+    return grid.samples;
+}
+
+std::vector<Vec4f> samplePoissonDiskSurface(const TriangleMesh& mesh, float radius, const PoissonDiskSettings& settings,
+                                           std::vector<uint32_t>* triangles){
+    return samplePoissonDiskSurface(mesh.positions.data(), mesh.indices.data(), mesh.indices.size() / 3, radius,
+                                    settings, triangles);
+}
+
+std::vector<Vec4f> samplePoissonDiskVolume(const SignedDistanceField& field, float radius,
+                                          const PoissonDiskSettings& settings){
+    checkParameters(radius, settings);
+    if(field.sizeX == 0 || field.sizeY == 0 || field.sizeZ == 0)
+        throw std::invalid_argument("samplePoissonDiskVolume: the field is empty.");
+
+    const Vec4f& o = field.origin;
+    float extent = field.voxelSize;
+    AABB bounds(o, Vec4f(o.x + float(field.sizeX - 1) * extent, o.y + float(field.sizeY - 1) * extent,
+                         o.z + float(field.sizeZ - 1) * extent));
+    SampleGrid grid(bounds, radius, false);
+
+    // A cell whose center is farther outside than half of its diagonal does
+    // not touch the volume:
+    float halfDiagonal = 0.5f * std::sqrt(3.f) * radius;
+    grid.setCells(collectCells(grid, [&](uint32_t x, uint32_t y, uint32_t z){
+        Vec4f center(grid.origin[0] + (float(x) + 0.5f) * radius, grid.origin[1] + (float(y) + 0.5f) * radius,
+                     grid.origin[2] + (float(z) + 0.5f) * radius);
+        return field.sample(center) < halfDiagonal;
+    }), true);
+
+    const float* max = &bounds.max.x;
+    grid.throwDarts(settings.attempts, settings.seed, [&](uint32_t cell, uint64_t key, Vec4f& dart, uint32_t&){
+        float min[3], p[3];
+        grid.getCellMin(cell, min);
+        for(int d=0; d < 3; ++d)
+            p[d] = min[d] + getRandom(key, uint32_t(d)) * std::max(0.f, std::min(radius, max[d] - min[d]));
+        dart = Vec4f(p[0], p[1], p[2]);
+        return field.sample(dart) <= 0.f;
+    });
+    return grid.samples;
+}
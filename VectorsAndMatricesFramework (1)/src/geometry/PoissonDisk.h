@@ -0,0 +1,110 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors, boxes, meshes and distance fields: */
+#include "../math/Vec4f.h"
+#include "../math/AABB.h"
+#include "TriangleMesh.h"
+#include "SignedDistanceField.h"
+
+/**
+ * The parameters of the Poisson-disk samplers.
+ */
+
+class PoissonDiskSettings
+{
+public:
+    /**
+     * The number of darts which are thrown into every grid cell (default
+     * 30). More darts fill more of the gaps between the samples, so the
+     * samples get denser and closer to a maximal sampling.
+     */
+    uint32_t attempts;
+
+    /**
+     * The seed of the random darts (default 1). The same seed always gives
+     * the same samples.
+     */
+    uint32_t seed;
+
+    /**
+     * Constructs the default settings.
+     */
+    PoissonDiskSettings();
+};
+
+/**
+ * Returns Poisson-disk samples inside of the given box (w = 1): random points
+ * which are at least 'radius' apart from each other, but otherwise uniformly
+ * distributed (blue noise). A box without extent along z gives samples in a
+ * rectangle.
+ *
+ * All samplers use the parallel dart throwing of Wei ("Parallel Poisson disk
+ * sampling", 2008) on a background grid whose cells have the edge length
+ * 'radius', so a sample only needs to be compared with the samples of its own
+ * and the 26 neighbouring cells. The cells are split into 8 phase groups by
+ * the parities of their coordinates: two cells of the same group are at least
+ * one cell apart, so the darts of all cells of a group can be thrown in
+ * parallel without any conflicts. Every round throws one dart into every
+ * cell, group by group in a random order, and a dart becomes a sample if no
+ * earlier sample is closer than 'radius'.
+ *
+ * The darts are drawn from a hash of the seed, the cell and the round, and
+ * the samples of a group are appended in the order of their cells, so the
+ * result does not depend on the number of threads. Throws
+ * std::invalid_argument if the radius is not positive, if the box is empty,
+ * if settings.attempts is 0, or if the grid would have 2^21 or more cells
+ * along an axis (or 2^32 or more cells in total).
+ */
+std::vector<Vec4f> samplePoissonDiskBox(const AABB& box, float radius,
+                                       const PoissonDiskSettings& settings = PoissonDiskSettings());
+
+/**
+ * Returns Poisson-disk samples on the surface of the given triangles (the
+ * samples are at least 'radius' apart in space, see samplePoissonDiskBox(...)).
+ * If 'triangles' is not nullptr, it receives the triangle of every sample
+ * (for example to orient instances along its normal).
+ *
+ * The background grid only contains the cells which are touched by the
+ * surface. Every triangle is clipped against the cells it touches, and a dart
+ * of a cell first picks one of its clipped triangles with a probability
+ * proportional to its area and then a uniformly distributed point on it, so
+ * the darts are distributed uniformly over the area of the surface, no matter
+ * how large or small its triangles are.
+ *
+ * Throws std::invalid_argument if there are no triangles, or in the cases of
+ * samplePoissonDiskBox(...).
+ */
+std::vector<Vec4f> samplePoissonDiskSurface(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                                           float radius, const PoissonDiskSettings& settings = PoissonDiskSettings(),
+                                           std::vector<uint32_t>* triangles = nullptr);
+
+/**
+ * Returns Poisson-disk samples on the surface of the given mesh (see above).
+ */
+std::vector<Vec4f> samplePoissonDiskSurface(const TriangleMesh& mesh, float radius,
+                                           const PoissonDiskSettings& settings = PoissonDiskSettings(),
+                                           std::vector<uint32_t>* triangles = nullptr);
+
+/**
+ * Returns Poisson-disk samples inside of the volume of the given signed
+ * distance field (where field.sample(...) <= 0, see samplePoissonDiskBox(...)).
+ * The background grid spans the field, but only contains the cells whose
+ * centers are closer to the inside than half of their diagonal, and darts
+ * outside of the volume are rejected.
+ *
+ * Throws std::invalid_argument if the field is empty, or in the cases of
+ * samplePoissonDiskBox(...).
+ */
+std::vector<Vec4f> samplePoissonDiskVolume(const SignedDistanceField& field, float radius,
+                                          const PoissonDiskSettings& settings = PoissonDiskSettings());
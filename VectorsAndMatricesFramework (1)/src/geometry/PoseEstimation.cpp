@@ -0,0 +1,408 @@
+#include "PoseEstimation.h"
+#include "../math/FloatLanes.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of correspondences which are accumulated by one task: */
+const size_t POSE_GRAIN_SIZE = 4096;
+
+/* Levenberg-Marquardt multiplies or divides lambda by this factor: */
+const double DAMPING_FACTOR = 10.0;
+
+/* A rigid transformation in double precision (rotation[row * 3 + col]): */
+struct RigidTransform {
+    double rotation[9];
+    double translation[3];
+};
+
+/* The normal equations H * delta = -g (H is stored completely) and the robust
+   cost of a set of correspondences: */
+struct NormalEquations {
+    double h[36];
+    double g[6];
+    double cost;
+};
+
+NormalEquations operator+(const NormalEquations& a, const NormalEquations& b){
+    NormalEquations sum;
+    for(int i=0; i < 36; ++i)
+        sum.h[i] = a.h[i] + b.h[i];
+    for(int i=0; i < 6; ++i)
+        sum.g[i] = a.g[i] + b.g[i];
+    sum.cost = a.cost + b.cost;
+    return sum;
+}
+
+/* Returns the sum of all lanes in double precision: */
+double sumLanes(const FloatLanes& a){
+    double sum = 0.0;
+    for(int l=0; l < FLOAT_LANES; ++l)
+        sum += a.v[l];
+    return sum;
+}
+
+/**
+ * Computes the weight of iteratively reweighted least squares (rho'(r) / r)
+ * and the cost rho(r) from the squared residuals.
+ */
+void evaluateLoss(RobustLoss loss, float k, const FloatLanes& squared, FloatLanes& weight, FloatLanes& cost){
+    FloatLanes one = broadcast(1.f);
+    switch(loss){
+    case RobustLoss::Squared:
+        weight = one;
+        cost = squared * 0.5f;
+        break;
+
+    case RobustLoss::Huber: {
+        FloatLanes r = sqrt(squared);
+        weight = broadcast(k) / maximum(r, broadcast(k));
+        cost = select(r > broadcast(k), k * (r + (-0.5f * k)), squared * 0.5f);
+        break;
+    }
+
+    case RobustLoss::Cauchy: {
+        FloatLanes u = squared * (1.f / (k * k));
+        weight = one / (one + u);
+        for(int l=0; l < FLOAT_LANES; ++l)
+            cost.v[l] = 0.5f * k * k * std::log1p(u.v[l]);
+        break;
+    }
+
+    case RobustLoss::Tukey: {
+        FloatLanes u = squared * (1.f / (k * k));
+        LaneMask outside = u > one;
+        FloatLanes v = one - minimum(u, one);
+        weight = select(outside, broadcast(0.f), v * v);
+        cost = (k * k / 6.f) * (one - v * v * v);
+        break;
+    }
+    }
+}
+
+/**
+ * Accumulates the normal equations of the correspondences [begin, end) at the
+ * pose with the given rotation R, linearized around the transformed source
+ * centroid c = R * sourceCentroid + t.
+ *
+ * For point-to-plane, every correspondence has one residual r = dot(n, e)
+ * with e = T * p - q and the Jacobian J = (d x n, n), where d = T * p - c.
+ * For point-to-point, the three residuals e have the Jacobian J = (-[d]x, I),
+ * so J^T * J only depends on d, and only its 10 distinct products are
+ * accumulated.
+ *
+ * All float computations use coordinates relative to the centroids:
+ * d = R * (p - sourceCentroid) and e = d - (q - targetCentroid) + offset with
+ * offset = c - targetCentroid (computed in double). So the precision does not
+ * depend on the distance of the points from the origin.
+ */
+NormalEquations accumulate(const Vec4f* sources, const Vec4f* targets, const Vec4f* normals,
+                           size_t begin, size_t end, const float rotation[9], const float sourceCentroid[3],
+                           const float targetCentroid[3], const float offset[3], RobustLoss loss, float k){
+    // Point-to-plane: the 21 cells of the upper triangle of H and g. Point-
+    // to-point: the sums of w, w*d, w*dd^T (6), w*(d x e) and w*e:
+    FloatLanes sums[27];
+    for(int i=0; i < 27; ++i)
+        sums[i] = broadcast(0.f);
+    FloatLanes cost = broadcast(0.f);
+
+    for(size_t i=begin; i < end; i += FLOAT_LANES){
+        int lanes = end - i < FLOAT_LANES ? int(end - i) : FLOAT_LANES;
+
+        FloatLanes p[3], q[3], n[3], valid;
+        for(int l=0; l < FLOAT_LANES; ++l){
+            size_t index = l < lanes ? i + l : i;
+            p[0].v[l] = sources[index].x - sourceCentroid[0];
+            p[1].v[l] = sources[index].y - sourceCentroid[1];
+            p[2].v[l] = sources[index].z - sourceCentroid[2];
+            q[0].v[l] = targets[index].x - targetCentroid[0];
+            q[1].v[l] = targets[index].y - targetCentroid[1];
+            q[2].v[l] = targets[index].z - targetCentroid[2];
+            if(normals){
+                n[0].v[l] = normals[index].x;
+                n[1].v[l] = normals[index].y;
+                n[2].v[l] = normals[index].z;
+            }
+            valid.v[l] = l < lanes ? 1.f : 0.f;
+        }
+
+        // d = T * p - c and e = T * p - q:
+        FloatLanes d[3], e[3];
+        for(int r=0; r < 3; ++r){
+            d[r] = rotation[r * 3] * p[0] + rotation[r * 3 + 1] * p[1] + rotation[r * 3 + 2] * p[2];
+            e[r] = d[r] - q[r] + offset[r];
+        }
+
+        FloatLanes weight, laneCost;
+        if(normals){
+            FloatLanes residual = n[0] * e[0] + n[1] * e[1] + n[2] * e[2];
+            evaluateLoss(loss, k, residual * residual, weight, laneCost);
+            weight = weight * valid;
+
+            FloatLanes j[6] = {d[1] * n[2] - d[2] * n[1], d[2] * n[0] - d[0] * n[2], d[0] * n[1] - d[1] * n[0],
+                               n[0], n[1], n[2]};
+            int index = 0;
+            for(int a=0; a < 6; ++a){
+                FloatLanes wj = weight * j[a];
+                for(int b=a; b < 6; ++b, ++index)
+                    sums[index] = sums[index] + wj * j[b];
+                sums[21 + a] = sums[21 + a] + wj * residual;
+            }
+        } else {
+            evaluateLoss(loss, k, e[0] * e[0] + e[1] * e[1] + e[2] * e[2], weight, laneCost);
+            weight = weight * valid;
+
+            FloatLanes wd[3] = {weight * d[0], weight * d[1], weight * d[2]};
+            FloatLanes terms[16] = {weight, wd[0], wd[1], wd[2],
+                                    wd[0] * d[0], wd[0] * d[1], wd[0] * d[2], wd[1] * d[1], wd[1] * d[2], wd[2] * d[2],
+                                    wd[1] * e[2] - wd[2] * e[1], wd[2] * e[0] - wd[0] * e[2], wd[0] * e[1] - wd[1] * e[0],
+                                    weight * e[0], weight * e[1], weight * e[2]};
+            for(int t=0; t < 16; ++t)
+                sums[t] = sums[t] + terms[t];
+        }
+        cost = cost + laneCost * valid;
+    }
+
+    NormalEquations result;
+    result.cost = sumLanes(cost);
+
+    double* h = result.h;
+    if(normals){
+        int index = 0;
+        for(int a=0; a < 6; ++a){
+            for(int b=a; b < 6; ++b, ++index)
+                h[a * 6 + b] = h[b * 6 + a] = sumLanes(sums[index]);
+            result.g[a] = sumLanes(sums[21 + a]);
+        }
+    } else {
+        double s[16];
+        for(int t=0; t < 16; ++t)
+            s[t] = sumLanes(sums[t]);
+
+        // sum w * [d]x^T [d]x = sum w * (|d|^2 I - d d^T):
+        double xx = s[4], xy = s[5], xz = s[6], yy = s[7], yz = s[8], zz = s[9];
+        double block[9] = {yy + zz, -xy, -xz,
+                           -xy, xx + zz, -yz,
+                           -xz, -yz, xx + yy};
+
+        // sum w * [d]x (the rotation-translation block) and sum w * I:
+        double mixed[9] = {0.0, -s[3], s[2],
+                           s[3], 0.0, -s[1],
+                           -s[2], s[1], 0.0};
+        for(int a=0; a < 3; ++a){
+            for(int b=0; b < 3; ++b){
+                h[a * 6 + b] = block[a * 3 + b];
+                h[a * 6 + b + 3] = mixed[a * 3 + b];
+                h[(b + 3) * 6 + a] = mixed[a * 3 + b];
+                h[(a + 3) * 6 + b + 3] = a == b ? s[0] : 0.0;
+            }
+            result.g[a] = s[10 + a];
+            result.g[a + 3] = s[13 + a];
+        }
+    }
+    return result;
+}
+
+/**
+ * Solves (H + lambda * diag(H)) * delta = -g with a Cholesky factorization
+ * in double precision. A tiny multiple of the largest diagonal element is
+ * added, so that Gauss-Newton still returns the minimal step in directions
+ * which are not determined by the correspondences. Returns false if the
+ * system is not positive definite.
+ */
+bool solveNormalEquations(const NormalEquations& equations, double lambda, double delta[6]){
+    double maxDiagonal = 0.0;
+    for(int i=0; i < 6; ++i)
+        maxDiagonal = std::max(maxDiagonal, equations.h[i * 7]);
+    if(!(maxDiagonal > 0.0))
+        return false;
+
+    double l[36];
+    for(int i=0; i < 36; ++i)
+        l[i] = equations.h[i];
+    for(int i=0; i < 6; ++i)
+        l[i * 7] += lambda * equations.h[i * 7] + 1e-12 * maxDiagonal;
+
+    for(int j=0; j < 6; ++j){
+        double diagonal = l[j * 7];
+        for(int p=0; p < j; ++p)
+            diagonal -= l[j * 6 + p] * l[j * 6 + p];
+        if(!(diagonal > 0.0))
+            return false;
+        l[j * 7] = std::sqrt(diagonal);
+
+        for(int i=j + 1; i < 6; ++i){
+            double value = l[i * 6 + j];
+            for(int p=0; p < j; ++p)
+                value -= l[i * 6 + p] * l[j * 6 + p];
+            l[i * 6 + j] = value / l[j * 7];
+        }
+    }
+
+    double y[6];
+    for(int i=0; i < 6; ++i){
+        double value = -equations.g[i];
+        for(int p=0; p < i; ++p)
+            value -= l[i * 6 + p] * y[p];
+        y[i] = value / l[i * 7];
+    }
+    for(int i=5; i >= 0; --i){
+        double value = y[i];
+        for(int p=i + 1; p < 6; ++p)
+            value -= l[p * 6 + i] * delta[p];
+        delta[i] = value / l[i * 7];
+    }
+    return true;
+}
+
+/**
+ * Applies the step delta = (omega, v) from the left: the transformed points
+ * are rotated by the rotation vector omega around 'center' and then
+ * translated by v.
+ */
+RigidTransform applyStep(const RigidTransform& transform, const double delta[6], const double center[3]){
+    // Rodrigues' formula:
+    double angle = std::sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+    double step[9] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    if(angle > 0.0){
+        double x = delta[0] / angle, y = delta[1] / angle, z = delta[2] / angle;
+        double s = std::sin(angle), c = std::cos(angle), t = 1.0 - c;
+        double rotation[9] = {t * x * x + c,     t * x * y - s * z, t * x * z + s * y,
+                              t * x * y + s * z, t * y * y + c,     t * y * z - s * x,
+                              t * x * z - s * y, t * y * z + s * x, t * z * z + c};
+        std::copy(rotation, rotation + 9, step);
+    }
+
+    RigidTransform result;
+    for(int r=0; r < 3; ++r){
+        for(int c=0; c < 3; ++c){
+            result.rotation[r * 3 + c] = step[r * 3] * transform.rotation[c] + step[r * 3 + 1] * transform.rotation[3 + c]
+                                       + step[r * 3 + 2] * transform.rotation[6 + c];
+        }
+        result.translation[r] = center[r] + delta[3 + r];
+        for(int c=0; c < 3; ++c)
+            result.translation[r] += step[r * 3 + c] * (transform.translation[c] - center[c]);
+    }
+    return result;
+}
+
+}
+
+PoseSettings::PoseSettings()
+    : optimizer(PoseOptimizer::LevenbergMarquardt), loss(RobustLoss::Huber), lossScale(0.05f),
+      maxIterations(20), tolerance(1e-6f), initialDamping(1e-4f)
+{}
+
+PoseResult estimateRigidPose(const Vec4f* sources, const Vec4f* targets, const Vec4f* targetNormals, size_t count,
+                             const PoseSettings& settings, const Mat4f& initialPose){
+    if(count == 0)
+        throw std::invalid_argument("estimateRigidPose: there are no correspondences.");
+    if(!(settings.lossScale > 0.f))
+        throw std::invalid_argument("estimateRigidPose: the loss scale must be positive.");
+
+    RigidTransform pose;
+    for(int r=0; r < 3; ++r){
+        for(int c=0; c < 3; ++c)
+            pose.rotation[r * 3 + c] = initialPose.data[c * 4 + r];
+        pose.translation[r] = initialPose.data[12 + r];
+    }
+
+    Vec4f sourceCentroid = computeCentroid(sources, count);
+    Vec4f targetCentroid = computeCentroid(targets, count);
+    float sourceCenter[3] = {sourceCentroid.x, sourceCentroid.y, sourceCentroid.z};
+    float targetCenter[3] = {targetCentroid.x, targetCentroid.y, targetCentroid.z};
+    double center[3];
+
+    // Accumulates the normal equations at the given pose (and sets the
+    // center of the linearization to the transformed source centroid):
+    auto evaluate = [&](const RigidTransform& transform){
+        float rotation[9], offset[3];
+        for(int r=0; r < 3; ++r){
+            for(int c=0; c < 3; ++c)
+                rotation[r * 3 + c] = float(transform.rotation[r * 3 + c]);
+            center[r] = transform.rotation[r * 3] * sourceCenter[0] + transform.rotation[r * 3 + 1] * sourceCenter[1]
+                      + transform.rotation[r * 3 + 2] * sourceCenter[2] + transform.translation[r];
+            offset[r] = float(center[r] - targetCenter[r]);
+        }
+
+        NormalEquations zero = {};
+        return parallelReduce(size_t(0), count, POSE_GRAIN_SIZE, zero,
+            [&](size_t begin, size_t end){
+                return accumulate(sources, targets, targetNormals, begin, end, rotation, sourceCenter,
+                                  targetCenter, offset, settings.loss, settings.lossScale);
+            },
+            [](const NormalEquations& a, const NormalEquations& b){ return a + b; });
+    };
+
+    bool levenbergMarquardt = settings.optimizer == PoseOptimizer::LevenbergMarquardt;
+    double lambda = levenbergMarquardt ? settings.initialDamping : 0.0;
+    NormalEquations equations = evaluate(pose);
+
+    PoseResult result;
+    result.iterations = 0;
+    result.converged = false;
+
+    while(result.iterations < settings.maxIterations){
+        ++result.iterations;
+
+        double delta[6];
+        if(!solveNormalEquations(equations, lambda, delta)){
+            // Only possible without any usable correspondence (for example
+            // if the robust loss rejected all of them):
+            break;
+        }
+
+        double rotationStep = std::sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+        double translationStep = std::sqrt(delta[3] * delta[3] + delta[4] * delta[4] + delta[5] * delta[5]);
+        bool small = rotationStep < settings.tolerance && translationStep < settings.tolerance;
+
+        RigidTransform candidate = applyStep(pose, delta, center);
+        double centerBackup[3] = {center[0], center[1], center[2]};
+        NormalEquations candidateEquations = evaluate(candidate);
+
+        if(!levenbergMarquardt || candidateEquations.cost < equations.cost){
+            pose = candidate;
+            equations = candidateEquations;
+            lambda /= DAMPING_FACTOR;
+        } else {
+            // Reject the step and restore the linearization center:
+            std::copy(centerBackup, centerBackup + 3, center);
+            lambda = lambda > 0.0 ? lambda * DAMPING_FACTOR : 1e-6;
+        }
+
+        if(small){
+            result.converged = true;
+            break;
+        }
+    }
+
+    float values[16] = {};
+    for(int r=0; r < 3; ++r){
+        for(int c=0; c < 3; ++c)
+            values[c * 4 + r] = float(pose.rotation[r * 3 + c]);
+        values[12 + r] = float(pose.translation[r]);
+    }
+    values[15] = 1.f;
+
+    result.pose = Mat4f(values);
+    result.cost = float(equations.cost / count);
+    return result;
+}
+
+void estimateRigidPoses(const PoseProblem* problems, PoseResult* results, size_t count,
+                        const PoseSettings& settings){
+    // One problem per task (the parallel loops of estimateRigidPose(...) run
+    // serially inside of it):
+    parallelFor(0, count, 1, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            const PoseProblem& problem = problems[i];
+            results[i] = estimateRigidPose(problem.sources, problem.targets, problem.targetNormals,
+                                           problem.count, settings, problem.initialPose);
+        }
+    });
+}
@@ -0,0 +1,197 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our matrices and vectors: */
+#include "../math/Mat4f.h"
+#include "../math/Vec4f.h"
+
+/**
+ * This file contains a nonlinear least squares solver for rigid poses: given
+ * correspondences sources[i] <-> targets[i], it finds the rotation and
+ * translation T which minimizes
+ *
+ *   sum rho(|T * sources[i] - targets[i]|)                 (point-to-point)
+ *   sum rho(dot(normals[i], T * sources[i] - targets[i]))  (point-to-plane)
+ *
+ * where rho is a robust loss function which limits the influence of wrong
+ * correspondences (outliers). This is the core of camera pose estimation and
+ * scan alignment (see also IcpRegistration.h).
+ *
+ * Every iteration linearizes the residuals around the current pose (with a
+ * small rotation and translation applied from the left) and accumulates the
+ * 6 x 6 normal equations J^T * W * J * delta = -J^T * W * r, where W are the
+ * weights of the robust loss (iteratively reweighted least squares). The
+ * accumulation runs in parallel over chunks of correspondences, FLOAT_LANES
+ * correspondences at once (see FloatLanes.h), and the chunks are summed in
+ * double precision in a fixed order, so the result does not depend on the
+ * number of threads. The rotation is linearized around the centroid of the
+ * transformed source points, which keeps the normal equations well
+ * conditioned even for scans far away from the origin.
+ */
+
+/**
+ * The robust loss functions rho(r) of a residual r, with the scale k (the
+ * residual at which a correspondence starts to count as an outlier).
+ */
+enum class RobustLoss {
+    /** rho = r^2 / 2 (ordinary least squares, not robust) */
+    Squared,
+
+    /**
+     * Huber: quadratic for |r| <= k and linear above. Convex, so it never
+     * introduces new local minima, but outliers still have some influence.
+     */
+    Huber,
+
+    /**
+     * Cauchy: rho = k^2 / 2 * log(1 + r^2 / k^2). The influence of outliers
+     * decreases with their distance.
+     */
+    Cauchy,
+
+    /**
+     * Tukey's biweight: residuals above k are ignored completely. Very
+     * robust, but needs a good initial pose.
+     */
+    Tukey
+};
+
+/**
+ * The optimization methods of estimateRigidPose(...).
+ */
+enum class PoseOptimizer {
+    /**
+     * Gauss-Newton: every step solves the normal equations and is accepted.
+     * Fast near the solution.
+     */
+    GaussNewton,
+
+    /**
+     * Levenberg-Marquardt: adds lambda * diag(J^T * W * J) to the normal
+     * equations and only accepts steps which decrease the cost (lambda is
+     * decreased after good steps and increased after bad ones). Robust
+     * against bad initial poses and degenerate configurations.
+     */
+    LevenbergMarquardt
+};
+
+/**
+ * The parameters of estimateRigidPose(...).
+ */
+
+class PoseSettings
+{
+public:
+    /** The optimization method (default LevenbergMarquardt) */
+    PoseOptimizer optimizer;
+
+    /** The robust loss function (default Huber) */
+    RobustLoss loss;
+
+    /**
+     * The scale k of the robust loss in the units of the points (default
+     * 0.05). Residuals which are much larger than k are treated as outliers.
+     */
+    float lossScale;
+
+    /** The maximum number of iterations (default 20) */
+    size_t maxIterations;
+
+    /**
+     * The solver stops when the rotation (in radians) and the translation of
+     * a step are both smaller than 'tolerance' (default 1e-6).
+     */
+    float tolerance;
+
+    /** The initial lambda of Levenberg-Marquardt (default 1e-4) */
+    float initialDamping;
+
+    /**
+     * Constructs the default settings.
+     */
+    PoseSettings();
+};
+
+/**
+ * The outcome of estimateRigidPose(...).
+ */
+
+class PoseResult
+{
+public:
+    /** The estimated rigid transformation (rotation and translation) */
+    Mat4f pose;
+
+    /** The number of iterations which were performed */
+    size_t iterations;
+
+    /** The mean robust cost of all correspondences at the final pose */
+    float cost;
+
+    /** Whether the tolerance was reached */
+    bool converged;
+};
+
+/**
+ * One pose estimation problem of estimateRigidPoses(...). The arrays are not
+ * owned by the problem.
+ */
+
+class PoseProblem
+{
+public:
+    /** The points which are transformed */
+    const Vec4f* sources;
+
+    /** The corresponding target points */
+    const Vec4f* targets;
+
+    /**
+     * The normals of the targets for point-to-plane residuals, or nullptr
+     * for point-to-point residuals
+     */
+    const Vec4f* targetNormals;
+
+    /** The number of correspondences */
+    size_t count;
+
+    /** The pose at which the optimization starts */
+    Mat4f initialPose;
+};
+
+/**
+ * Estimates the rigid transformation which maps the sources onto the targets
+ * (see above), starting at 'initialPose' (which must be a rigid
+ * transformation). If 'targetNormals' is not nullptr, point-to-plane
+ * residuals are used (with normalized normals). Only x, y and z of the
+ * vectors are used.
+ *
+ * Point-to-point needs at least three points which are not on a line,
+ * point-to-plane at least six correspondences on planes of different
+ * orientations; otherwise the pose is only determined partially (Gauss-Newton
+ * may then fail to make progress, Levenberg-Marquardt changes the pose as
+ * little as possible in the undetermined directions).
+ *
+ * Throws std::invalid_argument if count == 0.
+ */
+PoseResult estimateRigidPose(const Vec4f* sources, const Vec4f* targets, const Vec4f* targetNormals, size_t count,
+                             const PoseSettings& settings, const Mat4f& initialPose = Mat4f());
+
+/**
+ * Solves many independent pose estimation problems (for example one per
+ * camera or per scan pair) in parallel, one problem per task. This is much
+ * faster than calling estimateRigidPose(...) for each problem when the
+ * problems are small, since every problem is solved without any
+ * synchronization. The results are the same as those of
+ * estimateRigidPose(...).
+ *
+ * Throws std::invalid_argument if a problem has no correspondences.
+ */
+void estimateRigidPoses(const PoseProblem* problems, PoseResult* results, size_t count,
+                        const PoseSettings& settings);
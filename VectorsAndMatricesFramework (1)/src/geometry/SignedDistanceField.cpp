@@ -0,0 +1,883 @@
+#include "SignedDistanceField.h"
+#include "../math/AABB.h"
+#include "../math/FloatLanes.h"
+#include "../math/Morton.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of triangles which are binned by one task: */
+const size_t SDF_GRAIN_SIZE = 4096;
+
+/* The number of voxels of a brick: */
+const size_t BRICK_VOXELS = SDF_BRICK_SIZE * SDF_BRICK_SIZE * SDF_BRICK_SIZE;
+
+/* The maximum number of triangles in a leaf of the winding number tree: */
+const size_t WINDING_LEAF_SIZE = 4;
+
+/* A node of the winding number tree is approximated by its dipole if the
+   point is farther away from its center than this factor times its radius: */
+const float WINDING_ACCURACY = 1.5f;
+
+const float PI = 3.14159265358979f;
+
+/* Returns the number of leading zero bits of a (non-zero) value: */
+inline int countLeadingZeros(uint64_t value){
+    int count = 0;
+    while(!(value & (uint64_t(1) << 63))){
+        value <<= 1;
+        ++count;
+    }
+    return count;
+}
+
+/* A simple 3D vector for the geometric computations: */
+struct Vector3 {
+    float x, y, z;
+};
+
+inline Vector3 toVector3(const Vec4f& v){
+    Vector3 r = {v.x, v.y, v.z};
+    return r;
+}
+
+inline Vector3 operator-(const Vector3& a, const Vector3& b){
+    Vector3 r = {a.x - b.x, a.y - b.y, a.z - b.z};
+    return r;
+}
+
+inline Vector3 operator+(const Vector3& a, const Vector3& b){
+    Vector3 r = {a.x + b.x, a.y + b.y, a.z + b.z};
+    return r;
+}
+
+inline Vector3 operator*(float s, const Vector3& a){
+    Vector3 r = {s * a.x, s * a.y, s * a.z};
+    return r;
+}
+
+inline float dot(const Vector3& a, const Vector3& b){
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vector3 cross(const Vector3& a, const Vector3& b){
+    Vector3 r = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    return r;
+}
+
+/**
+ * Returns the squared distance of p to the triangle abc (Ericson, "Real-Time
+ * Collision Detection", 5.1.5: the closest point is found by the Voronoi
+ * region of p).
+ */
+float squaredDistanceToTriangle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c){
+    Vector3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if(d1 <= 0.f && d2 <= 0.f)
+        return dot(ap, ap);
+
+    Vector3 bp = p - b;
+    float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if(d3 >= 0.f && d4 <= d3)
+        return dot(bp, bp);
+
+    float vc = d1 * d4 - d3 * d2;
+    if(vc <= 0.f && d1 >= 0.f && d3 <= 0.f){
+        Vector3 q = ap - (d1 / (d1 - d3)) * ab;
+        return dot(q, q);
+    }
+
+    Vector3 cp = p - c;
+    float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if(d6 >= 0.f && d5 <= d6)
+        return dot(cp, cp);
+
+    float vb = d5 * d2 - d1 * d6;
+    if(vb <= 0.f && d2 >= 0.f && d6 <= 0.f){
+        Vector3 q = ap - (d2 / (d2 - d6)) * ac;
+        return dot(q, q);
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if(va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f){
+        Vector3 q = bp - ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+        return dot(q, q);
+    }
+
+    // p projects into the triangle:
+    float denominator = 1.f / (va + vb + vc);
+    Vector3 q = ap - (vb * denominator) * ab - (vc * denominator) * ac;
+    return dot(q, q);
+}
+
+/**
+ * Returns the signed solid angle of the triangle abc seen from p (Van
+ * Oosterom and Strackee, 1983), which is positive if p lies behind the
+ * triangle (the inside of a counterclockwise mesh).
+ */
+float solidAngle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c){
+    Vector3 u = a - p, v = b - p, w = c - p;
+    float lu = std::sqrt(dot(u, u)), lv = std::sqrt(dot(v, v)), lw = std::sqrt(dot(w, w));
+    float numerator = dot(u, cross(v, w));
+    float denominator = lu * lv * lw + dot(u, v) * lw + dot(u, w) * lv + dot(v, w) * lu;
+    return 2.f * std::atan2(numerator, denominator);
+}
+
+/* A node of the winding number tree: the triangles [begin, end) with their
+   area weighted center, the radius around it, their area and the sum of
+   their area weighted normals; the first child follows the node, the second
+   one is at 'second': */
+struct WindingNode {
+    Vector3 center;
+    float radius;
+    Vector3 normal;
+    float area;
+    uint32_t begin, end, second;
+};
+
+/**
+ * The tree for the fast evaluation of the winding number (see
+ * bakeSignedDistanceField(...)).
+ */
+class WindingTree
+{
+public:
+    WindingTree(const Vec4f* positions, const uint32_t* indices, size_t triangleCount){
+        // Sort the triangles (their corners) along a Morton curve of their
+        // centroids, so that every node holds a compact cluster:
+        std::vector<Vec4f> centroids(triangleCount);
+        parallelFor(0, triangleCount, SDF_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t t=begin; t < end; ++t){
+                const Vec4f& a = positions[indices[3 * t]];
+                const Vec4f& b = positions[indices[3 * t + 1]];
+                const Vec4f& c = positions[indices[3 * t + 2]];
+                centroids[t] = Vec4f((a.x + b.x + c.x) / 3.f, (a.y + b.y + c.y) / 3.f, (a.z + b.z + c.z) / 3.f);
+            }
+        });
+        AABB bounds = computeAABB(centroids.data(), triangleCount);
+        codes.resize(triangleCount);
+        std::vector<uint32_t> order(triangleCount);
+        parallelFor(0, triangleCount, SDF_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t t=begin; t < end; ++t){
+                codes[t] = computeMortonCode63(centroids[t], bounds);
+                order[t] = uint32_t(t);
+            }
+        });
+        radixSort(codes, order, 63);
+
+        corners.resize(3 * triangleCount);
+        parallelFor(0, triangleCount, SDF_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t t=begin; t < end; ++t){
+                for(int k=0; k < 3; ++k)
+                    corners[3 * t + k] = toVector3(positions[indices[3 * order[t] + k]]);
+            }
+        });
+
+        nodes.reserve(2 * (triangleCount / WINDING_LEAF_SIZE + 1));
+        build(0, uint32_t(triangleCount));
+    }
+
+    /**
+     * Computes the (approximate) winding numbers at the given points, which
+     * lie within 'radius' of 'center'. The nodes which are far away from all
+     * of these points are found once and evaluated FLOAT_LANES at a time;
+     * only the nodes close to the points are refined per point.
+     */
+    void evaluate(const Vector3* points, size_t count, const Vector3& center, float radius,
+                  float* windingNumbers) const {
+        // The far nodes (as lanes; unused lanes have no normal) and the
+        // roots of the close subtrees:
+        std::vector<FloatLanes> far[6];
+        std::vector<uint32_t> roots;
+        size_t farCount = 0;
+
+        uint32_t stack[128];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while(stackSize > 0){
+            uint32_t index = stack[--stackSize];
+            const WindingNode& node = nodes[index];
+            Vector3 offset = node.center - center;
+            if(std::sqrt(dot(offset, offset)) - radius > WINDING_ACCURACY * node.radius){
+                if(farCount % FLOAT_LANES == 0){
+                    for(int c=0; c < 6; ++c)
+                        far[c].push_back(broadcast(c < 3 ? 1e18f : 0.f));
+                }
+                const float values[6] = {node.center.x, node.center.y, node.center.z,
+                                         node.normal.x, node.normal.y, node.normal.z};
+                for(int c=0; c < 6; ++c)
+                    far[c].back().v[farCount % FLOAT_LANES] = values[c];
+                ++farCount;
+            } else if(node.end - node.begin <= WINDING_LEAF_SIZE || node.radius <= radius){
+                roots.push_back(index);
+            } else {
+                stack[stackSize++] = node.second;
+                stack[stackSize++] = index + 1;
+            }
+        }
+
+        for(size_t i=0; i < count; ++i){
+            const Vector3& p = points[i];
+            FloatLanes lanes = broadcast(0.f);
+            for(size_t block=0; block < far[0].size(); ++block){
+                FloatLanes dx = far[0][block] - broadcast(p.x);
+                FloatLanes dy = far[1][block] - broadcast(p.y);
+                FloatLanes dz = far[2][block] - broadcast(p.z);
+                FloatLanes squaredDistance = dx * dx + dy * dy + dz * dz;
+                lanes = lanes + (dx * far[3][block] + dy * far[4][block] + dz * far[5][block])
+                              / (squaredDistance * sqrt(squaredDistance));
+            }
+
+            float sum = 0.f;
+            for(int l=0; l < FLOAT_LANES; ++l)
+                sum += lanes.v[l];
+            for(uint32_t root : roots)
+                sum += evaluate(p, root);
+            windingNumbers[i] = sum / (4.f * PI);
+        }
+    }
+
+private:
+    /**
+     * Returns the sum of the solid angles of the subtree 'start' seen from p.
+     */
+    float evaluate(const Vector3& p, uint32_t start) const {
+        float sum = 0.f;
+        uint32_t stack[128];
+        int stackSize = 0;
+        stack[stackSize++] = start;
+        while(stackSize > 0){
+            uint32_t index = stack[--stackSize];
+            const WindingNode& node = nodes[index];
+            Vector3 offset = node.center - p;
+            float squaredDistance = dot(offset, offset);
+
+            if(squaredDistance > WINDING_ACCURACY * WINDING_ACCURACY * node.radius * node.radius){
+                // The solid angle of a dipole:
+                sum += dot(offset, node.normal) / (squaredDistance * std::sqrt(squaredDistance));
+            } else if(node.end - node.begin <= WINDING_LEAF_SIZE){
+                for(uint32_t t=node.begin; t < node.end; ++t)
+                    sum += solidAngle(p, corners[3 * t], corners[3 * t + 1], corners[3 * t + 2]);
+            } else {
+                stack[stackSize++] = node.second;
+                stack[stackSize++] = index + 1;
+            }
+        }
+        return sum;
+    }
+
+    std::vector<Vector3> corners;
+    std::vector<uint64_t> codes;
+    std::vector<WindingNode> nodes;
+
+    uint32_t build(uint32_t begin, uint32_t end){
+        uint32_t index = uint32_t(nodes.size());
+        nodes.push_back(WindingNode());
+
+        WindingNode node;
+        node.begin = begin;
+        node.end = end;
+        node.second = 0;
+
+        if(end - begin > WINDING_LEAF_SIZE){
+            // Split where the highest differing bit of the Morton codes
+            // changes, so that both children are compact cells:
+            uint32_t middle = begin + (end - begin) / 2;
+            uint64_t difference = codes[begin] ^ codes[end - 1];
+            if(difference != 0){
+                uint64_t bit = uint64_t(1) << (63 - countLeadingZeros(difference));
+                middle = uint32_t(std::partition_point(codes.begin() + begin, codes.begin() + end,
+                                                       [&](uint64_t code){ return (code & bit) == 0; })
+                                  - codes.begin());
+            }
+            build(begin, middle);
+            node.second = build(middle, end);
+
+            // Combine the children (the sphere encloses both of theirs):
+            const WindingNode& first = nodes[index + 1];
+            const WindingNode& second = nodes[node.second];
+            node.area = first.area + second.area;
+            node.normal = first.normal + second.normal;
+            node.center = node.area > 0.f
+                        ? (1.f / node.area) * (first.area * first.center + second.area * second.center)
+                        : 0.5f * (first.center + second.center);
+            Vector3 d1 = first.center - node.center, d2 = second.center - node.center;
+            node.radius = std::max(std::sqrt(dot(d1, d1)) + first.radius, std::sqrt(dot(d2, d2)) + second.radius);
+        } else {
+            // The area weighted center and normal (twice the area vector of
+            // a triangle is the cross product of two edges):
+            Vector3 center = {0.f, 0.f, 0.f}, normal = {0.f, 0.f, 0.f};
+            float area = 0.f;
+            for(uint32_t t=begin; t < end; ++t){
+                const Vector3* c = &corners[3 * t];
+                Vector3 n = cross(c[1] - c[0], c[2] - c[0]);
+                float a = 0.5f * std::sqrt(dot(n, n));
+                center = center + (a / 3.f) * (c[0] + c[1] + c[2]);
+                normal = normal + 0.5f * n;
+                area += a;
+            }
+            node.center = area > 0.f ? (1.f / area) * center
+                                     : (1.f / 3.f) * (corners[3 * begin] + corners[3 * begin + 1] + corners[3 * begin + 2]);
+            node.area = area;
+            node.normal = normal;
+
+            float radius = 0.f;
+            for(uint32_t i=3 * begin; i < 3 * end; ++i){
+                Vector3 d = corners[i] - node.center;
+                radius = std::max(radius, dot(d, d));
+            }
+            node.radius = std::sqrt(radius);
+        }
+
+        nodes[index] = node;
+        return index;
+    }
+};
+
+/**
+ * The voxel grid of a field which is being baked, and its bricks.
+ */
+struct Grid {
+    Vec4f origin;
+    float voxelSize;
+    size_t size[3];
+    size_t brickCount[3];
+
+    size_t getBrickCount() const {
+        return brickCount[0] * brickCount[1] * brickCount[2];
+    }
+
+    /* Returns the first voxel and the end (exclusive) of the given brick: */
+    void getBrickRange(size_t brick, size_t begin[3], size_t end[3]) const {
+        size_t coordinates[3] = {brick % brickCount[0], (brick / brickCount[0]) % brickCount[1],
+                                 brick / (brickCount[0] * brickCount[1])};
+        for(int d=0; d < 3; ++d){
+            begin[d] = coordinates[d] * SDF_BRICK_SIZE;
+            end[d] = std::min(begin[d] + SDF_BRICK_SIZE, size[d]);
+        }
+    }
+
+    Vector3 getPosition(size_t x, size_t y, size_t z) const {
+        Vector3 r = {origin.x + x * voxelSize, origin.y + y * voxelSize, origin.z + z * voxelSize};
+        return r;
+    }
+};
+
+/**
+ * Computes the smallest and largest voxel coordinate (clamped to the grid)
+ * within the given distance of the triangle t. Returns false if there is no
+ * such voxel.
+ */
+bool getVoxelRange(const Grid& grid, const Vec4f* positions, const uint32_t* indices, size_t t, float distance,
+                   size_t low[3], size_t high[3]){
+    AABB box;
+    for(int k=0; k < 3; ++k)
+        box.extend(positions[indices[3 * t + k]]);
+
+    const float* boxMin = &box.min.x;
+    const float* boxMax = &box.max.x;
+    const float* origin = &grid.origin.x;
+    for(int d=0; d < 3; ++d){
+        float first = std::ceil((boxMin[d] - distance - origin[d]) / grid.voxelSize);
+        float last = std::floor((boxMax[d] + distance - origin[d]) / grid.voxelSize);
+        first = std::max(first, 0.f);
+        last = std::min(last, float(grid.size[d] - 1));
+        if(!(first <= last))
+            return false;
+        low[d] = size_t(first);
+        high[d] = size_t(last);
+    }
+    return true;
+}
+
+/**
+ * Updates the voxel at 'index' from its neighbours (the Godunov upwind
+ * discretization of |grad d| = 1, see Zhao 2005). Values of FLT_MAX are
+ * unknown; the voxel takes the sign of its closest neighbour. Returns
+ * whether the value decreased.
+ */
+inline bool updateVoxel(float* values, const Grid& grid, size_t x, size_t y, size_t z, size_t index){
+    size_t strideY = grid.size[0], strideZ = grid.size[0] * grid.size[1];
+    float neighbours[6] = {x > 0 ? values[index - 1] : FLT_MAX,
+                           x + 1 < grid.size[0] ? values[index + 1] : FLT_MAX,
+                           y > 0 ? values[index - strideY] : FLT_MAX,
+                           y + 1 < grid.size[1] ? values[index + strideY] : FLT_MAX,
+                           z > 0 ? values[index - strideZ] : FLT_MAX,
+                           z + 1 < grid.size[2] ? values[index + strideZ] : FLT_MAX};
+
+    // The smallest magnitude per axis, and the closest neighbour overall:
+    float minima[3];
+    float closest = neighbours[0];
+    for(int d=0; d < 3; ++d){
+        float first = neighbours[2 * d], second = neighbours[2 * d + 1];
+        minima[d] = std::min(std::fabs(first), std::fabs(second));
+        float nearer = std::fabs(first) < std::fabs(second) ? first : second;
+        closest = std::fabs(nearer) < std::fabs(closest) ? nearer : closest;
+    }
+
+    float a = minima[0], b = minima[1], c = minima[2];
+    if(a > b) std::swap(a, b);
+    if(b > c) std::swap(b, c);
+    if(a > b) std::swap(a, b);
+
+    // The new value is larger than a, so nothing changes if a is not smaller:
+    float current = std::fabs(values[index]);
+    if(!(a < current))
+        return false;
+
+    float h = grid.voxelSize;
+    float u = a + h;
+    if(u > b){
+        u = 0.5f * (a + b + std::sqrt(std::max(2.f * h * h - (a - b) * (a - b), 0.f)));
+        if(u > c){
+            float s = a + b + c;
+            u = (s + std::sqrt(std::max(s * s - 3.f * (a * a + b * b + c * c - h * h), 0.f))) / 3.f;
+        }
+    }
+
+    if(!(u < current))
+        return false;
+    values[index] = closest < 0.f ? -u : u;
+    return true;
+}
+
+/**
+ * Sweeps all voxels of the brick (bx, by, bz) in the given directions
+ * (+1 or -1 per axis), skipping the voxels of the band. Returns whether a
+ * voxel changed.
+ */
+bool sweepBrick(float* values, const Grid& grid, size_t bx, size_t by, size_t bz, const int directions[3],
+                float bandDistance){
+    size_t brick = (bz * grid.brickCount[1] + by) * grid.brickCount[0] + bx;
+    size_t begin[3], end[3];
+    grid.getBrickRange(brick, begin, end);
+
+    bool changed = false;
+    for(size_t k=0; k < end[2] - begin[2]; ++k){
+        size_t z = directions[2] > 0 ? begin[2] + k : end[2] - 1 - k;
+        for(size_t j=0; j < end[1] - begin[1]; ++j){
+            size_t y = directions[1] > 0 ? begin[1] + j : end[1] - 1 - j;
+            for(size_t i=0; i < end[0] - begin[0]; ++i){
+                size_t x = directions[0] > 0 ? begin[0] + i : end[0] - 1 - i;
+                size_t index = (z * grid.size[1] + y) * grid.size[0] + x;
+                if(std::fabs(values[index]) > bandDistance)
+                    changed |= updateVoxel(values, grid, x, y, z, index);
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * Returns the trilinearly interpolated value of the given field (dense or
+ * sparse) at the given point.
+ */
+template<typename Field>
+float sampleTrilinear(const Field& field, const Vec4f& point){
+    if(field.sizeX == 0 || field.sizeY == 0 || field.sizeZ == 0)
+        return FLT_MAX;
+
+    const float* p = &point.x;
+    const float* origin = &field.origin.x;
+    size_t sizes[3] = {field.sizeX, field.sizeY, field.sizeZ};
+    size_t low[3], high[3];
+    float t[3];
+    for(int d=0; d < 3; ++d){
+        float f = (p[d] - origin[d]) / field.voxelSize;
+        f = std::max(0.f, std::min(f, float(sizes[d] - 1)));
+        low[d] = std::min(size_t(f), sizes[d] - 1);
+        high[d] = std::min(low[d] + 1, sizes[d] - 1);
+        t[d] = f - float(low[d]);
+    }
+
+    float result = 0.f;
+    for(int corner=0; corner < 8; ++corner){
+        float weight = 1.f;
+        size_t c[3];
+        for(int d=0; d < 3; ++d){
+            bool upper = (corner >> d) & 1;
+            c[d] = upper ? high[d] : low[d];
+            weight *= upper ? t[d] : 1.f - t[d];
+        }
+        if(weight > 0.f)
+            result += weight * field.getValue(c[0], c[1], c[2]);
+    }
+    return result;
+}
+
+/**
+ * Returns the gradient of the trilinearly interpolated value of the given
+ * field by central differences over one voxel.
+ */
+template<typename Field>
+Vec4f sampleGradientCentral(const Field& field, const Vec4f& point){
+    if(field.sizeX == 0 || field.sizeY == 0 || field.sizeZ == 0)
+        return Vec4f(0.f, 0.f, 0.f, 0.f);
+
+    float h = field.voxelSize, gradient[3];
+    for(int d=0; d < 3; ++d){
+        Vec4f high = point, low = point;
+        (&high.x)[d] += h;
+        (&low.x)[d] -= h;
+        gradient[d] = (sampleTrilinear(field, high) - sampleTrilinear(field, low)) / (2.f * h);
+    }
+    return Vec4f(gradient[0], gradient[1], gradient[2], 0.f);
+}
+
+}
+
+SignedDistanceSettings::SignedDistanceSettings()
+    : resolution(256), padding(4), bandWidth(2.f)
+{
+}
+
+SignedDistanceField::SignedDistanceField()
+    : origin(0.f, 0.f, 0.f), voxelSize(1.f), sizeX(0), sizeY(0), sizeZ(0)
+{
+}
+
+float SignedDistanceField::sample(const Vec4f& point) const{
+    return sampleTrilinear(*this, point);
+}
+
+Vec4f SignedDistanceField::sampleGradient(const Vec4f& point) const{
+    return sampleGradientCentral(*this, point);
+}
+
+const uint32_t SparseSignedDistanceField::EMPTY_BRICK;
+
+SparseSignedDistanceField::SparseSignedDistanceField()
+    : origin(0.f, 0.f, 0.f), voxelSize(1.f), sizeX(0), sizeY(0), sizeZ(0),
+      brickCountX(0), brickCountY(0), brickCountZ(0)
+{
+}
+
+float SparseSignedDistanceField::getValue(size_t x, size_t y, size_t z) const{
+    size_t brick = ((z / SDF_BRICK_SIZE) * brickCountY + y / SDF_BRICK_SIZE) * brickCountX + x / SDF_BRICK_SIZE;
+    uint32_t stored = brickIndices[brick];
+    if(stored == EMPTY_BRICK)
+        return constants[brick];
+
+    size_t voxel = ((z % SDF_BRICK_SIZE) * SDF_BRICK_SIZE + y % SDF_BRICK_SIZE) * SDF_BRICK_SIZE + x % SDF_BRICK_SIZE;
+    return brickValues[stored * BRICK_VOXELS + voxel];
+}
+
+float SparseSignedDistanceField::sample(const Vec4f& point) const{
+    return sampleTrilinear(*this, point);
+}
+
+Vec4f SparseSignedDistanceField::sampleGradient(const Vec4f& point) const{
+    return sampleGradientCentral(*this, point);
+}
+
+SignedDistanceField bakeSignedDistanceField(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                                            const SignedDistanceSettings& settings){
+    if(triangleCount == 0)
+        throw std::invalid_argument("bakeSignedDistanceField: the mesh is empty.");
+    if(settings.resolution == 0 || !(settings.bandWidth >= 1.f))
+        throw std::invalid_argument("bakeSignedDistanceField: the resolution must be positive and the band at least 1 voxel.");
+    if(triangleCount >= size_t(0xffffffffu))
+        throw std::invalid_argument("bakeSignedDistanceField: too many triangles.");
+
+    // The grid around the bounding box of the mesh:
+    AABB bounds = parallelReduce(size_t(0), triangleCount, SDF_GRAIN_SIZE, AABB(),
+        [&](size_t begin, size_t end){
+            AABB box;
+            for(size_t i=3 * begin; i < 3 * end; ++i)
+                box.extend(positions[indices[i]]);
+            return box;
+        },
+        [](AABB a, const AABB& b){ a.extend(b); return a; });
+
+    Vec4f extents = bounds.getExtents();
+    float largest = 2.f * std::max(extents.x, std::max(extents.y, extents.z));
+    Grid grid;
+    grid.voxelSize = largest > 0.f ? largest / float(settings.resolution) : 1.f;
+    grid.origin = Vec4f(bounds.min.x - settings.padding * grid.voxelSize,
+                        bounds.min.y - settings.padding * grid.voxelSize,
+                        bounds.min.z - settings.padding * grid.voxelSize);
+    const float* extent = &extents.x;
+    for(int d=0; d < 3; ++d){
+        grid.size[d] = size_t(std::ceil(2.f * extent[d] / grid.voxelSize)) + 1 + 2 * settings.padding;
+        grid.brickCount[d] = (grid.size[d] + SDF_BRICK_SIZE - 1) / SDF_BRICK_SIZE;
+    }
+    float bandDistance = settings.bandWidth * grid.voxelSize;
+
+    SignedDistanceField field;
+    field.origin = grid.origin;
+    field.voxelSize = grid.voxelSize;
+    field.sizeX = grid.size[0];
+    field.sizeY = grid.size[1];
+    field.sizeZ = grid.size[2];
+    field.values.assign(grid.size[0] * grid.size[1] * grid.size[2], FLT_MAX);
+    float* values = field.values.data();
+
+    // 1. Bin the triangles into the bricks which their grown bounding boxes
+    //    overlap (as (brick, triangle) pairs sorted by brick):
+    std::vector<size_t> pairOffsets(triangleCount + 1, 0);
+    parallelFor(0, triangleCount, SDF_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t t=begin; t < end; ++t){
+            size_t low[3], high[3];
+            if(getVoxelRange(grid, positions, indices, t, bandDistance, low, high)){
+                size_t bricks = 1;
+                for(int d=0; d < 3; ++d)
+                    bricks *= high[d] / SDF_BRICK_SIZE - low[d] / SDF_BRICK_SIZE + 1;
+                pairOffsets[t + 1] = bricks;
+            }
+        }
+    });
+    for(size_t t=0; t < triangleCount; ++t)
+        pairOffsets[t + 1] += pairOffsets[t];
+
+    std::vector<uint64_t> pairBricks(pairOffsets[triangleCount]);
+    std::vector<uint32_t> pairTriangles(pairOffsets[triangleCount]);
+    parallelFor(0, triangleCount, SDF_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t t=begin; t < end; ++t){
+            size_t low[3], high[3];
+            if(!getVoxelRange(grid, positions, indices, t, bandDistance, low, high))
+                continue;
+            size_t pair = pairOffsets[t];
+            for(size_t bz=low[2] / SDF_BRICK_SIZE; bz <= high[2] / SDF_BRICK_SIZE; ++bz){
+                for(size_t by=low[1] / SDF_BRICK_SIZE; by <= high[1] / SDF_BRICK_SIZE; ++by){
+                    for(size_t bx=low[0] / SDF_BRICK_SIZE; bx <= high[0] / SDF_BRICK_SIZE; ++bx){
+                        pairBricks[pair] = (bz * grid.brickCount[1] + by) * grid.brickCount[0] + bx;
+                        pairTriangles[pair] = uint32_t(t);
+                        ++pair;
+                    }
+                }
+            }
+        }
+    });
+
+    int brickBits = 1;
+    while(brickBits < 64 && (uint64_t(1) << brickBits) < grid.getBrickCount())
+        ++brickBits;
+    radixSort(pairBricks, pairTriangles, brickBits);
+
+    // The bricks which contain triangles and the range of their pairs:
+    std::vector<size_t> activeBricks, activeStarts;
+    for(size_t pair=0; pair < pairBricks.size(); ++pair){
+        if(pair == 0 || pairBricks[pair] != pairBricks[pair - 1]){
+            activeBricks.push_back(size_t(pairBricks[pair]));
+            activeStarts.push_back(pair);
+        }
+    }
+    activeStarts.push_back(pairBricks.size());
+
+    //    ... and compute the exact distances of the band voxels per brick:
+    WindingTree tree(positions, indices, triangleCount);
+    parallelFor(0, activeBricks.size(), 1, [&](size_t begin, size_t end){
+        float squared[BRICK_VOXELS];
+        std::vector<size_t> bandVoxels;
+        std::vector<Vector3> bandPositions;
+        std::vector<float> windingNumbers;
+        for(size_t active=begin; active < end; ++active){
+            size_t brickBegin[3], brickEnd[3];
+            grid.getBrickRange(activeBricks[active], brickBegin, brickEnd);
+            std::fill(squared, squared + BRICK_VOXELS, bandDistance * bandDistance);
+
+            for(size_t pair=activeStarts[active]; pair < activeStarts[active + 1]; ++pair){
+                size_t t = pairTriangles[pair];
+                size_t low[3], high[3];
+                getVoxelRange(grid, positions, indices, t, bandDistance, low, high);
+                Vector3 a = toVector3(positions[indices[3 * t]]);
+                Vector3 b = toVector3(positions[indices[3 * t + 1]]);
+                Vector3 c = toVector3(positions[indices[3 * t + 2]]);
+                for(size_t z=std::max(low[2], brickBegin[2]); z <= std::min(high[2], brickEnd[2] - 1); ++z){
+                    for(size_t y=std::max(low[1], brickBegin[1]); y <= std::min(high[1], brickEnd[1] - 1); ++y){
+                        for(size_t x=std::max(low[0], brickBegin[0]); x <= std::min(high[0], brickEnd[0] - 1); ++x){
+                            float& s = squared[((z - brickBegin[2]) * SDF_BRICK_SIZE + y - brickBegin[1]) * SDF_BRICK_SIZE
+                                               + x - brickBegin[0]];
+                            s = std::min(s, squaredDistanceToTriangle(grid.getPosition(x, y, z), a, b, c));
+                        }
+                    }
+                }
+            }
+
+            // 2. The signs of the band voxels from the winding number:
+            bandVoxels.clear();
+            bandPositions.clear();
+            AABB bandBounds;
+            for(size_t z=brickBegin[2]; z < brickEnd[2]; ++z){
+                for(size_t y=brickBegin[1]; y < brickEnd[1]; ++y){
+                    for(size_t x=brickBegin[0]; x < brickEnd[0]; ++x){
+                        size_t voxel = ((z - brickBegin[2]) * SDF_BRICK_SIZE + y - brickBegin[1]) * SDF_BRICK_SIZE
+                                     + x - brickBegin[0];
+                        if(squared[voxel] >= bandDistance * bandDistance)
+                            continue;
+                        Vector3 position = grid.getPosition(x, y, z);
+                        bandVoxels.push_back(voxel);
+                        bandPositions.push_back(position);
+                        bandBounds.extend(Vec4f(position.x, position.y, position.z));
+                    }
+                }
+            }
+            if(bandVoxels.empty())
+                continue;
+
+            Vec4f center = bandBounds.getCenter(), extents = bandBounds.getExtents();
+            Vector3 bandCenter = toVector3(center);
+            float bandRadius = std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+            windingNumbers.resize(bandVoxels.size());
+            tree.evaluate(bandPositions.data(), bandPositions.size(), bandCenter, bandRadius, windingNumbers.data());
+
+            for(size_t i=0; i < bandVoxels.size(); ++i){
+                size_t voxel = bandVoxels[i];
+                size_t x = brickBegin[0] + voxel % SDF_BRICK_SIZE;
+                size_t y = brickBegin[1] + (voxel / SDF_BRICK_SIZE) % SDF_BRICK_SIZE;
+                size_t z = brickBegin[2] + voxel / (SDF_BRICK_SIZE * SDF_BRICK_SIZE);
+                float distance = std::sqrt(squared[voxel]);
+                values[(z * grid.size[1] + y) * grid.size[0] + x] = windingNumbers[i] > 0.5f ? -distance : distance;
+            }
+        }
+    });
+
+    // 3. Fast sweeping in the 8 diagonal directions, along the diagonal
+    //    planes of bricks:
+    //    A brick is skipped if neither it changed during its last sweep nor
+    //    one of its neighbours afterwards (like the locking sweeping method
+    //    of Bak et al., 2010), which skips most bricks of the later sweeps:
+    std::vector<size_t> lastChange(grid.getBrickCount(), 0), lastVisit(grid.getBrickCount(), 1);
+    for(size_t brick : activeBricks)
+        lastChange[brick] = 1;
+    size_t time = 2;
+
+    size_t planeCount = grid.brickCount[0] + grid.brickCount[1] + grid.brickCount[2] - 2;
+    for(int sweep=0; sweep < 8; ++sweep){
+        int directions[3] = {(sweep & 1) ? -1 : 1, (sweep & 2) ? -1 : 1, (sweep & 4) ? -1 : 1};
+        for(size_t plane=0; plane < planeCount; ++plane){
+            // The swept brick coordinates (i, j, k) with i + j + k = plane:
+            size_t iFirst = plane > grid.brickCount[1] + grid.brickCount[2] - 2
+                          ? plane - (grid.brickCount[1] + grid.brickCount[2] - 2) : 0;
+            size_t iLast = std::min(plane, grid.brickCount[0] - 1);
+            parallelFor(iFirst, iLast + 1, 1, [&](size_t begin, size_t end){
+                for(size_t i=begin; i < end; ++i){
+                    size_t rest = plane - i;
+                    size_t jFirst = rest > grid.brickCount[2] - 1 ? rest - (grid.brickCount[2] - 1) : 0;
+                    size_t jLast = std::min(rest, grid.brickCount[1] - 1);
+                    for(size_t j=jFirst; j <= jLast; ++j){
+                        size_t k = rest - j;
+                        size_t bx = directions[0] > 0 ? i : grid.brickCount[0] - 1 - i;
+                        size_t by = directions[1] > 0 ? j : grid.brickCount[1] - 1 - j;
+                        size_t bz = directions[2] > 0 ? k : grid.brickCount[2] - 1 - k;
+                        size_t brick = (bz * grid.brickCount[1] + by) * grid.brickCount[0] + bx;
+                        bool dirty = lastChange[brick] >= lastVisit[brick];
+                        size_t coordinates[3] = {bx, by, bz};
+                        size_t strides[3] = {1, grid.brickCount[0], grid.brickCount[0] * grid.brickCount[1]};
+                        for(int d=0; d < 3 && !dirty; ++d){
+                            dirty = (coordinates[d] > 0 && lastChange[brick - strides[d]] >= lastVisit[brick])
+                                 || (coordinates[d] + 1 < grid.brickCount[d] && lastChange[brick + strides[d]] >= lastVisit[brick]);
+                        }
+                        if(!dirty)
+                            continue;
+
+                        if(sweepBrick(values, grid, bx, by, bz, directions, bandDistance))
+                            lastChange[brick] = time;
+                        lastVisit[brick] = time;
+                    }
+                }
+            });
+            ++time;
+        }
+    }
+
+    return field;
+}
+
+SignedDistanceField bakeSignedDistanceField(const TriangleMesh& mesh, const SignedDistanceSettings& settings){
+    return bakeSignedDistanceField(mesh.positions.data(), mesh.indices.data(), mesh.getTriangleCount(), settings);
+}
+
+SparseSignedDistanceField createSparseSignedDistanceField(const SignedDistanceField& field, float maxDistance){
+    SparseSignedDistanceField sparse;
+    sparse.origin = field.origin;
+    sparse.voxelSize = field.voxelSize;
+    sparse.sizeX = field.sizeX;
+    sparse.sizeY = field.sizeY;
+    sparse.sizeZ = field.sizeZ;
+    sparse.brickCountX = (field.sizeX + SDF_BRICK_SIZE - 1) / SDF_BRICK_SIZE;
+    sparse.brickCountY = (field.sizeY + SDF_BRICK_SIZE - 1) / SDF_BRICK_SIZE;
+    sparse.brickCountZ = (field.sizeZ + SDF_BRICK_SIZE - 1) / SDF_BRICK_SIZE;
+
+    Grid grid;
+    grid.size[0] = field.sizeX;
+    grid.size[1] = field.sizeY;
+    grid.size[2] = field.sizeZ;
+    grid.brickCount[0] = sparse.brickCountX;
+    grid.brickCount[1] = sparse.brickCountY;
+    grid.brickCount[2] = sparse.brickCountZ;
+    size_t brickCount = grid.getBrickCount();
+
+    // The constant of every brick, and whether it is stored:
+    sparse.constants.resize(brickCount);
+    sparse.brickIndices.resize(brickCount);
+    parallelFor(0, brickCount, 64, [&](size_t begin, size_t end){
+        for(size_t brick=begin; brick < end; ++brick){
+            size_t brickBegin[3], brickEnd[3];
+            grid.getBrickRange(brick, brickBegin, brickEnd);
+            float closest = FLT_MAX;
+            for(size_t z=brickBegin[2]; z < brickEnd[2]; ++z){
+                for(size_t y=brickBegin[1]; y < brickEnd[1]; ++y){
+                    for(size_t x=brickBegin[0]; x < brickEnd[0]; ++x){
+                        float value = field.getValue(x, y, z);
+                        if(std::fabs(value) < std::fabs(closest))
+                            closest = value;
+                    }
+                }
+            }
+            sparse.constants[brick] = closest;
+            sparse.brickIndices[brick] = std::fabs(closest) <= maxDistance ? 0 : SparseSignedDistanceField::EMPTY_BRICK;
+        }
+    });
+
+    uint32_t storedCount = 0;
+    for(uint32_t& index : sparse.brickIndices){
+        if(index != SparseSignedDistanceField::EMPTY_BRICK)
+            index = storedCount++;
+    }
+
+    // Copy the stored bricks (the voxels beyond the grid repeat its border):
+    sparse.brickValues.resize(size_t(storedCount) * BRICK_VOXELS);
+    parallelFor(0, brickCount, 64, [&](size_t begin, size_t end){
+        for(size_t brick=begin; brick < end; ++brick){
+            if(sparse.brickIndices[brick] == SparseSignedDistanceField::EMPTY_BRICK)
+                continue;
+            size_t brickBegin[3], brickEnd[3];
+            grid.getBrickRange(brick, brickBegin, brickEnd);
+            float* target = &sparse.brickValues[sparse.brickIndices[brick] * BRICK_VOXELS];
+            for(size_t z=0; z < SDF_BRICK_SIZE; ++z){
+                for(size_t y=0; y < SDF_BRICK_SIZE; ++y){
+                    for(size_t x=0; x < SDF_BRICK_SIZE; ++x){
+                        *target++ = field.getValue(std::min(brickBegin[0] + x, brickEnd[0] - 1),
+                                                   std::min(brickBegin[1] + y, brickEnd[1] - 1),
+                                                   std::min(brickBegin[2] + z, brickEnd[2] - 1));
+                    }
+                }
+            }
+        }
+    });
+
+    return sparse;
+}
+
+float computeWindingNumber(const Vec4f* positions, const uint32_t* indices, size_t triangleCount, const Vec4f& point){
+    Vector3 p = toVector3(point);
+    double sum = parallelReduce(size_t(0), triangleCount, SDF_GRAIN_SIZE, 0.0,
+        [&](size_t begin, size_t end){
+            double chunk = 0.0;
+            for(size_t t=begin; t < end; ++t){
+                chunk += solidAngle(p, toVector3(positions[indices[3 * t]]), toVector3(positions[indices[3 * t + 1]]),
+                                    toVector3(positions[indices[3 * t + 2]]));
+            }
+            return chunk;
+        },
+        [](double a, double b){ return a + b; });
+    return float(sum / (4.0 * PI));
+}
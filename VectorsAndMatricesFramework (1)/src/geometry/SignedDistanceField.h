@@ -0,0 +1,226 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors and meshes: */
+#include "../math/Vec4f.h"
+#include "TriangleMesh.h"
+
+/**
+ * The edge length (in voxels) of the cubic bricks in which the signed
+ * distance fields are baked and stored sparsely.
+ */
+#define SDF_BRICK_SIZE 8
+
+/**
+ * The parameters of bakeSignedDistanceField(...).
+ */
+
+class SignedDistanceSettings
+{
+public:
+    /**
+     * The number of voxels along the longest axis of the bounding box of the
+     * mesh (default 256). The voxels are cubes.
+     */
+    size_t resolution;
+
+    /**
+     * The number of voxels which are added around the bounding box of the
+     * mesh on every side (default 4).
+     */
+    size_t padding;
+
+    /**
+     * Voxels within this distance of the mesh (in voxels, default 2) get the
+     * exact distance; the others are filled by fast sweeping. Must be at
+     * least 1, so that the band separates the inside from the outside.
+     */
+    float bandWidth;
+
+    /**
+     * Constructs the default settings.
+     */
+    SignedDistanceSettings();
+};
+
+/**
+ * A signed distance field on a dense, uniform grid: the value of a voxel is
+ * the distance of its position to the closest point of the surface, negative
+ * inside and positive outside.
+ *
+ * The voxel (x, y, z) lies at origin + (x, y, z) * voxelSize and its value is
+ * values[(z * sizeY + y) * sizeX + x].
+ */
+
+class SignedDistanceField
+{
+public:
+    /** The position of the voxel (0, 0, 0) */
+    Vec4f origin;
+
+    /** The edge length of a voxel */
+    float voxelSize;
+
+    /** The number of voxels along x, y and z */
+    size_t sizeX, sizeY, sizeZ;
+
+    /** The values of all voxels */
+    std::vector<float> values;
+
+    /**
+     * Constructs an empty field.
+     */
+    SignedDistanceField();
+
+    /**
+     * Returns the value of the given voxel (unchecked).
+     */
+    float getValue(size_t x, size_t y, size_t z) const {
+        return values[(z * sizeY + y) * sizeX + x];
+    }
+
+    /**
+     * Returns the trilinearly interpolated value at the given point (which is
+     * clamped to the grid).
+     */
+    float sample(const Vec4f& point) const;
+
+    /**
+     * Returns the gradient of sample(...) at the given point by central
+     * differences over one voxel (w = 0). Near the surface, this is the
+     * outward normal (of about unit length); it is zero for an empty field.
+     */
+    Vec4f sampleGradient(const Vec4f& point) const;
+};
+
+/**
+ * A signed distance field which only stores the bricks of
+ * SDF_BRICK_SIZE^3 voxels which are close to the surface. Every other brick
+ * is represented by one constant: the value of its voxel which is closest to
+ * the surface, which is a conservative distance for all of its voxels (for
+ * example for sphere tracing and collision tests).
+ *
+ * The brick (bx, by, bz) has the index b = (bz * brickCountY + by) *
+ * brickCountX + bx. If brickIndices[b] is not EMPTY_BRICK, the value of its
+ * voxel (x, y, z) (relative to the brick) is brickValues[brickIndices[b] *
+ * SDF_BRICK_SIZE^3 + (z * SDF_BRICK_SIZE + y) * SDF_BRICK_SIZE + x],
+ * otherwise it is constants[b].
+ */
+
+class SparseSignedDistanceField
+{
+public:
+    /** Marks the bricks which are represented by their constant */
+    static const uint32_t EMPTY_BRICK = 0xffffffffu;
+
+    /** The position of the voxel (0, 0, 0) */
+    Vec4f origin;
+
+    /** The edge length of a voxel */
+    float voxelSize;
+
+    /** The number of voxels along x, y and z */
+    size_t sizeX, sizeY, sizeZ;
+
+    /** The number of bricks along x, y and z */
+    size_t brickCountX, brickCountY, brickCountZ;
+
+    /** The index of the stored brick (or EMPTY_BRICK) of every brick */
+    std::vector<uint32_t> brickIndices;
+
+    /** The values of the stored bricks */
+    std::vector<float> brickValues;
+
+    /** The constant of every brick */
+    std::vector<float> constants;
+
+    /**
+     * Constructs an empty field.
+     */
+    SparseSignedDistanceField();
+
+    /**
+     * Returns the value of the given voxel (unchecked).
+     */
+    float getValue(size_t x, size_t y, size_t z) const;
+
+    /**
+     * Returns the trilinearly interpolated value at the given point (which is
+     * clamped to the grid).
+     */
+    float sample(const Vec4f& point) const;
+
+    /**
+     * Returns the gradient of sample(...) at the given point by central
+     * differences over one voxel (w = 0). Near the surface, this is the
+     * outward normal (of about unit length); it is zero for an empty field.
+     */
+    Vec4f sampleGradient(const Vec4f& point) const;
+};
+
+/**
+ * Bakes the signed distance field of a closed triangle mesh (given by its
+ * vertex positions and three indices per triangle, counterclockwise seen
+ * from the outside, like TriangleMesh).
+ *
+ * The field is computed in three parallel steps:
+ *
+ *  1. Exact distances in the narrow band: the triangles are binned into the
+ *     bricks of SDF_BRICK_SIZE^3 voxels which their bounding boxes (grown by
+ *     the band) overlap, by sorting (brick, triangle) pairs with radixSort(...)
+ *     (see Sorting.h). Then every brick computes the exact distances of its
+ *     voxels to its triangles, without any synchronization.
+ *  2. The signs of the band voxels from the generalized winding number
+ *     (Jacobson et al., "Robust inside-outside segmentation using generalized
+ *     winding numbers", 2013), which is also correct for meshes with small
+ *     holes or self-intersections. It is evaluated hierarchically (Barill et
+ *     al., "Fast winding numbers for soups and clouds", 2018): the triangles
+ *     are sorted along a Morton curve into a tree, whose nodes store their
+ *     area weighted normals, so distant nodes are approximated by a dipole
+ *     and only close triangles need their exact solid angle.
+ *  3. The remaining voxels with the fast sweeping method (Zhao, "A fast
+ *     sweeping method for Eikonal equations", 2005), which solves
+ *     |grad d| = 1 with Gauss-Seidel sweeps in all 8 diagonal directions
+ *     (which suffices for distance functions). Each sweep visits the bricks
+ *     along the diagonal planes bx + by + bz = const in the direction of the
+ *     sweep: the bricks of one plane do not depend on each other, so they are
+ *     swept in parallel, and every brick stays in the cache while it is
+ *     swept. The sign of a voxel is the sign of its upwind neighbour, so it
+ *     travels outwards from the band.
+ *
+ * The result does not depend on the number of threads. Throws
+ * std::invalid_argument if the mesh is empty, or if the settings are invalid.
+ */
+SignedDistanceField bakeSignedDistanceField(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                                            const SignedDistanceSettings& settings = SignedDistanceSettings());
+
+/**
+ * Bakes the signed distance field of the given mesh (see above).
+ */
+SignedDistanceField bakeSignedDistanceField(const TriangleMesh& mesh,
+                                            const SignedDistanceSettings& settings = SignedDistanceSettings());
+
+/**
+ * Converts a dense field into a sparse field, which stores all bricks that
+ * contain a voxel whose absolute value is at most maxDistance (for example
+ * the narrow band around the surface).
+ */
+SparseSignedDistanceField createSparseSignedDistanceField(const SignedDistanceField& field, float maxDistance);
+
+/**
+ * Returns the generalized winding number of the given mesh at the given
+ * point: about 1 inside of a closed mesh and 0 outside (computed exactly by
+ * summing the solid angles of all triangles, which is mainly useful for
+ * tests; see bakeSignedDistanceField(...) for the fast approximation).
+ */
+float computeWindingNumber(const Vec4f* positions, const uint32_t* indices, size_t triangleCount, const Vec4f& point);
@@ -0,0 +1,361 @@
+#include "SparseVoxelOctree.h"
+#include "../math/Morton.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of samples or nodes which are processed by one task: */
+const size_t SVO_GRAIN_SIZE = 65536;
+
+/* The number of queries which are processed by one task: */
+const size_t QUERY_GRAIN_SIZE = 1024;
+
+/* The maximum size of the traversal stack (every visited level pushes at
+   most 8 children, one of which is popped right away): */
+const int STACK_SIZE = 7 * SVO_MAX_DEPTH + 8;
+
+/* Returns the number of set bits of an 8 bit mask: */
+int countBits(uint32_t mask){
+    mask = mask - ((mask >> 1) & 0x55u);
+    mask = (mask & 0x33u) + ((mask >> 2) & 0x33u);
+    return int((mask + (mask >> 4)) & 0x0fu);
+}
+
+/* Returns the cell of the coordinate t in [0, 1] in a grid with 'cells'
+   cells (clamped to the grid): */
+uint32_t getCell(double t, uint32_t cells){
+    double cell = t * double(cells);
+    if(!(cell > 0.0))
+        return 0;
+    return cell < double(cells - 1) ? uint32_t(cell) : cells - 1;
+}
+
+/**
+ * One level of the octree during the construction: the sorted codes of its
+ * nodes, their sample counts and (for inner nodes) their children.
+ */
+struct Level {
+    std::vector<uint64_t> codes;
+    std::vector<uint32_t> sampleCounts;
+    std::vector<uint32_t> firstChildren;
+    std::vector<uint8_t> childMasks;
+};
+
+/**
+ * Creates the parents of the given sorted codes, which are the codes shifted
+ * right by 'shift' bits: every run of equal parent codes gives one parent,
+ * whose sample count is the sum of the run (or its length, if the children
+ * have no counts). With 'linkChildren', the parents also get their first
+ * child and child mask.
+ */
+void createParents(const std::vector<uint64_t>& codes, const std::vector<uint32_t>* counts, int shift,
+                   bool linkChildren, Level& parents){
+    size_t count = codes.size();
+    size_t chunkCount = getChunkCount(count, SVO_GRAIN_SIZE);
+    std::vector<size_t> offsets(chunkCount + 1, 0);
+
+    // Count the runs which start in every chunk:
+    parallelFor(0, count, SVO_GRAIN_SIZE, [&](size_t begin, size_t end){
+        size_t starts = 0;
+        for(size_t i=begin; i < end; ++i)
+            starts += i == 0 || (codes[i] >> shift) != (codes[i - 1] >> shift);
+        offsets[begin / SVO_GRAIN_SIZE + 1] = starts;
+    });
+    for(size_t chunk=0; chunk < chunkCount; ++chunk)
+        offsets[chunk + 1] += offsets[chunk];
+
+    size_t parentCount = offsets[chunkCount];
+    parents.codes.resize(parentCount);
+    parents.sampleCounts.resize(parentCount);
+    if(linkChildren){
+        parents.firstChildren.resize(parentCount);
+        parents.childMasks.resize(parentCount);
+    }
+
+    // Create the parents of the runs which start in every chunk (a run may
+    // continue into the next chunk):
+    parallelFor(0, count, SVO_GRAIN_SIZE, [&](size_t begin, size_t end){
+        size_t parent = offsets[begin / SVO_GRAIN_SIZE];
+        for(size_t i=begin; i < end; ++i){
+            uint64_t code = codes[i] >> shift;
+            if(i > 0 && (codes[i - 1] >> shift) == code)
+                continue;
+
+            uint32_t samples = 0;
+            uint32_t mask = 0;
+            for(size_t j=i; j < count && (codes[j] >> shift) == code; ++j){
+                samples += counts ? (*counts)[j] : 1;
+                mask |= 1u << (codes[j] & 7);
+            }
+            parents.codes[parent] = code;
+            parents.sampleCounts[parent] = samples;
+            if(linkChildren){
+                parents.firstChildren[parent] = uint32_t(i);
+                parents.childMasks[parent] = uint8_t(mask);
+            }
+            ++parent;
+        }
+    });
+}
+
+/* A node which still has to be visited by a ray, with the t at which the
+   ray enters it: */
+struct StackEntry {
+    uint32_t node;
+    uint32_t level;
+    uint32_t cell[3];
+    float enter;
+};
+
+}
+
+SparseVoxelOctree::SparseVoxelOctree()
+    : size(0.f), depth(0), levelOffsets(1, 0)
+{}
+
+SparseVoxelOctree::SparseVoxelOctree(const Vec4f* samples, size_t count, size_t depth)
+    : depth(depth)
+{
+    if(count == 0)
+        throw std::invalid_argument("SparseVoxelOctree: there are no samples.");
+    if(count >= INVALID)
+        throw std::invalid_argument("SparseVoxelOctree: too many samples.");
+    if(depth > SVO_MAX_DEPTH)
+        throw std::invalid_argument("SparseVoxelOctree: the depth is too large.");
+
+    // The root cube around the bounding box (enlarged a little, so that the
+    // samples on the border stay inside despite rounding):
+    AABB bounds = computeAABB(samples, count);
+    Vec4f center = bounds.getCenter();
+    size = std::max(bounds.max.x - bounds.min.x, std::max(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z));
+    size *= 1.f + 1e-6f;
+    if(!(size > 0.f))
+        size = 1.f;
+    origin = Vec4f(center.x - 0.5f * size, center.y - 0.5f * size, center.z - 0.5f * size);
+
+    // Sort the Morton codes of the voxels of all samples:
+    uint32_t cells = 1u << depth;
+    std::vector<uint64_t> codes(count);
+    std::vector<uint32_t> indices(count);
+    parallelFor(0, count, SVO_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            codes[i] = encodeMorton63(getCell((double(samples[i].x) - origin.x) / size, cells),
+                                      getCell((double(samples[i].y) - origin.y) / size, cells),
+                                      getCell((double(samples[i].z) - origin.z) / size, cells));
+            indices[i] = uint32_t(i);
+        }
+    });
+    radixSort(codes, indices, int(3 * depth));
+    std::vector<uint32_t>().swap(indices);
+
+    // Merge the samples into voxels, and the nodes of every level into their
+    // parents:
+    std::vector<Level> levels(depth + 1);
+    createParents(codes, nullptr, 0, false, levels[depth]);
+    std::vector<uint64_t>().swap(codes);
+    for(size_t level=depth; level > 0; --level)
+        createParents(levels[level].codes, &levels[level].sampleCounts, 3, true, levels[level - 1]);
+
+    // Store the levels one after another:
+    levelOffsets.assign(depth + 2, 0);
+    for(size_t level=0; level <= depth; ++level)
+        levelOffsets[level + 1] = levelOffsets[level] + levels[level].codes.size();
+
+    sampleCounts.resize(levelOffsets[depth + 1]);
+    firstChildren.resize(levelOffsets[depth]);
+    childMasks.resize(levelOffsets[depth]);
+    for(size_t level=0; level <= depth; ++level){
+        Level& nodes = levels[level];
+        std::copy(nodes.sampleCounts.begin(), nodes.sampleCounts.end(), sampleCounts.begin() + levelOffsets[level]);
+        if(level < depth){
+            std::copy(nodes.firstChildren.begin(), nodes.firstChildren.end(), firstChildren.begin() + levelOffsets[level]);
+            std::copy(nodes.childMasks.begin(), nodes.childMasks.end(), childMasks.begin() + levelOffsets[level]);
+        }
+        nodes = Level();
+    }
+}
+
+size_t SparseVoxelOctree::getDepth() const {
+    return depth;
+}
+
+AABB SparseVoxelOctree::getBounds() const {
+    return AABB(origin, Vec4f(origin.x + size, origin.y + size, origin.z + size));
+}
+
+float SparseVoxelOctree::getNodeSize(size_t level) const {
+    return std::ldexp(size, -int(level));
+}
+
+size_t SparseVoxelOctree::getNodeCount(size_t level) const {
+    return level < levelOffsets.size() - 1 ? levelOffsets[level + 1] - levelOffsets[level] : 0;
+}
+
+uint32_t SparseVoxelOctree::getSampleCount(size_t level, uint32_t node) const {
+    return sampleCounts[levelOffsets[level] + node];
+}
+
+size_t SparseVoxelOctree::getMemorySize() const {
+    return sampleCounts.size() * sizeof(uint32_t) + firstChildren.size() * sizeof(uint32_t)
+         + childMasks.size() * sizeof(uint8_t) + levelOffsets.size() * sizeof(size_t);
+}
+
+uint32_t SparseVoxelOctree::findNode(const Vec4f& point, size_t level) const {
+    if(sampleCounts.empty() || level > depth)
+        return INVALID;
+
+    double t[3] = {(double(point.x) - origin.x) / size, (double(point.y) - origin.y) / size,
+                   (double(point.z) - origin.z) / size};
+    uint32_t cells = 1u << depth;
+    uint32_t cell[3];
+    for(int d=0; d < 3; ++d){
+        if(!(t[d] >= 0.0 && t[d] <= 1.0))
+            return INVALID;
+        cell[d] = getCell(t[d], cells);
+    }
+
+    // Descend along the bits of the cell, from the highest one:
+    uint32_t node = 0;
+    for(size_t l=0; l < level; ++l){
+        int bit = int(depth - 1 - l);
+        uint32_t octant = ((cell[0] >> bit) & 1) | ((cell[1] >> bit) & 1) << 1 | ((cell[2] >> bit) & 1) << 2;
+        uint32_t mask = childMasks[levelOffsets[l] + node];
+        if(!(mask & (1u << octant)))
+            return INVALID;
+        node = firstChildren[levelOffsets[l] + node] + uint32_t(countBits(mask & ((1u << octant) - 1)));
+    }
+    return node;
+}
+
+uint32_t SparseVoxelOctree::intersectRay(const Vec4f& rayOrigin, const Vec4f& direction, float maxDistance,
+                                         size_t level, float* distance) const {
+    if(sampleCounts.empty() || level > depth)
+        return INVALID;
+
+    // The ray in the coordinates of the root cube (scaled to [0, 1]^3);
+    // directions parallel to an axis get a tiny component, which avoids
+    // 0 * infinity in the slab tests:
+    float start[3] = {(rayOrigin.x - origin.x) / size, (rayOrigin.y - origin.y) / size, (rayOrigin.z - origin.z) / size};
+    float inverse[3];
+    float components[3] = {direction.x, direction.y, direction.z};
+    for(int d=0; d < 3; ++d){
+        float c = components[d] / size;
+        if(std::fabs(c) < 1e-30f)
+            c = c < 0.f ? -1e-30f : 1e-30f;
+        inverse[d] = 1.f / c;
+    }
+
+    // Returns the interval [enter, leave] of t in which the ray is inside of
+    // the cube with the given minimum corner and edge length:
+    auto intersectCube = [&](const float* minimum, float edge, float& enter, float& leave){
+        enter = 0.f;
+        leave = maxDistance;
+        for(int d=0; d < 3; ++d){
+            float t0 = (minimum[d] - start[d]) * inverse[d];
+            float t1 = (minimum[d] + edge - start[d]) * inverse[d];
+            enter = std::max(enter, std::min(t0, t1));
+            leave = std::min(leave, std::max(t0, t1));
+        }
+        return enter <= leave;
+    };
+
+    StackEntry stack[STACK_SIZE];
+    int stackSize = 0;
+    float minimum[3] = {0.f, 0.f, 0.f};
+    float enter, leave;
+    if(!intersectCube(minimum, 1.f, enter, leave))
+        return INVALID;
+    StackEntry root = {0, 0, {0, 0, 0}, enter};
+    stack[stackSize++] = root;
+
+    while(stackSize > 0){
+        StackEntry entry = stack[--stackSize];
+        if(entry.level == level){
+            if(distance)
+                *distance = entry.enter;
+            return entry.node;
+        }
+
+        // Find the occupied children which are hit, and push them so that
+        // the closest one is popped first:
+        size_t inner = levelOffsets[entry.level] + entry.node;
+        uint32_t mask = childMasks[inner];
+        uint32_t child = firstChildren[inner];
+        float edge = std::ldexp(1.f, -int(entry.level + 1));
+        StackEntry hits[8];
+        int hitCount = 0;
+        for(uint32_t octant=0; octant < 8; ++octant){
+            if(!(mask & (1u << octant)))
+                continue;
+
+            StackEntry next = {child++, entry.level + 1,
+                               {2 * entry.cell[0] + (octant & 1), 2 * entry.cell[1] + ((octant >> 1) & 1),
+                                2 * entry.cell[2] + (octant >> 2)}, 0.f};
+            for(int d=0; d < 3; ++d)
+                minimum[d] = float(next.cell[d]) * edge;
+            if(!intersectCube(minimum, edge, next.enter, leave))
+                continue;
+
+            int position = hitCount++;
+            for(; position > 0 && hits[position - 1].enter < next.enter; --position)
+                hits[position] = hits[position - 1];
+            hits[position] = next;
+        }
+        for(int i=0; i < hitCount; ++i)
+            stack[stackSize++] = hits[i];
+    }
+    return INVALID;
+}
+
+void SparseVoxelOctree::intersectRayBatch(const Vec4f* origins, const Vec4f* directions, size_t count,
+                                          float maxDistance, size_t level, uint32_t* nodes, float* distances) const {
+    parallelFor(0, count, QUERY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            distances[i] = maxDistance;
+            nodes[i] = intersectRay(origins[i], directions[i], maxDistance, level, distances + i);
+        }
+    });
+}
+
+std::vector<Vec4f> SparseVoxelOctree::getNodeCenters(size_t level) const {
+    if(level >= levelOffsets.size() - 1)
+        return std::vector<Vec4f>();
+
+    // The cells of the nodes of every level follow from the cells of their
+    // parents and the child masks:
+    std::vector<uint32_t> cells(3, 0), children;
+    for(size_t l=0; l < level; ++l){
+        children.resize(3 * getNodeCount(l + 1));
+        parallelFor(0, getNodeCount(l), SVO_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t node=begin; node < end; ++node){
+                uint32_t mask = childMasks[levelOffsets[l] + node];
+                uint32_t child = firstChildren[levelOffsets[l] + node];
+                for(uint32_t octant=0; octant < 8; ++octant){
+                    if(!(mask & (1u << octant)))
+                        continue;
+                    for(int d=0; d < 3; ++d)
+                        children[3 * child + d] = 2 * cells[3 * node + d] + ((octant >> d) & 1);
+                    ++child;
+                }
+            }
+        });
+        cells.swap(children);
+    }
+
+    std::vector<Vec4f> centers(getNodeCount(level));
+    float edge = getNodeSize(level);
+    parallelFor(0, centers.size(), SVO_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t node=begin; node < end; ++node){
+            centers[node] = Vec4f(origin.x + (float(cells[3 * node]) + 0.5f) * edge,
+                                  origin.y + (float(cells[3 * node + 1]) + 0.5f) * edge,
+                                  origin.z + (float(cells[3 * node + 2]) + 0.5f) * edge);
+        }
+    });
+    return centers;
+}
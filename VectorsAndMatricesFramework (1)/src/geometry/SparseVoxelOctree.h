@@ -0,0 +1,163 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t, uint8_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors and boxes: */
+#include "../math/Vec4f.h"
+#include "../math/AABB.h"
+
+/**
+ * The maximum depth of a SparseVoxelOctree (the voxels of the deepest level
+ * are the cells of the 63 bit Morton codes, see Morton.h).
+ */
+#define SVO_MAX_DEPTH 21
+
+/**
+ * A sparse voxel octree which stores which voxels of a 2^depth x 2^depth x
+ * 2^depth grid contain at least one sample (for example the points of a
+ * scan), and how many. Only occupied voxels and their ancestors exist, so the
+ * memory grows with the surface of the scanned scene instead of its volume.
+ *
+ * The nodes are stored level by level (level 0 is the root cube, level
+ * 'depth' are the voxels), and the nodes of a level are sorted along the
+ * Morton curve. There are no pointers: an inner node stores an 8 bit mask of
+ * its occupied children and the index of its first child in the next level;
+ * its other children follow directly, so the child in octant o has the index
+ * firstChild + (number of set bits of the mask below o). A node costs 9 bytes
+ * (mask, first child and sample count), a voxel only 4 (its sample count).
+ *
+ * The octree is built bottom-up: the samples are sorted by their Morton codes
+ * with radixSort(...) (see Sorting.h), equal codes are merged into voxels,
+ * and every level is created from the next deeper one by merging the codes
+ * with equal prefixes (each in parallel by a chunked prefix sum, so the
+ * result does not depend on the number of threads).
+ *
+ * All queries are read-only, so any number of threads may query the octree
+ * at the same time.
+ */
+
+class SparseVoxelOctree
+{
+public:
+    /**
+     * The index which is returned if no node was found.
+     */
+    static const uint32_t INVALID = 0xffffffffu;
+
+    /**
+     * Constructs an empty octree.
+     */
+    SparseVoxelOctree();
+
+    /**
+     * Builds the octree of the given samples (only x, y and z are used) with
+     * the given depth (at most SVO_MAX_DEPTH). The root cube is the smallest
+     * cube around the bounding box of the samples which has the same center
+     * (enlarged by a factor of 1 + 10^-6, so that rounding errors cannot move
+     * the samples on its border outside).
+     *
+     * Throws std::invalid_argument if there are no samples, 2^32 or more
+     * samples, or if the depth is too large.
+     */
+    SparseVoxelOctree(const Vec4f* samples, size_t count, size_t depth);
+
+    /**
+     * Returns the depth (the level of the voxels).
+     */
+    size_t getDepth() const;
+
+    /**
+     * Returns the root cube.
+     */
+    AABB getBounds() const;
+
+    /**
+     * Returns the edge length of the nodes of the given level.
+     */
+    float getNodeSize(size_t level) const;
+
+    /**
+     * Returns the number of (occupied) nodes of the given level.
+     */
+    size_t getNodeCount(size_t level) const;
+
+    /**
+     * Returns the number of samples inside of the given node of the given
+     * level.
+     */
+    uint32_t getSampleCount(size_t level, uint32_t node) const;
+
+    /**
+     * Returns the number of bytes which are used by the nodes.
+     */
+    size_t getMemorySize() const;
+
+    /**
+     * Returns the index of the node of the given level which contains the
+     * given point, or INVALID if it is not occupied (or outside of the root
+     * cube). With level = getDepth(), this tests whether the voxel of the
+     * point is occupied.
+     */
+    uint32_t findNode(const Vec4f& point, size_t level) const;
+
+    /**
+     * Returns the index of the first occupied node of the given level which
+     * is hit by the ray origin + t * direction with 0 <= t <= maxDistance,
+     * or INVALID if there is none. If 'distance' is not nullptr, it receives
+     * the t at which the ray enters the node (0 if it starts inside).
+     *
+     * The children of every node are visited front to back, and empty
+     * children are skipped by their masks, so the cost grows with the number
+     * of occupied nodes close to the ray. A coarser level gives a faster
+     * query with a coarser result (for level of detail).
+     */
+    uint32_t intersectRay(const Vec4f& origin, const Vec4f& direction, float maxDistance, size_t level,
+                          float* distance = nullptr) const;
+
+    /**
+     * Calls intersectRay(...) for all given rays in parallel. 'nodes' and
+     * 'distances' must provide space for 'count' elements (rays without a
+     * hit get INVALID and maxDistance).
+     */
+    void intersectRayBatch(const Vec4f* origins, const Vec4f* directions, size_t count, float maxDistance,
+                           size_t level, uint32_t* nodes, float* distances) const;
+
+    /**
+     * Returns the centers of all nodes of the given level (w = 1), in the
+     * order of their indices. This is a level of detail of the samples, with
+     * one point per occupied cube of edge length getNodeSize(level); the
+     * number of samples of every point is given by getSampleCount(...).
+     */
+    std::vector<Vec4f> getNodeCenters(size_t level) const;
+
+private:
+    /** The minimum corner of the root cube */
+    Vec4f origin;
+
+    /** The edge length of the root cube */
+    float size;
+
+    /** The level of the voxels */
+    size_t depth;
+
+    /** The index of the first node of every level (and the total count) */
+    std::vector<size_t> levelOffsets;
+
+    /** The child mask of every inner node (bit o is set if octant o is occupied) */
+    std::vector<uint8_t> childMasks;
+
+    /** The index of the first child (in the next level) of every inner node */
+    std::vector<uint32_t> firstChildren;
+
+    /** The number of samples inside of every node */
+    std::vector<uint32_t> sampleCounts;
+};
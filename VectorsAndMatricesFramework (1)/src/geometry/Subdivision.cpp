@@ -0,0 +1,330 @@
+#include "Subdivision.h"
+#include "../math/Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of stencil rows or faces which are processed by one task: */
+const size_t STENCIL_GRAIN_SIZE = 4096;
+
+/* One weighted old vertex of a stencil: */
+struct StencilEntry {
+    uint32_t source;
+    float weight;
+
+    bool operator<(const StencilEntry& other) const {
+        return source < other.source;
+    }
+};
+
+/* Sorts the entries of a stencil by their source and merges equal sources: */
+void mergeEntries(std::vector<StencilEntry>& entries){
+    std::sort(entries.begin(), entries.end());
+    size_t count = 0;
+    for(size_t k=0; k < entries.size(); ++k){
+        if(count > 0 && entries[count - 1].source == entries[k].source)
+            entries[count - 1].weight += entries[k].weight;
+        else
+            entries[count++] = entries[k];
+    }
+    entries.resize(count);
+}
+
+/**
+ * Builds the stencils in parallel: rowFunction(row, entries) appends the
+ * (unmerged) entries of a row. Every chunk of rows is collected into its own
+ * buffers, which are then copied behind each other in the order of the rows.
+ */
+template<typename RowFunction>
+void buildStencils(size_t rowCount, const RowFunction& rowFunction, SubdivisionStencils& stencils){
+    size_t chunkCount = getChunkCount(rowCount, STENCIL_GRAIN_SIZE);
+    std::vector<std::vector<StencilEntry>> chunkEntries(chunkCount);
+    stencils.start.assign(rowCount + 1, 0);
+
+    parallelFor(0, rowCount, STENCIL_GRAIN_SIZE, [&](size_t begin, size_t end){
+        std::vector<StencilEntry>& collected = chunkEntries[begin / STENCIL_GRAIN_SIZE];
+        std::vector<StencilEntry> entries;
+        for(size_t row=begin; row < end; ++row){
+            entries.clear();
+            rowFunction(uint32_t(row), entries);
+            mergeEntries(entries);
+            stencils.start[row + 1] = uint32_t(entries.size());
+            collected.insert(collected.end(), entries.begin(), entries.end());
+        }
+    });
+
+    for(size_t row=0; row < rowCount; ++row)
+        stencils.start[row + 1] += stencils.start[row];
+
+    stencils.sources.resize(stencils.start[rowCount]);
+    stencils.weights.resize(stencils.start[rowCount]);
+    parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end){
+        for(size_t chunk=begin; chunk < end; ++chunk){
+            size_t offset = stencils.start[chunk * STENCIL_GRAIN_SIZE];
+            const std::vector<StencilEntry>& collected = chunkEntries[chunk];
+            for(size_t k=0; k < collected.size(); ++k){
+                stencils.sources[offset + k] = collected[k].source;
+                stencils.weights[offset + k] = collected[k].weight;
+            }
+        }
+    });
+}
+
+/* Returns one half-edge of every edge: */
+std::vector<uint32_t> findEdgeHalfEdges(const HalfEdgeMesh& mesh){
+    std::vector<uint32_t> edgeHalfEdges(mesh.edgeCount);
+    parallelFor(0, mesh.getHalfEdgeCount(), STENCIL_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t h=begin; h < end; ++h){
+            if(mesh.twins[h] == HalfEdgeMesh::INVALID || h < mesh.twins[h])
+                edgeHalfEdges[mesh.edges[h]] = uint32_t(h);
+        }
+    });
+    return edgeHalfEdges;
+}
+
+/**
+ * Collects the neighbours of a vertex (in the order of rotation). Returns
+ * false if the vertex is on a border; then 'borderNeighbours' contains the
+ * two neighbours along the border.
+ */
+bool collectNeighbours(const HalfEdgeMesh& mesh, uint32_t vertex, std::vector<uint32_t>& neighbours,
+                       uint32_t borderNeighbours[2]){
+    neighbours.clear();
+    uint32_t first = mesh.vertexHalfEdges[vertex];
+    uint32_t h = first;
+    while(true){
+        neighbours.push_back(mesh.target(h));
+        uint32_t incoming = mesh.previous(h);
+        if(mesh.twins[incoming] == HalfEdgeMesh::INVALID){
+            borderNeighbours[0] = mesh.target(first);
+            borderNeighbours[1] = mesh.origins[incoming];
+            neighbours.push_back(mesh.origins[incoming]);
+            return false;
+        }
+        h = mesh.twins[incoming];
+        if(h == first)
+            return true;
+    }
+}
+
+/* Appends the border rule (1/8, 3/4, 1/8) of a vertex: */
+void appendBorderVertex(uint32_t vertex, const uint32_t borderNeighbours[2], std::vector<StencilEntry>& entries){
+    StencilEntry border[3] = {{vertex, 0.75f}, {borderNeighbours[0], 0.125f}, {borderNeighbours[1], 0.125f}};
+    entries.insert(entries.end(), border, border + 3);
+}
+
+/* Builds the stencils of the Loop scheme: */
+void buildLoopStencils(const HalfEdgeMesh& mesh, const std::vector<uint32_t>& edgeHalfEdges,
+                       SubdivisionStencils& stencils){
+    uint32_t vertexCount = uint32_t(mesh.getVertexCount());
+    const float pi = 3.14159265358979f;
+
+    buildStencils(vertexCount + mesh.edgeCount, [&](uint32_t row, std::vector<StencilEntry>& entries){
+        if(row < vertexCount){
+            // Vertex rule: 1 - n * beta for the vertex and beta for each of
+            // its n neighbours (Loop's original weights):
+            if(mesh.vertexHalfEdges[row] == HalfEdgeMesh::INVALID){
+                entries.push_back(StencilEntry{row, 1.f});
+                return;
+            }
+
+            std::vector<uint32_t> neighbours;
+            uint32_t borderNeighbours[2];
+            if(!collectNeighbours(mesh, row, neighbours, borderNeighbours)){
+                appendBorderVertex(row, borderNeighbours, entries);
+                return;
+            }
+
+            float n = float(neighbours.size());
+            float c = 0.375f + 0.25f * std::cos(2.f * pi / n);
+            float beta = (0.625f - c * c) / n;
+            entries.push_back(StencilEntry{row, 1.f - n * beta});
+            for(uint32_t neighbour : neighbours)
+                entries.push_back(StencilEntry{neighbour, beta});
+        } else {
+            // Edge rule: 3/8 for both end points and 1/8 for both opposite
+            // vertices (1/2 and 1/2 on a border):
+            uint32_t h = edgeHalfEdges[row - vertexCount];
+            uint32_t twin = mesh.twins[h];
+            if(twin == HalfEdgeMesh::INVALID){
+                StencilEntry border[2] = {{mesh.origins[h], 0.5f}, {mesh.target(h), 0.5f}};
+                entries.insert(entries.end(), border, border + 2);
+                return;
+            }
+
+            StencilEntry inner[4] = {{mesh.origins[h], 0.375f}, {mesh.target(h), 0.375f},
+                                     {mesh.origins[mesh.previous(h)], 0.125f},
+                                     {mesh.origins[mesh.previous(twin)], 0.125f}};
+            entries.insert(entries.end(), inner, inner + 4);
+        }
+    }, stencils);
+}
+
+/* Appends the average of the vertices of a face, multiplied by 'weight': */
+void appendFace(const HalfEdgeMesh& mesh, uint32_t face, float weight, std::vector<StencilEntry>& entries){
+    float vertexWeight = weight / float(mesh.getFaceSize(face));
+    for(uint32_t h=mesh.faceStart[face]; h < mesh.faceStart[face + 1]; ++h)
+        entries.push_back(StencilEntry{mesh.origins[h], vertexWeight});
+}
+
+/* Builds the stencils of the Catmull-Clark scheme: */
+void buildCatmullClarkStencils(const HalfEdgeMesh& mesh, const std::vector<uint32_t>& edgeHalfEdges,
+                               SubdivisionStencils& stencils){
+    uint32_t vertexCount = uint32_t(mesh.getVertexCount());
+    uint32_t edgeCount = uint32_t(mesh.edgeCount);
+
+    buildStencils(vertexCount + edgeCount + mesh.getFaceCount(), [&](uint32_t row, std::vector<StencilEntry>& entries){
+        if(row < vertexCount){
+            // Vertex rule: (F + 2 R + (n - 3) P) / n, where F is the average
+            // of the n face points, R the average of the n edge midpoints
+            // and P the old vertex:
+            if(mesh.vertexHalfEdges[row] == HalfEdgeMesh::INVALID){
+                entries.push_back(StencilEntry{row, 1.f});
+                return;
+            }
+
+            std::vector<uint32_t> neighbours;
+            uint32_t borderNeighbours[2];
+            if(!collectNeighbours(mesh, row, neighbours, borderNeighbours)){
+                appendBorderVertex(row, borderNeighbours, entries);
+                return;
+            }
+
+            float n = float(neighbours.size());
+            float nn = n * n;
+            entries.push_back(StencilEntry{row, (n - 2.f) / n});
+            for(uint32_t neighbour : neighbours)
+                entries.push_back(StencilEntry{neighbour, 1.f / nn});
+
+            uint32_t h = mesh.vertexHalfEdges[row];
+            do {
+                appendFace(mesh, mesh.faces[h], 1.f / nn, entries);
+                h = mesh.rotateAroundOrigin(h);
+            } while(h != mesh.vertexHalfEdges[row]);
+        } else if(row < vertexCount + edgeCount){
+            // Edge rule: the average of both end points and both face points
+            // (the midpoint on a border):
+            uint32_t h = edgeHalfEdges[row - vertexCount];
+            uint32_t twin = mesh.twins[h];
+            if(twin == HalfEdgeMesh::INVALID){
+                StencilEntry border[2] = {{mesh.origins[h], 0.5f}, {mesh.target(h), 0.5f}};
+                entries.insert(entries.end(), border, border + 2);
+                return;
+            }
+
+            StencilEntry ends[2] = {{mesh.origins[h], 0.25f}, {mesh.target(h), 0.25f}};
+            entries.insert(entries.end(), ends, ends + 2);
+            appendFace(mesh, mesh.faces[h], 0.25f, entries);
+            appendFace(mesh, mesh.faces[twin], 0.25f, entries);
+        } else {
+            // Face rule: the average of the vertices of the face:
+            appendFace(mesh, row - vertexCount - edgeCount, 1.f, entries);
+        }
+    }, stencils);
+}
+
+}
+
+SubdivisionStencils::SubdivisionStencils()
+    : start(1, 0)
+{}
+
+size_t SubdivisionStencils::getRowCount() const{
+    return start.size() - 1;
+}
+
+void SubdivisionStencils::apply(const Vec4f* input, Vec4f* output) const{
+    parallelFor(0, getRowCount(), STENCIL_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t row=begin; row < end; ++row){
+            float x = 0.f, y = 0.f, z = 0.f, w = 0.f;
+            for(uint32_t k=start[row]; k < start[row + 1]; ++k){
+                const Vec4f& source = input[sources[k]];
+                float weight = weights[k];
+                x += weight * source.x;
+                y += weight * source.y;
+                z += weight * source.z;
+                w += weight * source.w;
+            }
+            output[row] = Vec4f(x, y, z, w);
+        }
+    });
+}
+
+SubdivisionStep subdivide(const HalfEdgeMesh& mesh, SubdivisionScheme scheme){
+    if(scheme == SubdivisionScheme::Loop && !mesh.isTriangleMesh())
+        throw std::invalid_argument("subdivide: the Loop scheme needs a triangle mesh.");
+
+    SubdivisionStep step;
+    std::vector<uint32_t> edgeHalfEdges = findEdgeHalfEdges(mesh);
+    uint32_t vertexCount = uint32_t(mesh.getVertexCount());
+    uint32_t edgeCount = uint32_t(mesh.edgeCount);
+    std::vector<uint32_t> indices;
+
+    if(scheme == SubdivisionScheme::Loop){
+        buildLoopStencils(mesh, edgeHalfEdges, step.stencils);
+
+        // Every triangle (a, b, c) is split at its edge vertices into three
+        // corner triangles and one center triangle:
+        indices.resize(12 * mesh.getFaceCount());
+        parallelFor(0, mesh.getFaceCount(), STENCIL_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t f=begin; f < end; ++f){
+                uint32_t h = mesh.faceStart[f];
+                uint32_t a = mesh.origins[h], b = mesh.origins[h + 1], c = mesh.origins[h + 2];
+                uint32_t ab = vertexCount + mesh.edges[h];
+                uint32_t bc = vertexCount + mesh.edges[h + 1];
+                uint32_t ca = vertexCount + mesh.edges[h + 2];
+                uint32_t triangles[12] = {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca};
+                std::copy(triangles, triangles + 12, indices.begin() + 12 * f);
+            }
+        });
+        step.mesh = HalfEdgeMesh(indices.data(), 4 * mesh.getFaceCount(), 3, vertexCount + edgeCount);
+    } else {
+        buildCatmullClarkStencils(mesh, edgeHalfEdges, step.stencils);
+
+        // Every corner of a face gets one quad (corner, edge vertex, face
+        // vertex, edge vertex), so quad h belongs to half-edge h:
+        indices.resize(4 * mesh.getHalfEdgeCount());
+        parallelFor(0, mesh.getHalfEdgeCount(), STENCIL_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t h=begin; h < end; ++h){
+                indices[4 * h] = mesh.origins[h];
+                indices[4 * h + 1] = vertexCount + mesh.edges[h];
+                indices[4 * h + 2] = vertexCount + edgeCount + mesh.faces[h];
+                indices[4 * h + 3] = vertexCount + mesh.edges[mesh.previous(uint32_t(h))];
+            }
+        });
+        step.mesh = HalfEdgeMesh(indices.data(), mesh.getHalfEdgeCount(), 4,
+                                 vertexCount + edgeCount + mesh.getFaceCount());
+    }
+
+    return step;
+}
+
+SubdivisionSurface::SubdivisionSurface(const HalfEdgeMesh& controlMesh, SubdivisionScheme scheme, unsigned int levelCount)
+    : controlMesh(controlMesh)
+{
+    steps.reserve(levelCount);
+    for(unsigned int level=0; level < levelCount; ++level)
+        steps.push_back(subdivide(level == 0 ? controlMesh : steps.back().mesh, scheme));
+}
+
+const HalfEdgeMesh& SubdivisionSurface::getFinestMesh() const{
+    return steps.empty() ? controlMesh : steps.back().mesh;
+}
+
+void SubdivisionSurface::evaluate(const std::vector<Vec4f>& controlPositions, std::vector<Vec4f>& positions) const{
+    if(controlPositions.size() != controlMesh.getVertexCount())
+        throw std::invalid_argument("SubdivisionSurface::evaluate: one position per control vertex is needed.");
+
+    // Alternate between two buffers, so that the last step writes into
+    // 'positions':
+    std::vector<Vec4f> scratch;
+    positions = controlPositions;
+    for(const SubdivisionStep& step : steps){
+        scratch.resize(step.stencils.getRowCount());
+        step.stencils.apply(positions.data(), scratch.data());
+        positions.swap(scratch);
+    }
+}
@@ -0,0 +1,148 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our Vec4f and the half-edge topology which is subdivided: */
+#include "../math/Vec4f.h"
+#include "HalfEdgeMesh.h"
+
+/**
+ * Subdivision surfaces: a coarse control mesh is refined step by step, and
+ * every step places each new vertex at a fixed weighted average of a few
+ * vertices of the previous step. The meshes converge to a smooth surface.
+ *
+ * Since the weights only depend on the topology, they are computed once per
+ * step as 'stencils' (a sparse matrix with one row per new vertex). When the
+ * control points move (animation, interactive editing), the new positions
+ * are just a sparse matrix-vector product per step, which runs in parallel
+ * and is much cheaper than subdividing again.
+ */
+
+/**
+ * The supported subdivision schemes.
+ */
+enum class SubdivisionScheme {
+    /**
+     * Loop subdivision (Loop, 1987) for triangle meshes: every triangle is
+     * split into four.
+     */
+    Loop,
+
+    /**
+     * Catmull-Clark subdivision (Catmull and Clark, 1978) for arbitrary
+     * polygon meshes: every face with k vertices is split into k quads, so
+     * after the first step the mesh only consists of quads.
+     */
+    CatmullClark
+};
+
+/**
+ * The weights of a subdivision step as a sparse matrix in the compressed row
+ * format: the new vertex r is the sum of weights[k] * (old vertex sources[k])
+ * for k = start[r], ..., start[r + 1] - 1. The weights of a row sum up to 1.
+ */
+
+class SubdivisionStencils
+{
+public:
+    /** The first entry of every row (rowCount + 1 entries) */
+    std::vector<uint32_t> start;
+
+    /** The old vertex of every entry */
+    std::vector<uint32_t> sources;
+
+    /** The weight of every entry */
+    std::vector<float> weights;
+
+    /**
+     * Constructs stencils without rows.
+     */
+    SubdivisionStencils();
+
+    /**
+     * Returns the number of rows (new vertices).
+     */
+    size_t getRowCount() const;
+
+    /**
+     * Computes all new vertices from the old ones (a parallel sparse
+     * matrix-vector product). 'output' must have space for getRowCount()
+     * vertices and must not overlap 'input'.
+     */
+    void apply(const Vec4f* input, Vec4f* output) const;
+};
+
+/**
+ * One subdivision step: the refined topology and the stencils which compute
+ * its vertices from the vertices of the coarser mesh.
+ *
+ * The new vertices are numbered as follows: first the vertices of the
+ * coarser mesh (at the same indices), then one vertex per edge, and for
+ * Catmull-Clark one vertex per face.
+ */
+
+class SubdivisionStep
+{
+public:
+    /** The topology of the refined mesh */
+    HalfEdgeMesh mesh;
+
+    /** The stencils of the refined vertices */
+    SubdivisionStencils stencils;
+};
+
+/**
+ * Computes one subdivision step of the given mesh. Both the topology and the
+ * stencils are computed in parallel.
+ *
+ * On borders, the usual rules for curves are used (the border of the refined
+ * mesh only depends on the border of the coarse mesh), so the border of the
+ * surface converges to a cubic B-spline through the border vertices.
+ *
+ * Throws std::invalid_argument if the Loop scheme is used on a mesh which
+ * does not only consist of triangles.
+ */
+SubdivisionStep subdivide(const HalfEdgeMesh& mesh, SubdivisionScheme scheme);
+
+/**
+ * A control mesh with a fixed number of subdivision steps, whose positions
+ * can be evaluated again and again for changing control points.
+ */
+
+class SubdivisionSurface
+{
+public:
+    /** The topology of the control mesh */
+    HalfEdgeMesh controlMesh;
+
+    /** The subdivision steps (the last one contains the finest mesh) */
+    std::vector<SubdivisionStep> steps;
+
+    /**
+     * Precomputes 'levelCount' subdivision steps of the given control mesh.
+     */
+    SubdivisionSurface(const HalfEdgeMesh& controlMesh, SubdivisionScheme scheme, unsigned int levelCount);
+
+    /**
+     * Returns the topology of the finest mesh (the control mesh if there are
+     * no steps).
+     */
+    const HalfEdgeMesh& getFinestMesh() const;
+
+    /**
+     * Computes the positions of the vertices of the finest mesh from the
+     * given positions of the control mesh by applying the stencils of all
+     * steps. Throws std::invalid_argument if the number of control points
+     * does not match the control mesh.
+     */
+    void evaluate(const std::vector<Vec4f>& controlPositions, std::vector<Vec4f>& positions) const;
+};
@@ -0,0 +1,13 @@
+#include "TriangleMesh.h"
+
+size_t TriangleMesh::getVertexCount() const{
+    return positions.size();
+}
+
+size_t TriangleMesh::getTriangleCount() const{
+    return indices.size() / 3;
+}
+
+bool TriangleMesh::hasNormals() const{
+    return !normals.empty() && normals.size() == positions.size();
+}
@@ -0,0 +1,56 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes fixed size integer types like uint32_t: */
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our Vec4f which is used for the vertex positions: */
+#include "../math/Vec4f.h"
+
+/**
+ * An indexed triangle mesh.
+ *
+ * The vertex positions are stored in the array 'positions' (points, w = 1),
+ * and every three consecutive entries in 'indices' define one triangle by
+ * the indices of its vertices. The vertices of a triangle are ordered
+ * counterclockwise when viewed from the outside.
+ *
+ * The vertex attributes are stored as a structure of arrays: the array
+ * 'normals' is either empty or contains one normal (w = 0) per vertex. This
+ * way passes which only need the positions (transformations, bounding
+ * volumes, ...) do not have to load the normals.
+ */
+
+class TriangleMesh
+{
+public:
+    /** The positions of all vertices */
+    std::vector<Vec4f> positions;
+
+    /** The normals of all vertices (or empty if the mesh has no normals) */
+    std::vector<Vec4f> normals;
+
+    /** Three vertex indices per triangle */
+    std::vector<uint32_t> indices;
+
+    /**
+     * Returns the number of vertices.
+     */
+    size_t getVertexCount() const;
+
+    /**
+     * Returns the number of triangles.
+     */
+    size_t getTriangleCount() const;
+
+    /**
+     * Returns whether the mesh has one normal per vertex.
+     */
+    bool hasNormals() const;
+};
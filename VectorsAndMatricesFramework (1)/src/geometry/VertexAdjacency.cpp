@@ -0,0 +1,29 @@
+#include "VertexAdjacency.h"
+
+#include <stdexcept>
+
+VertexAdjacency::VertexAdjacency()
+    : start(1, 0)
+{}
+
+VertexAdjacency::VertexAdjacency(const uint32_t* indices, size_t triangleCount, size_t vertexCount)
+    : start(vertexCount + 1, 0), corners(3 * triangleCount)
+{
+    // Count the corners of every vertex (counting sort):
+    for(size_t corner=0; corner < 3 * triangleCount; ++corner){
+        if(indices[corner] >= vertexCount)
+            throw std::invalid_argument("VertexAdjacency: index out of range.");
+        ++start[indices[corner] + 1];
+    }
+
+    for(size_t v=0; v < vertexCount; ++v)
+        start[v + 1] += start[v];
+
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    for(size_t corner=0; corner < 3 * triangleCount; ++corner)
+        corners[fill[indices[corner]]++] = uint32_t(corner);
+}
+
+size_t VertexAdjacency::getVertexCount() const{
+    return start.size() - 1;
+}
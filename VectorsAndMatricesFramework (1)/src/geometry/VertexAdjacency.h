@@ -0,0 +1,59 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/**
+ * The triangle corners around every vertex of an indexed triangle mesh, in
+ * compressed sparse row (CSR) form: the corners of vertex v are
+ *
+ *     corners[start[v]], ..., corners[start[v + 1] - 1]
+ *
+ * where a corner is stored as 3 * triangle + k (k = 0, 1, 2 is the position
+ * of the vertex in the triangle, so indices[corner] == v).
+ *
+ * With this structure, per-vertex values which depend on the triangles (like
+ * normals) can be computed by 'gathering' from the triangles of a vertex
+ * instead of 'scattering' from every triangle to its three vertices. Every
+ * vertex is then written by exactly one thread, so no atomics or locks are
+ * needed. The adjacency only depends on the index buffer, so it can be built
+ * once and reused as long as only the vertex positions change (e.g. for an
+ * animated mesh).
+ */
+
+class VertexAdjacency
+{
+public:
+    /** The first corner of every vertex (vertexCount + 1 entries) */
+    std::vector<uint32_t> start;
+
+    /** The corners of all vertices, sorted by vertex */
+    std::vector<uint32_t> corners;
+
+    /**
+     * Constructs an empty adjacency (without vertices).
+     */
+    VertexAdjacency();
+
+    /**
+     * Builds the adjacency of the given index buffer (three indices per
+     * triangle). Within a vertex, the corners are sorted by triangle.
+     *
+     * Throws std::invalid_argument if an index is not smaller than
+     * vertexCount.
+     */
+    VertexAdjacency(const uint32_t* indices, size_t triangleCount, size_t vertexCount);
+
+    /**
+     * Returns the number of vertices.
+     */
+    size_t getVertexCount() const;
+};
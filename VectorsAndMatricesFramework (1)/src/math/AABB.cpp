@@ -0,0 +1,45 @@
+#include "AABB.h"
+
+AABB::AABB()
+    : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX){}
+
+AABB::AABB(const Vec4f pMin, const Vec4f pMax)
+    : min(pMin.x, pMin.y, pMin.z), max(pMax.x, pMax.y, pMax.z){}
+
+bool AABB::isEmpty() const{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void AABB::extend(const Vec4f p){
+    min.x = std::fmin(min.x, p.x);
+    min.y = std::fmin(min.y, p.y);
+    min.z = std::fmin(min.z, p.z);
+
+    max.x = std::fmax(max.x, p.x);
+    max.y = std::fmax(max.y, p.y);
+    max.z = std::fmax(max.z, p.z);
+}
+
+void AABB::extend(const AABB& box){
+    // An empty box has min > max, so it does not change this box:
+    min.x = std::fmin(min.x, box.min.x);
+    min.y = std::fmin(min.y, box.min.y);
+    min.z = std::fmin(min.z, box.min.z);
+
+    max.x = std::fmax(max.x, box.max.x);
+    max.y = std::fmax(max.y, box.max.y);
+    max.z = std::fmax(max.z, box.max.z);
+}
+
+bool AABB::contains(const Vec4f p) const{
+    return p.x >= min.x && p.y >= min.y && p.z >= min.z
+        && p.x <= max.x && p.y <= max.y && p.z <= max.z;
+}
+
+Vec4f AABB::getCenter() const{
+    return Vec4f((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f, 1.f);
+}
+
+Vec4f AABB::getExtents() const{
+    return Vec4f((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f, 0.f);
+}
@@ -0,0 +1,69 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Include our Vec4f which is used for the corners of the box: */
+#include "Vec4f.h"
+
+/**
+ * An axis aligned bounding box (AABB), which is defined by its minimum and
+ * its maximum corner (both are points, so w = 1).
+ *
+ * A default constructed AABB is empty: its minimum is +FLT_MAX and its
+ * maximum is -FLT_MAX, so that extending it by any point results in a box
+ * which only contains this point.
+ */
+
+class AABB
+{
+public:
+    /** The corner with the smallest x, y and z coordinates */
+    Vec4f min;
+
+    /** The corner with the largest x, y and z coordinates */
+    Vec4f max;
+
+    /**
+     * Constructs an empty box.
+     */
+    AABB();
+
+    /**
+     * Constructs a box with the given minimum and maximum corner.
+     */
+    AABB(const Vec4f min, const Vec4f max);
+
+    /**
+     * Returns whether this box is empty (which means that it contains no
+     * point at all).
+     */
+    bool isEmpty() const;
+
+    /**
+     * Grows this box so that it contains the given point.
+     */
+    void extend(const Vec4f point);
+
+    /**
+     * Grows this box so that it contains the given box.
+     */
+    void extend(const AABB& box);
+
+    /**
+     * Returns whether the given point lies inside of this box (points on the
+     * boundary are inside).
+     */
+    bool contains(const Vec4f point) const;
+
+    /**
+     * Returns the center point of this box.
+     */
+    Vec4f getCenter() const;
+
+    /**
+     * Returns the half size of this box along each axis as a vector (w = 0).
+     */
+    Vec4f getExtents() const;
+};
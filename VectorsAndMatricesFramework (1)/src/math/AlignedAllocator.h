@@ -0,0 +1,75 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uintptr_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes ::operator new and std::bad_alloc: */
+#include <new>
+
+/**
+ * An allocator for std::vector which aligns the memory to 'Alignment' bytes
+ * (a power of two), for example to 64 bytes (one cache line, and the width
+ * of an AVX-512 register):
+ *
+ *     std::vector<float, AlignedAllocator<float, 64>> values(1000);
+ *
+ * Aligned data never straddles cache lines unnecessarily, and SIMD loads of
+ * aligned addresses are never split. The allocator reserves 'Alignment'
+ * additional bytes and stores the original pointer just before the aligned
+ * block, so it only needs the standard ::operator new.
+ */
+template<typename T, size_t Alignment>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator(){}
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&){}
+
+    /**
+     * Allocates memory for 'count' elements, aligned to 'Alignment' bytes.
+     */
+    T* allocate(size_t count){
+        static_assert(Alignment >= sizeof(void*) && (Alignment & (Alignment - 1)) == 0,
+                      "The alignment must be a power of two and hold a pointer.");
+
+        if(count > (size_t(-1) - Alignment) / sizeof(T))
+            throw std::bad_alloc();
+
+        char* original = static_cast<char*>(::operator new(count * sizeof(T) + Alignment));
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(original) + Alignment) & ~uintptr_t(Alignment - 1);
+        reinterpret_cast<char**>(aligned)[-1] = original;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    /**
+     * Frees memory which was returned by allocate(...).
+     */
+    void deallocate(T* pointer, size_t){
+        if(pointer)
+            ::operator delete(reinterpret_cast<char**>(pointer)[-1]);
+    }
+};
+
+template<typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&){
+    return true;
+}
+
+template<typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&){
+    return false;
+}
@@ -0,0 +1,357 @@
+#include "ConjugateGradient.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+/* The number of vector elements which are processed by one task: */
+const size_t VECTOR_GRAIN_SIZE = 16384;
+
+/* The number of partial sums of a dot product within a chunk: */
+const int DOT_LANES = 8;
+
+/* A linear map from one float array to another (non-overlapping) one: */
+typedef std::function<void(const float* input, float* output)> LinearMap;
+
+/**
+ * Returns the dot product of a and b. The chunks are summed in DOT_LANES
+ * interleaved partial sums (which the compiler vectorizes) and combined in
+ * double precision in a fixed order.
+ */
+double dot(const float* a, const float* b, size_t n){
+    return parallelReduce(size_t(0), n, VECTOR_GRAIN_SIZE, 0.0,
+        [&](size_t begin, size_t end){
+            float lanes[DOT_LANES] = {};
+            size_t i = begin;
+            for(; i + DOT_LANES <= end; i += DOT_LANES){
+                for(int l=0; l < DOT_LANES; ++l)
+                    lanes[l] += a[i + l] * b[i + l];
+            }
+            for(; i < end; ++i)
+                lanes[0] += a[i] * b[i];
+
+            double sum = 0.0;
+            for(int l=0; l < DOT_LANES; ++l)
+                sum += lanes[l];
+            return sum;
+        },
+        [](double s, double t){ return s + t; });
+}
+
+/**
+ * The incomplete Cholesky factorization L * L^T of a symmetric matrix, where
+ * L has the sparsity pattern of the lower triangle of the matrix. Its rows
+ * are stored in the CSR format with the diagonal as the last entry.
+ */
+class IncompleteCholesky
+{
+public:
+    explicit IncompleteCholesky(const SparseMatrix& A);
+
+    /* Computes z = (L * L^T)^-1 * r: */
+    void solve(const float* r, float* z) const;
+
+private:
+    std::vector<uint32_t> rowStart;
+    std::vector<uint32_t> columns;
+    std::vector<float> values;
+
+    bool factorize(const SparseMatrix& A, double shift);
+};
+
+IncompleteCholesky::IncompleteCholesky(const SparseMatrix& A){
+    // Copy the lower triangle (the columns are sorted, so the diagonal is
+    // the last entry of every row):
+    rowStart.assign(A.rowCount + 1, 0);
+    for(size_t r=0; r < A.rowCount; ++r){
+        for(uint32_t k=A.rowStart[r]; k < A.rowStart[r + 1] && A.columns[k] <= r; ++k)
+            columns.push_back(A.columns[k]);
+        if(columns.empty() || columns.back() != r)
+            throw std::invalid_argument("solveConjugateGradient: the matrix has a zero on its diagonal.");
+        rowStart[r + 1] = uint32_t(columns.size());
+    }
+    values.resize(columns.size());
+
+    // IC(0) can break down (a non-positive pivot) even for positive definite
+    // matrices; then the diagonal is enlarged step by step (Manteuffel, 1980):
+    double shift = 0.0;
+    while(!factorize(A, shift)){
+        shift = shift == 0.0 ? 1e-3 : 2.0 * shift;
+        if(shift > 1.0)
+            throw std::invalid_argument("solveConjugateGradient: the matrix is not positive definite.");
+    }
+}
+
+bool IncompleteCholesky::factorize(const SparseMatrix& A, double shift){
+    size_t n = rowStart.size() - 1;
+    for(size_t i=0; i < n; ++i){
+        uint32_t diagonal = rowStart[i + 1] - 1;
+        uint32_t source = A.rowStart[i];
+
+        for(uint32_t k=rowStart[i]; k <= diagonal; ++k){
+            uint32_t j = columns[k];
+            while(A.columns[source] != j)
+                ++source;
+
+            // The sparse dot product of the rows i and j of L left of column j:
+            double sum = A.values[source];
+            uint32_t a = rowStart[i], b = rowStart[j];
+            uint32_t aEnd = k, bEnd = rowStart[j + 1] - 1;
+            while(a < aEnd && b < bEnd){
+                if(columns[a] < columns[b])
+                    ++a;
+                else if(columns[b] < columns[a])
+                    ++b;
+                else
+                    sum -= double(values[a++]) * values[b++];
+            }
+
+            if(k < diagonal){
+                values[k] = float(sum / values[rowStart[j + 1] - 1]);
+            } else {
+                sum += shift * A.values[source];
+                if(!(sum > 0.0))
+                    return false;
+                values[k] = float(std::sqrt(sum));
+            }
+        }
+    }
+    return true;
+}
+
+void IncompleteCholesky::solve(const float* r, float* z) const{
+    size_t n = rowStart.size() - 1;
+
+    // Forward substitution with L:
+    for(size_t i=0; i < n; ++i){
+        float sum = r[i];
+        uint32_t diagonal = rowStart[i + 1] - 1;
+        for(uint32_t k=rowStart[i]; k < diagonal; ++k)
+            sum -= values[k] * z[columns[k]];
+        z[i] = sum / values[diagonal];
+    }
+
+    // Backward substitution with L^T (column by column):
+    for(size_t i=n; i-- > 0;){
+        uint32_t diagonal = rowStart[i + 1] - 1;
+        z[i] /= values[diagonal];
+        for(uint32_t k=rowStart[i]; k < diagonal; ++k)
+            z[columns[k]] -= values[k] * z[i];
+    }
+}
+
+/* Runs the preconditioned conjugate gradient method on arrays of n floats: */
+SolverResult runConjugateGradient(size_t n, const LinearMap& multiply, const LinearMap& precondition,
+                                  const float* b, float* x, const SolverSettings& settings){
+    SolverResult result;
+    result.iterations = 0;
+    result.relativeResidual = 0.f;
+    result.converged = true;
+
+    double bNorm = std::sqrt(dot(b, b, n));
+    if(bNorm == 0.0){
+        parallelFor(0, n, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i)
+                x[i] = 0.f;
+        });
+        return result;
+    }
+
+    std::vector<float> r(n), z(n), p(n), Ap(n);
+    multiply(x, Ap.data());
+    parallelFor(0, n, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i)
+            r[i] = b[i] - Ap[i];
+    });
+
+    double residual = std::sqrt(dot(r.data(), r.data(), n)) / bNorm;
+    precondition(r.data(), z.data());
+    p = z;
+    double rz = dot(r.data(), z.data(), n);
+
+    while(residual > settings.tolerance && result.iterations < settings.maxIterations){
+        multiply(p.data(), Ap.data());
+        double pAp = dot(p.data(), Ap.data(), n);
+        if(!(pAp > 0.0))
+            throw std::invalid_argument("solveConjugateGradient: the matrix is not positive definite.");
+
+        // Step along p and update the residual:
+        float alpha = float(rz / pAp);
+        parallelFor(0, n, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i){
+                x[i] += alpha * p[i];
+                r[i] -= alpha * Ap[i];
+            }
+        });
+        ++result.iterations;
+        residual = std::sqrt(dot(r.data(), r.data(), n)) / bNorm;
+        if(residual <= settings.tolerance)
+            break;
+
+        // The next direction is A-orthogonal to all previous ones:
+        precondition(r.data(), z.data());
+        double rzNext = dot(r.data(), z.data(), n);
+        float beta = float(rzNext / rz);
+        rz = rzNext;
+        parallelFor(0, n, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i)
+                p[i] = z[i] + beta * p[i];
+        });
+    }
+
+    result.relativeResidual = float(residual);
+    result.converged = residual <= settings.tolerance;
+    return result;
+}
+
+/* Returns the identity (no preconditioning): */
+LinearMap createIdentity(size_t n){
+    return [n](const float* r, float* z){
+        parallelFor(0, n, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i)
+                z[i] = r[i];
+        });
+    };
+}
+
+/* Inverts a 3 x 3 block (stored like in BlockSparseMatrix) into 'inverse': */
+void invertBlock(const float* block, float* inverse){
+    // a(i, j) = block[4 * j + i]:
+    double a[3][3];
+    for(int i=0; i < 3; ++i)
+        for(int j=0; j < 3; ++j)
+            a[i][j] = block[4 * j + i];
+
+    double c00 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+    double c01 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+    double c02 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+    double determinant = a[0][0] * c00 + a[0][1] * c01 + a[0][2] * c02;
+    if(!(std::fabs(determinant) > 0.0))
+        throw std::invalid_argument("solveConjugateGradient: a diagonal block of the matrix is singular.");
+
+    // The inverse is the transposed cofactor matrix divided by the determinant:
+    double adjugate[3][3] = {
+        {c00, a[0][2] * a[2][1] - a[0][1] * a[2][2], a[0][1] * a[1][2] - a[0][2] * a[1][1]},
+        {c01, a[0][0] * a[2][2] - a[0][2] * a[2][0], a[0][2] * a[1][0] - a[0][0] * a[1][2]},
+        {c02, a[0][1] * a[2][0] - a[0][0] * a[2][1], a[0][0] * a[1][1] - a[0][1] * a[1][0]}
+    };
+    for(int j=0; j < 3; ++j){
+        for(int i=0; i < 3; ++i)
+            inverse[4 * j + i] = float(adjugate[i][j] / determinant);
+        inverse[4 * j + 3] = 0.f;
+    }
+}
+
+}
+
+SolverSettings::SolverSettings()
+    : maxIterations(1000), tolerance(1e-6f), preconditioner(Preconditioner::Jacobi)
+{}
+
+SolverResult solveConjugateGradient(const SparseMatrix& A, const std::vector<float>& b, std::vector<float>& x,
+                                    const SolverSettings& settings){
+    if(A.rowCount != A.columnCount || b.size() != A.rowCount)
+        throw std::invalid_argument("solveConjugateGradient: the matrix must be square and match b.");
+    if(x.size() != A.rowCount)
+        x.assign(A.rowCount, 0.f);
+
+    size_t n = A.rowCount;
+    LinearMap multiply = [&A](const float* input, float* output){ A.multiply(input, output); };
+    LinearMap precondition;
+
+    if(settings.preconditioner == Preconditioner::Jacobi){
+        std::vector<float> inverseDiagonal = A.getDiagonal();
+        for(float& d : inverseDiagonal){
+            if(!(d > 0.f))
+                throw std::invalid_argument("solveConjugateGradient: the matrix is not positive definite.");
+            d = 1.f / d;
+        }
+        precondition = [n, inverseDiagonal](const float* r, float* z){
+            parallelFor(0, n, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+                for(size_t i=begin; i < end; ++i)
+                    z[i] = inverseDiagonal[i] * r[i];
+            });
+        };
+    } else if(settings.preconditioner == Preconditioner::IncompleteCholesky){
+        std::shared_ptr<IncompleteCholesky> factorization = std::make_shared<IncompleteCholesky>(A);
+        precondition = [factorization](const float* r, float* z){ factorization->solve(r, z); };
+    } else {
+        precondition = createIdentity(n);
+    }
+
+    return runConjugateGradient(n, multiply, precondition, b.data(), x.data(), settings);
+}
+
+SolverResult solveConjugateGradient(const BlockSparseMatrix& A, const std::vector<Vec4f>& b, std::vector<Vec4f>& x,
+                                    const SolverSettings& settings){
+    static_assert(sizeof(Vec4f) == 4 * sizeof(float), "Vec4f must consist of four floats.");
+
+    if(A.blockRowCount != A.blockColumnCount || b.size() != A.blockRowCount)
+        throw std::invalid_argument("solveConjugateGradient: the matrix must be square and match b.");
+    if(x.size() != A.blockRowCount)
+        x.assign(A.blockRowCount, Vec4f(0.f, 0.f, 0.f, 0.f));
+
+    // The Vec4f arrays are treated as float arrays whose every fourth
+    // element (w) is 0, which does not change any dot product:
+    size_t blockCount = A.blockRowCount;
+    size_t n = 4 * blockCount;
+    std::vector<Vec4f> rightSide(b);
+    for(size_t i=0; i < blockCount; ++i){
+        rightSide[i].w = 0.f;
+        x[i].w = 0.f;
+    }
+
+    LinearMap multiply = [&A](const float* input, float* output){
+        A.multiply(reinterpret_cast<const Vec4f*>(input), reinterpret_cast<Vec4f*>(output));
+    };
+    LinearMap precondition;
+
+    if(settings.preconditioner == Preconditioner::Jacobi){
+        // Block Jacobi with the inverse 3 x 3 diagonal blocks:
+        std::vector<float> inverseBlocks(12 * blockCount, 0.f);
+        for(size_t r=0; r < blockCount; ++r){
+            uint32_t k = A.rowStart[r];
+            while(k < A.rowStart[r + 1] && A.columns[k] < r)
+                ++k;
+            if(k == A.rowStart[r + 1] || A.columns[k] != r)
+                throw std::invalid_argument("solveConjugateGradient: the matrix has a zero block on its diagonal.");
+            invertBlock(A.blocks.data() + 12 * size_t(k), inverseBlocks.data() + 12 * r);
+        }
+        precondition = [blockCount, inverseBlocks](const float* r, float* z){
+            parallelFor(0, blockCount, VECTOR_GRAIN_SIZE, [&](size_t begin, size_t end){
+                for(size_t i=begin; i < end; ++i){
+                    const float* block = inverseBlocks.data() + 12 * i;
+                    for(int l=0; l < 4; ++l)
+                        z[4 * i + l] = block[l] * r[4 * i] + block[4 + l] * r[4 * i + 1] + block[8 + l] * r[4 * i + 2];
+                }
+            });
+        };
+    } else if(settings.preconditioner == Preconditioner::IncompleteCholesky){
+        // IC(0) of the scalar matrix, with the w components removed:
+        std::shared_ptr<IncompleteCholesky> factorization = std::make_shared<IncompleteCholesky>(A.toSparseMatrix());
+        std::shared_ptr<std::vector<float>> packed = std::make_shared<std::vector<float>>(6 * blockCount);
+        precondition = [blockCount, factorization, packed](const float* r, float* z){
+            float* packedR = packed->data();
+            float* packedZ = packed->data() + 3 * blockCount;
+            for(size_t i=0; i < blockCount; ++i){
+                for(int l=0; l < 3; ++l)
+                    packedR[3 * i + l] = r[4 * i + l];
+            }
+            factorization->solve(packedR, packedZ);
+            for(size_t i=0; i < blockCount; ++i){
+                for(int l=0; l < 3; ++l)
+                    z[4 * i + l] = packedZ[3 * i + l];
+                z[4 * i + 3] = 0.f;
+            }
+        };
+    } else {
+        precondition = createIdentity(n);
+    }
+
+    return runConjugateGradient(n, multiply, precondition, reinterpret_cast<const float*>(rightSide.data()),
+                                reinterpret_cast<float*>(x.data()), settings);
+}
@@ -0,0 +1,108 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include the sparse matrices and our Vec4f: */
+#include "SparseMatrix.h"
+#include "Vec4f.h"
+
+/**
+ * The preconditioners of solveConjugateGradient(...). A preconditioner is a
+ * cheap approximation of the inverse matrix; the better it is, the fewer
+ * iterations are needed.
+ */
+enum class Preconditioner {
+    /** No preconditioning */
+    None,
+
+    /**
+     * Jacobi: divides by the diagonal (by the inverse 3 x 3 diagonal blocks
+     * for block matrices). Cheap and fully parallel.
+     */
+    Jacobi,
+
+    /**
+     * Incomplete Cholesky factorization without fill-in (IC(0)): L * L^T
+     * with the sparsity pattern of the matrix. Usually needs two to three
+     * times fewer iterations than Jacobi, but its two triangular solves per
+     * iteration are sequential, so Jacobi is often faster on many threads.
+     */
+    IncompleteCholesky
+};
+
+/**
+ * The parameters of solveConjugateGradient(...).
+ */
+
+class SolverSettings
+{
+public:
+    /** The maximum number of iterations (default 1000) */
+    size_t maxIterations;
+
+    /**
+     * The solver stops when |b - A * x| <= tolerance * |b| (default 1e-6).
+     * Note that float precision limits the reachable tolerance to about
+     * 1e-7 times the condition number of the matrix.
+     */
+    float tolerance;
+
+    /** The preconditioner (default Jacobi) */
+    Preconditioner preconditioner;
+
+    /**
+     * Constructs the default settings.
+     */
+    SolverSettings();
+};
+
+/**
+ * The outcome of solveConjugateGradient(...).
+ */
+
+class SolverResult
+{
+public:
+    /** The number of iterations which were performed */
+    size_t iterations;
+
+    /** The final relative residual |b - A * x| / |b| */
+    float relativeResidual;
+
+    /** Whether the tolerance was reached */
+    bool converged;
+};
+
+/**
+ * Solves A * x = b for a symmetric positive definite matrix A with the
+ * preconditioned conjugate gradient method (Hestenes and Stiefel, 1952). The
+ * given x is used as the initial guess (it is resized and set to 0 if it has
+ * the wrong size).
+ *
+ * Every iteration needs one matrix-vector product, one application of the
+ * preconditioner, two dot products and three vector updates, which all run
+ * in parallel (the dot products with a fixed summation order, so the result
+ * does not depend on the number of threads).
+ *
+ * Throws std::invalid_argument if the sizes do not match, or if the matrix
+ * turns out not to be positive definite (a non-positive diagonal, or a
+ * direction p with p^T * A * p <= 0).
+ */
+SolverResult solveConjugateGradient(const SparseMatrix& A, const std::vector<float>& b, std::vector<float>& x,
+                                    const SolverSettings& settings);
+
+/**
+ * Solves A * x = b for a symmetric positive definite block matrix (see
+ * above), where b and x have one Vec4f per block row. The w of b is ignored,
+ * and the w of the solution is 0.
+ */
+SolverResult solveConjugateGradient(const BlockSparseMatrix& A, const std::vector<Vec4f>& b, std::vector<Vec4f>& x,
+                                    const SolverSettings& settings);
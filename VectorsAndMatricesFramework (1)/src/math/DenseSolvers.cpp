@@ -0,0 +1,433 @@
+#include "DenseSolvers.h"
+#include "FloatLanes.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of columns of a panel (LU) or diagonal block (Cholesky): */
+const size_t FACTORIZATION_BLOCK_SIZE = 64;
+
+/* The number of columns (or right sides) which are processed by one task: */
+const size_t COLUMN_GRAIN_SIZE = 16;
+
+/* The number of rows which are processed by one task: */
+const size_t ROW_GRAIN_SIZE = 256;
+
+/* The number of 4x4 batches (of FLOAT_LANES systems) per task: */
+const size_t BATCH_GRAIN_SIZE = 256;
+
+/* Returns the largest absolute entry of the matrix (or of its diagonal): */
+float computeMaxAbs(const MatrixXf& A, bool diagonalOnly){
+    size_t n = A.getColumnCount();
+    return parallelReduce(size_t(0), n, COLUMN_GRAIN_SIZE, 0.f,
+        [&](size_t begin, size_t end){
+            float result = 0.f;
+            for(size_t j=begin; j < end; ++j){
+                if(diagonalOnly){
+                    result = std::max(result, std::fabs(A(j, j)));
+                } else {
+                    const float* column = A.getData() + j * A.getStride();
+                    for(size_t i=0; i < A.getRowCount(); ++i)
+                        result = std::max(result, std::fabs(column[i]));
+                }
+            }
+            return result;
+        },
+        [](float a, float b){ return std::max(a, b); });
+}
+
+}
+
+LUFactorization::LUFactorization(const MatrixXf& A)
+    : lu(A), permutation(A.getRowCount()), status(FactorizationStatus::Success),
+      failedColumn(A.getRowCount()), permutationSign(1)
+{
+    if(A.getRowCount() != A.getColumnCount())
+        throw std::invalid_argument("LUFactorization: the matrix is not square.");
+
+    size_t n = A.getRowCount();
+    for(size_t i=0; i < n; ++i)
+        permutation[i] = uint32_t(i);
+
+    float threshold = float(n) * FLT_EPSILON * computeMaxAbs(A, false);
+    float* a = lu.getData();
+    size_t s = lu.getStride();
+
+    for(size_t k0=0; k0 < n; k0 += FACTORIZATION_BLOCK_SIZE){
+        size_t nb = std::min(FACTORIZATION_BLOCK_SIZE, n - k0);
+        size_t pivots[FACTORIZATION_BLOCK_SIZE];
+
+        // Factorize the panel (columns k0, ..., k0 + nb - 1) column by column:
+        for(size_t j=k0; j < k0 + nb; ++j){
+            float* column = a + j * s;
+
+            // The pivot is the (first) largest entry on or below the diagonal:
+            size_t pivot = j;
+            for(size_t r=j + 1; r < n; ++r){
+                if(std::fabs(column[r]) > std::fabs(column[pivot]))
+                    pivot = r;
+            }
+            pivots[j - k0] = pivot;
+
+            if(!(std::fabs(column[pivot]) > threshold)){
+                status = FactorizationStatus::Singular;
+                failedColumn = j;
+                return;
+            }
+
+            if(pivot != j){
+                for(size_t c=k0; c < k0 + nb; ++c)
+                    std::swap(a[c * s + j], a[c * s + pivot]);
+                std::swap(permutation[j], permutation[pivot]);
+                permutationSign = -permutationSign;
+            }
+
+            // Compute the column of L and update the rest of the panel:
+            float inverse = 1.f / column[j];
+            for(size_t r=j + 1; r < n; ++r)
+                column[r] *= inverse;
+
+            for(size_t c=j + 1; c < k0 + nb; ++c){
+                float* target = a + c * s;
+                float factor = target[j];
+                for(size_t r=j + 1; r < n; ++r)
+                    target[r] -= column[r] * factor;
+            }
+        }
+
+        // Apply the row swaps of the panel to all other columns:
+        parallelFor(0, n - nb, COLUMN_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t index=begin; index < end; ++index){
+                float* column = a + (index < k0 ? index : index + nb) * s;
+                for(size_t j=0; j < nb; ++j)
+                    std::swap(column[k0 + j], column[pivots[j]]);
+            }
+        });
+
+        if(k0 + nb == n)
+            break;
+
+        // U12 = L11^-1 * A12 (forward substitution, column by column):
+        parallelFor(k0 + nb, n, COLUMN_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t c=begin; c < end; ++c){
+                float* column = a + c * s + k0;
+                for(size_t i=0; i < nb; ++i){
+                    const float* l = a + (k0 + i) * s + k0;
+                    for(size_t r=i + 1; r < nb; ++r)
+                        column[r] -= l[r] * column[i];
+                }
+            }
+        });
+
+        // A22 -= L21 * U12 (on all threads):
+        size_t m = n - k0 - nb;
+        multiply(m, m, nb, -1.f, a + k0 * s + k0 + nb, s, a + (k0 + nb) * s + k0, s,
+                 1.f, a + (k0 + nb) * s + k0 + nb, s);
+    }
+}
+
+FactorizationStatus LUFactorization::getStatus() const{
+    return status;
+}
+
+size_t LUFactorization::getFailedColumn() const{
+    return failedColumn;
+}
+
+const MatrixXf& LUFactorization::getLU() const{
+    return lu;
+}
+
+const std::vector<uint32_t>& LUFactorization::getPermutation() const{
+    return permutation;
+}
+
+double LUFactorization::getDeterminant() const{
+    if(status != FactorizationStatus::Success)
+        return 0.0;
+
+    double determinant = permutationSign;
+    for(size_t i=0; i < lu.getRowCount(); ++i)
+        determinant *= lu(i, i);
+    return determinant;
+}
+
+MatrixXf LUFactorization::solve(const MatrixXf& B) const{
+    size_t n = lu.getRowCount();
+    if(B.getRowCount() != n)
+        throw std::invalid_argument("LUFactorization::solve: the size of the right side does not match.");
+    if(status != FactorizationStatus::Success)
+        throw std::invalid_argument("LUFactorization::solve: the matrix is singular.");
+
+    MatrixXf X(n, B.getColumnCount());
+    const float* a = lu.getData();
+    size_t s = lu.getStride();
+
+    parallelFor(0, B.getColumnCount(), COLUMN_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t c=begin; c < end; ++c){
+            float* x = X.getData() + c * X.getStride();
+            for(size_t i=0; i < n; ++i)
+                x[i] = B(permutation[i], c);
+
+            // Forward substitution with L (ones on the diagonal):
+            for(size_t j=0; j < n; ++j){
+                const float* column = a + j * s;
+                for(size_t r=j + 1; r < n; ++r)
+                    x[r] -= column[r] * x[j];
+            }
+
+            // Backward substitution with U:
+            for(size_t j=n; j-- > 0;){
+                const float* column = a + j * s;
+                x[j] /= column[j];
+                for(size_t r=0; r < j; ++r)
+                    x[r] -= column[r] * x[j];
+            }
+        }
+    });
+
+    return X;
+}
+
+std::vector<float> LUFactorization::solve(const std::vector<float>& b) const{
+    MatrixXf B(b.size(), 1);
+    std::copy(b.begin(), b.end(), B.getData());
+    MatrixXf X = solve(B);
+    return std::vector<float>(X.getData(), X.getData() + b.size());
+}
+
+CholeskyFactorization::CholeskyFactorization(const MatrixXf& A)
+    : l(A), status(FactorizationStatus::Success), failedColumn(A.getRowCount())
+{
+    if(A.getRowCount() != A.getColumnCount())
+        throw std::invalid_argument("CholeskyFactorization: the matrix is not square.");
+
+    size_t n = A.getRowCount();
+    float threshold = float(n) * FLT_EPSILON * computeMaxAbs(A, true);
+    float* a = l.getData();
+    size_t s = l.getStride();
+    std::vector<float> transposed;
+
+    for(size_t k0=0; k0 < n; k0 += FACTORIZATION_BLOCK_SIZE){
+        size_t nb = std::min(FACTORIZATION_BLOCK_SIZE, n - k0);
+
+        // Factorize the diagonal block L11 (lower triangle only):
+        for(size_t j=k0; j < k0 + nb; ++j){
+            float* column = a + j * s;
+            if(!(column[j] > threshold)){
+                status = FactorizationStatus::NotPositiveDefinite;
+                failedColumn = j;
+                return;
+            }
+
+            column[j] = std::sqrt(column[j]);
+            float inverse = 1.f / column[j];
+            for(size_t r=j + 1; r < k0 + nb; ++r)
+                column[r] *= inverse;
+
+            for(size_t c=j + 1; c < k0 + nb; ++c){
+                float* target = a + c * s;
+                float factor = column[c];
+                for(size_t r=c; r < k0 + nb; ++r)
+                    target[r] -= column[r] * factor;
+            }
+        }
+
+        if(k0 + nb == n)
+            break;
+
+        // L21 = A21 * L11^-T (in parallel over blocks of rows):
+        parallelFor(k0 + nb, n, ROW_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t j=0; j < nb; ++j){
+                float* column = a + (k0 + j) * s;
+                for(size_t p=0; p < j; ++p){
+                    const float* previous = a + (k0 + p) * s;
+                    float factor = previous[k0 + j];
+                    for(size_t r=begin; r < end; ++r)
+                        column[r] -= previous[r] * factor;
+                }
+
+                float inverse = 1.f / column[k0 + j];
+                for(size_t r=begin; r < end; ++r)
+                    column[r] *= inverse;
+            }
+        });
+
+        // A22 -= L21 * L21^T, where only the block columns of the lower
+        // triangle are computed (with a transposed copy of L21 as right
+        // factor):
+        size_t m = n - k0 - nb;
+        const float* l21 = a + k0 * s + k0 + nb;
+        transposed.resize(nb * m);
+        parallelFor(0, m, ROW_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t c=begin; c < end; ++c){
+                for(size_t p=0; p < nb; ++p)
+                    transposed[c * nb + p] = l21[p * s + c];
+            }
+        });
+
+        const size_t width = 4 * FACTORIZATION_BLOCK_SIZE;
+        for(size_t jb=0; jb < m; jb += width){
+            size_t w = std::min(width, m - jb);
+            multiply(m - jb, w, nb, -1.f, l21 + jb, s, transposed.data() + jb * nb, nb,
+                     1.f, a + (k0 + nb + jb) * s + k0 + nb + jb, s);
+        }
+    }
+
+    // Clear the upper triangle (it still contains A and intermediate values):
+    parallelFor(1, n, COLUMN_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t c=begin; c < end; ++c)
+            std::fill(a + c * s, a + c * s + c, 0.f);
+    });
+}
+
+FactorizationStatus CholeskyFactorization::getStatus() const{
+    return status;
+}
+
+size_t CholeskyFactorization::getFailedColumn() const{
+    return failedColumn;
+}
+
+const MatrixXf& CholeskyFactorization::getL() const{
+    return l;
+}
+
+MatrixXf CholeskyFactorization::solve(const MatrixXf& B) const{
+    size_t n = l.getRowCount();
+    if(B.getRowCount() != n)
+        throw std::invalid_argument("CholeskyFactorization::solve: the size of the right side does not match.");
+    if(status != FactorizationStatus::Success)
+        throw std::invalid_argument("CholeskyFactorization::solve: the matrix is not positive definite.");
+
+    MatrixXf X(B);
+    const float* a = l.getData();
+    size_t s = l.getStride();
+
+    parallelFor(0, B.getColumnCount(), COLUMN_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t c=begin; c < end; ++c){
+            float* x = X.getData() + c * X.getStride();
+
+            // Forward substitution with L:
+            for(size_t j=0; j < n; ++j){
+                const float* column = a + j * s;
+                x[j] /= column[j];
+                for(size_t r=j + 1; r < n; ++r)
+                    x[r] -= column[r] * x[j];
+            }
+
+            // Backward substitution with L^T (a column of L is a row of L^T):
+            for(size_t j=n; j-- > 0;){
+                const float* column = a + j * s;
+                float sum = x[j];
+                for(size_t r=j + 1; r < n; ++r)
+                    sum -= column[r] * x[r];
+                x[j] = sum / column[j];
+            }
+        }
+    });
+
+    return X;
+}
+
+std::vector<float> CholeskyFactorization::solve(const std::vector<float>& b) const{
+    MatrixXf B(b.size(), 1);
+    std::copy(b.begin(), b.end(), B.getData());
+    MatrixXf X = solve(B);
+    return std::vector<float>(X.getData(), X.getData() + b.size());
+}
+
+size_t solveBatch4x4(const Mat4f* matrices, const Vec4f* rightSides, Vec4f* solutions, size_t count,
+                     FactorizationStatus* statuses){
+    size_t batchCount = getChunkCount(count, FLOAT_LANES);
+
+    return parallelReduce(size_t(0), batchCount, BATCH_GRAIN_SIZE, size_t(0),
+        [&](size_t begin, size_t end){
+            size_t singularCount = 0;
+            for(size_t batch=begin; batch < end; ++batch){
+                size_t first = batch * FLOAT_LANES;
+                size_t lanes = std::min(size_t(FLOAT_LANES), count - first);
+
+                // Load the systems (row i, column j); unused lanes get the
+                // identity:
+                FloatLanes a[4][4], b[4];
+                for(int l=0; l < FLOAT_LANES; ++l){
+                    bool used = size_t(l) < lanes;
+                    for(int i=0; i < 4; ++i){
+                        for(int j=0; j < 4; ++j)
+                            a[i][j].v[l] = used ? matrices[first + l].data[j * 4 + i] : (i == j ? 1.f : 0.f);
+                    }
+                    b[0].v[l] = used ? rightSides[first + l].x : 0.f;
+                    b[1].v[l] = used ? rightSides[first + l].y : 0.f;
+                    b[2].v[l] = used ? rightSides[first + l].z : 0.f;
+                    b[3].v[l] = used ? rightSides[first + l].w : 0.f;
+                }
+
+                FloatLanes maxAbs = broadcast(0.f);
+                for(int i=0; i < 4; ++i){
+                    for(int j=0; j < 4; ++j)
+                        maxAbs = maximum(maxAbs, abs(a[i][j]));
+                }
+                FloatLanes threshold = maxAbs * (4.f * FLT_EPSILON);
+                FloatLanes one = broadcast(1.f), zero = broadcast(0.f);
+
+                // Gaussian elimination with branchless partial pivoting: row k
+                // is swapped with every row below whose entry in column k is
+                // larger, so it ends up with the largest one:
+                FloatLanes singular = zero;
+                FloatLanes inversePivots[4];
+                for(int k=0; k < 4; ++k){
+                    for(int r=k + 1; r < 4; ++r){
+                        LaneMask swap = abs(a[r][k]) > abs(a[k][k]);
+                        for(int j=k; j < 4; ++j){
+                            FloatLanes upper = a[k][j];
+                            a[k][j] = select(swap, a[r][j], upper);
+                            a[r][j] = select(swap, upper, a[r][j]);
+                        }
+                        FloatLanes upper = b[k];
+                        b[k] = select(swap, b[r], upper);
+                        b[r] = select(swap, upper, b[r]);
+                    }
+
+                    LaneMask valid = abs(a[k][k]) > threshold;
+                    singular = select(valid, singular, one);
+                    inversePivots[k] = one / select(valid, a[k][k], one);
+
+                    for(int r=k + 1; r < 4; ++r){
+                        FloatLanes factor = a[r][k] * inversePivots[k];
+                        for(int j=k + 1; j < 4; ++j)
+                            a[r][j] = a[r][j] - factor * a[k][j];
+                        b[r] = b[r] - factor * b[k];
+                    }
+                }
+
+                // Backward substitution:
+                FloatLanes x[4];
+                for(int k=3; k >= 0; --k){
+                    FloatLanes sum = b[k];
+                    for(int j=k + 1; j < 4; ++j)
+                        sum = sum - a[k][j] * x[j];
+                    x[k] = sum * inversePivots[k];
+                }
+
+                LaneMask failed = singular > zero;
+                for(int k=0; k < 4; ++k)
+                    x[k] = select(failed, zero, x[k]);
+
+                for(size_t l=0; l < lanes; ++l){
+                    solutions[first + l] = Vec4f(x[0].v[l], x[1].v[l], x[2].v[l], x[3].v[l]);
+                    if(failed.v[l])
+                        ++singularCount;
+                    if(statuses)
+                        statuses[first + l] = failed.v[l] ? FactorizationStatus::Singular : FactorizationStatus::Success;
+                }
+            }
+            return singularCount;
+        },
+        [](size_t s, size_t t){ return s + t; });
+}
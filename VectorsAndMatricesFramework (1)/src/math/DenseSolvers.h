@@ -0,0 +1,197 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our matrices and vectors: */
+#include "MatrixXf.h"
+#include "Mat4f.h"
+#include "Vec4f.h"
+
+/**
+ * This file contains direct solvers for dense linear systems A * x = b: the
+ * LU factorization for general square matrices, the Cholesky factorization
+ * for symmetric positive definite matrices (about twice as fast), and a
+ * batched solver for many small 4x4 systems.
+ *
+ * A failed factorization is not an exception, but a status which can be
+ * checked (numerical problems are expected input for many callers, like the
+ * solver of a degenerate least squares fit). The status is deterministic: it
+ * names the first column in which the factorization failed, independent of
+ * the number of threads. Only solving with a failed factorization, and
+ * invalid arguments (like non-square matrices), throw std::invalid_argument.
+ */
+
+/**
+ * The outcome of a factorization or a small solve.
+ */
+enum class FactorizationStatus {
+    /** The factorization succeeded */
+    Success,
+
+    /**
+     * The matrix is singular in float precision: a pivot was not larger than
+     * n * FLT_EPSILON times the largest absolute entry of the n x n matrix
+     */
+    Singular,
+
+    /**
+     * The matrix is not (numerically) positive definite: a diagonal element
+     * of the Cholesky factorization was not larger than n * FLT_EPSILON times
+     * the largest diagonal entry of the n x n matrix
+     */
+    NotPositiveDefinite
+};
+
+/**
+ * The LU factorization P * A = L * U with partial pivoting of a square matrix,
+ * where P is a permutation, L is lower triangular with ones on the diagonal
+ * and U is upper triangular.
+ *
+ * The factorization is blocked (like LAPACK's getrf): a panel of
+ * FACTORIZATION_BLOCK_SIZE columns is factorized with partial pivoting, the
+ * row swaps and a triangular solve are applied to the columns on its right
+ * (in parallel, column by column), and the remaining 'trailing' matrix is
+ * updated with one large matrix multiplication A22 -= L21 * U12, which runs
+ * on all threads with the packed GEMM of MatrixXf. This update contains
+ * almost all of the 2/3 n^3 operations.
+ */
+
+class LUFactorization
+{
+public:
+    /**
+     * Factorizes the given square matrix. Throws std::invalid_argument if it
+     * is not square.
+     */
+    explicit LUFactorization(const MatrixXf& A);
+
+    /**
+     * Returns whether the factorization succeeded or the matrix is singular.
+     */
+    FactorizationStatus getStatus() const;
+
+    /**
+     * Returns the first column whose pivot was too small (or the size of the
+     * matrix if the factorization succeeded).
+     */
+    size_t getFailedColumn() const;
+
+    /**
+     * Returns L (below the diagonal) and U (on and above the diagonal) in one
+     * matrix (only complete if the factorization succeeded).
+     */
+    const MatrixXf& getLU() const;
+
+    /**
+     * Returns the row permutation: row i of P * A is row permutation[i] of A.
+     */
+    const std::vector<uint32_t>& getPermutation() const;
+
+    /**
+     * Returns the determinant of A (0 if the factorization failed).
+     */
+    double getDeterminant() const;
+
+    /**
+     * Solves A * X = B for all columns of B at once (in parallel). Throws
+     * std::invalid_argument if the size does not match or the matrix is
+     * singular.
+     */
+    MatrixXf solve(const MatrixXf& B) const;
+
+    /**
+     * Solves A * x = b.
+     */
+    std::vector<float> solve(const std::vector<float>& b) const;
+
+private:
+    MatrixXf lu;
+    std::vector<uint32_t> permutation;
+    FactorizationStatus status;
+    size_t failedColumn;
+    int permutationSign;
+};
+
+/**
+ * The Cholesky factorization A = L * L^T of a symmetric positive definite
+ * matrix (for example the normal equations J^T * J of a least squares fit),
+ * where L is lower triangular. Only the lower triangle of A is read.
+ *
+ * It needs no pivoting and half of the operations of the LU factorization.
+ * It is blocked like LUFactorization: the diagonal block is factorized, the
+ * block below it is solved in parallel, and the trailing matrix is updated
+ * with A22 -= L21 * L21^T using the parallel GEMM (only the block columns of
+ * the lower triangle are computed).
+ */
+
+class CholeskyFactorization
+{
+public:
+    /**
+     * Factorizes the given square matrix. Throws std::invalid_argument if it
+     * is not square.
+     */
+    explicit CholeskyFactorization(const MatrixXf& A);
+
+    /**
+     * Returns whether the factorization succeeded or the matrix is not
+     * positive definite.
+     */
+    FactorizationStatus getStatus() const;
+
+    /**
+     * Returns the first column whose diagonal element was too small (or the
+     * size of the matrix if the factorization succeeded).
+     */
+    size_t getFailedColumn() const;
+
+    /**
+     * Returns L (the upper triangle is 0; only complete if the factorization
+     * succeeded).
+     */
+    const MatrixXf& getL() const;
+
+    /**
+     * Solves A * X = B for all columns of B at once (in parallel). Throws
+     * std::invalid_argument if the size does not match or the factorization
+     * failed.
+     */
+    MatrixXf solve(const MatrixXf& B) const;
+
+    /**
+     * Solves A * x = b.
+     */
+    std::vector<float> solve(const std::vector<float>& b) const;
+
+private:
+    MatrixXf l;
+    FactorizationStatus status;
+    size_t failedColumn;
+};
+
+/**
+ * Solves the 4x4 systems matrices[i] * solutions[i] = rightSides[i] for
+ * i = 0, ..., count - 1 (with all four components, including w), for example
+ * millions of small fits or intersections.
+ *
+ * FLOAT_LANES systems are solved at once with Gaussian elimination and
+ * partial pivoting. The implementation is branchless (see FloatLanes.h):
+ * the pivot rows are swapped with select(...) instead of 'if', so all lanes
+ * execute the same instructions, and the batches are distributed over the
+ * threads.
+ *
+ * A singular system (see FactorizationStatus::Singular) gets the solution
+ * (0, 0, 0, 0). If 'statuses' is not nullptr, it receives the status of every
+ * system. Returns the number of singular systems.
+ */
+size_t solveBatch4x4(const Mat4f* matrices, const Vec4f* rightSides, Vec4f* solutions, size_t count,
+                     FactorizationStatus* statuses = nullptr);
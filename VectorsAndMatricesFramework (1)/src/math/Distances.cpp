@@ -0,0 +1,64 @@
+#include "Distances.h"
+#include "FloatLanes.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/* The number of lanes of the rows of one tile: */
+const size_t TILE_LANE_BLOCKS = (DISTANCE_TILE_ROWS + FLOAT_LANES - 1) / FLOAT_LANES;
+
+}
+
+void computeSquaredDistances(const Vec4f* rows, size_t rowCount, const Vec4f* columns, size_t columnCount,
+                             const DistanceTileFunction& function){
+    if(rowCount == 0 || columnCount == 0)
+        return;
+
+    parallelFor(0, rowCount, DISTANCE_TILE_ROWS, [&](size_t rowBegin, size_t rowEnd){
+        // The rows of the block as lanes (the last lanes repeat the last row):
+        FloatLanes x[TILE_LANE_BLOCKS], y[TILE_LANE_BLOCKS], z[TILE_LANE_BLOCKS];
+        size_t blockCount = (rowEnd - rowBegin + FLOAT_LANES - 1) / FLOAT_LANES;
+        for(size_t b=0; b < blockCount; ++b){
+            for(int l=0; l < FLOAT_LANES; ++l){
+                const Vec4f& row = rows[std::min(rowBegin + b * FLOAT_LANES + l, rowEnd - 1)];
+                x[b].v[l] = row.x;
+                y[b].v[l] = row.y;
+                z[b].v[l] = row.z;
+            }
+        }
+
+        std::vector<FloatLanes> tile(DISTANCE_TILE_COLUMNS * TILE_LANE_BLOCKS);
+        for(size_t columnBegin=0; columnBegin < columnCount; columnBegin += DISTANCE_TILE_COLUMNS){
+            size_t columnEnd = std::min(columnBegin + DISTANCE_TILE_COLUMNS, columnCount);
+            for(size_t j=columnBegin; j < columnEnd; ++j){
+                FloatLanes* out = &tile[(j - columnBegin) * TILE_LANE_BLOCKS];
+                FloatLanes cx = broadcast(columns[j].x);
+                FloatLanes cy = broadcast(columns[j].y);
+                FloatLanes cz = broadcast(columns[j].z);
+                for(size_t b=0; b < blockCount; ++b){
+                    FloatLanes dx = x[b] - cx, dy = y[b] - cy, dz = z[b] - cz;
+                    out[b] = dx * dx + dy * dy + dz * dz;
+                }
+            }
+            function(rowBegin, rowEnd, columnBegin, columnEnd, tile[0].v, TILE_LANE_BLOCKS * FLOAT_LANES);
+        }
+    });
+}
+
+void computeSquaredDistances(const Vec4f* rows, size_t rowCount, const Vec4f* columns, size_t columnCount,
+                             MatrixXf& distances){
+    distances = MatrixXf(rowCount, columnCount);
+    float* data = distances.getData();
+    size_t stride = distances.getStride();
+
+    computeSquaredDistances(rows, rowCount, columns, columnCount,
+        [&](size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd, const float* tile, size_t tileStride){
+            for(size_t j=columnBegin; j < columnEnd; ++j){
+                const float* source = tile + (j - columnBegin) * tileStride;
+                std::copy(source, source + (rowEnd - rowBegin), data + j * stride + rowBegin);
+            }
+        });
+}
@@ -0,0 +1,60 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Includes std::function, which receives the tiles of the distances: */
+#include <functional>
+
+/* Include our vectors and dense matrices: */
+#include "Vec4f.h"
+#include "MatrixXf.h"
+
+/**
+ * The size of the tiles in which computeSquaredDistances(...) computes and
+ * passes the distances: DISTANCE_TILE_ROWS x DISTANCE_TILE_COLUMNS floats
+ * (64 KB, which stay in the L2 cache while they are consumed).
+ */
+#define DISTANCE_TILE_ROWS 128
+#define DISTANCE_TILE_COLUMNS 128
+
+/**
+ * Receives one tile of squared distances: the distance between rows[i] and
+ * columns[j] (for rowBegin <= i < rowEnd and columnBegin <= j < columnEnd) is
+ * tile[(j - columnBegin) * stride + (i - rowBegin)] (column-major, like
+ * MatrixXf).
+ */
+typedef std::function<void(size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd,
+                           const float* tile, size_t stride)> DistanceTileFunction;
+
+/**
+ * Computes the squared Euclidean distances (of x, y and z, like
+ * Vec4f::distanceTo(...)) between all rows[i] and all columns[j], and passes
+ * them tile by tile to the given function, without ever storing the whole
+ * rowCount x columnCount matrix. This allows reductions over all pairs (like
+ * the nearest column of every row) whose matrix would not fit into memory.
+ *
+ * The rows are split into blocks of DISTANCE_TILE_ROWS, which are processed
+ * in parallel. Within a block, the rows are stored as FLOAT_LANES wide lanes
+ * of x, y and z, so that FLOAT_LANES distances are computed at once from the
+ * differences (not from |a|^2 + |b|^2 - 2 a.b, which loses all precision for
+ * close points far away from the origin).
+ *
+ * All tiles of one block of rows are passed by the same thread in ascending
+ * order of their columns, so the function may accumulate per-row results
+ * without synchronization. Different blocks of rows are passed concurrently
+ * (unless this is called inside of a parallelFor(...)).
+ */
+void computeSquaredDistances(const Vec4f* rows, size_t rowCount, const Vec4f* columns, size_t columnCount,
+                             const DistanceTileFunction& function);
+
+/**
+ * Computes the rowCount x columnCount matrix of the squared distances between
+ * all rows[i] and all columns[j] (see above) into 'distances'.
+ */
+void computeSquaredDistances(const Vec4f* rows, size_t rowCount, const Vec4f* columns, size_t columnCount,
+                             MatrixXf& distances);
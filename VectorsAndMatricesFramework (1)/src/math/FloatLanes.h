@@ -0,0 +1,158 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes the some math functions like std::sqrt(...), std::fabs(...), etc.: */
+#include <cmath>
+
+/* Includes fixed size integer types like int32_t: */
+#include <cstdint>
+
+/**
+ * The number of lanes of FloatLanes. 8 lanes fill one AVX register, 16 lanes
+ * one AVX-512 register (define FLOAT_LANES before including this file, or as
+ * a compile definition, to change it).
+ */
+#ifndef FLOAT_LANES
+#define FLOAT_LANES 8
+#endif
+
+/**
+ * A small fixed size array of floats on which all arithmetic operations are
+ * performed lane by lane. Code which is written with FloatLanes looks like
+ * normal scalar code, but it processes FLOAT_LANES independent problems at
+ * once. Every operator is a short loop with a constant trip count and
+ * without branches, which the compiler turns into SIMD instructions.
+ *
+ * Conditions are expressed with masks and select(...) instead of 'if', so
+ * that all lanes always execute the same instructions.
+ */
+
+struct FloatLanes
+{
+    float v[FLOAT_LANES];
+};
+
+/**
+ * The result of a lane-wise comparison (one flag per lane).
+ */
+struct LaneMask
+{
+    int32_t v[FLOAT_LANES];
+};
+
+/* Returns lanes which are all set to the given value: */
+inline FloatLanes broadcast(float value){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = value;
+    return r;
+}
+
+inline FloatLanes operator+(const FloatLanes& a, const FloatLanes& b){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] + b.v[l];
+    return r;
+}
+
+inline FloatLanes operator-(const FloatLanes& a, const FloatLanes& b){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] - b.v[l];
+    return r;
+}
+
+inline FloatLanes operator*(const FloatLanes& a, const FloatLanes& b){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] * b.v[l];
+    return r;
+}
+
+inline FloatLanes operator/(const FloatLanes& a, const FloatLanes& b){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] / b.v[l];
+    return r;
+}
+
+inline FloatLanes operator-(const FloatLanes& a){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = -a.v[l];
+    return r;
+}
+
+inline FloatLanes operator*(const FloatLanes& a, float s){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] * s;
+    return r;
+}
+
+inline FloatLanes operator*(float s, const FloatLanes& a){
+    return a * s;
+}
+
+inline FloatLanes operator+(const FloatLanes& a, float s){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] + s;
+    return r;
+}
+
+inline FloatLanes operator-(float s, const FloatLanes& a){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = s - a.v[l];
+    return r;
+}
+
+inline FloatLanes sqrt(const FloatLanes& a){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = std::sqrt(a.v[l]);
+    return r;
+}
+
+/* Returns 1 / sqrt(a) per lane: */
+inline FloatLanes rsqrt(const FloatLanes& a){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = 1.f / std::sqrt(a.v[l]);
+    return r;
+}
+
+inline FloatLanes abs(const FloatLanes& a){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = std::fabs(a.v[l]);
+    return r;
+}
+
+inline FloatLanes maximum(const FloatLanes& a, const FloatLanes& b){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] > b.v[l] ? a.v[l] : b.v[l];
+    return r;
+}
+
+inline FloatLanes minimum(const FloatLanes& a, const FloatLanes& b){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] < b.v[l] ? a.v[l] : b.v[l];
+    return r;
+}
+
+/* Returns the angle of the point (x, y) per lane (see std::atan2): */
+inline FloatLanes atan2(const FloatLanes& y, const FloatLanes& x){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = std::atan2(y.v[l], x.v[l]);
+    return r;
+}
+
+inline LaneMask operator<(const FloatLanes& a, const FloatLanes& b){
+    LaneMask r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = a.v[l] < b.v[l] ? -1 : 0;
+    return r;
+}
+
+inline LaneMask operator>(const FloatLanes& a, const FloatLanes& b){
+    return b < a;
+}
+
+/* Returns 'ifTrue' in all lanes where the mask is set, otherwise 'ifFalse': */
+inline FloatLanes select(const LaneMask& mask, const FloatLanes& ifTrue, const FloatLanes& ifFalse){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = mask.v[l] ? ifTrue.v[l] : ifFalse.v[l];
+    return r;
+}
@@ -0,0 +1,296 @@
+#include "MatrixXf.h"
+#include "FloatLanes.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/* The number of floats per aligned block (the stride is a multiple of it): */
+const size_t ALIGNED_FLOATS = MATRIX_ALIGNMENT / sizeof(float);
+
+/* The size of the tile of C which the micro-kernel keeps in registers: 12
+   SIMD registers of accumulators, 3 for a column of A and 1 for a value of
+   B, which are exactly the 16 registers of AVX2: */
+const size_t GEMM_MR = 3 * FLOAT_LANES;
+const size_t GEMM_NR = 4;
+
+/* The sizes of the packed blocks: a GEMM_KC x GEMM_NR sliver of B fits into
+   the L1 cache, a GEMM_MC x GEMM_KC block of A into the L2 cache and a
+   GEMM_KC x GEMM_NC panel of B into the L3 cache: */
+const size_t GEMM_KC = 256;
+const size_t GEMM_MC = 6 * GEMM_MR;
+const size_t GEMM_NC = 1024 * GEMM_NR;
+
+/* Products with at most this number of multiply-adds use the direct loop: */
+const size_t GEMM_SMALL = 32 * 32 * 32;
+
+/**
+ * Computes the GEMM_MR x GEMM_NR tile a * b of the packed slivers (kc
+ * columns of A with GEMM_MR values each, kc rows of B with GEMM_NR values
+ * each) into 'tile' (column-major). The loop over j is innermost, so the
+ * compiler keeps all accumulators in registers and vectorizes over i.
+ */
+void microKernel(size_t kc, const float* a, const float* b, float* tile){
+    float c[GEMM_NR][GEMM_MR] = {};
+    for(size_t p=0; p < kc; ++p){
+        for(size_t i=0; i < GEMM_MR; ++i){
+            float ai = a[i];
+            for(size_t j=0; j < GEMM_NR; ++j)
+                c[j][i] += ai * b[j];
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    for(size_t j=0; j < GEMM_NR; ++j){
+        for(size_t i=0; i < GEMM_MR; ++i)
+            tile[j * GEMM_MR + i] = c[j][i];
+    }
+}
+
+/**
+ * Packs the mc x kc block of A at 'a' (with the stride 'lda') into slivers of
+ * GEMM_MR rows; the last sliver is padded with zeros.
+ */
+void packA(const float* a, size_t lda, size_t mc, size_t kc, float* packed){
+    for(size_t i=0; i < mc; i += GEMM_MR){
+        size_t rows = std::min(GEMM_MR, mc - i);
+        for(size_t p=0; p < kc; ++p){
+            const float* column = a + p * lda + i;
+            for(size_t r=0; r < rows; ++r)
+                packed[r] = column[r];
+            for(size_t r=rows; r < GEMM_MR; ++r)
+                packed[r] = 0.f;
+            packed += GEMM_MR;
+        }
+    }
+}
+
+/**
+ * Packs the kc x nc panel of B at 'b' (with the stride 'ldb') into slivers of
+ * GEMM_NR columns; the last sliver is padded with zeros.
+ */
+void packB(const float* b, size_t ldb, size_t kc, size_t nc, float* packed){
+    for(size_t j=0; j < nc; j += GEMM_NR){
+        size_t columns = std::min(GEMM_NR, nc - j);
+        for(size_t p=0; p < kc; ++p){
+            for(size_t c=0; c < columns; ++c)
+                packed[c] = b[(j + c) * ldb + p];
+            for(size_t c=columns; c < GEMM_NR; ++c)
+                packed[c] = 0.f;
+            packed += GEMM_NR;
+        }
+    }
+}
+
+/* Computes C = alpha * A * B + beta * C directly (for small sizes): */
+void multiplyDirect(size_t m, size_t n, size_t k, float alpha, const float* A, size_t strideA,
+                    const float* B, size_t strideB, float beta, float* C, size_t strideC){
+    for(size_t j=0; j < n; ++j){
+        float* c = C + j * strideC;
+        for(size_t i=0; i < m; ++i)
+            c[i] = beta == 0.f ? 0.f : beta * c[i];
+
+        for(size_t p=0; p < k; ++p){
+            const float* a = A + p * strideA;
+            float scaled = alpha * B[j * strideB + p];
+            for(size_t i=0; i < m; ++i)
+                c[i] += a[i] * scaled;
+        }
+    }
+}
+}
+
+MatrixXf::MatrixXf()
+    : rowCount(0), columnCount(0), stride(0)
+{}
+
+MatrixXf::MatrixXf(size_t rowCount, size_t columnCount, float value)
+    : rowCount(rowCount), columnCount(columnCount),
+      stride((rowCount + ALIGNED_FLOATS - 1) / ALIGNED_FLOATS * ALIGNED_FLOATS),
+      data(stride * columnCount, 0.f)
+{
+    if(value != 0.f){
+        for(size_t j=0; j < columnCount; ++j)
+            std::fill(data.begin() + j * stride, data.begin() + j * stride + rowCount, value);
+    }
+}
+
+MatrixXf::MatrixXf(const Mat4f& matrix)
+    : MatrixXf(4, 4)
+{
+    for(size_t j=0; j < 4; ++j){
+        for(size_t i=0; i < 4; ++i)
+            (*this)(i, j) = matrix.data[j * 4 + i];
+    }
+}
+
+MatrixXf MatrixXf::identity(size_t n){
+    MatrixXf matrix(n, n);
+    for(size_t i=0; i < n; ++i)
+        matrix(i, i) = 1.f;
+    return matrix;
+}
+
+size_t MatrixXf::getRowCount() const{
+    return rowCount;
+}
+
+size_t MatrixXf::getColumnCount() const{
+    return columnCount;
+}
+
+size_t MatrixXf::getStride() const{
+    return stride;
+}
+
+float* MatrixXf::getData(){
+    return data.data();
+}
+
+const float* MatrixXf::getData() const{
+    return data.data();
+}
+
+MatrixXf MatrixXf::transposed() const{
+    // Transpose in 16 x 16 tiles, so that both matrices are accessed along
+    // cache lines:
+    MatrixXf result(columnCount, rowCount);
+    for(size_t j0=0; j0 < columnCount; j0 += ALIGNED_FLOATS){
+        for(size_t i0=0; i0 < rowCount; i0 += ALIGNED_FLOATS){
+            for(size_t j=j0; j < std::min(j0 + ALIGNED_FLOATS, columnCount); ++j){
+                for(size_t i=i0; i < std::min(i0 + ALIGNED_FLOATS, rowCount); ++i)
+                    result(j, i) = (*this)(i, j);
+            }
+        }
+    }
+    return result;
+}
+
+Mat4f MatrixXf::toMat4f() const{
+    if(rowCount != 4 || columnCount != 4)
+        throw std::invalid_argument("MatrixXf::toMat4f: the matrix is not 4 x 4.");
+
+    float values[16];
+    for(size_t j=0; j < 4; ++j){
+        for(size_t i=0; i < 4; ++i)
+            values[j * 4 + i] = (*this)(i, j);
+    }
+    return Mat4f(values);
+}
+
+MatrixXf MatrixXf::operator+(const MatrixXf& matrix) const{
+    if(rowCount != matrix.rowCount || columnCount != matrix.columnCount)
+        throw std::invalid_argument("MatrixXf::operator+: the sizes do not match.");
+
+    // The padding is 0 in both matrices, so it stays 0:
+    MatrixXf result(*this);
+    for(size_t k=0; k < data.size(); ++k)
+        result.data[k] += matrix.data[k];
+    return result;
+}
+
+MatrixXf MatrixXf::operator-(const MatrixXf& matrix) const{
+    if(rowCount != matrix.rowCount || columnCount != matrix.columnCount)
+        throw std::invalid_argument("MatrixXf::operator-: the sizes do not match.");
+
+    MatrixXf result(*this);
+    for(size_t k=0; k < data.size(); ++k)
+        result.data[k] -= matrix.data[k];
+    return result;
+}
+
+MatrixXf MatrixXf::operator*(float scalar) const{
+    MatrixXf result(*this);
+    for(size_t k=0; k < data.size(); ++k)
+        result.data[k] *= scalar;
+    return result;
+}
+
+MatrixXf MatrixXf::operator*(const MatrixXf& matrix) const{
+    MatrixXf result(rowCount, matrix.columnCount);
+    multiply(*this, matrix, result);
+    return result;
+}
+
+void multiply(const MatrixXf& A, const MatrixXf& B, MatrixXf& C, float alpha, float beta){
+    size_t m = A.getRowCount(), k = A.getColumnCount(), n = B.getColumnCount();
+    if(B.getRowCount() != k || C.getRowCount() != m || C.getColumnCount() != n)
+        throw std::invalid_argument("multiply: the sizes of the matrices do not match.");
+    if(&C == &A || &C == &B)
+        throw std::invalid_argument("multiply: the result must not be an input.");
+
+    multiply(m, n, k, alpha, A.getData(), A.getStride(), B.getData(), B.getStride(), beta, C.getData(), C.getStride());
+}
+
+void multiply(size_t m, size_t n, size_t k, float alpha, const float* A, size_t strideA,
+              const float* B, size_t strideB, float beta, float* C, size_t strideC){
+    if(m == 0 || n == 0)
+        return;
+
+    if(m * n * k <= GEMM_SMALL || k == 0){
+        multiplyDirect(m, n, k, alpha, A, strideA, B, strideB, beta, C, strideC);
+        return;
+    }
+
+    // Use smaller blocks of A if there are not enough blocks for all threads:
+    size_t threadCount = getThreadCount();
+    size_t mc = GEMM_MC;
+    if(threadCount > 1 && (m + mc - 1) / mc < threadCount)
+        mc = std::max(GEMM_MR, ((m + threadCount - 1) / threadCount + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+
+    std::vector<float, AlignedAllocator<float, MATRIX_ALIGNMENT>> packedB(GEMM_KC * ((std::min(n, GEMM_NC) + GEMM_NR - 1) / GEMM_NR * GEMM_NR));
+
+    for(size_t jc=0; jc < n; jc += GEMM_NC){
+        size_t nc = std::min(GEMM_NC, n - jc);
+        for(size_t pc=0; pc < k; pc += GEMM_KC){
+            size_t kc = std::min(GEMM_KC, k - pc);
+            bool first = pc == 0;
+
+            // Pack the panel of B (in parallel, sliver by sliver):
+            size_t sliverCount = (nc + GEMM_NR - 1) / GEMM_NR;
+            parallelFor(0, sliverCount, 16, [&](size_t begin, size_t end){
+                for(size_t s=begin; s < end; ++s){
+                    packB(B + (jc + s * GEMM_NR) * strideB + pc, strideB, kc,
+                          std::min(GEMM_NR, nc - s * GEMM_NR), packedB.data() + s * GEMM_NR * kc);
+                }
+            });
+
+            // Every block of A is packed and multiplied on one thread:
+            parallelFor(0, m, mc, [&](size_t ic, size_t icEnd){
+                size_t mcBlock = icEnd - ic;
+                std::vector<float, AlignedAllocator<float, MATRIX_ALIGNMENT>> packedA(
+                    kc * ((mcBlock + GEMM_MR - 1) / GEMM_MR * GEMM_MR));
+                packA(A + pc * strideA + ic, strideA, mcBlock, kc, packedA.data());
+
+                float tile[GEMM_MR * GEMM_NR];
+                for(size_t jr=0; jr < nc; jr += GEMM_NR){
+                    size_t columns = std::min(GEMM_NR, nc - jr);
+                    for(size_t ir=0; ir < mcBlock; ir += GEMM_MR){
+                        size_t rows = std::min(GEMM_MR, mcBlock - ir);
+                        microKernel(kc, packedA.data() + ir * kc, packedB.data() + jr * kc, tile);
+
+                        // Add the tile to C (the first block of k also
+                        // applies beta):
+                        for(size_t j=0; j < columns; ++j){
+                            float* c = C + (jc + jr + j) * strideC + ic + ir;
+                            const float* t = tile + j * GEMM_MR;
+                            if(!first){
+                                for(size_t i=0; i < rows; ++i)
+                                    c[i] += alpha * t[i];
+                            } else if(beta == 0.f){
+                                for(size_t i=0; i < rows; ++i)
+                                    c[i] = alpha * t[i];
+                            } else {
+                                for(size_t i=0; i < rows; ++i)
+                                    c[i] = alpha * t[i] + beta * c[i];
+                            }
+                        }
+                    }
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,166 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our 4x4 matrix (for conversions) and the aligned allocator: */
+#include "Mat4f.h"
+#include "AlignedAllocator.h"
+
+/**
+ * The alignment of the columns of a MatrixXf in bytes (one cache line).
+ */
+#define MATRIX_ALIGNMENT 64
+
+/**
+ * A dense matrix of arbitrary size (for example the normal equations of a
+ * least squares problem, or a Jacobian with one row per measurement).
+ *
+ * Like Mat4f, the values are stored column by column (column-major order),
+ * so the cell (row, column) is data[column * stride + row]. The distance
+ * between two columns ('stride') is the number of rows rounded up to a
+ * multiple of MATRIX_ALIGNMENT / sizeof(float) = 16, and the storage is
+ * aligned to MATRIX_ALIGNMENT bytes, so every column starts at a cache line.
+ * The padding rows are always 0.
+ */
+
+class MatrixXf
+{
+public:
+    /**
+     * Constructs an empty 0 x 0 matrix.
+     */
+    MatrixXf();
+
+    /**
+     * Constructs a rowCount x columnCount matrix filled with 'value'.
+     */
+    MatrixXf(size_t rowCount, size_t columnCount, float value = 0.f);
+
+    /**
+     * Constructs a 4 x 4 matrix with the values of the given Mat4f.
+     */
+    explicit MatrixXf(const Mat4f& matrix);
+
+    /**
+     * Returns a n x n identity matrix.
+     */
+    static MatrixXf identity(size_t n);
+
+    /**
+     * Returns the number of rows.
+     */
+    size_t getRowCount() const;
+
+    /**
+     * Returns the number of columns.
+     */
+    size_t getColumnCount() const;
+
+    /**
+     * Returns the distance between the first elements of two neighbouring
+     * columns (in floats).
+     */
+    size_t getStride() const;
+
+    /**
+     * Returns the first element of the (aligned) storage.
+     */
+    float* getData();
+    const float* getData() const;
+
+    /**
+     * Returns the cell in the given row and column (unchecked).
+     */
+    float& operator()(size_t row, size_t column){
+        return data[column * stride + row];
+    }
+
+    float operator()(size_t row, size_t column) const {
+        return data[column * stride + row];
+    }
+
+    /**
+     * Returns the transposed matrix.
+     */
+    MatrixXf transposed() const;
+
+    /**
+     * Converts a 4 x 4 matrix into a Mat4f. Throws std::invalid_argument for
+     * other sizes.
+     */
+    Mat4f toMat4f() const;
+
+    /**
+     * Adds or subtracts two matrices of the same size (throws
+     * std::invalid_argument otherwise).
+     */
+    MatrixXf operator+(const MatrixXf& matrix) const;
+    MatrixXf operator-(const MatrixXf& matrix) const;
+
+    /**
+     * Multiplies the matrix by a scalar.
+     */
+    MatrixXf operator*(float scalar) const;
+
+    /**
+     * Multiplies this matrix by the given matrix (see multiply(...)) and
+     * returns the result as a new matrix.
+     */
+    MatrixXf operator*(const MatrixXf& matrix) const;
+
+private:
+    size_t rowCount;
+    size_t columnCount;
+    size_t stride;
+    std::vector<float, AlignedAllocator<float, MATRIX_ALIGNMENT>> data;
+};
+
+/**
+ * Computes C = alpha * A * B + beta * C (the general matrix multiplication,
+ * 'GEMM'). C must already have the correct size (A.rows x B.columns), and it
+ * must not be A or B. If beta is 0, the old values of C are ignored (even
+ * NaNs). Throws std::invalid_argument if the sizes do not match.
+ *
+ * A product of two n x n matrices needs 2 n^3 floating point operations but
+ * only reads 2 n^2 values, so it is limited by arithmetic, not by memory -
+ * if the values are reused from the caches and registers. This is done like
+ * in high performance BLAS libraries (Goto and van de Geijn, "Anatomy of
+ * High-Performance Matrix Multiplication", 2008):
+ *
+ *  - B is split into panels of GEMM_KC x GEMM_NC and A into blocks of
+ *    GEMM_MC x GEMM_KC, which are copied ('packed') into contiguous buffers
+ *    in exactly the order in which they are read. A block of A stays in the
+ *    L2 cache while all columns of the panel of B stream past it.
+ *  - A micro-kernel computes a GEMM_MR x GEMM_NR tile of C in registers
+ *    (3 * FLOAT_LANES x 4 = 12 SIMD registers of accumulators) from a thin
+ *    sliver of the packed A and B, which stay in the L1 cache. Every loaded
+ *    value of A is used GEMM_NR times and every value of B GEMM_MR times.
+ *  - The blocks of A (rows of C) are distributed over the threads of
+ *    parallelFor(...); since every element of C is always summed in the
+ *    same order, the result does not depend on the number of threads.
+ *
+ * The micro-kernel is written as plain loops over small arrays which the
+ * compiler turns into SIMD multiply-adds; it reaches its full speed when
+ * compiling for the CPU (VECTORS_AND_MATRICES_NATIVE in CMake, which enables
+ * AVX2 and FMA on current x86 processors). Small products (like 4 x 4
+ * matrices, or up to 32^3 multiply-adds) skip the packing and use a simple
+ * direct loop, whose overhead is much lower.
+ */
+void multiply(const MatrixXf& A, const MatrixXf& B, MatrixXf& C, float alpha = 1.f, float beta = 0.f);
+
+/**
+ * Computes C = alpha * A * B + beta * C like above for matrices which are
+ * given by their first element and their stride (column-major), for example
+ * blocks of larger matrices: A is m x k, B is k x n and C is m x n. C must not
+ * overlap A or B.
+ */
+void multiply(size_t m, size_t n, size_t k, float alpha, const float* A, size_t strideA,
+              const float* B, size_t strideB, float beta, float* C, size_t strideC);
@@ -0,0 +1,109 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes fixed size integer types like uint32_t and uint64_t: */
+#include <cstdint>
+
+/* Include our math classes: */
+#include "Vec4f.h"
+#include "AABB.h"
+
+/**
+ * Morton codes (also called Z-order codes) interleave the bits of the x, y
+ * and z coordinates of a grid cell: ... z1 y1 x1 z0 y0 x0. Sorting points by
+ * their Morton code orders them along a space filling curve, so points which
+ * are close in the sorted array are (mostly) also close in space. This is
+ * used to split point sets and meshes into spatially coherent blocks, and the
+ * leading bits of a code directly describe the octree cell of a point.
+ */
+
+/* Inserts two zero bits after each of the lowest 10 bits of x: */
+inline uint32_t expandBits10(uint32_t x){
+    x &= 0x000003ffu;
+    x = (x | (x << 16)) & 0x030000ffu;
+    x = (x | (x << 8))  & 0x0300f00fu;
+    x = (x | (x << 4))  & 0x030c30c3u;
+    x = (x | (x << 2))  & 0x09249249u;
+    return x;
+}
+
+/* Inserts two zero bits after each of the lowest 21 bits of x: */
+inline uint64_t expandBits21(uint64_t x){
+    x &= 0x1fffffull;
+    x = (x | (x << 32)) & 0x001f00000000ffffull;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+    x = (x | (x << 8))  & 0x100f00f00f00f00full;
+    x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+    x = (x | (x << 2))  & 0x1249249249249249ull;
+    return x;
+}
+
+/**
+ * Returns the 30 bit Morton code of the grid cell (x, y, z), where each
+ * coordinate must be smaller than 1024.
+ */
+inline uint32_t encodeMorton30(uint32_t x, uint32_t y, uint32_t z){
+    return expandBits10(x) | (expandBits10(y) << 1) | (expandBits10(z) << 2);
+}
+
+/**
+ * Returns the 63 bit Morton code of the grid cell (x, y, z), where each
+ * coordinate must be smaller than 2^21.
+ */
+inline uint64_t encodeMorton63(uint32_t x, uint32_t y, uint32_t z){
+    return expandBits21(x) | (expandBits21(y) << 1) | (expandBits21(z) << 2);
+}
+
+/* Removes the two bits after each of the lowest 21 bits of x (the inverse of
+   expandBits21(...)): */
+inline uint64_t compactBits21(uint64_t x){
+    x &= 0x1249249249249249ull;
+    x = (x | (x >> 2))  & 0x10c30c30c30c30c3ull;
+    x = (x | (x >> 4))  & 0x100f00f00f00f00full;
+    x = (x | (x >> 8))  & 0x001f0000ff0000ffull;
+    x = (x | (x >> 16)) & 0x001f00000000ffffull;
+    x = (x | (x >> 32)) & 0x1fffffull;
+    return x;
+}
+
+/**
+ * Returns the grid cell (x, y, z) of the given 63 bit Morton code (the
+ * inverse of encodeMorton63(...)).
+ */
+inline void decodeMorton63(uint64_t code, uint32_t& x, uint32_t& y, uint32_t& z){
+    x = uint32_t(compactBits21(code));
+    y = uint32_t(compactBits21(code >> 1));
+    z = uint32_t(compactBits21(code >> 2));
+}
+
+/* Maps a coordinate in [min, max] to a grid cell in [0, cells - 1]: */
+inline uint32_t quantizeCoordinate(float value, float min, float max, uint32_t cells){
+    float t = max > min ? (value - min) / (max - min) : 0.f;
+    float cell = t * float(cells);
+    if(!(cell > 0.f))
+        return 0;
+    return cell < float(cells - 1) ? uint32_t(cell) : cells - 1;
+}
+
+/**
+ * Returns the 30 bit Morton code of the given point in a 1024^3 grid which
+ * spans the given box (points outside of the box are clamped to its border).
+ */
+inline uint32_t computeMortonCode30(const Vec4f point, const AABB& bounds){
+    return encodeMorton30(quantizeCoordinate(point.x, bounds.min.x, bounds.max.x, 1u << 10),
+                          quantizeCoordinate(point.y, bounds.min.y, bounds.max.y, 1u << 10),
+                          quantizeCoordinate(point.z, bounds.min.z, bounds.max.z, 1u << 10));
+}
+
+/**
+ * Returns the 63 bit Morton code of the given point in a 2^21 x 2^21 x 2^21
+ * grid which spans the given box (points outside of the box are clamped).
+ */
+inline uint64_t computeMortonCode63(const Vec4f point, const AABB& bounds){
+    return encodeMorton63(quantizeCoordinate(point.x, bounds.min.x, bounds.max.x, 1u << 21),
+                          quantizeCoordinate(point.y, bounds.min.y, bounds.max.y, 1u << 21),
+                          quantizeCoordinate(point.z, bounds.min.z, bounds.max.z, 1u << 21));
+}
@@ -0,0 +1,202 @@
+#include "Parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/* Is true on threads which are currently executing chunks of a parallelFor: */
+thread_local bool insideParallelFor = false;
+
+/**
+ * A minimal thread pool. The calling thread of run(...) also executes chunks,
+ * so a pool for n threads only owns n-1 worker threads.
+ *
+ * Every worker takes part in every job (even if there is no chunk left for it),
+ * so run(...) can not return while some worker still holds a reference to the
+ * function of the current job.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(unsigned int threadCount)
+        : jobFunction(nullptr), jobChunkCount(0), nextChunk(0),
+          pendingWorkers(0), generation(0), stopping(false)
+    {
+        for(unsigned int i=1; i < threadCount; ++i)
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+
+        for(std::thread& worker : workers)
+            worker.join();
+    }
+
+    unsigned int getThreadCount() const{
+        return (unsigned int)workers.size() + 1;
+    }
+
+    void run(size_t chunkCount, const std::function<void(size_t)>& function){
+        // Only one job can be executed by the pool at a time:
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobFunction = &function;
+            jobChunkCount = chunkCount;
+            nextChunk = 0;
+            pendingWorkers = workers.size();
+            jobException = nullptr;
+            ++generation;
+        }
+        wakeCondition.notify_all();
+
+        // The calling thread helps processing the chunks:
+        executeChunks(function, chunkCount);
+
+        // Wait until every worker has finished the current job:
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this]{ return pendingWorkers == 0; });
+        jobFunction = nullptr;
+
+        if(jobException)
+            std::rethrow_exception(jobException);
+    }
+
+private:
+    void executeChunks(const std::function<void(size_t)>& function, size_t chunkCount){
+        insideParallelFor = true;
+
+        for(size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++){
+            try {
+                function(chunk);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(!jobException)
+                    jobException = std::current_exception();
+            }
+        }
+
+        insideParallelFor = false;
+    }
+
+    void workerLoop(){
+        unsigned long long seenGeneration = 0;
+
+        for(;;){
+            const std::function<void(size_t)>* function;
+            size_t chunkCount;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [&]{ return stopping || generation != seenGeneration; });
+
+                if(stopping)
+                    return;
+
+                seenGeneration = generation;
+                function = jobFunction;
+                chunkCount = jobChunkCount;
+            }
+
+            executeChunks(*function, chunkCount);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(--pendingWorkers == 0)
+                    doneCondition.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+
+    std::mutex submitMutex;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(size_t)>* jobFunction;
+    size_t jobChunkCount;
+    std::atomic<size_t> nextChunk;
+    size_t pendingWorkers;
+    unsigned long long generation;
+    bool stopping;
+    std::exception_ptr jobException;
+};
+
+unsigned int getHardwareThreadCount(){
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+std::unique_ptr<ThreadPool>& getPool(){
+    static std::unique_ptr<ThreadPool> pool(new ThreadPool(getHardwareThreadCount()));
+    return pool;
+}
+
+}
+
+unsigned int getThreadCount(){
+    return getPool()->getThreadCount();
+}
+
+void setThreadCount(unsigned int threadCount){
+    if(threadCount == 0)
+        threadCount = getHardwareThreadCount();
+
+    std::unique_ptr<ThreadPool>& pool = getPool();
+
+    if(pool->getThreadCount() != threadCount){
+        // Destroy the old pool first, so that its threads are joined:
+        pool.reset();
+        pool.reset(new ThreadPool(threadCount));
+    }
+}
+
+size_t getChunkCount(size_t rangeSize, size_t grainSize){
+    if(grainSize == 0)
+        grainSize = 1;
+
+    return (rangeSize + grainSize - 1) / grainSize;
+}
+
+void parallelFor(size_t begin, size_t end, size_t grainSize,
+                 const std::function<void(size_t, size_t)>& function){
+    if(end <= begin)
+        return;
+
+    if(grainSize == 0)
+        grainSize = 1;
+
+    size_t chunkCount = getChunkCount(end - begin, grainSize);
+
+    // Execute the chunks on the calling thread if there is nothing to split
+    // or if we are already inside of a parallelFor:
+    ThreadPool* pool = getPool().get();
+    if(chunkCount == 1 || insideParallelFor || pool->getThreadCount() == 1){
+        for(size_t chunk=0; chunk < chunkCount; ++chunk){
+            size_t chunkBegin = begin + chunk * grainSize;
+            size_t chunkEnd = chunkBegin + grainSize < end ? chunkBegin + grainSize : end;
+            function(chunkBegin, chunkEnd);
+        }
+        return;
+    }
+
+    pool->run(chunkCount, [&](size_t chunk){
+        size_t chunkBegin = begin + chunk * grainSize;
+        size_t chunkEnd = chunkBegin + grainSize < end ? chunkBegin + grainSize : end;
+        function(chunkBegin, chunkEnd);
+    });
+}
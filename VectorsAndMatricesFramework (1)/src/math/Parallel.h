@@ -0,0 +1,102 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Includes std::function, which is used to pass the work of a parallel loop: */
+#include <functional>
+
+/* Includes std::vector, which stores the partial results of parallelReduce(...): */
+#include <vector>
+
+/**
+ * This file provides a small, shared thread pool which is used by all the
+ * bulk algorithms working on large Vec4f arrays (reductions, bounding volumes,
+ * meshes, ...).
+ *
+ * The work of a parallel loop is always split into chunks of a fixed size
+ * (the 'grain size'). The chunk boundaries only depend on the loop range and
+ * the grain size, but NOT on the number of threads. This is important for
+ * algorithms which should return bitwise identical results regardless of how
+ * many threads are used: they compute one partial result per chunk and combine
+ * the partial results in a fixed order afterwards.
+ */
+
+/**
+ * Returns the number of threads (including the calling thread) which are used
+ * by parallelFor(...). Per default this is the number of hardware threads.
+ */
+unsigned int getThreadCount();
+
+/**
+ * Sets the number of threads (including the calling thread) which are used by
+ * parallelFor(...). A value of 0 selects the number of hardware threads, a
+ * value of 1 disables multithreading completely.
+ *
+ * WARNING: Do not call this while a parallelFor(...) is running.
+ */
+void setThreadCount(unsigned int threadCount);
+
+/**
+ * Executes the given function for all chunks of the range [begin, end) in
+ * parallel. Each call receives a sub range [chunkBegin, chunkEnd) which
+ * contains at most grainSize elements, where chunkBegin is always
+ * begin + k * grainSize. This function returns after all chunks have been
+ * processed.
+ *
+ * Nested calls (a parallelFor inside of a parallelFor) are executed serially on
+ * the calling thread. If the function throws an exception, the first exception
+ * is rethrown on the calling thread after all chunks have finished.
+ */
+void parallelFor(size_t begin, size_t end, size_t grainSize,
+                 const std::function<void(size_t chunkBegin, size_t chunkEnd)>& function);
+
+/**
+ * Returns the number of chunks parallelFor(...) would use for a range of the
+ * given size and the given grain size (which is useful to allocate one partial
+ * result per chunk).
+ */
+size_t getChunkCount(size_t rangeSize, size_t grainSize);
+
+/**
+ * Reduces the range [begin, end) in parallel and returns the result.
+ *
+ * The function 'reduceChunk(chunkBegin, chunkEnd)' computes the partial result
+ * of one chunk (see parallelFor(...) for the chunk boundaries). The partial
+ * results of all chunks are then combined pairwise in a fixed binary tree
+ * ((c0 + c1) + (c2 + c3)) + ... using 'combine(a, b)'.
+ *
+ * Since neither the chunk boundaries nor the combination order depend on the
+ * number of threads, the result is bitwise identical for every thread count,
+ * even for floating point sums (which are not associative). For an empty
+ * range, 'identity' is returned.
+ */
+template<typename T, typename ReduceChunk, typename Combine>
+T parallelReduce(size_t begin, size_t end, size_t grainSize, const T& identity,
+                 const ReduceChunk& reduceChunk, const Combine& combine)
+{
+    if(end <= begin)
+        return identity;
+
+    if(grainSize == 0)
+        grainSize = 1;
+
+    // Compute one partial result per chunk:
+    std::vector<T> partials(getChunkCount(end - begin, grainSize), identity);
+    parallelFor(begin, end, grainSize, [&](size_t chunkBegin, size_t chunkEnd){
+        partials[(chunkBegin - begin) / grainSize] = reduceChunk(chunkBegin, chunkEnd);
+    });
+
+    // Combine the partial results in a fixed tree order:
+    for(size_t step=1; step < partials.size(); step *= 2){
+        for(size_t i=0; i + step < partials.size(); i += 2 * step){
+            partials[i] = combine(partials[i], partials[i + step]);
+        }
+    }
+
+    return partials[0];
+}
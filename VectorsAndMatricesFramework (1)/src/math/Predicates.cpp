@@ -0,0 +1,484 @@
+#include "Predicates.h"
+#include "Parallel.h"
+
+#include <vector>
+
+namespace {
+
+/* Machine epsilon of double (half an ulp of 1.0): */
+const double EPSILON = 1.1102230246251565e-16;
+
+/* Splits a double into two halves with 26 bits each: */
+const double SPLITTER = 134217729.0;
+
+/* Error bounds of the double precision filters (see Shewchuk's paper): */
+const double ORIENT2D_ERROR_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+const double ORIENT3D_ERROR_BOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+const double INCIRCLE_ERROR_BOUND = (10.0 + 96.0 * EPSILON) * EPSILON;
+const double INSPHERE_ERROR_BOUND = (16.0 + 224.0 * EPSILON) * EPSILON;
+
+/* The number of predicates of a batch which are filtered together: */
+const size_t BATCH_BLOCK_SIZE = 64;
+
+/* The number of predicates of a batch which are evaluated by one task: */
+const size_t BATCH_GRAIN_SIZE = 4096;
+
+/**
+ * An expansion is a sum of doubles which do not overlap, sorted by increasing
+ * magnitude. It represents the exact value of its sum. Zero components are
+ * always eliminated (but an expansion contains at least one component).
+ *
+ * NOTE: The following functions rely on every operation being rounded
+ * separately, so the compiler must not fuse multiplications and additions.
+ */
+typedef std::vector<double> Expansion;
+
+/* Computes x + y = a + b exactly, where x = fl(a + b). Requires |a| >= |b|: */
+inline void fastTwoSum(double a, double b, double& x, double& y){
+    x = a + b;
+    double bVirtual = x - a;
+    y = b - bVirtual;
+}
+
+/* Computes x + y = a + b exactly, where x = fl(a + b): */
+inline void twoSum(double a, double b, double& x, double& y){
+    x = a + b;
+    double bVirtual = x - a;
+    double aVirtual = x - bVirtual;
+    double bRoundoff = b - bVirtual;
+    double aRoundoff = a - aVirtual;
+    y = aRoundoff + bRoundoff;
+}
+
+/* Computes x + y = a - b exactly, where x = fl(a - b): */
+inline void twoDiff(double a, double b, double& x, double& y){
+    x = a - b;
+    double bVirtual = a - x;
+    double aVirtual = x + bVirtual;
+    double bRoundoff = bVirtual - b;
+    double aRoundoff = a - aVirtual;
+    y = aRoundoff + bRoundoff;
+}
+
+/* Computes x + y = a * b exactly, where x = fl(a * b): */
+inline void twoProduct(double a, double b, double& x, double& y){
+    x = a * b;
+#ifdef FP_FAST_FMA
+    y = std::fma(a, b, -x);
+#else
+    double c = SPLITTER * a;
+    double aBig = c - a;
+    double aHigh = c - aBig;
+    double aLow = a - aHigh;
+
+    c = SPLITTER * b;
+    double bBig = c - b;
+    double bHigh = c - bBig;
+    double bLow = b - bHigh;
+
+    double error1 = x - aHigh * bHigh;
+    double error2 = error1 - aLow * bHigh;
+    double error3 = error2 - aHigh * bLow;
+    y = aLow * bLow - error3;
+#endif
+}
+
+/* Returns the exact difference a - b as an expansion: */
+Expansion difference(double a, double b){
+    double x, y;
+    twoDiff(a, b, x, y);
+
+    Expansion e;
+    if(y != 0.0)
+        e.push_back(y);
+    if(x != 0.0 || e.empty())
+        e.push_back(x);
+    return e;
+}
+
+/* Returns e + b: */
+Expansion grow(const Expansion& e, double b){
+    Expansion h;
+    h.reserve(e.size() + 1);
+
+    double q = b;
+    for(size_t i=0; i < e.size(); ++i){
+        double sum, error;
+        twoSum(q, e[i], sum, error);
+        q = sum;
+        if(error != 0.0)
+            h.push_back(error);
+    }
+
+    if(q != 0.0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+/* Returns e * b: */
+Expansion scale(const Expansion& e, double b){
+    Expansion h;
+    h.reserve(2 * e.size());
+
+    double q, error;
+    twoProduct(e[0], b, q, error);
+    if(error != 0.0)
+        h.push_back(error);
+
+    for(size_t i=1; i < e.size(); ++i){
+        double product1, product0, sum;
+        twoProduct(e[i], b, product1, product0);
+        twoSum(q, product0, sum, error);
+        if(error != 0.0)
+            h.push_back(error);
+        fastTwoSum(product1, sum, q, error);
+        if(error != 0.0)
+            h.push_back(error);
+    }
+
+    if(q != 0.0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+/**
+ * Returns an expansion with the same value, but with as few components as
+ * possible (Shewchuk's COMPRESS), which keeps the products below small.
+ */
+Expansion compress(const Expansion& e){
+    Expansion h(e.size());
+
+    int bottom = int(e.size()) - 1;
+    double q = e[bottom];
+    for(int i=int(e.size()) - 2; i >= 0; --i){
+        double sum, error;
+        fastTwoSum(q, e[i], sum, error);
+        if(error != 0.0){
+            h[bottom--] = sum;
+            q = error;
+        } else {
+            q = sum;
+        }
+    }
+
+    int top = 0;
+    for(int i=bottom + 1; i < int(e.size()); ++i){
+        double sum, error;
+        fastTwoSum(h[i], q, sum, error);
+        if(error != 0.0)
+            h[top++] = error;
+        q = sum;
+    }
+    h[top++] = q;
+
+    h.resize(top);
+    return h;
+}
+
+/* Returns e + f: */
+Expansion add(const Expansion& e, const Expansion& f){
+    Expansion h = e;
+    for(size_t i=0; i < f.size(); ++i)
+        h = grow(h, f[i]);
+    return compress(h);
+}
+
+/* Returns e - f: */
+Expansion sub(const Expansion& e, const Expansion& f){
+    Expansion h = e;
+    for(size_t i=0; i < f.size(); ++i)
+        h = grow(h, -f[i]);
+    return compress(h);
+}
+
+/* Returns e * f: */
+Expansion mul(const Expansion& e, const Expansion& f){
+    Expansion h = scale(e, f[0]);
+    for(size_t i=1; i < f.size(); ++i)
+        h = add(h, scale(e, f[i]));
+    return compress(h);
+}
+
+/* Returns an approximation of the value of e with the correct sign: */
+double estimate(const Expansion& e){
+    // The last component has the largest magnitude and determines the sign:
+    return e.back();
+}
+
+/* Exact evaluation of orient2d: */
+double orient2dExact(const Vec4f& a, const Vec4f& b, const Vec4f& c){
+    Expansion acx = difference(a.x, c.x), acy = difference(a.y, c.y);
+    Expansion bcx = difference(b.x, c.x), bcy = difference(b.y, c.y);
+
+    return estimate(sub(mul(acx, bcy), mul(acy, bcx)));
+}
+
+/* Exact evaluation of orient3d: */
+double orient3dExact(const Vec4f& a, const Vec4f& b, const Vec4f& c, const Vec4f& d){
+    Expansion adx = difference(a.x, d.x), ady = difference(a.y, d.y), adz = difference(a.z, d.z);
+    Expansion bdx = difference(b.x, d.x), bdy = difference(b.y, d.y), bdz = difference(b.z, d.z);
+    Expansion cdx = difference(c.x, d.x), cdy = difference(c.y, d.y), cdz = difference(c.z, d.z);
+
+    Expansion det = mul(adz, sub(mul(bdx, cdy), mul(cdx, bdy)));
+    det = add(det, mul(bdz, sub(mul(cdx, ady), mul(adx, cdy))));
+    det = add(det, mul(cdz, sub(mul(adx, bdy), mul(bdx, ady))));
+    return estimate(det);
+}
+
+/* Exact evaluation of incircle: */
+double incircleExact(const Vec4f& a, const Vec4f& b, const Vec4f& c, const Vec4f& d){
+    Expansion adx = difference(a.x, d.x), ady = difference(a.y, d.y);
+    Expansion bdx = difference(b.x, d.x), bdy = difference(b.y, d.y);
+    Expansion cdx = difference(c.x, d.x), cdy = difference(c.y, d.y);
+
+    Expansion aLift = add(mul(adx, adx), mul(ady, ady));
+    Expansion bLift = add(mul(bdx, bdx), mul(bdy, bdy));
+    Expansion cLift = add(mul(cdx, cdx), mul(cdy, cdy));
+
+    Expansion det = mul(aLift, sub(mul(bdx, cdy), mul(cdx, bdy)));
+    det = add(det, mul(bLift, sub(mul(cdx, ady), mul(adx, cdy))));
+    det = add(det, mul(cLift, sub(mul(adx, bdy), mul(bdx, ady))));
+    return estimate(det);
+}
+
+/* Exact evaluation of insphere: */
+double insphereExact(const Vec4f& a, const Vec4f& b, const Vec4f& c, const Vec4f& d, const Vec4f& e){
+    Expansion aex = difference(a.x, e.x), aey = difference(a.y, e.y), aez = difference(a.z, e.z);
+    Expansion bex = difference(b.x, e.x), bey = difference(b.y, e.y), bez = difference(b.z, e.z);
+    Expansion cex = difference(c.x, e.x), cey = difference(c.y, e.y), cez = difference(c.z, e.z);
+    Expansion dex = difference(d.x, e.x), dey = difference(d.y, e.y), dez = difference(d.z, e.z);
+
+    // 2x2 minors of the x and y columns:
+    Expansion ab = sub(mul(aex, bey), mul(bex, aey));
+    Expansion bc = sub(mul(bex, cey), mul(cex, bey));
+    Expansion cd = sub(mul(cex, dey), mul(dex, cey));
+    Expansion da = sub(mul(dex, aey), mul(aex, dey));
+    Expansion ac = sub(mul(aex, cey), mul(cex, aey));
+    Expansion bd = sub(mul(bex, dey), mul(dex, bey));
+
+    // 3x3 minors of the x, y and z columns:
+    Expansion abc = add(sub(mul(aez, bc), mul(bez, ac)), mul(cez, ab));
+    Expansion bcd = add(sub(mul(bez, cd), mul(cez, bd)), mul(dez, bc));
+    Expansion cda = add(add(mul(cez, da), mul(dez, ac)), mul(aez, cd));
+    Expansion dab = add(add(mul(dez, ab), mul(aez, bd)), mul(bez, da));
+
+    Expansion aLift = add(add(mul(aex, aex), mul(aey, aey)), mul(aez, aez));
+    Expansion bLift = add(add(mul(bex, bex), mul(bey, bey)), mul(bez, bez));
+    Expansion cLift = add(add(mul(cex, cex), mul(cey, cey)), mul(cez, cez));
+    Expansion dLift = add(add(mul(dex, dex), mul(dey, dey)), mul(dez, dez));
+
+    Expansion det = sub(mul(dLift, abc), mul(cLift, dab));
+    det = add(det, sub(mul(bLift, cda), mul(aLift, bcd)));
+    return estimate(det);
+}
+
+/* Double precision evaluation of orient2d with its error bound: */
+inline double orient2dFilter(const Vec4f& a, const Vec4f& b, const Vec4f& c, double& errorBound){
+    double left = (double(a.x) - c.x) * (double(b.y) - c.y);
+    double right = (double(a.y) - c.y) * (double(b.x) - c.x);
+
+    errorBound = ORIENT2D_ERROR_BOUND * (std::fabs(left) + std::fabs(right));
+    return left - right;
+}
+
+/* Double precision evaluation of orient3d with its error bound: */
+inline double orient3dFilter(const Vec4f& a, const Vec4f& b, const Vec4f& c, const Vec4f& d, double& errorBound){
+    double adx = double(a.x) - d.x, ady = double(a.y) - d.y, adz = double(a.z) - d.z;
+    double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y, bdz = double(b.z) - d.z;
+    double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y, cdz = double(c.z) - d.z;
+
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+    double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * std::fabs(adz)
+                     + (std::fabs(cdxady) + std::fabs(adxcdy)) * std::fabs(bdz)
+                     + (std::fabs(adxbdy) + std::fabs(bdxady)) * std::fabs(cdz);
+
+    errorBound = ORIENT3D_ERROR_BOUND * permanent;
+    return adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+}
+
+/* Double precision evaluation of incircle with its error bound: */
+inline double incircleFilter(const Vec4f& a, const Vec4f& b, const Vec4f& c, const Vec4f& d, double& errorBound){
+    double adx = double(a.x) - d.x, ady = double(a.y) - d.y;
+    double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y;
+    double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y;
+
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+    double aLift = adx * adx + ady * ady;
+    double bLift = bdx * bdx + bdy * bdy;
+    double cLift = cdx * cdx + cdy * cdy;
+
+    double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * aLift
+                     + (std::fabs(cdxady) + std::fabs(adxcdy)) * bLift
+                     + (std::fabs(adxbdy) + std::fabs(bdxady)) * cLift;
+
+    errorBound = INCIRCLE_ERROR_BOUND * permanent;
+    return aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+}
+
+/* Double precision evaluation of insphere with its error bound: */
+inline double insphereFilter(const Vec4f& a, const Vec4f& b, const Vec4f& c, const Vec4f& d, const Vec4f& e,
+                             double& errorBound){
+    double aex = double(a.x) - e.x, aey = double(a.y) - e.y, aez = double(a.z) - e.z;
+    double bex = double(b.x) - e.x, bey = double(b.y) - e.y, bez = double(b.z) - e.z;
+    double cex = double(c.x) - e.x, cey = double(c.y) - e.y, cez = double(c.z) - e.z;
+    double dex = double(d.x) - e.x, dey = double(d.y) - e.y, dez = double(d.z) - e.z;
+
+    double aexbey = aex * bey, bexaey = bex * aey;
+    double bexcey = bex * cey, cexbey = cex * bey;
+    double cexdey = cex * dey, dexcey = dex * cey;
+    double dexaey = dex * aey, aexdey = aex * dey;
+    double aexcey = aex * cey, cexaey = cex * aey;
+    double bexdey = bex * dey, dexbey = dex * bey;
+
+    double ab = aexbey - bexaey, bc = bexcey - cexbey;
+    double cd = cexdey - dexcey, da = dexaey - aexdey;
+    double ac = aexcey - cexaey, bd = bexdey - dexbey;
+
+    double abc = aez * bc - bez * ac + cez * ab;
+    double bcd = bez * cd - cez * bd + dez * bc;
+    double cda = cez * da + dez * ac + aez * cd;
+    double dab = dez * ab + aez * bd + bez * da;
+
+    double aLift = aex * aex + aey * aey + aez * aez;
+    double bLift = bex * bex + bey * bey + bez * bez;
+    double cLift = cex * cex + cey * cey + cez * cez;
+    double dLift = dex * dex + dey * dey + dez * dez;
+
+    double aezPlus = std::fabs(aez), bezPlus = std::fabs(bez);
+    double cezPlus = std::fabs(cez), dezPlus = std::fabs(dez);
+    double aexbeyPlus = std::fabs(aexbey), bexaeyPlus = std::fabs(bexaey);
+    double bexceyPlus = std::fabs(bexcey), cexbeyPlus = std::fabs(cexbey);
+    double cexdeyPlus = std::fabs(cexdey), dexceyPlus = std::fabs(dexcey);
+    double dexaeyPlus = std::fabs(dexaey), aexdeyPlus = std::fabs(aexdey);
+    double aexceyPlus = std::fabs(aexcey), cexaeyPlus = std::fabs(cexaey);
+    double bexdeyPlus = std::fabs(bexdey), dexbeyPlus = std::fabs(dexbey);
+
+    double permanent = ((cexdeyPlus + dexceyPlus) * bezPlus
+                      + (dexbeyPlus + bexdeyPlus) * cezPlus
+                      + (bexceyPlus + cexbeyPlus) * dezPlus) * aLift
+                     + ((dexaeyPlus + aexdeyPlus) * cezPlus
+                      + (aexceyPlus + cexaeyPlus) * dezPlus
+                      + (cexdeyPlus + dexceyPlus) * aezPlus) * bLift
+                     + ((aexbeyPlus + bexaeyPlus) * dezPlus
+                      + (bexdeyPlus + dexbeyPlus) * aezPlus
+                      + (dexaeyPlus + aexdeyPlus) * bezPlus) * cLift
+                     + ((bexceyPlus + cexbeyPlus) * aezPlus
+                      + (cexaeyPlus + aexceyPlus) * bezPlus
+                      + (aexbeyPlus + bexaeyPlus) * cezPlus) * dLift;
+
+    errorBound = INSPHERE_ERROR_BOUND * permanent;
+    return (dLift * abc - cLift * dab) + (bLift * cda - aLift * bcd);
+}
+
+/* Returns the sign (-1, 0 or 1) of the given value: */
+inline int sign(double value){
+    return (value > 0.0) - (value < 0.0);
+}
+
+/**
+ * Runs a batch of predicates: 'filter(i, errorBound)' evaluates the double
+ * precision determinant of predicate i and 'exact(i)' its exact version.
+ * The filter is evaluated for a whole block first (so that this loop can be
+ * vectorized), afterwards the few uncertain results are recomputed exactly.
+ */
+template<typename Filter, typename Exact>
+void runBatch(int* signs, size_t count, const Filter& filter, const Exact& exact){
+    parallelFor(0, count, BATCH_GRAIN_SIZE, [&](size_t begin, size_t end){
+        double determinants[BATCH_BLOCK_SIZE];
+        double errorBounds[BATCH_BLOCK_SIZE];
+
+        for(size_t blockBegin=begin; blockBegin < end; blockBegin += BATCH_BLOCK_SIZE){
+            size_t blockSize = end - blockBegin < BATCH_BLOCK_SIZE ? end - blockBegin : BATCH_BLOCK_SIZE;
+
+            for(size_t k=0; k < blockSize; ++k)
+                determinants[k] = filter(blockBegin + k, errorBounds[k]);
+
+            for(size_t k=0; k < blockSize; ++k){
+                double det = determinants[k];
+                if(det >= errorBounds[k] || -det >= errorBounds[k])
+                    signs[blockBegin + k] = sign(det);
+                else
+                    signs[blockBegin + k] = sign(exact(blockBegin + k));
+            }
+        }
+    });
+}
+
+}
+
+double orient2d(const Vec4f a, const Vec4f b, const Vec4f c){
+    double errorBound;
+    double det = orient2dFilter(a, b, c, errorBound);
+
+    if(det >= errorBound || -det >= errorBound)
+        return det;
+
+    return orient2dExact(a, b, c);
+}
+
+double orient3d(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f d){
+    double errorBound;
+    double det = orient3dFilter(a, b, c, d, errorBound);
+
+    if(det >= errorBound || -det >= errorBound)
+        return det;
+
+    return orient3dExact(a, b, c, d);
+}
+
+double incircle(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f d){
+    double errorBound;
+    double det = incircleFilter(a, b, c, d, errorBound);
+
+    if(det >= errorBound || -det >= errorBound)
+        return det;
+
+    return incircleExact(a, b, c, d);
+}
+
+double insphere(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f d, const Vec4f e){
+    double errorBound;
+    double det = insphereFilter(a, b, c, d, e, errorBound);
+
+    if(det >= errorBound || -det >= errorBound)
+        return det;
+
+    return insphereExact(a, b, c, d, e);
+}
+
+void orient2dBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, int* signs, size_t count){
+    runBatch(signs, count,
+        [&](size_t i, double& errorBound){ return orient2dFilter(a[i], b[i], c[i], errorBound); },
+        [&](size_t i){ return orient2dExact(a[i], b[i], c[i]); });
+}
+
+void orient3dBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, const Vec4f* d, int* signs, size_t count){
+    runBatch(signs, count,
+        [&](size_t i, double& errorBound){ return orient3dFilter(a[i], b[i], c[i], d[i], errorBound); },
+        [&](size_t i){ return orient3dExact(a[i], b[i], c[i], d[i]); });
+}
+
+void orient3dBatch(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f* points, int* signs, size_t count){
+    runBatch(signs, count,
+        [&](size_t i, double& errorBound){ return orient3dFilter(a, b, c, points[i], errorBound); },
+        [&](size_t i){ return orient3dExact(a, b, c, points[i]); });
+}
+
+void incircleBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, const Vec4f* d, int* signs, size_t count){
+    runBatch(signs, count,
+        [&](size_t i, double& errorBound){ return incircleFilter(a[i], b[i], c[i], d[i], errorBound); },
+        [&](size_t i){ return incircleExact(a[i], b[i], c[i], d[i]); });
+}
+
+void insphereBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, const Vec4f* d, const Vec4f* e,
+                   int* signs, size_t count){
+    runBatch(signs, count,
+        [&](size_t i, double& errorBound){ return insphereFilter(a[i], b[i], c[i], d[i], e[i], errorBound); },
+        [&](size_t i){ return insphereExact(a[i], b[i], c[i], d[i], e[i]); });
+}
@@ -0,0 +1,98 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our Vec4f which is used for all points: */
+#include "Vec4f.h"
+
+/**
+ * Robust geometric predicates after J. R. Shewchuk ("Adaptive Precision
+ * Floating-Point Arithmetic and Fast Robust Geometric Predicates", 1997).
+ *
+ * Geometric algorithms like convex hulls or triangulations make decisions
+ * based on the sign of small determinants (is this point left of that line?).
+ * If these signs are computed with normal floating point arithmetic, rounding
+ * errors can produce contradicting answers for nearly degenerate input, and
+ * the algorithms break.
+ *
+ * Each predicate first evaluates the determinant in double precision (which
+ * is very accurate for float input) together with an upper bound of the
+ * rounding error. Only if the result is smaller than this bound, the
+ * determinant is evaluated again with exact expansion arithmetic. Therefore
+ * the sign is always correct, while the common case stays fast.
+ *
+ * All predicates return a value whose SIGN is exact (its magnitude is only
+ * an approximation of the determinant). The batch versions evaluate many
+ * predicates in parallel with a vectorized filter and store only the signs
+ * (-1, 0 or 1).
+ */
+
+/**
+ * Returns a positive value if the points a, b and c occur in counterclockwise
+ * order in the xy-plane, a negative value if they occur in clockwise order
+ * and zero if they are collinear. Only x and y are used.
+ */
+double orient2d(const Vec4f a, const Vec4f b, const Vec4f c);
+
+/**
+ * Returns a positive value if the point d lies below the plane through a, b
+ * and c, a negative value if it lies above the plane and zero if the four
+ * points are coplanar. 'Below' is defined so that a, b and c appear in
+ * counterclockwise order when viewed from above the plane. Only x, y and z
+ * are used.
+ */
+double orient3d(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f d);
+
+/**
+ * Returns a positive value if the point d lies inside the circle through a, b
+ * and c, a negative value if it lies outside and zero if the four points are
+ * cocircular. The points a, b and c must be in counterclockwise order (see
+ * orient2d(...)), otherwise the sign is reversed. Only x and y are used.
+ */
+double incircle(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f d);
+
+/**
+ * Returns a positive value if the point e lies inside the sphere through a, b,
+ * c and d, a negative value if it lies outside and zero if the five points are
+ * cospherical. The points a, b, c and d must be ordered so that they have a
+ * positive orientation (see orient3d(...)), otherwise the sign is reversed.
+ * Only x, y and z are used.
+ */
+double insphere(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f d, const Vec4f e);
+
+/**
+ * Evaluates orient2d(a[i], b[i], c[i]) for all i < count and stores the sign
+ * of each result (-1, 0 or 1) into signs[i].
+ */
+void orient2dBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, int* signs, size_t count);
+
+/**
+ * Evaluates orient3d(a[i], b[i], c[i], d[i]) for all i < count and stores the
+ * sign of each result (-1, 0 or 1) into signs[i].
+ */
+void orient3dBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, const Vec4f* d, int* signs, size_t count);
+
+/**
+ * Evaluates orient3d(a, b, c, points[i]) for all i < count (so the side of
+ * many points relative to one plane) and stores the sign of each result
+ * (-1, 0 or 1) into signs[i].
+ */
+void orient3dBatch(const Vec4f a, const Vec4f b, const Vec4f c, const Vec4f* points, int* signs, size_t count);
+
+/**
+ * Evaluates incircle(a[i], b[i], c[i], d[i]) for all i < count and stores the
+ * sign of each result (-1, 0 or 1) into signs[i].
+ */
+void incircleBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, const Vec4f* d, int* signs, size_t count);
+
+/**
+ * Evaluates insphere(a[i], b[i], c[i], d[i], e[i]) for all i < count and
+ * stores the sign of each result (-1, 0 or 1) into signs[i].
+ */
+void insphereBatch(const Vec4f* a, const Vec4f* b, const Vec4f* c, const Vec4f* d, const Vec4f* e,
+                   int* signs, size_t count);
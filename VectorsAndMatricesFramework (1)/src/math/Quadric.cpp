@@ -0,0 +1,127 @@
+#include "Quadric.h"
+
+#include <cmath>
+
+Quadric::Quadric(){
+    for(int i=0; i < 10; ++i)
+        data[i] = 0.f;
+}
+
+Quadric::Quadric(const Vec4f plane, const float weight){
+    float a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+    data[0] = weight * a * a; data[1] = weight * a * b; data[2] = weight * a * c; data[3] = weight * a * d;
+    data[4] = weight * b * b; data[5] = weight * b * c; data[6] = weight * b * d;
+    data[7] = weight * c * c; data[8] = weight * c * d;
+    data[9] = weight * d * d;
+}
+
+Quadric::Quadric(const Mat4f& matrix){
+    // Copy the upper triangle row by row (cell (row, col) = data[col * 4 + row]):
+    int i = 0;
+    for(int row=0; row < 4; ++row){
+        for(int col=row; col < 4; ++col){
+            data[i++] = matrix.data[col * 4 + row];
+        }
+    }
+}
+
+Mat4f Quadric::toMat4f() const{
+    float cells[16];
+    int i = 0;
+    for(int row=0; row < 4; ++row){
+        for(int col=row; col < 4; ++col){
+            cells[col * 4 + row] = data[i];
+            cells[row * 4 + col] = data[i];
+            ++i;
+        }
+    }
+    return Mat4f(cells);
+}
+
+Quadric& Quadric::operator+=(const Quadric& quadric){
+    for(int i=0; i < 10; ++i)
+        data[i] += quadric.data[i];
+    return *this;
+}
+
+Quadric Quadric::operator+(const Quadric& quadric) const{
+    Quadric result = *this;
+    result += quadric;
+    return result;
+}
+
+Quadric Quadric::operator-(const Quadric& quadric) const{
+    Quadric result;
+    for(int i=0; i < 10; ++i)
+        result.data[i] = data[i] - quadric.data[i];
+    return result;
+}
+
+Quadric Quadric::operator*(const float scalar) const{
+    Quadric result;
+    for(int i=0; i < 10; ++i)
+        result.data[i] = data[i] * scalar;
+    return result;
+}
+
+Quadric Quadric::translate(const Vec4f translation) const{
+    // With A = upper left 3x3 block, b = last column and c = data[9], the
+    // error of q'(p) = q(p - t) has A' = A, b' = b - A * t and c' = q(-t):
+    double t[3] = {translation.x, translation.y, translation.z};
+    double a[3][3] = {{data[0], data[1], data[2]},
+                      {data[1], data[4], data[5]},
+                      {data[2], data[5], data[7]}};
+    double b[3] = {data[3], data[6], data[8]};
+
+    double at[3];
+    for(int row=0; row < 3; ++row)
+        at[row] = a[row][0] * t[0] + a[row][1] * t[1] + a[row][2] * t[2];
+
+    Quadric result = *this;
+    result.data[3] = float(b[0] - at[0]);
+    result.data[6] = float(b[1] - at[1]);
+    result.data[8] = float(b[2] - at[2]);
+    result.data[9] = float(double(data[9]) - 2.0 * (b[0] * t[0] + b[1] * t[1] + b[2] * t[2])
+                           + at[0] * t[0] + at[1] * t[1] + at[2] * t[2]);
+    return result;
+}
+
+double Quadric::evaluate(const Vec4f point) const{
+    double x = point.x, y = point.y, z = point.z;
+
+    // p^T * Q * p, where every off-diagonal cell appears twice:
+    double error = data[0] * x * x + data[4] * y * y + data[7] * z * z + double(data[9])
+                 + 2.0 * (data[1] * x * y + data[2] * x * z + data[5] * y * z)
+                 + 2.0 * (data[3] * x + data[6] * y + data[8] * z);
+
+    return error > 0.0 ? error : 0.0;
+}
+
+bool Quadric::findMinimum(Vec4f& result) const{
+    // The gradient vanishes where A * p = -b with A = upper left 3x3 block:
+    double a00 = data[0], a01 = data[1], a02 = data[2];
+    double a11 = data[4], a12 = data[5], a22 = data[7];
+    double b0 = -data[3], b1 = -data[6], b2 = -data[8];
+
+    // Cofactors of the symmetric matrix:
+    double c00 = a11 * a22 - a12 * a12;
+    double c01 = a02 * a12 - a01 * a22;
+    double c02 = a01 * a12 - a02 * a11;
+    double c11 = a00 * a22 - a02 * a02;
+    double c12 = a01 * a02 - a00 * a12;
+    double c22 = a00 * a11 - a01 * a01;
+
+    double determinant = a00 * c00 + a01 * c01 + a02 * c02;
+
+    // Compare against the scale of the matrix, so that the test does not
+    // depend on the units of the coordinates:
+    double trace = a00 + a11 + a22;
+    if(!(std::fabs(determinant) > 1e-6 * trace * trace * trace))
+        return false;
+
+    double inverse = 1.0 / determinant;
+    result = Vec4f(float((c00 * b0 + c01 * b1 + c02 * b2) * inverse),
+                   float((c01 * b0 + c11 * b1 + c12 * b2) * inverse),
+                   float((c02 * b0 + c12 * b1 + c22 * b2) * inverse), 1.f);
+    return true;
+}
@@ -0,0 +1,105 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Include our math classes: */
+#include "Vec4f.h"
+#include "Mat4f.h"
+
+/**
+ * A quadric error metric (Garland and Heckbert, 1997): a symmetric 4x4
+ * matrix Q which measures the sum of squared distances of a point p to a set
+ * of planes as p^T * Q * p (with p = (x, y, z, 1)).
+ *
+ * For a plane (a, b, c, d) with a normalized normal (a, b, c), the quadric
+ * is the outer product of the plane vector with itself. The quadric of a set
+ * of planes is simply the sum of their quadrics, so a quadric can accumulate
+ * any number of planes in constant space.
+ *
+ * Since Q is symmetric, only its upper triangle is stored (10 instead of 16
+ * floats). Use toMat4f() if you need the full matrix:
+ *
+ *     | data[0] data[1] data[2] data[3] |
+ *     | data[1] data[4] data[5] data[6] |
+ *     | data[2] data[5] data[7] data[8] |
+ *     | data[3] data[6] data[8] data[9] |
+ */
+
+class Quadric
+{
+public:
+    /** The upper triangle of the symmetric matrix (row by row) */
+    float data[10];
+
+    /**
+     * Constructs a zero quadric (the error of every point is zero).
+     */
+    Quadric();
+
+    /**
+     * Constructs the quadric of the given plane (a, b, c, d), where (a, b, c)
+     * must be normalized, multiplied by the given weight.
+     */
+    explicit Quadric(const Vec4f plane, const float weight = 1.f);
+
+    /**
+     * Constructs a quadric from the upper triangle of the given matrix (the
+     * lower triangle is ignored).
+     */
+    explicit Quadric(const Mat4f& matrix);
+
+    /**
+     * Returns the full symmetric 4x4 matrix of this quadric.
+     */
+    Mat4f toMat4f() const;
+
+    /**
+     * Adds the given quadric to this one (so this quadric measures the
+     * distances to the planes of both).
+     */
+    Quadric& operator+=(const Quadric& quadric);
+
+    /**
+     * Returns the sum of this and the given quadric.
+     */
+    Quadric operator+(const Quadric& quadric) const;
+
+    /**
+     * Returns the difference of this and the given quadric.
+     */
+    Quadric operator-(const Quadric& quadric) const;
+
+    /**
+     * Returns this quadric multiplied by the given scalar.
+     */
+    Quadric operator*(const float scalar) const;
+
+    /**
+     * Returns the quadric of the planes translated by the given vector (its w
+     * component is ignored), so that result.evaluate(p + translation) equals
+     * evaluate(p).
+     *
+     * The error is computed by summing up large terms which cancel each
+     * other, so float quadrics lose precision far away from their origin.
+     * Keeping the quadric of a vertex relative to the vertex position (and
+     * translating it when the vertex moves) avoids this.
+     */
+    Quadric translate(const Vec4f translation) const;
+
+    /**
+     * Returns the error p^T * Q * p of the given point (its w component is
+     * ignored and treated as 1). The computation is performed in double
+     * precision, the result is never negative.
+     */
+    double evaluate(const Vec4f point) const;
+
+    /**
+     * Computes the point with the smallest error, which is the solution of
+     * the 3x3 linear system formed by the first three rows. Returns false
+     * (and leaves 'result' unchanged) if the system is (nearly) singular,
+     * which happens if all planes are parallel or intersect in a line.
+     */
+    bool findMinimum(Vec4f& result) const;
+};
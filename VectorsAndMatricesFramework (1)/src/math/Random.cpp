@@ -0,0 +1,235 @@
+#include "Random.h"
+#include "Parallel.h"
+
+namespace {
+
+/* Returns the next number of the SplitMix64 sequence with the given state: */
+uint64_t nextSplitMix64(uint64_t& state){
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* Rotates the bits of x to the left: */
+inline uint32_t rotateLeft(uint32_t x, int bits){
+    return (x << bits) | (x >> (32 - bits));
+}
+
+/* Returns the sine and cosine of 2 * pi * t per lane for t in [0, 1). The
+   angle is moved into [-pi / 2, pi / 2], where the Taylor series up to the
+   terms of degree 11 and 12 are accurate to about 6e-8. */
+void computeSinCos(const FloatLanes& t, FloatLanes& sine, FloatLanes& cosine){
+    const float pi = 3.14159265358979f;
+
+    // sin(2 pi t) = -sin(a) and cos(2 pi t) = -cos(a) with a in [-pi, pi):
+    FloatLanes a = (t - broadcast(0.5f)) * (2.f * pi);
+    LaneMask above = a > broadcast(0.5f * pi);
+    LaneMask below = a < broadcast(-0.5f * pi);
+    FloatLanes q = select(above, pi - a, select(below, -pi - a, a));
+    FloatLanes sign = select(above, broadcast(1.f), select(below, broadcast(1.f), broadcast(-1.f)));
+
+    FloatLanes q2 = q * q;
+    FloatLanes s = broadcast(-1.f / 39916800.f);
+    s = s * q2 + 1.f / 362880.f;
+    s = s * q2 + -1.f / 5040.f;
+    s = s * q2 + 1.f / 120.f;
+    s = s * q2 + -1.f / 6.f;
+    s = s * q2 + 1.f;
+    FloatLanes c = broadcast(1.f / 479001600.f);
+    c = c * q2 + -1.f / 3628800.f;
+    c = c * q2 + 1.f / 40320.f;
+    c = c * q2 + -1.f / 720.f;
+    c = c * q2 + 1.f / 24.f;
+    c = c * q2 + -1.f / 2.f;
+    c = c * q2 + 1.f;
+
+    sine = -(s * q);
+    cosine = sign * c;
+}
+
+/* Stores the first 'count' lanes as Vec4f (with the given w): */
+void storeVectors(Vec4f* vectors, size_t count, const FloatLanes& x, const FloatLanes& y, const FloatLanes& z,
+                  float w){
+    for(size_t l=0; l < count; ++l){
+        vectors[l].x = x.v[l];
+        vectors[l].y = y.v[l];
+        vectors[l].z = z.v[l];
+        vectors[l].w = w;
+    }
+}
+
+/**
+ * Calls generate(random, first, count) for all groups of FLOAT_LANES elements
+ * in parallel, where 'random' is the stream of the chunk of the group (see
+ * RANDOM_GRAIN_SIZE) and 'count' is the number of elements of the group.
+ */
+template<typename Generate>
+void generateChunks(size_t count, uint64_t seed, const Generate& generate){
+    parallelFor(0, count, RANDOM_GRAIN_SIZE, [&](size_t begin, size_t end){
+        RandomLanes random(seed, begin / RANDOM_GRAIN_SIZE);
+        for(size_t first=begin; first < end; first += FLOAT_LANES)
+            generate(random, first, end - first < FLOAT_LANES ? end - first : size_t(FLOAT_LANES));
+    });
+}
+
+/* Computes uniformly distributed points in the unit disk per lane (the
+   radius sqrt(u) gives the density 2r): */
+void sampleDisk(RandomLanes& random, FloatLanes& x, FloatLanes& y){
+    FloatLanes radius = sqrt(random.nextFloat());
+    FloatLanes sine, cosine;
+    computeSinCos(random.nextFloat(), sine, cosine);
+    x = radius * cosine;
+    y = radius * sine;
+}
+
+/* Computes uniformly distributed unit vectors per lane: */
+void sampleSphere(RandomLanes& random, FloatLanes& x, FloatLanes& y, FloatLanes& z){
+    z = 1.f - 2.f * random.nextFloat();
+    FloatLanes radius = sqrt(maximum(broadcast(0.f), 1.f - z * z));
+    FloatLanes sine, cosine;
+    computeSinCos(random.nextFloat(), sine, cosine);
+    x = radius * cosine;
+    y = radius * sine;
+}
+
+/**
+ * Computes cosine distributed directions around the normals (nx, ny, nz)
+ * per lane.
+ */
+void sampleCosineHemisphere(RandomLanes& random, const FloatLanes& nx, const FloatLanes& ny, const FloatLanes& nz,
+                            FloatLanes& x, FloatLanes& y, FloatLanes& z){
+    // A point in the disk, lifted onto the hemisphere:
+    FloatLanes u = random.nextFloat();
+    FloatLanes radius = sqrt(u);
+    FloatLanes sine, cosine;
+    computeSinCos(random.nextFloat(), sine, cosine);
+    FloatLanes a = radius * cosine, b = radius * sine;
+    FloatLanes c = sqrt(maximum(broadcast(0.f), 1.f - u));
+
+    // The tangent t and bitangent s of the normal (Duff et al.):
+    FloatLanes sign = select(nz < broadcast(0.f), broadcast(-1.f), broadcast(1.f));
+    FloatLanes inverse = broadcast(-1.f) / (sign + nz);
+    FloatLanes product = nx * ny * inverse;
+    FloatLanes tx = sign * nx * nx * inverse + 1.f, ty = sign * product, tz = -(sign * nx);
+    FloatLanes sx = product, sy = sign + ny * ny * inverse, sz = -ny;
+
+    x = a * tx + b * sx + c * nx;
+    y = a * ty + b * sy + c * ny;
+    z = a * tz + b * sz + c * nz;
+}
+
+}
+
+RandomLanes::RandomLanes(uint64_t seed, uint64_t stream){
+    for(int l=0; l < FLOAT_LANES; ++l){
+        uint64_t splitMix = seed;
+        splitMix = nextSplitMix64(splitMix) ^ stream;
+        splitMix = nextSplitMix64(splitMix) ^ uint64_t(l);
+        uint64_t first = nextSplitMix64(splitMix), second = nextSplitMix64(splitMix);
+
+        // The state must not be zero (which the hash practically never
+        // gives, but it costs nothing to be sure):
+        if(first == 0 && second == 0)
+            first = 1;
+        state[0][l] = uint32_t(first);
+        state[1][l] = uint32_t(first >> 32);
+        state[2][l] = uint32_t(second);
+        state[3][l] = uint32_t(second >> 32);
+    }
+}
+
+void RandomLanes::nextBits(uint32_t bits[FLOAT_LANES]){
+    for(int l=0; l < FLOAT_LANES; ++l){
+        bits[l] = rotateLeft(state[1][l] * 5u, 7) * 9u;
+        uint32_t t = state[1][l] << 9;
+        state[2][l] ^= state[0][l];
+        state[3][l] ^= state[1][l];
+        state[1][l] ^= state[2][l];
+        state[0][l] ^= state[3][l];
+        state[2][l] ^= t;
+        state[3][l] = rotateLeft(state[3][l], 11);
+    }
+}
+
+FloatLanes RandomLanes::nextFloat(){
+    uint32_t bits[FLOAT_LANES];
+    nextBits(bits);
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l)
+        r.v[l] = float(int32_t(bits[l] >> 8)) * (1.f / 16777216.f);
+    return r;
+}
+
+void generateUniform(float* values, size_t count, uint64_t seed, float min, float max){
+    float range = max - min;
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        FloatLanes u = random.nextFloat() * range + min;
+        for(size_t l=0; l < lanes; ++l)
+            values[first + l] = u.v[l];
+    });
+}
+
+void generatePointsInSphere(Vec4f* points, size_t count, uint64_t seed){
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        FloatLanes x, y, z;
+        sampleSphere(random, x, y, z);
+        FloatLanes radius = random.nextFloat();
+        radius = maximum(radius, random.nextFloat());
+        radius = maximum(radius, random.nextFloat());
+        storeVectors(&points[first], lanes, x * radius, y * radius, z * radius, 1.f);
+    });
+}
+
+void generatePointsOnSphere(Vec4f* directions, size_t count, uint64_t seed){
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        FloatLanes x, y, z;
+        sampleSphere(random, x, y, z);
+        storeVectors(&directions[first], lanes, x, y, z, 0.f);
+    });
+}
+
+void generatePointsInDisk(Vec4f* points, size_t count, uint64_t seed){
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        FloatLanes x, y;
+        sampleDisk(random, x, y);
+        storeVectors(&points[first], lanes, x, y, broadcast(0.f), 1.f);
+    });
+}
+
+void generatePointsInTriangle(Vec4f* points, size_t count, const Vec4f& a, const Vec4f& b, const Vec4f& c,
+                              uint64_t seed){
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        // Points in the parallelogram, folded back into the triangle:
+        FloatLanes u = random.nextFloat(), v = random.nextFloat();
+        LaneMask outside = (u + v) > broadcast(1.f);
+        u = select(outside, 1.f - u, u);
+        v = select(outside, 1.f - v, v);
+        storeVectors(&points[first], lanes, u * (b.x - a.x) + v * (c.x - a.x) + a.x,
+                     u * (b.y - a.y) + v * (c.y - a.y) + a.y, u * (b.z - a.z) + v * (c.z - a.z) + a.z, 1.f);
+    });
+}
+
+void generateCosineHemisphere(Vec4f* directions, size_t count, const Vec4f& normal, uint64_t seed){
+    FloatLanes nx = broadcast(normal.x), ny = broadcast(normal.y), nz = broadcast(normal.z);
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        FloatLanes x, y, z;
+        sampleCosineHemisphere(random, nx, ny, nz, x, y, z);
+        storeVectors(&directions[first], lanes, x, y, z, 0.f);
+    });
+}
+
+void generateCosineHemisphere(Vec4f* directions, const Vec4f* normals, size_t count, uint64_t seed){
+    generateChunks(count, seed, [&](RandomLanes& random, size_t first, size_t lanes){
+        // Unused lanes get the normal (0, 0, 1):
+        FloatLanes nx = broadcast(0.f), ny = broadcast(0.f), nz = broadcast(1.f);
+        for(size_t l=0; l < lanes; ++l){
+            nx.v[l] = normals[first + l].x;
+            ny.v[l] = normals[first + l].y;
+            nz.v[l] = normals[first + l].z;
+        }
+        FloatLanes x, y, z;
+        sampleCosineHemisphere(random, nx, ny, nz, x, y, z);
+        storeVectors(&directions[first], lanes, x, y, z, 0.f);
+    });
+}
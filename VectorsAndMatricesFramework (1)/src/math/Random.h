@@ -0,0 +1,113 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and fixed size integer types like uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Include our math classes: */
+#include "Vec4f.h"
+#include "FloatLanes.h"
+
+/**
+ * FLOAT_LANES independent xoshiro128** generators (Blackman and Vigna,
+ * "Scrambled linear pseudorandom number generators", 2021), one per lane.
+ * A generator only needs 32 bit shifts, rotations, xors and multiplications,
+ * so the lanes are advanced together with SIMD instructions (like all other
+ * FloatLanes code).
+ *
+ * Every pair (seed, stream) gives a different set of generators: the 128 bit
+ * states of the lanes are filled with SplitMix64 from a hash of the seed, the
+ * stream and the lane. Use one stream per thread or per chunk of work (see
+ * Parallel.h) to get independent random numbers without any sharing.
+ */
+
+class RandomLanes
+{
+public:
+    /**
+     * Initializes the generators of the given stream.
+     */
+    RandomLanes(uint64_t seed, uint64_t stream = 0);
+
+    /**
+     * Sets 'bits' to the next uniformly distributed 32 bit integer of every
+     * lane.
+     */
+    void nextBits(uint32_t bits[FLOAT_LANES]);
+
+    /**
+     * Returns the next uniformly distributed float in [0, 1) of every lane
+     * (with 24 random bits).
+     */
+    FloatLanes nextFloat();
+
+private:
+    /** The state of every lane */
+    uint32_t state[4][FLOAT_LANES];
+};
+
+/**
+ * The bulk generators fill whole arrays with random numbers in parallel. The
+ * array is split into chunks of RANDOM_GRAIN_SIZE elements, and the chunk k
+ * uses the stream k of RandomLanes, so every element only depends on the
+ * seed and its index: the result is the same for every number of threads
+ * (and the first n elements do not change if more elements are generated).
+ *
+ * Points are written with w = 1 and directions with w = 0.
+ */
+
+/* The number of elements which are generated by one task (and stream), a
+   multiple of FLOAT_LANES: */
+#define RANDOM_GRAIN_SIZE 16384
+
+/**
+ * Fills 'values' with uniformly distributed floats in [min, max).
+ */
+void generateUniform(float* values, size_t count, uint64_t seed, float min = 0.f, float max = 1.f);
+
+/**
+ * Fills 'points' with uniformly distributed points inside of the unit sphere.
+ * The radius is the maximum of three uniform numbers, which has the density
+ * 3r^2 of a ball without computing a cube root.
+ */
+void generatePointsInSphere(Vec4f* points, size_t count, uint64_t seed);
+
+/**
+ * Fills 'directions' with uniformly distributed unit vectors (points on the
+ * unit sphere, from z = 1 - 2u and an angle around the z-axis).
+ */
+void generatePointsOnSphere(Vec4f* directions, size_t count, uint64_t seed);
+
+/**
+ * Fills 'points' with uniformly distributed points inside of the unit disk in
+ * the xy-plane.
+ */
+void generatePointsInDisk(Vec4f* points, size_t count, uint64_t seed);
+
+/**
+ * Fills 'points' with uniformly distributed points inside of the triangle
+ * (a, b, c).
+ */
+void generatePointsInTriangle(Vec4f* points, size_t count, const Vec4f& a, const Vec4f& b, const Vec4f& c,
+                              uint64_t seed);
+
+/**
+ * Fills 'directions' with cosine distributed unit vectors in the hemisphere
+ * around the given unit normal (the density is proportional to the cosine of
+ * the angle to the normal, which is the ideal importance sampling of a
+ * diffuse surface). A uniformly distributed point in the unit disk is lifted
+ * onto the hemisphere (Malley's method) and rotated into the orthonormal
+ * basis of Duff et al. ("Building an orthonormal basis, revisited", 2017),
+ * which has no branches.
+ */
+void generateCosineHemisphere(Vec4f* directions, size_t count, const Vec4f& normal, uint64_t seed);
+
+/**
+ * Fills 'directions' with cosine distributed unit vectors around the given
+ * unit normals (one normal per direction, see above).
+ */
+void generateCosineHemisphere(Vec4f* directions, const Vec4f* normals, size_t count, uint64_t seed);
@@ -0,0 +1,173 @@
+#include "Reductions.h"
+#include "Parallel.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/**
+ * Sums the REDUCTION_LANES accumulators of a chunk in a fixed tree order.
+ */
+double sumLanes(const float lanes[REDUCTION_LANES]){
+    float sums[REDUCTION_LANES];
+    for(int l=0; l < REDUCTION_LANES; ++l)
+        sums[l] = lanes[l];
+
+    for(int step=1; step < REDUCTION_LANES; step *= 2){
+        for(int l=0; l + step < REDUCTION_LANES; l += 2 * step){
+            sums[l] += sums[l + step];
+        }
+    }
+
+    return sums[0];
+}
+
+/* Partial result of the centroid computation: */
+struct Sum3 {
+    double x, y, z;
+};
+
+/* Partial result of the covariance computation (upper triangle): */
+struct Sum6 {
+    double xx, xy, xz, yy, yz, zz;
+};
+
+}
+
+AABB computeAABB(const Vec4f* points, size_t count){
+    Vec4f min, max;
+    computeMinMax(points, count, min, max);
+
+    AABB box;
+    box.min = Vec4f(min.x, min.y, min.z, 1.f);
+    box.max = Vec4f(max.x, max.y, max.z, 1.f);
+    return box;
+}
+
+void computeMinMax(const Vec4f* vectors, size_t count, Vec4f& min, Vec4f& max){
+    std::pair<Vec4f, Vec4f> identity(Vec4f(FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX),
+                                     Vec4f(-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX));
+
+    std::pair<Vec4f, Vec4f> result = parallelReduce(size_t(0), count, REDUCTION_GRAIN_SIZE, identity,
+        [&](size_t begin, size_t end){
+            // One minimum and maximum per lane and component, so that the loop
+            // has no dependency between consecutive elements:
+            float lanesMin[4][REDUCTION_LANES];
+            float lanesMax[4][REDUCTION_LANES];
+            for(int c=0; c < 4; ++c){
+                for(int l=0; l < REDUCTION_LANES; ++l){
+                    lanesMin[c][l] = FLT_MAX;
+                    lanesMax[c][l] = -FLT_MAX;
+                }
+            }
+
+            for(size_t i=begin; i < end; i += REDUCTION_LANES){
+                int lanes = end - i < REDUCTION_LANES ? int(end - i) : REDUCTION_LANES;
+                for(int l=0; l < lanes; ++l){
+                    const float* v = &vectors[i + l].x;
+                    for(int c=0; c < 4; ++c){
+                        lanesMin[c][l] = std::fmin(lanesMin[c][l], v[c]);
+                        lanesMax[c][l] = std::fmax(lanesMax[c][l], v[c]);
+                    }
+                }
+            }
+
+            std::pair<Vec4f, Vec4f> chunk = identity;
+            for(int c=0; c < 4; ++c){
+                for(int l=0; l < REDUCTION_LANES; ++l){
+                    chunk.first[c] = std::fmin(chunk.first[c], lanesMin[c][l]);
+                    chunk.second[c] = std::fmax(chunk.second[c], lanesMax[c][l]);
+                }
+            }
+            return chunk;
+        },
+        [](const std::pair<Vec4f, Vec4f>& a, const std::pair<Vec4f, Vec4f>& b){
+            std::pair<Vec4f, Vec4f> combined;
+            for(int c=0; c < 4; ++c){
+                combined.first[c] = std::fmin(a.first[c], b.first[c]);
+                combined.second[c] = std::fmax(a.second[c], b.second[c]);
+            }
+            return combined;
+        });
+
+    min = result.first;
+    max = result.second;
+}
+
+Vec4f computeCentroid(const Vec4f* points, size_t count){
+    if(count == 0)
+        throw std::invalid_argument("The centroid of zero points is undefined!");
+
+    Sum3 zero = {0.0, 0.0, 0.0};
+    Sum3 sum = parallelReduce(size_t(0), count, REDUCTION_GRAIN_SIZE, zero,
+        [&](size_t begin, size_t end){
+            float x[REDUCTION_LANES] = {}, y[REDUCTION_LANES] = {}, z[REDUCTION_LANES] = {};
+
+            for(size_t i=begin; i < end; i += REDUCTION_LANES){
+                int lanes = end - i < REDUCTION_LANES ? int(end - i) : REDUCTION_LANES;
+                for(int l=0; l < lanes; ++l){
+                    x[l] += points[i + l].x;
+                    y[l] += points[i + l].y;
+                    z[l] += points[i + l].z;
+                }
+            }
+
+            Sum3 chunk = {sumLanes(x), sumLanes(y), sumLanes(z)};
+            return chunk;
+        },
+        [](const Sum3& a, const Sum3& b){
+            Sum3 combined = {a.x + b.x, a.y + b.y, a.z + b.z};
+            return combined;
+        });
+
+    return Vec4f(float(sum.x / count), float(sum.y / count), float(sum.z / count), 1.f);
+}
+
+Mat4f computeCovariance(const Vec4f* points, size_t count, const Vec4f mean){
+    if(count == 0)
+        throw std::invalid_argument("The covariance of zero points is undefined!");
+
+    Sum6 zero = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    Sum6 sum = parallelReduce(size_t(0), count, REDUCTION_GRAIN_SIZE, zero,
+        [&](size_t begin, size_t end){
+            float xx[REDUCTION_LANES] = {}, xy[REDUCTION_LANES] = {}, xz[REDUCTION_LANES] = {};
+            float yy[REDUCTION_LANES] = {}, yz[REDUCTION_LANES] = {}, zz[REDUCTION_LANES] = {};
+
+            for(size_t i=begin; i < end; i += REDUCTION_LANES){
+                int lanes = end - i < REDUCTION_LANES ? int(end - i) : REDUCTION_LANES;
+                for(int l=0; l < lanes; ++l){
+                    // Subtracting the mean first keeps the products small:
+                    float dx = points[i + l].x - mean.x;
+                    float dy = points[i + l].y - mean.y;
+                    float dz = points[i + l].z - mean.z;
+
+                    xx[l] += dx * dx; xy[l] += dx * dy; xz[l] += dx * dz;
+                    yy[l] += dy * dy; yz[l] += dy * dz; zz[l] += dz * dz;
+                }
+            }
+
+            Sum6 chunk = {sumLanes(xx), sumLanes(xy), sumLanes(xz),
+                          sumLanes(yy), sumLanes(yz), sumLanes(zz)};
+            return chunk;
+        },
+        [](const Sum6& a, const Sum6& b){
+            Sum6 combined = {a.xx + b.xx, a.xy + b.xy, a.xz + b.xz,
+                             a.yy + b.yy, a.yz + b.yz, a.zz + b.zz};
+            return combined;
+        });
+
+    // Store the symmetric matrix in column-major order:
+    Mat4f covariance;
+    covariance.data[0] = float(sum.xx / count);
+    covariance.data[1] = covariance.data[4] = float(sum.xy / count);
+    covariance.data[2] = covariance.data[8] = float(sum.xz / count);
+    covariance.data[5] = float(sum.yy / count);
+    covariance.data[6] = covariance.data[9] = float(sum.yz / count);
+    covariance.data[10] = float(sum.zz / count);
+    return covariance;
+}
+
+Mat4f computeCovariance(const Vec4f* points, size_t count){
+    return computeCovariance(points, count, computeCentroid(points, count));
+}
@@ -0,0 +1,75 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our math classes: */
+#include "Vec4f.h"
+#include "Mat4f.h"
+#include "AABB.h"
+
+/**
+ * This file contains parallel reductions over (large) arrays of Vec4f, like
+ * the bounding box, the centroid or the covariance matrix of a point set.
+ *
+ * All functions split the array into chunks of REDUCTION_GRAIN_SIZE elements.
+ * Inside a chunk, the elements are accumulated into REDUCTION_LANES independent
+ * accumulators (so that the compiler can vectorize the loop), and the chunk
+ * results are combined in a fixed tree order (see parallelReduce(...) in
+ * Parallel.h). Therefore the results are bitwise identical regardless of the
+ * number of threads which is used.
+ */
+
+/* The number of elements which are reduced by one task: */
+#define REDUCTION_GRAIN_SIZE 16384
+
+/* The number of independent accumulators inside of a chunk: */
+#define REDUCTION_LANES 8
+
+/**
+ * Returns the axis aligned bounding box of the given points (only x, y and z
+ * are used). For count == 0, an empty box is returned.
+ */
+AABB computeAABB(const Vec4f* points, size_t count);
+
+/**
+ * Computes the minimum and maximum of every component (x, y, z AND w) of the
+ * given vectors. For count == 0, min is set to +FLT_MAX and max to -FLT_MAX.
+ */
+void computeMinMax(const Vec4f* vectors, size_t count, Vec4f& min, Vec4f& max);
+
+/**
+ * Returns the centroid (the mean) of the given points as a point (w = 1).
+ *
+ * The sums are accumulated in double precision across chunks, so that the
+ * result stays accurate for millions of points.
+ *
+ * Throws std::invalid_argument if count == 0.
+ */
+Vec4f computeCentroid(const Vec4f* points, size_t count);
+
+/**
+ * Returns the 3x3 covariance matrix of the given points (only x, y and z are
+ * used) in the upper left 3x3 block of a Mat4f. The remaining cells are those
+ * of the identity matrix.
+ *
+ * The covariance is the population covariance (divided by count) around the
+ * given mean:
+ *
+ *   C = 1/n * sum (p_i - mean) * (p_i - mean)^T
+ *
+ * Throws std::invalid_argument if count == 0.
+ */
+Mat4f computeCovariance(const Vec4f* points, size_t count, const Vec4f mean);
+
+/**
+ * Returns the 3x3 covariance matrix of the given points around their centroid
+ * (see computeCovariance(...) above).
+ *
+ * Throws std::invalid_argument if count == 0.
+ */
+Mat4f computeCovariance(const Vec4f* points, size_t count);
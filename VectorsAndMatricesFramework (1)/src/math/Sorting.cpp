@@ -0,0 +1,93 @@
+#include "Sorting.h"
+#include "Morton.h"
+#include "Parallel.h"
+#include "Reductions.h"
+
+#include <stdexcept>
+
+namespace {
+
+/* The number of bits per digit (and pass) of the radix sort: */
+const int RADIX_BITS = 8;
+const size_t RADIX_SIZE = size_t(1) << RADIX_BITS;
+
+/* The number of elements which are counted and scattered by one task: */
+const size_t RADIX_GRAIN_SIZE = 65536;
+
+}
+
+void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, int keyBits){
+    if(keys.size() != values.size())
+        throw std::invalid_argument("radixSort: the number of keys and values differ.");
+
+    size_t count = keys.size();
+    size_t chunkCount = getChunkCount(count, RADIX_GRAIN_SIZE);
+    std::vector<uint64_t> keyBuffer(count);
+    std::vector<uint32_t> valueBuffer(count);
+
+    // The number of elements of every digit in every chunk (digit-major, so
+    // that the prefix sum yields the offsets of a stable scatter):
+    std::vector<size_t> offsets(RADIX_SIZE * chunkCount);
+
+    for(int shift=0; shift < keyBits; shift += RADIX_BITS){
+        parallelFor(0, count, RADIX_GRAIN_SIZE, [&](size_t begin, size_t end){
+            size_t chunk = begin / RADIX_GRAIN_SIZE;
+            size_t histogram[RADIX_SIZE] = {};
+            for(size_t i=begin; i < end; ++i)
+                ++histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)];
+            for(size_t digit=0; digit < RADIX_SIZE; ++digit)
+                offsets[digit * chunkCount + chunk] = histogram[digit];
+        });
+
+        // Skip the pass if all keys have the same digit:
+        bool trivial = false;
+        for(size_t digit=0; digit < RADIX_SIZE && !trivial; ++digit){
+            size_t digitCount = 0;
+            for(size_t chunk=0; chunk < chunkCount; ++chunk)
+                digitCount += offsets[digit * chunkCount + chunk];
+            trivial = digitCount == count;
+        }
+        if(trivial)
+            continue;
+
+        size_t sum = 0;
+        for(size_t& offset : offsets){
+            size_t elements = offset;
+            offset = sum;
+            sum += elements;
+        }
+
+        parallelFor(0, count, RADIX_GRAIN_SIZE, [&](size_t begin, size_t end){
+            size_t chunk = begin / RADIX_GRAIN_SIZE;
+            size_t positions[RADIX_SIZE];
+            for(size_t digit=0; digit < RADIX_SIZE; ++digit)
+                positions[digit] = offsets[digit * chunkCount + chunk];
+            for(size_t i=begin; i < end; ++i){
+                size_t position = positions[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+                keyBuffer[position] = keys[i];
+                valueBuffer[position] = values[i];
+            }
+        });
+
+        keys.swap(keyBuffer);
+        values.swap(valueBuffer);
+    }
+}
+
+std::vector<uint32_t> computeMortonOrder(const Vec4f* points, size_t count){
+    if(count >= size_t(0xffffffffu))
+        throw std::invalid_argument("computeMortonOrder: too many points.");
+
+    AABB bounds = computeAABB(points, count);
+    std::vector<uint64_t> codes(count);
+    std::vector<uint32_t> order(count);
+    parallelFor(0, count, RADIX_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            codes[i] = computeMortonCode63(points[i], bounds);
+            order[i] = uint32_t(i);
+        }
+    });
+
+    radixSort(codes, order, 63);
+    return order;
+}
@@ -0,0 +1,41 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t, uint32_t and uint64_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors: */
+#include "Vec4f.h"
+
+/**
+ * Sorts the given keys in ascending order and applies the same permutation to
+ * the values (for example the indices of points). Only the lowest 'keyBits'
+ * bits of the keys are compared. The sort is stable: values with equal keys
+ * keep their order.
+ *
+ * This is a least significant digit radix sort with 8 bit digits, so it needs
+ * keyBits / 8 passes over the data (instead of the log n passes of a
+ * comparison sort). Every pass counts the digits of each chunk in parallel,
+ * computes the output offset of every digit in every chunk with a prefix sum,
+ * and scatters the chunks in parallel. Since the chunks never depend on the
+ * number of threads, neither does the result. Passes in which all keys have
+ * the same digit are skipped.
+ *
+ * Throws std::invalid_argument if the sizes of the arrays differ.
+ */
+void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, int keyBits = 64);
+
+/**
+ * Returns the indices of the given points sorted by their 63 bit Morton codes
+ * in the bounding box of the points (see Morton.h), so that consecutive
+ * indices refer to points which are mostly close to each other. Points in the
+ * same cell of the 2^21 x 2^21 x 2^21 grid keep their order.
+ */
+std::vector<uint32_t> computeMortonOrder(const Vec4f* points, size_t count);
@@ -0,0 +1,231 @@
+#include "SparseMatrix.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/* The number of rows which are processed by one task: */
+const size_t SPARSE_GRAIN_SIZE = 4096;
+
+/* An entry of a row during the construction (for block matrices, 'slot' is
+   the position inside the block): */
+struct RowEntry {
+    uint32_t column;
+    uint32_t slot;
+    float value;
+
+    bool operator<(const RowEntry& other) const {
+        return column < other.column;
+    }
+};
+
+/**
+ * Sorts the given entries by row (counting sort, the order of the triplets
+ * is kept within a row) and then every row by column (in parallel). Returns
+ * the sorted entries; rowStart receives the first entry of every row.
+ */
+std::vector<RowEntry> sortByRow(const std::vector<RowEntry>& entries, const std::vector<uint32_t>& rows,
+                                size_t rowCount, std::vector<uint32_t>& rowStart){
+    rowStart.assign(rowCount + 1, 0);
+    for(size_t k=0; k < rows.size(); ++k)
+        ++rowStart[rows[k] + 1];
+    for(size_t r=0; r < rowCount; ++r)
+        rowStart[r + 1] += rowStart[r];
+
+    std::vector<RowEntry> sorted(entries.size());
+    std::vector<uint32_t> fill(rowStart.begin(), rowStart.end() - 1);
+    for(size_t k=0; k < entries.size(); ++k)
+        sorted[fill[rows[k]]++] = entries[k];
+
+    parallelFor(0, rowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r)
+            std::stable_sort(sorted.begin() + rowStart[r], sorted.begin() + rowStart[r + 1]);
+    });
+
+    return sorted;
+}
+
+/* Counts the different columns of every row of sorted entries and turns the
+   counts into the row starts of the compressed matrix: */
+void countColumns(const std::vector<RowEntry>& sorted, const std::vector<uint32_t>& sortedStart,
+                  std::vector<uint32_t>& rowStart){
+    size_t rowCount = sortedStart.size() - 1;
+    rowStart.assign(rowCount + 1, 0);
+
+    parallelFor(0, rowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            uint32_t count = 0;
+            for(uint32_t k=sortedStart[r]; k < sortedStart[r + 1]; ++k){
+                if(k == sortedStart[r] || sorted[k].column != sorted[k - 1].column)
+                    ++count;
+            }
+            rowStart[r + 1] = count;
+        }
+    });
+
+    for(size_t r=0; r < rowCount; ++r)
+        rowStart[r + 1] += rowStart[r];
+}
+
+}
+
+Triplet::Triplet(uint32_t row, uint32_t column, float value)
+    : row(row), column(column), value(value)
+{}
+
+SparseMatrix::SparseMatrix()
+    : rowCount(0), columnCount(0), rowStart(1, 0)
+{}
+
+SparseMatrix::SparseMatrix(size_t rowCount, size_t columnCount, const std::vector<Triplet>& triplets)
+    : rowCount(rowCount), columnCount(columnCount)
+{
+    std::vector<RowEntry> entries(triplets.size());
+    std::vector<uint32_t> rows(triplets.size());
+    for(size_t k=0; k < triplets.size(); ++k){
+        if(triplets[k].row >= rowCount || triplets[k].column >= columnCount)
+            throw std::invalid_argument("SparseMatrix: triplet outside of the matrix.");
+        entries[k].column = triplets[k].column;
+        entries[k].slot = 0;
+        entries[k].value = triplets[k].value;
+        rows[k] = triplets[k].row;
+    }
+
+    std::vector<uint32_t> sortedStart;
+    std::vector<RowEntry> sorted = sortByRow(entries, rows, rowCount, sortedStart);
+    countColumns(sorted, sortedStart, rowStart);
+
+    // Add up the entries with equal columns:
+    columns.resize(rowStart[rowCount]);
+    values.resize(rowStart[rowCount]);
+    parallelFor(0, rowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            uint32_t target = rowStart[r] - 1;
+            for(uint32_t k=sortedStart[r]; k < sortedStart[r + 1]; ++k){
+                if(k == sortedStart[r] || sorted[k].column != sorted[k - 1].column){
+                    columns[++target] = sorted[k].column;
+                    values[target] = 0.f;
+                }
+                values[target] += sorted[k].value;
+            }
+        }
+    });
+}
+
+size_t SparseMatrix::getNonZeroCount() const{
+    return values.size();
+}
+
+std::vector<float> SparseMatrix::getDiagonal() const{
+    std::vector<float> diagonal(rowCount < columnCount ? rowCount : columnCount, 0.f);
+    parallelFor(0, diagonal.size(), SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            const uint32_t* first = columns.data() + rowStart[r];
+            const uint32_t* last = columns.data() + rowStart[r + 1];
+            const uint32_t* found = std::lower_bound(first, last, uint32_t(r));
+            if(found != last && *found == r)
+                diagonal[r] = values[found - columns.data()];
+        }
+    });
+    return diagonal;
+}
+
+void SparseMatrix::multiply(const float* x, float* y) const{
+    parallelFor(0, rowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            float sum = 0.f;
+            for(uint32_t k=rowStart[r]; k < rowStart[r + 1]; ++k)
+                sum += values[k] * x[columns[k]];
+            y[r] = sum;
+        }
+    });
+}
+
+BlockSparseMatrix::BlockSparseMatrix()
+    : blockRowCount(0), blockColumnCount(0), rowStart(1, 0)
+{}
+
+BlockSparseMatrix::BlockSparseMatrix(size_t blockRowCount, size_t blockColumnCount, const std::vector<Triplet>& triplets)
+    : blockRowCount(blockRowCount), blockColumnCount(blockColumnCount)
+{
+    std::vector<RowEntry> entries(triplets.size());
+    std::vector<uint32_t> rows(triplets.size());
+    for(size_t k=0; k < triplets.size(); ++k){
+        if(triplets[k].row >= 3 * blockRowCount || triplets[k].column >= 3 * blockColumnCount)
+            throw std::invalid_argument("BlockSparseMatrix: triplet outside of the matrix.");
+        entries[k].column = triplets[k].column / 3;
+        entries[k].slot = 4 * (triplets[k].column % 3) + triplets[k].row % 3;
+        entries[k].value = triplets[k].value;
+        rows[k] = triplets[k].row / 3;
+    }
+
+    std::vector<uint32_t> sortedStart;
+    std::vector<RowEntry> sorted = sortByRow(entries, rows, blockRowCount, sortedStart);
+    countColumns(sorted, sortedStart, rowStart);
+
+    // Add the entries into their blocks:
+    columns.resize(rowStart[blockRowCount]);
+    blocks.assign(12 * rowStart[blockRowCount], 0.f);
+    parallelFor(0, blockRowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            uint32_t target = rowStart[r] - 1;
+            for(uint32_t k=sortedStart[r]; k < sortedStart[r + 1]; ++k){
+                if(k == sortedStart[r] || sorted[k].column != sorted[k - 1].column)
+                    columns[++target] = sorted[k].column;
+                blocks[12 * size_t(target) + sorted[k].slot] += sorted[k].value;
+            }
+        }
+    });
+}
+
+size_t BlockSparseMatrix::getBlockCount() const{
+    return columns.size();
+}
+
+SparseMatrix BlockSparseMatrix::toSparseMatrix() const{
+    SparseMatrix matrix;
+    matrix.rowCount = 3 * blockRowCount;
+    matrix.columnCount = 3 * blockColumnCount;
+    matrix.rowStart.resize(matrix.rowCount + 1);
+    matrix.columns.resize(9 * getBlockCount());
+    matrix.values.resize(9 * getBlockCount());
+
+    // Every row of a block row has the same columns:
+    for(size_t r=0; r <= matrix.rowCount; ++r){
+        size_t blockRow = r / 3;
+        matrix.rowStart[r] = blockRow < blockRowCount ?
+            uint32_t(9 * rowStart[blockRow] + 3 * (r % 3) * (rowStart[blockRow + 1] - rowStart[blockRow])) :
+            uint32_t(9 * rowStart[blockRowCount]);
+    }
+
+    parallelFor(0, matrix.rowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            uint32_t target = matrix.rowStart[r];
+            for(uint32_t k=rowStart[r / 3]; k < rowStart[r / 3 + 1]; ++k){
+                for(uint32_t j=0; j < 3; ++j){
+                    matrix.columns[target] = 3 * columns[k] + j;
+                    matrix.values[target++] = blocks[12 * size_t(k) + 4 * j + r % 3];
+                }
+            }
+        }
+    });
+
+    return matrix;
+}
+
+void BlockSparseMatrix::multiply(const Vec4f* x, Vec4f* y) const{
+    parallelFor(0, blockRowCount, SPARSE_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t r=begin; r < end; ++r){
+            float sum[4] = {0.f, 0.f, 0.f, 0.f};
+            for(uint32_t k=rowStart[r]; k < rowStart[r + 1]; ++k){
+                const float* block = blocks.data() + 12 * size_t(k);
+                const Vec4f& v = x[columns[k]];
+                for(int i=0; i < 4; ++i)
+                    sum[i] += block[i] * v.x + block[4 + i] * v.y + block[8 + i] * v.z;
+            }
+            y[r] = Vec4f(sum[0], sum[1], sum[2], 0.f);
+        }
+    });
+}
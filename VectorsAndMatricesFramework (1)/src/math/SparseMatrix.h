@@ -0,0 +1,170 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our Vec4f, which is used for the vectors of block matrices: */
+#include "Vec4f.h"
+
+/**
+ * Large matrices from meshes and simulations (Laplacians, stiffness and mass
+ * matrices, ...) have millions of rows, but only a few non-zero entries per
+ * row (one per neighbour). They are stored as sparse matrices, which only
+ * store the non-zero entries.
+ *
+ * Sparse matrices are usually assembled as a list of 'triplets' (row,
+ * column, value) in any order, for example one per edge of a mesh. Triplets
+ * with the same row and column are added up, so every element can simply
+ * add its contribution.
+ */
+
+/**
+ * One entry which is added to a sparse matrix.
+ */
+
+class Triplet
+{
+public:
+    /** The row of the entry */
+    uint32_t row;
+
+    /** The column of the entry */
+    uint32_t column;
+
+    /** The value which is added to the entry */
+    float value;
+
+    /**
+     * Constructs a triplet.
+     */
+    Triplet(uint32_t row, uint32_t column, float value);
+};
+
+/**
+ * A sparse matrix in the compressed sparse row (CSR) format: the non-zero
+ * entries of row r are columns[k] and values[k] for k = rowStart[r], ...,
+ * rowStart[r + 1] - 1, sorted by column.
+ */
+
+class SparseMatrix
+{
+public:
+    /** The number of rows */
+    size_t rowCount;
+
+    /** The number of columns */
+    size_t columnCount;
+
+    /** The first entry of every row (rowCount + 1 entries) */
+    std::vector<uint32_t> rowStart;
+
+    /** The column of every entry */
+    std::vector<uint32_t> columns;
+
+    /** The value of every entry */
+    std::vector<float> values;
+
+    /**
+     * Constructs an empty 0 x 0 matrix.
+     */
+    SparseMatrix();
+
+    /**
+     * Constructs the matrix from the given triplets (in any order; equal
+     * positions are added up). The triplets are sorted with a counting sort
+     * by row, and the rows are sorted in parallel.
+     *
+     * Throws std::invalid_argument if a triplet is outside of the matrix.
+     */
+    SparseMatrix(size_t rowCount, size_t columnCount, const std::vector<Triplet>& triplets);
+
+    /**
+     * Returns the number of stored entries.
+     */
+    size_t getNonZeroCount() const;
+
+    /**
+     * Returns the diagonal (0 for missing entries).
+     */
+    std::vector<float> getDiagonal() const;
+
+    /**
+     * Computes y = A * x in parallel. 'x' must have columnCount and 'y'
+     * rowCount elements, and they must not overlap.
+     */
+    void multiply(const float* x, float* y) const;
+};
+
+/**
+ * A sparse matrix of 3 x 3 blocks in the block compressed sparse row (BSR)
+ * format. Such matrices appear whenever every vertex has a 3D quantity
+ * (positions, displacements, velocities), for example in cloth and elasticity
+ * simulations. Compared to CSR, the column index is stored once per block
+ * instead of once per entry, and a block is multiplied with a whole vector.
+ *
+ * The vectors are arrays of Vec4f (one per block row or column) whose w is
+ * ignored. Every block is stored column by column like a Mat4f, padded to
+ * four rows with zeros, so blocks[12 * k + 4 * j + i] is the entry (i, j) of
+ * block k. This way the product of a block and a Vec4f is three 4-wide
+ * multiply-adds of whole columns, which the compiler vectorizes.
+ */
+
+class BlockSparseMatrix
+{
+public:
+    /** The number of block rows (the matrix has 3 * blockRowCount rows) */
+    size_t blockRowCount;
+
+    /** The number of block columns */
+    size_t blockColumnCount;
+
+    /** The first block of every block row (blockRowCount + 1 entries) */
+    std::vector<uint32_t> rowStart;
+
+    /** The block column of every block */
+    std::vector<uint32_t> columns;
+
+    /** The entries of all blocks (12 per block, see above) */
+    std::vector<float> blocks;
+
+    /**
+     * Constructs an empty matrix.
+     */
+    BlockSparseMatrix();
+
+    /**
+     * Constructs the matrix with 3 * blockRowCount rows and
+     * 3 * blockColumnCount columns from triplets of single entries (the
+     * entry (r, c) belongs to the block (r / 3, c / 3)). Equal positions are
+     * added up.
+     *
+     * Throws std::invalid_argument if a triplet is outside of the matrix.
+     */
+    BlockSparseMatrix(size_t blockRowCount, size_t blockColumnCount, const std::vector<Triplet>& triplets);
+
+    /**
+     * Returns the number of stored blocks.
+     */
+    size_t getBlockCount() const;
+
+    /**
+     * Returns the same matrix in the CSR format (with all nine entries of
+     * every block).
+     */
+    SparseMatrix toSparseMatrix() const;
+
+    /**
+     * Computes y = A * x in parallel, where x has blockColumnCount and y has
+     * blockRowCount elements (which must not overlap). The w of the results
+     * is 0.
+     */
+    void multiply(const Vec4f* x, Vec4f* y) const;
+};
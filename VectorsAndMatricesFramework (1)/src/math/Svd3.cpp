@@ -0,0 +1,416 @@
+#include "Svd3.h"
+#include "Parallel.h"
+
+namespace {
+
+/* Constants of the approximate Givens rotations (see McAdams et al.): */
+const float GAMMA = 5.828427124f;     // 3 + 2 * sqrt(2)
+const float CSTAR = 0.923879532f;     // cos(pi / 8)
+const float SSTAR = 0.3826834323f;    // sin(pi / 8)
+
+/* Threshold below which a Givens rotation of the QR decomposition is skipped: */
+const float QR_EPSILON = 1e-6f;
+
+/* The number of matrices which are decomposed by one task: */
+const size_t BATCH_GRAIN_SIZE = 1024;
+
+/* A symmetric 3x3 matrix (lower triangle): */
+struct Symmetric3 {
+    FloatLanes s11, s21, s22, s31, s32, s33;
+};
+
+/* A quaternion (x, y, z, w) per lane: */
+struct QuaternionLanes {
+    FloatLanes q[4];
+};
+
+/* Swaps a and b in all lanes where the mask is set: */
+inline void conditionalSwap(const LaneMask& mask, FloatLanes& a, FloatLanes& b){
+    FloatLanes tmp = a;
+    a = select(mask, b, a);
+    b = select(mask, tmp, b);
+}
+
+/* Swaps a and -b in all lanes where the mask is set (which keeps determinants): */
+inline void conditionalNegativeSwap(const LaneMask& mask, FloatLanes& a, FloatLanes& b){
+    FloatLanes negativeA = -a;
+    a = select(mask, b, a);
+    b = select(mask, negativeA, b);
+}
+
+/**
+ * Computes the approximate Givens rotation (as half angle cosine ch and sine
+ * sh) which reduces the off-diagonal element of [a11 a12; a12 a22].
+ */
+inline void approximateGivens(const FloatLanes& a11, const FloatLanes& a12, const FloatLanes& a22,
+                              FloatLanes& ch, FloatLanes& sh){
+    ch = (a11 - a22) * 2.f;
+    sh = a12;
+
+    // If the exact angle is too large, the rotation by pi/4 is used instead:
+    LaneMask useExact = (sh * sh) * GAMMA < ch * ch;
+    FloatLanes w = rsqrt(ch * ch + sh * sh);
+    ch = select(useExact, w * ch, broadcast(CSTAR));
+    sh = select(useExact, w * sh, broadcast(SSTAR));
+}
+
+/**
+ * Applies one Jacobi rotation to the (1,2) block of s and accumulates it into
+ * the quaternion. Afterwards the rows and columns of s are permuted
+ * cyclically, so that three calls treat all three off-diagonal elements.
+ * (x, y, z) are the quaternion components belonging to this permutation.
+ */
+inline void jacobiConjugation(int x, int y, int z, Symmetric3& s, QuaternionLanes& quaternion){
+    FloatLanes ch, sh;
+    approximateGivens(s.s11, s.s21, s.s22, ch, sh);
+
+    FloatLanes scale = ch * ch + sh * sh;
+    FloatLanes a = (ch * ch - sh * sh) / scale;
+    FloatLanes b = (sh * ch * 2.f) / scale;
+
+    // S = Q^T * S * Q:
+    Symmetric3 t = s;
+    s.s11 = a * (a * t.s11 + b * t.s21) + b * (a * t.s21 + b * t.s22);
+    s.s21 = a * (-b * t.s11 + a * t.s21) + b * (-b * t.s21 + a * t.s22);
+    s.s22 = -b * (-b * t.s11 + a * t.s21) + a * (-b * t.s21 + a * t.s22);
+    s.s31 = a * t.s31 + b * t.s32;
+    s.s32 = -b * t.s31 + a * t.s32;
+    s.s33 = t.s33;
+
+    // Accumulate the rotation into the quaternion:
+    FloatLanes* q = quaternion.q;
+    FloatLanes tmp[3] = {q[0] * sh, q[1] * sh, q[2] * sh};
+    sh = sh * q[3];
+    for(int k=0; k < 4; ++k)
+        q[k] = q[k] * ch;
+
+    q[z] = q[z] + sh;
+    q[3] = q[3] - tmp[z];
+    q[x] = q[x] + tmp[y];
+    q[y] = q[y] - tmp[x];
+
+    // Permute the matrix cyclically for the next rotation:
+    t = s;
+    s.s11 = t.s22; s.s21 = t.s32; s.s22 = t.s33;
+    s.s31 = t.s21; s.s32 = t.s31; s.s33 = t.s11;
+}
+
+/**
+ * Diagonalizes the symmetric matrix s with SVD3_SWEEPS Jacobi sweeps. The
+ * diagonal of s contains the eigenvalues afterwards, and v the rotation
+ * whose columns are the eigenvectors.
+ */
+void jacobiEigenanalysis(Symmetric3& s, Matrix3Lanes& v){
+    QuaternionLanes quaternion;
+    quaternion.q[0] = quaternion.q[1] = quaternion.q[2] = broadcast(0.f);
+    quaternion.q[3] = broadcast(1.f);
+
+    for(int sweep=0; sweep < SVD3_SWEEPS; ++sweep){
+        jacobiConjugation(0, 1, 2, s, quaternion);
+        jacobiConjugation(1, 2, 0, s, quaternion);
+        jacobiConjugation(2, 0, 1, s, quaternion);
+    }
+
+    // Convert the normalized quaternion into a rotation matrix:
+    FloatLanes n = rsqrt(quaternion.q[0] * quaternion.q[0] + quaternion.q[1] * quaternion.q[1]
+                       + quaternion.q[2] * quaternion.q[2] + quaternion.q[3] * quaternion.q[3]);
+    FloatLanes x = quaternion.q[0] * n, y = quaternion.q[1] * n;
+    FloatLanes z = quaternion.q[2] * n, w = quaternion.q[3] * n;
+
+    FloatLanes xx = x * x, yy = y * y, zz = z * z;
+    FloatLanes xy = x * y, xz = x * z, yz = y * z;
+    FloatLanes wx = w * x, wy = w * y, wz = w * z;
+
+    v.m[0] = 1.f - (yy + zz) * 2.f;  // v11
+    v.m[1] = (xy + wz) * 2.f;        // v21
+    v.m[2] = (xz - wy) * 2.f;        // v31
+    v.m[3] = (xy - wz) * 2.f;        // v12
+    v.m[4] = 1.f - (xx + zz) * 2.f;  // v22
+    v.m[5] = (yz + wx) * 2.f;        // v32
+    v.m[6] = (xz + wy) * 2.f;        // v13
+    v.m[7] = (yz - wx) * 2.f;        // v23
+    v.m[8] = 1.f - (xx + yy) * 2.f;  // v33
+}
+
+/* Returns c = a * b: */
+void multiply(const Matrix3Lanes& a, const Matrix3Lanes& b, Matrix3Lanes& c){
+    for(int col=0; col < 3; ++col){
+        for(int row=0; row < 3; ++row){
+            c.m[col * 3 + row] = a.m[row] * b.m[col * 3] + a.m[3 + row] * b.m[col * 3 + 1] + a.m[6 + row] * b.m[col * 3 + 2];
+        }
+    }
+}
+
+/* Returns c = a * b^T: */
+void multiplyTransposed(const Matrix3Lanes& a, const Matrix3Lanes& b, Matrix3Lanes& c){
+    for(int col=0; col < 3; ++col){
+        for(int row=0; row < 3; ++row){
+            c.m[col * 3 + row] = a.m[row] * b.m[col] + a.m[3 + row] * b.m[3 + col] + a.m[6 + row] * b.m[6 + col];
+        }
+    }
+}
+
+/* Swaps column i and -column j of m in all lanes where the mask is set: */
+void conditionalNegativeSwapColumns(const LaneMask& mask, Matrix3Lanes& m, int i, int j){
+    for(int row=0; row < 3; ++row)
+        conditionalNegativeSwap(mask, m.m[i * 3 + row], m.m[j * 3 + row]);
+}
+
+/**
+ * Computes the Givens rotation (as half angle cosine ch and sine sh) which
+ * zeroes a2 in the vector (a1, a2), for the QR decomposition.
+ */
+inline void qrGivens(const FloatLanes& a1, const FloatLanes& a2, FloatLanes& ch, FloatLanes& sh){
+    FloatLanes rho = sqrt(a1 * a1 + a2 * a2);
+    sh = select(rho > broadcast(QR_EPSILON), a2, broadcast(0.f));
+    ch = abs(a1) + maximum(rho, broadcast(QR_EPSILON));
+
+    conditionalSwap(a1 < broadcast(0.f), sh, ch);
+
+    FloatLanes w = rsqrt(ch * ch + sh * sh);
+    ch = ch * w;
+    sh = sh * w;
+}
+
+/**
+ * Computes the QR decomposition B = Q * R with three Givens rotations, where
+ * Q is a rotation and R is upper triangular.
+ */
+void qrDecomposition(const Matrix3Lanes& input, Matrix3Lanes& q, Matrix3Lanes& r){
+    FloatLanes b11 = input.m[0], b21 = input.m[1], b31 = input.m[2];
+    FloatLanes b12 = input.m[3], b22 = input.m[4], b32 = input.m[5];
+    FloatLanes b13 = input.m[6], b23 = input.m[7], b33 = input.m[8];
+    FloatLanes r11, r12, r13, r21, r22, r23, r31, r32, r33;
+
+    // First rotation zeroes b21:
+    FloatLanes ch1, sh1;
+    qrGivens(b11, b21, ch1, sh1);
+    FloatLanes a = 1.f - sh1 * sh1 * 2.f;
+    FloatLanes b = ch1 * sh1 * 2.f;
+    r11 = a * b11 + b * b21;  r12 = a * b12 + b * b22;  r13 = a * b13 + b * b23;
+    r21 = -b * b11 + a * b21; r22 = -b * b12 + a * b22; r23 = -b * b13 + a * b23;
+    r31 = b31; r32 = b32; r33 = b33;
+
+    // Second rotation zeroes r31:
+    FloatLanes ch2, sh2;
+    qrGivens(r11, r31, ch2, sh2);
+    a = 1.f - sh2 * sh2 * 2.f;
+    b = ch2 * sh2 * 2.f;
+    b11 = a * r11 + b * r31;  b12 = a * r12 + b * r32;  b13 = a * r13 + b * r33;
+    b21 = r21; b22 = r22; b23 = r23;
+    b31 = -b * r11 + a * r31; b32 = -b * r12 + a * r32; b33 = -b * r13 + a * r33;
+
+    // Third rotation zeroes b32:
+    FloatLanes ch3, sh3;
+    qrGivens(b22, b32, ch3, sh3);
+    a = 1.f - sh3 * sh3 * 2.f;
+    b = ch3 * sh3 * 2.f;
+    r.m[0] = b11; r.m[3] = b12; r.m[6] = b13;
+    r.m[1] = a * b21 + b * b31;  r.m[4] = a * b22 + b * b32;  r.m[7] = a * b23 + b * b33;
+    r.m[2] = -b * b21 + a * b31; r.m[5] = -b * b22 + a * b32; r.m[8] = -b * b23 + a * b33;
+
+    // Q = Q1 * Q2 * Q3:
+    FloatLanes sh12 = sh1 * sh1, sh22 = sh2 * sh2, sh32 = sh3 * sh3;
+    FloatLanes m12 = sh12 * 2.f + (-1.f), m22 = sh22 * 2.f + (-1.f), m32 = sh32 * 2.f + (-1.f);
+
+    q.m[0] = m12 * m22;                                                          // q11
+    q.m[3] = ch2 * ch3 * m12 * sh2 * sh3 * 4.f + ch1 * sh1 * m32 * 2.f;          // q12
+    q.m[6] = ch1 * ch3 * sh1 * sh3 * 4.f - ch2 * m12 * sh2 * m32 * 2.f;          // q13
+    q.m[1] = -(ch1 * sh1 * m22 * 2.f);                                           // q21
+    q.m[4] = -(ch1 * ch2 * ch3 * sh1 * sh2 * sh3 * 8.f) + m12 * m32;             // q22
+    q.m[7] = -(ch3 * sh3 * 2.f) + sh1 * (ch3 * sh1 * sh3 + ch1 * ch2 * sh2 * m32) * 4.f; // q23
+    q.m[2] = ch2 * sh2 * 2.f;                                                    // q31
+    q.m[5] = -(ch3 * m22 * sh3 * 2.f);                                           // q32
+    q.m[8] = m22 * m32;                                                          // q33
+}
+
+/* Returns the largest absolute cell of each matrix (at least FLT_MIN): */
+FloatLanes getMaximumMagnitude(const Matrix3Lanes& a){
+    FloatLanes result = broadcast(FLT_MIN);
+    for(int k=0; k < 9; ++k)
+        result = maximum(result, abs(a.m[k]));
+    return result;
+}
+
+}
+
+void Matrix3Lanes::load(const Mat4f* matrices, size_t count){
+    for(int l=0; l < FLOAT_LANES; ++l){
+        for(int col=0; col < 3; ++col){
+            for(int row=0; row < 3; ++row){
+                m[col * 3 + row].v[l] = size_t(l) < count ? matrices[l].data[col * 4 + row] : (row == col ? 1.f : 0.f);
+            }
+        }
+    }
+}
+
+void Matrix3Lanes::store(Mat4f* matrices, size_t count) const{
+    for(size_t l=0; l < count && l < FLOAT_LANES; ++l){
+        matrices[l] = Mat4f();
+        for(int col=0; col < 3; ++col){
+            for(int row=0; row < 3; ++row){
+                matrices[l].data[col * 4 + row] = m[col * 3 + row].v[l];
+            }
+        }
+    }
+}
+
+void computeSvdLanes(const Matrix3Lanes& input, Matrix3Lanes& u, FloatLanes sigma[3], Matrix3Lanes& v){
+    // Scale every matrix so that its largest cell is 1, which keeps the fixed
+    // thresholds meaningful for very small and very large matrices:
+    FloatLanes magnitude = getMaximumMagnitude(input);
+    FloatLanes inverseMagnitude = broadcast(1.f) / magnitude;
+    Matrix3Lanes a;
+    for(int k=0; k < 9; ++k)
+        a.m[k] = input.m[k] * inverseMagnitude;
+
+    // The eigenvectors of A^T * A are the right singular vectors V:
+    Symmetric3 s;
+    s.s11 = a.m[0] * a.m[0] + a.m[1] * a.m[1] + a.m[2] * a.m[2];
+    s.s21 = a.m[3] * a.m[0] + a.m[4] * a.m[1] + a.m[5] * a.m[2];
+    s.s22 = a.m[3] * a.m[3] + a.m[4] * a.m[4] + a.m[5] * a.m[5];
+    s.s31 = a.m[6] * a.m[0] + a.m[7] * a.m[1] + a.m[8] * a.m[2];
+    s.s32 = a.m[6] * a.m[3] + a.m[7] * a.m[4] + a.m[8] * a.m[5];
+    s.s33 = a.m[6] * a.m[6] + a.m[7] * a.m[7] + a.m[8] * a.m[8];
+    jacobiEigenanalysis(s, v);
+
+    // B = A * V has orthogonal columns whose lengths are the singular values:
+    Matrix3Lanes b;
+    multiply(a, v, b);
+
+    // Sort the columns of B (and V) by decreasing length:
+    FloatLanes rho1 = b.m[0] * b.m[0] + b.m[1] * b.m[1] + b.m[2] * b.m[2];
+    FloatLanes rho2 = b.m[3] * b.m[3] + b.m[4] * b.m[4] + b.m[5] * b.m[5];
+    FloatLanes rho3 = b.m[6] * b.m[6] + b.m[7] * b.m[7] + b.m[8] * b.m[8];
+
+    LaneMask swap = rho1 < rho2;
+    conditionalNegativeSwapColumns(swap, b, 0, 1);
+    conditionalNegativeSwapColumns(swap, v, 0, 1);
+    conditionalSwap(swap, rho1, rho2);
+
+    swap = rho1 < rho3;
+    conditionalNegativeSwapColumns(swap, b, 0, 2);
+    conditionalNegativeSwapColumns(swap, v, 0, 2);
+    conditionalSwap(swap, rho1, rho3);
+
+    swap = rho2 < rho3;
+    conditionalNegativeSwapColumns(swap, b, 1, 2);
+    conditionalNegativeSwapColumns(swap, v, 1, 2);
+
+    // B = U * Sigma, where the QR decomposition yields U and the diagonal:
+    Matrix3Lanes r;
+    qrDecomposition(b, u, r);
+
+    sigma[0] = r.m[0] * magnitude;
+    sigma[1] = r.m[4] * magnitude;
+    sigma[2] = r.m[8] * magnitude;
+}
+
+void computePolarDecompositionLanes(const Matrix3Lanes& a, Matrix3Lanes& rotation, Matrix3Lanes& stretch){
+    Matrix3Lanes u, v;
+    FloatLanes sigma[3];
+    computeSvdLanes(a, u, sigma, v);
+
+    // R = U * V^T:
+    multiplyTransposed(u, v, rotation);
+
+    // S = V * Sigma * V^T:
+    Matrix3Lanes vSigma;
+    for(int col=0; col < 3; ++col){
+        for(int row=0; row < 3; ++row)
+            vSigma.m[col * 3 + row] = v.m[col * 3 + row] * sigma[col];
+    }
+    multiplyTransposed(vSigma, v, stretch);
+}
+
+void computeSymmetricEigenLanes(const Matrix3Lanes& a, FloatLanes eigenvalues[3], Matrix3Lanes& eigenvectors){
+    // Scale the matrices like in computeSvdLanes(...):
+    FloatLanes magnitude = getMaximumMagnitude(a);
+    FloatLanes inverseMagnitude = broadcast(1.f) / magnitude;
+
+    Symmetric3 s;
+    s.s11 = a.m[0] * inverseMagnitude;
+    s.s21 = a.m[1] * inverseMagnitude;
+    s.s22 = a.m[4] * inverseMagnitude;
+    s.s31 = a.m[2] * inverseMagnitude;
+    s.s32 = a.m[5] * inverseMagnitude;
+    s.s33 = a.m[8] * inverseMagnitude;
+    jacobiEigenanalysis(s, eigenvectors);
+
+    FloatLanes lambda1 = s.s11, lambda2 = s.s22, lambda3 = s.s33;
+
+    // Sort the eigenvalues (and eigenvectors) in descending order:
+    LaneMask swap = lambda1 < lambda2;
+    conditionalNegativeSwapColumns(swap, eigenvectors, 0, 1);
+    conditionalSwap(swap, lambda1, lambda2);
+
+    swap = lambda1 < lambda3;
+    conditionalNegativeSwapColumns(swap, eigenvectors, 0, 2);
+    conditionalSwap(swap, lambda1, lambda3);
+
+    swap = lambda2 < lambda3;
+    conditionalNegativeSwapColumns(swap, eigenvectors, 1, 2);
+    conditionalSwap(swap, lambda2, lambda3);
+
+    eigenvalues[0] = lambda1 * magnitude;
+    eigenvalues[1] = lambda2 * magnitude;
+    eigenvalues[2] = lambda3 * magnitude;
+}
+
+void computeSvdBatch(const Mat4f* matrices, Mat4f* u, Vec4f* sigma, Mat4f* v, size_t count){
+    size_t batchCount = getChunkCount(count, FLOAT_LANES);
+
+    parallelFor(0, batchCount, BATCH_GRAIN_SIZE / FLOAT_LANES, [&](size_t begin, size_t end){
+        for(size_t batch=begin; batch < end; ++batch){
+            size_t first = batch * FLOAT_LANES;
+            size_t lanes = count - first < FLOAT_LANES ? count - first : FLOAT_LANES;
+
+            Matrix3Lanes a, uLanes, vLanes;
+            FloatLanes sigmaLanes[3];
+            a.load(&matrices[first], lanes);
+            computeSvdLanes(a, uLanes, sigmaLanes, vLanes);
+            uLanes.store(&u[first], lanes);
+            vLanes.store(&v[first], lanes);
+
+            for(size_t l=0; l < lanes; ++l)
+                sigma[first + l] = Vec4f(sigmaLanes[0].v[l], sigmaLanes[1].v[l], sigmaLanes[2].v[l], 0.f);
+        }
+    });
+}
+
+void computePolarDecompositionBatch(const Mat4f* matrices, Mat4f* rotations, Mat4f* stretches, size_t count){
+    size_t batchCount = getChunkCount(count, FLOAT_LANES);
+
+    parallelFor(0, batchCount, BATCH_GRAIN_SIZE / FLOAT_LANES, [&](size_t begin, size_t end){
+        for(size_t batch=begin; batch < end; ++batch){
+            size_t first = batch * FLOAT_LANES;
+            size_t lanes = count - first < FLOAT_LANES ? count - first : FLOAT_LANES;
+
+            Matrix3Lanes a, rotation, stretch;
+            a.load(&matrices[first], lanes);
+            computePolarDecompositionLanes(a, rotation, stretch);
+            rotation.store(&rotations[first], lanes);
+            stretch.store(&stretches[first], lanes);
+        }
+    });
+}
+
+void computeSymmetricEigenBatch(const Mat4f* matrices, Vec4f* eigenvalues, Mat4f* eigenvectors, size_t count){
+    size_t batchCount = getChunkCount(count, FLOAT_LANES);
+
+    parallelFor(0, batchCount, BATCH_GRAIN_SIZE / FLOAT_LANES, [&](size_t begin, size_t end){
+        for(size_t batch=begin; batch < end; ++batch){
+            size_t first = batch * FLOAT_LANES;
+            size_t lanes = count - first < FLOAT_LANES ? count - first : FLOAT_LANES;
+
+            Matrix3Lanes a, vectors;
+            FloatLanes values[3];
+            a.load(&matrices[first], lanes);
+            computeSymmetricEigenLanes(a, values, vectors);
+            vectors.store(&eigenvectors[first], lanes);
+
+            for(size_t l=0; l < lanes; ++l)
+                eigenvalues[first + l] = Vec4f(values[0].v[l], values[1].v[l], values[2].v[l], 0.f);
+        }
+    });
+}
@@ -0,0 +1,120 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our math classes: */
+#include "Vec4f.h"
+#include "Mat4f.h"
+#include "FloatLanes.h"
+
+/**
+ * Batched decompositions of 3x3 matrices: the singular value decomposition
+ * (SVD), the polar decomposition and the eigen decomposition of symmetric
+ * matrices. The input is always the upper left 3x3 block of a Mat4f.
+ *
+ * The kernels follow McAdams et al. ("Computing the Singular Value
+ * Decomposition of 3x3 matrices with minimal branching and elementary
+ * floating point operations", 2011): a fixed number of Jacobi sweeps with
+ * approximate Givens rotations (accumulated as a quaternion), followed by a
+ * sort of the singular values and a Givens QR decomposition. There are no
+ * data dependent branches, so FLOAT_LANES matrices are processed at once in
+ * structure-of-arrays layout (see Matrix3Lanes).
+ *
+ * Accuracy versus throughput:
+ *  - The number of Jacobi sweeps is SVD3_SWEEPS (default 5). Measured on
+ *    random matrices with cells in [-1, 1] (including rank deficient ones),
+ *    the reconstruction error |U * diag(sigma) * V^T - A| relative to the
+ *    largest cell of A is:
+ *
+ *      4 sweeps: < 1e-6 for 94% of the matrices, but up to 1e-2 for 0.25%
+ *      5 sweeps: < 1e-6 for 99.7% of the matrices, at most about 1e-5
+ *      6 sweeps: < 1e-6 for 99.7% of the matrices, at most about 9e-6
+ *
+ *    Each sweep costs roughly 15% of the total time, so 4 sweeps (as in the
+ *    paper) are only recommended if occasional outliers are acceptable.
+ *  - All computations are performed in float. Singular values which are
+ *    smaller than about 1e-6 times the largest one are only accurate in
+ *    absolute terms (which is enough for polar decompositions, but not for
+ *    computing the rank of a matrix).
+ *  - U and V are always rotations (determinant +1). The sign of a
+ *    reflection is therefore carried by the smallest singular value, which
+ *    may be negative.
+ *
+ * For a single matrix with the highest accuracy, use computeSymmetricEigen(...)
+ * from SymmetricEigen.h instead.
+ */
+
+/* The number of Jacobi sweeps of the batched kernels: */
+#ifndef SVD3_SWEEPS
+#define SVD3_SWEEPS 5
+#endif
+
+/**
+ * FLOAT_LANES 3x3 matrices in structure-of-arrays layout: m[col * 3 + row]
+ * contains the cell (row, col) of all matrices (column-major like Mat4f).
+ */
+
+class Matrix3Lanes
+{
+public:
+    /** The cells of the matrices, one FloatLanes per cell */
+    FloatLanes m[9];
+
+    /**
+     * Loads the upper left 3x3 blocks of up to FLOAT_LANES matrices. Unused
+     * lanes are filled with the identity matrix.
+     */
+    void load(const Mat4f* matrices, size_t count);
+
+    /**
+     * Stores the first 'count' matrices into the upper left 3x3 blocks of the
+     * given matrices. The remaining cells are set to those of the identity.
+     */
+    void store(Mat4f* matrices, size_t count) const;
+};
+
+/**
+ * Computes the SVD A = U * diag(sigma) * V^T of FLOAT_LANES matrices, where U
+ * and V are rotations and sigma is sorted by decreasing magnitude.
+ */
+void computeSvdLanes(const Matrix3Lanes& a, Matrix3Lanes& u, FloatLanes sigma[3], Matrix3Lanes& v);
+
+/**
+ * Computes the polar decomposition A = R * S of FLOAT_LANES matrices, where R
+ * is a rotation and S is symmetric (S = V * diag(sigma) * V^T).
+ */
+void computePolarDecompositionLanes(const Matrix3Lanes& a, Matrix3Lanes& rotation, Matrix3Lanes& stretch);
+
+/**
+ * Computes the eigen decomposition A = V * diag(lambda) * V^T of FLOAT_LANES
+ * symmetric matrices. The eigenvalues are sorted in descending order and V is
+ * a rotation whose columns are the eigenvectors. Only the lower triangle of A
+ * is read.
+ */
+void computeSymmetricEigenLanes(const Matrix3Lanes& a, FloatLanes eigenvalues[3], Matrix3Lanes& eigenvectors);
+
+/**
+ * Computes the SVD of the upper left 3x3 blocks of all given matrices in
+ * parallel (see computeSvdLanes(...)). The singular values are stored into
+ * (x, y, z) of 'sigma' (w = 0), U and V into the upper left blocks of 'u' and
+ * 'v'. Each output array must provide space for 'count' elements.
+ */
+void computeSvdBatch(const Mat4f* matrices, Mat4f* u, Vec4f* sigma, Mat4f* v, size_t count);
+
+/**
+ * Computes the polar decomposition of the upper left 3x3 blocks of all given
+ * matrices in parallel (see computePolarDecompositionLanes(...)).
+ */
+void computePolarDecompositionBatch(const Mat4f* matrices, Mat4f* rotations, Mat4f* stretches, size_t count);
+
+/**
+ * Computes the eigen decomposition of the (symmetric) upper left 3x3 blocks of
+ * all given matrices in parallel (see computeSymmetricEigenLanes(...)). The
+ * eigenvalues are stored into (x, y, z) of 'eigenvalues' (w = 0).
+ */
+void computeSymmetricEigenBatch(const Mat4f* matrices, Vec4f* eigenvalues, Mat4f* eigenvectors, size_t count);
@@ -0,0 +1,81 @@
+#include "SymmetricEigen.h"
+
+void computeSymmetricEigen(const Mat4f& matrix, Vec4f& eigenvalues, Mat4f& eigenvectors){
+    // Copy the upper left 3x3 block (a[row][col]) and start with V = I:
+    double a[3][3], v[3][3];
+    for(int row=0; row < 3; ++row){
+        for(int col=0; col < 3; ++col){
+            a[row][col] = matrix.data[col * 4 + row];
+            v[row][col] = row == col ? 1.0 : 0.0;
+        }
+    }
+
+    // Apply Jacobi rotations until the off-diagonal elements vanish:
+    for(int sweep=0; sweep < 32; ++sweep){
+        double offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if(offDiagonal <= 1e-30 * diagonal || offDiagonal == 0.0)
+            break;
+
+        for(int p=0; p < 2; ++p){
+            for(int q=p+1; q < 3; ++q){
+                if(a[p][q] == 0.0)
+                    continue;
+
+                // Compute the rotation which zeroes a[p][q]:
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                // A' = J^T * A * J:
+                for(int k=0; k < 3; ++k){
+                    double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for(int k=0; k < 3; ++k){
+                    double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+
+                // V' = V * J:
+                for(int k=0; k < 3; ++k){
+                    double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    // Sort the eigenvalues (and their eigenvectors) in descending order:
+    int order[3] = {0, 1, 2};
+    for(int i=0; i < 3; ++i){
+        for(int j=i+1; j < 3; ++j){
+            if(a[order[j]][order[j]] > a[order[i]][order[i]]){
+                int tmp = order[i];
+                order[i] = order[j];
+                order[j] = tmp;
+            }
+        }
+    }
+
+    eigenvalues = Vec4f(float(a[order[0]][order[0]]), float(a[order[1]][order[1]]), float(a[order[2]][order[2]]), 0.f);
+
+    eigenvectors = Mat4f();
+    for(int col=0; col < 3; ++col){
+        for(int row=0; row < 3; ++row){
+            eigenvectors.data[col * 4 + row] = float(v[row][order[col]]);
+        }
+    }
+
+    // Make the basis right-handed by recomputing the third axis as the cross
+    // product of the first two:
+    const float* e0 = &eigenvectors.data[0];
+    const float* e1 = &eigenvectors.data[4];
+    eigenvectors.data[8] = e0[1] * e1[2] - e0[2] * e1[1];
+    eigenvectors.data[9] = e0[2] * e1[0] - e0[0] * e1[2];
+    eigenvectors.data[10] = e0[0] * e1[1] - e0[1] * e1[0];
+}
@@ -0,0 +1,26 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Include our math classes: */
+#include "Vec4f.h"
+#include "Mat4f.h"
+
+/**
+ * Computes the eigenvalues and eigenvectors of the symmetric 3x3 matrix which
+ * is stored in the upper left 3x3 block of the given Mat4f (for example a
+ * covariance matrix, see computeCovariance(...) in Reductions.h).
+ *
+ * The eigenvalues are returned in (x, y, z) of 'eigenvalues' (w = 0), sorted
+ * from the largest to the smallest one. The corresponding normalized
+ * eigenvectors are stored in the first three columns of 'eigenvectors', so
+ * that column i belongs to eigenvalue i. The columns form a right-handed
+ * rotation, the fourth column is (0,0,0,1).
+ *
+ * This uses the cyclic Jacobi method in double precision, which is slow but
+ * very accurate. It is meant for single matrices (for example the PCA of a
+ * whole point set), not for millions of matrices.
+ */
+void computeSymmetricEigen(const Mat4f& matrix, Vec4f& eigenvalues, Mat4f& eigenvectors);
@@ -0,0 +1,475 @@
+#include "NBody.h"
+#include "../math/AABB.h"
+#include "../math/FloatLanes.h"
+#include "../math/Morton.h"
+#include "../math/Parallel.h"
+#include "../math/Reductions.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/* The number of bodies which are processed by one task: */
+const size_t NBODY_GRAIN_SIZE = 16384;
+
+/* The number of leaves whose forces are computed by one task: */
+const size_t LEAF_GRAIN_SIZE = 16;
+
+/* The number of target bodies of computeGravityDirect(...) per task: */
+const size_t DIRECT_GRAIN_SIZE = 64;
+
+/* The largest number of bodies of a subtree which is built by one task: */
+const uint32_t SUBTREE_SIZE = 65536;
+
+/* The deepest level of the octree (the cells of the 63 bit Morton codes): */
+const int MAX_LEVEL = 21;
+
+/**
+ * A node of the octree in depth first order: its first child (if it is no
+ * leaf) is the next node, and 'next' is the node after its subtree.
+ */
+struct TreeNode {
+    /** The center of mass and the total mass */
+    float x, y, z, mass;
+
+    /** Beyond this squared distance, the node is approximated by its center of mass */
+    float openDistanceSquared;
+
+    /** The index of the node after the subtree of this node */
+    uint32_t next;
+
+    /** The range of the sorted bodies inside of the node */
+    uint32_t begin, end;
+
+    /** Whether the node is a leaf */
+    uint32_t leaf;
+};
+
+/**
+ * The bodies sorted by their Morton codes, in structure-of-arrays layout.
+ * The arrays are padded with massless bodies to a multiple of FLOAT_LANES.
+ */
+struct SortedBodies {
+    std::vector<float> x, y, z, mass;
+    std::vector<uint32_t> order;
+};
+
+/* Loads FLOAT_LANES floats: */
+inline FloatLanes loadLanes(const float* values){
+    FloatLanes r;
+    for(int l=0; l < FLOAT_LANES; ++l) r.v[l] = values[l];
+    return r;
+}
+
+/* Returns the sum of all lanes: */
+inline float sumLanes(const FloatLanes& a){
+    float sum = 0.f;
+    for(int l=0; l < FLOAT_LANES; ++l) sum += a.v[l];
+    return sum;
+}
+
+/**
+ * Adds the accelerations of the given point masses (a multiple of
+ * FLOAT_LANES) on the point (px, py, pz) to 'acceleration' (without the
+ * gravitational constant). Point masses at the point itself are skipped.
+ */
+void addAccelerations(const float* x, const float* y, const float* z, const float* mass, size_t count,
+                      float px, float py, float pz, float softeningSquared, float acceleration[3]){
+    FloatLanes ax = broadcast(0.f), ay = broadcast(0.f), az = broadcast(0.f);
+    FloatLanes zero = broadcast(0.f);
+    for(size_t j=0; j < count; j += FLOAT_LANES){
+        FloatLanes dx = loadLanes(x + j) + (-px), dy = loadLanes(y + j) + (-py), dz = loadLanes(z + j) + (-pz);
+        FloatLanes distanceSquared = dx * dx + dy * dy + dz * dz + softeningSquared;
+        FloatLanes inverse = select(distanceSquared > zero, rsqrt(distanceSquared), zero);
+        FloatLanes factor = loadLanes(mass + j) * inverse * inverse * inverse;
+        ax = ax + dx * factor;
+        ay = ay + dy * factor;
+        az = az + dz * factor;
+    }
+    acceleration[0] += sumLanes(ax);
+    acceleration[1] += sumLanes(ay);
+    acceleration[2] += sumLanes(az);
+}
+
+/* Appends a point mass to the interaction list: */
+inline void appendPointMass(std::vector<float> list[4], float x, float y, float z, float mass){
+    list[0].push_back(x);
+    list[1].push_back(y);
+    list[2].push_back(z);
+    list[3].push_back(mass);
+}
+
+/* Checks the settings and the number of bodies: */
+void checkSettings(size_t count, const NBodySettings& settings){
+    if(count >= 0xffffffffu)
+        throw std::invalid_argument("NBody: too many bodies.");
+    if(!(settings.openingAngle >= 0.f) || !(settings.softening >= 0.f) || settings.leafSize == 0)
+        throw std::invalid_argument("NBody: invalid settings.");
+}
+
+/**
+ * Builds the octree of the sorted bodies with their Morton codes.
+ */
+class TreeBuilder
+{
+public:
+    TreeBuilder(const std::vector<uint64_t>& codes, const SortedBodies& bodies, const AABB& cube,
+                const NBodySettings& settings)
+        : codes(codes), bodies(bodies), cube(cube), settings(settings)
+    {
+    }
+
+    /**
+     * Builds the tree in parallel and returns its nodes.
+     */
+    std::vector<TreeNode> build(uint32_t count){
+        // Split the top of the tree into subtrees and build them in parallel:
+        std::vector<Subtree> subtrees;
+        collectSubtrees(0, 0, count, subtrees);
+        parallelFor(0, subtrees.size(), 1, [&](size_t begin, size_t end){
+            for(size_t s=begin; s < end; ++s)
+                buildSubtree(subtrees[s].level, subtrees[s].begin, subtrees[s].end, subtrees[s].nodes);
+        });
+
+        // Join them in depth first order:
+        std::vector<TreeNode> nodes;
+        size_t nextSubtree = 0;
+        joinSubtrees(0, 0, count, subtrees, nextSubtree, nodes);
+        return nodes;
+    }
+
+private:
+    /**
+     * A subtree which is built by one task.
+     */
+    struct Subtree {
+        int level;
+        uint32_t begin, end;
+        std::vector<TreeNode> nodes;
+    };
+
+    const std::vector<uint64_t>& codes;
+    const SortedBodies& bodies;
+    AABB cube;
+    const NBodySettings& settings;
+
+    /* Returns whether the node of the given level and range is a leaf: */
+    bool isLeaf(int level, uint32_t begin, uint32_t end) const {
+        return end - begin <= settings.leafSize || level == MAX_LEVEL;
+    }
+
+    /* Splits the range of a node into the ranges of its 8 children: */
+    void findChildren(int level, uint32_t begin, uint32_t end, uint32_t bounds[9]) const {
+        int shift = 3 * (MAX_LEVEL - 1 - level);
+        bounds[0] = begin;
+        bounds[8] = end;
+        for(uint32_t c=1; c < 8; ++c){
+            bounds[c] = uint32_t(std::partition_point(codes.begin() + bounds[c - 1], codes.begin() + end,
+                                                      [&](uint64_t code){ return ((code >> shift) & 7) < c; })
+                                 - codes.begin());
+        }
+    }
+
+    /**
+     * Sets the moments of the node at 'index' (from its bodies if it is a
+     * leaf, otherwise from its children) and its opening distance.
+     */
+    void finishNode(std::vector<TreeNode>& nodes, size_t index, int level, const std::vector<uint32_t>& children) const {
+        TreeNode& node = nodes[index];
+        double sum[4] = {0.0, 0.0, 0.0, 0.0};
+        if(node.leaf){
+            for(uint32_t i=node.begin; i < node.end; ++i){
+                sum[0] += double(bodies.mass[i]) * bodies.x[i];
+                sum[1] += double(bodies.mass[i]) * bodies.y[i];
+                sum[2] += double(bodies.mass[i]) * bodies.z[i];
+                sum[3] += bodies.mass[i];
+            }
+        } else {
+            for(uint32_t child : children){
+                const TreeNode& c = nodes[child];
+                sum[0] += double(c.mass) * c.x;
+                sum[1] += double(c.mass) * c.y;
+                sum[2] += double(c.mass) * c.z;
+                sum[3] += c.mass;
+            }
+        }
+
+        // The geometric center of the cube of the node:
+        uint32_t cell[3];
+        decodeMorton63(codes[node.begin] >> (3 * (MAX_LEVEL - level)), cell[0], cell[1], cell[2]);
+        float size = (cube.max.x - cube.min.x) / float(1u << level);
+        const float* min = &cube.min.x;
+        float center[3];
+        for(int d=0; d < 3; ++d)
+            center[d] = min[d] + (float(cell[d]) + 0.5f) * size;
+
+        // Charges of both signs may cancel out, then the center is used:
+        if(std::fabs(sum[3]) > 1e-30){
+            node.x = float(sum[0] / sum[3]);
+            node.y = float(sum[1] / sum[3]);
+            node.z = float(sum[2] / sum[3]);
+        } else {
+            node.x = center[0];
+            node.y = center[1];
+            node.z = center[2];
+        }
+        node.mass = float(sum[3]);
+
+        // The offset of the center of mass enlarges the opening distance
+        // (Salmon and Warren), which keeps the error bounded even if the
+        // mass is concentrated in a corner:
+        if(settings.openingAngle > 0.f){
+            float dx = node.x - center[0], dy = node.y - center[1], dz = node.z - center[2];
+            float distance = size / settings.openingAngle + std::sqrt(dx * dx + dy * dy + dz * dz);
+            node.openDistanceSquared = distance * distance;
+        } else {
+            node.openDistanceSquared = FLT_MAX;
+        }
+    }
+
+    /* Appends a new node and returns its index: */
+    size_t appendNode(std::vector<TreeNode>& nodes, int level, uint32_t begin, uint32_t end) const {
+        TreeNode node;
+        node.begin = begin;
+        node.end = end;
+        node.leaf = isLeaf(level, begin, end) ? 1 : 0;
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+
+    /* Builds the subtree of the given node into 'nodes' (whose 'next'
+       indices are relative to the first node of 'nodes'): */
+    void buildSubtree(int level, uint32_t begin, uint32_t end, std::vector<TreeNode>& nodes) const {
+        size_t index = appendNode(nodes, level, begin, end);
+        std::vector<uint32_t> children;
+        if(!nodes[index].leaf){
+            uint32_t bounds[9];
+            findChildren(level, begin, end, bounds);
+            for(int c=0; c < 8; ++c){
+                if(bounds[c] < bounds[c + 1]){
+                    children.push_back(uint32_t(nodes.size()));
+                    buildSubtree(level + 1, bounds[c], bounds[c + 1], nodes);
+                }
+            }
+        }
+        finishNode(nodes, index, level, children);
+        nodes[index].next = uint32_t(nodes.size());
+    }
+
+    /* Returns whether the given node is built as one subtree: */
+    bool isSubtree(int level, uint32_t begin, uint32_t end) const {
+        return end - begin <= SUBTREE_SIZE || isLeaf(level, begin, end);
+    }
+
+    /* Collects the subtrees in depth first order: */
+    void collectSubtrees(int level, uint32_t begin, uint32_t end, std::vector<Subtree>& subtrees) const {
+        if(isSubtree(level, begin, end)){
+            Subtree subtree;
+            subtree.level = level;
+            subtree.begin = begin;
+            subtree.end = end;
+            subtrees.push_back(subtree);
+            return;
+        }
+        uint32_t bounds[9];
+        findChildren(level, begin, end, bounds);
+        for(int c=0; c < 8; ++c){
+            if(bounds[c] < bounds[c + 1])
+                collectSubtrees(level + 1, bounds[c], bounds[c + 1], subtrees);
+        }
+    }
+
+    /* Appends the top nodes and the built subtrees in depth first order: */
+    void joinSubtrees(int level, uint32_t begin, uint32_t end, std::vector<Subtree>& subtrees, size_t& nextSubtree,
+                      std::vector<TreeNode>& nodes) const {
+        if(isSubtree(level, begin, end)){
+            std::vector<TreeNode>& subtreeNodes = subtrees[nextSubtree++].nodes;
+            uint32_t offset = uint32_t(nodes.size());
+            for(TreeNode& node : subtreeNodes)
+                node.next += offset;
+            nodes.insert(nodes.end(), subtreeNodes.begin(), subtreeNodes.end());
+            std::vector<TreeNode>().swap(subtreeNodes);
+            return;
+        }
+
+        size_t index = appendNode(nodes, level, begin, end);
+        std::vector<uint32_t> children;
+        uint32_t bounds[9];
+        findChildren(level, begin, end, bounds);
+        for(int c=0; c < 8; ++c){
+            if(bounds[c] < bounds[c + 1]){
+                children.push_back(uint32_t(nodes.size()));
+                joinSubtrees(level + 1, bounds[c], bounds[c + 1], subtrees, nextSubtree, nodes);
+            }
+        }
+        finishNode(nodes, index, level, children);
+        nodes[index].next = uint32_t(nodes.size());
+    }
+};
+
+/* Copies the bodies in the given order into structure-of-arrays layout
+   (padded with massless bodies): */
+void sortBodies(const Vec4f* bodies, size_t count, std::vector<uint32_t> order, SortedBodies& sorted){
+    size_t padded = (count + FLOAT_LANES - 1) / FLOAT_LANES * FLOAT_LANES;
+    sorted.x.assign(padded, 0.f);
+    sorted.y.assign(padded, 0.f);
+    sorted.z.assign(padded, 0.f);
+    sorted.mass.assign(padded, 0.f);
+    parallelFor(0, count, NBODY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            const Vec4f& body = bodies[order[i]];
+            sorted.x[i] = body.x;
+            sorted.y[i] = body.y;
+            sorted.z[i] = body.z;
+            sorted.mass[i] = body.w;
+        }
+    });
+    sorted.order.swap(order);
+}
+
+}
+
+NBodySettings::NBodySettings()
+    : openingAngle(0.5f), gravitationalConstant(1.f), softening(0.01f), leafSize(16)
+{
+}
+
+void computeGravity(const Vec4f* bodies, size_t count, Vec4f* accelerations, const NBodySettings& settings){
+    checkSettings(count, settings);
+    if(count == 0)
+        return;
+
+    // Sort the bodies along the Morton curve of their bounding cube (which is
+    // slightly enlarged, so rounding cannot move bodies outside):
+    AABB bounds = computeAABB(bodies, count);
+    float size = std::max(bounds.max.x - bounds.min.x, std::max(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z));
+    size = size > 0.f ? size * (1.f + 1e-6f) : 1.f;
+    Vec4f center = bounds.getCenter();
+    AABB cube(Vec4f(center.x - 0.5f * size, center.y - 0.5f * size, center.z - 0.5f * size),
+              Vec4f(center.x + 0.5f * size, center.y + 0.5f * size, center.z + 0.5f * size));
+
+    std::vector<uint64_t> codes(count);
+    std::vector<uint32_t> order(count);
+    parallelFor(0, count, NBODY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            codes[i] = computeMortonCode63(bodies[i], cube);
+            order[i] = uint32_t(i);
+        }
+    });
+    radixSort(codes, order, 63);
+
+    SortedBodies sorted;
+    sortBodies(bodies, count, order, sorted);
+    TreeBuilder builder(codes, sorted, cube, settings);
+    std::vector<TreeNode> nodes = builder.build(uint32_t(count));
+
+    std::vector<uint32_t> leaves;
+    for(size_t i=0; i < nodes.size(); ++i){
+        if(nodes[i].leaf)
+            leaves.push_back(uint32_t(i));
+    }
+
+    // Walk the tree once for every leaf and sum the forces of the collected
+    // point masses on its bodies:
+    float softeningSquared = settings.softening * settings.softening;
+    float g = settings.gravitationalConstant;
+    parallelFor(0, leaves.size(), LEAF_GRAIN_SIZE, [&](size_t begin, size_t end){
+        std::vector<float> list[4];
+        for(size_t leafIndex=begin; leafIndex < end; ++leafIndex){
+            const TreeNode& leaf = nodes[leaves[leafIndex]];
+            float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+            for(uint32_t i=leaf.begin; i < leaf.end; ++i){
+                float p[3] = {sorted.x[i], sorted.y[i], sorted.z[i]};
+                for(int d=0; d < 3; ++d){
+                    min[d] = std::min(min[d], p[d]);
+                    max[d] = std::max(max[d], p[d]);
+                }
+            }
+
+            for(int k=0; k < 4; ++k)
+                list[k].clear();
+            for(uint32_t n=0; n < nodes.size();){
+                const TreeNode& node = nodes[n];
+                float dx = std::max(std::max(min[0] - node.x, node.x - max[0]), 0.f);
+                float dy = std::max(std::max(min[1] - node.y, node.y - max[1]), 0.f);
+                float dz = std::max(std::max(min[2] - node.z, node.z - max[2]), 0.f);
+                if(dx * dx + dy * dy + dz * dz > node.openDistanceSquared){
+                    appendPointMass(list, node.x, node.y, node.z, node.mass);
+                    n = node.next;
+                } else if(node.leaf){
+                    for(uint32_t i=node.begin; i < node.end; ++i)
+                        appendPointMass(list, sorted.x[i], sorted.y[i], sorted.z[i], sorted.mass[i]);
+                    n = node.next;
+                } else {
+                    ++n;
+                }
+            }
+            while(list[0].size() % FLOAT_LANES != 0)
+                appendPointMass(list, 0.f, 0.f, 0.f, 0.f);
+
+            for(uint32_t i=leaf.begin; i < leaf.end; ++i){
+                float acceleration[3] = {0.f, 0.f, 0.f};
+                addAccelerations(list[0].data(), list[1].data(), list[2].data(), list[3].data(), list[0].size(),
+                                 sorted.x[i], sorted.y[i], sorted.z[i], softeningSquared, acceleration);
+                accelerations[sorted.order[i]] = Vec4f(g * acceleration[0], g * acceleration[1], g * acceleration[2], 0.f);
+            }
+        }
+    });
+}
+
+void computeGravityDirect(const Vec4f* bodies, size_t count, Vec4f* accelerations, const NBodySettings& settings){
+    checkSettings(count, settings);
+    std::vector<uint32_t> order(count);
+    for(size_t i=0; i < count; ++i)
+        order[i] = uint32_t(i);
+    SortedBodies sorted;
+    sortBodies(bodies, count, order, sorted);
+
+    float softeningSquared = settings.softening * settings.softening;
+    float g = settings.gravitationalConstant;
+    parallelFor(0, count, DIRECT_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            float acceleration[3] = {0.f, 0.f, 0.f};
+            addAccelerations(sorted.x.data(), sorted.y.data(), sorted.z.data(), sorted.mass.data(), sorted.x.size(),
+                             bodies[i].x, bodies[i].y, bodies[i].z, softeningSquared, acceleration);
+            accelerations[i] = Vec4f(g * acceleration[0], g * acceleration[1], g * acceleration[2], 0.f);
+        }
+    });
+}
+
+void stepLeapfrog(Vec4f* bodies, Vec4f* velocities, Vec4f* accelerations, size_t count, float timeStep,
+                  const NBodySettings& settings){
+    float halfStep = 0.5f * timeStep;
+
+    // Kick and drift:
+    parallelFor(0, count, NBODY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            Vec4f& v = velocities[i];
+            const Vec4f& a = accelerations[i];
+            v.x += halfStep * a.x;
+            v.y += halfStep * a.y;
+            v.z += halfStep * a.z;
+            bodies[i].x += timeStep * v.x;
+            bodies[i].y += timeStep * v.y;
+            bodies[i].z += timeStep * v.z;
+        }
+    });
+
+    computeGravity(bodies, count, accelerations, settings);
+
+    // Kick:
+    parallelFor(0, count, NBODY_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            Vec4f& v = velocities[i];
+            const Vec4f& a = accelerations[i];
+            v.x += halfStep * a.x;
+            v.y += halfStep * a.y;
+            v.z += halfStep * a.z;
+        }
+    });
+}
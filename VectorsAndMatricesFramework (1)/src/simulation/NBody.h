@@ -0,0 +1,110 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t: */
+#include <cstddef>
+
+/* Include our vectors: */
+#include "../math/Vec4f.h"
+
+/**
+ * N-body simulations of gravity (or of any other 1 / r^2 force, like the
+ * electrostatic force). The state of the bodies are two arrays of Vec4f:
+ *  - bodies[i]: the position (x, y, z) and the mass (w) of body i
+ *  - velocities[i]: its velocity (x, y, z, w = 0)
+ *
+ * The acceleration of body i is
+ *
+ *   a_i = G * sum_j m_j * (x_j - x_i) / (|x_j - x_i|^2 + eps^2)^(3/2)
+ *
+ * with the gravitational constant G and the softening length eps, which
+ * limits the force of close encounters. For charges, store the charges in w
+ * and use G = -k * q / m (for bodies which all have the same charge to mass
+ * ratio q / m), so equal charges repel each other. Mixed signs are allowed,
+ * but since a group of charges is approximated by its total charge, the
+ * Barnes-Hut approximation is less accurate for neutral groups.
+ */
+
+/**
+ * The parameters of computeGravity(...) and stepLeapfrog(...).
+ */
+
+class NBodySettings
+{
+public:
+    /**
+     * The opening angle theta of the Barnes-Hut approximation (default 0.5):
+     * a node of edge length s is approximated by its center of mass if it is
+     * farther than s / theta (plus the offset of its center of mass) from the
+     * bodies. Smaller angles are more accurate, 0 gives the exact sum.
+     */
+    float openingAngle;
+
+    /** The gravitational constant G (default 1) */
+    float gravitationalConstant;
+
+    /** The softening length eps (default 0.01) */
+    float softening;
+
+    /**
+     * The largest number of bodies of a leaf of the octree (default 16). The
+     * bodies of a leaf are also the group which shares one walk through the
+     * tree, see computeGravity(...).
+     */
+    size_t leafSize;
+
+    /**
+     * Constructs the default settings.
+     */
+    NBodySettings();
+};
+
+/**
+ * Computes the accelerations of all bodies with the Barnes-Hut algorithm in
+ * O(n log n) and stores them in 'accelerations' (w = 0).
+ *
+ * The octree is rebuilt in parallel by every call: the bodies are sorted by
+ * their Morton codes (see Sorting.h), so every node of the octree is a range
+ * of the sorted bodies, whose children are found by binary searches for the
+ * next three bits of the codes. The top of the tree is split into subtrees of
+ * at most 65536 bodies, which are built in parallel and then joined in depth
+ * first order; every node stores the index of the node after its subtree, so
+ * the tree is walked without a stack.
+ *
+ * The forces are computed for all leaves in parallel: the tree is walked once
+ * per leaf (with the opening criterion for the bounding box of its bodies),
+ * which collects the accepted nodes and the bodies of the opened leaves in
+ * one list of point masses. Then the force of this list on every body of the
+ * leaf is summed with a vectorized loop (FLOAT_LANES point masses at once).
+ *
+ * The result does not depend on the number of threads. Throws
+ * std::invalid_argument for invalid settings or 2^32 or more bodies.
+ */
+void computeGravity(const Vec4f* bodies, size_t count, Vec4f* accelerations,
+                    const NBodySettings& settings = NBodySettings());
+
+/**
+ * Computes the exact accelerations of all bodies by summing over all pairs in
+ * O(n^2) (vectorized and in parallel; settings.openingAngle and
+ * settings.leafSize are ignored). This is faster than computeGravity(...) for
+ * small n, and a reference for its accuracy.
+ */
+void computeGravityDirect(const Vec4f* bodies, size_t count, Vec4f* accelerations,
+                          const NBodySettings& settings = NBodySettings());
+
+/**
+ * Advances the bodies by one time step with the leapfrog integrator in its
+ * kick-drift-kick form (velocity Verlet), which is symplectic and time
+ * reversible, so the energy of an orbit does not drift:
+ *
+ *   v += a * dt / 2,   x += v * dt,   a = computeGravity(x),   v += a * dt / 2
+ *
+ * 'accelerations' must contain the accelerations of the current positions
+ * (call computeGravity(...) once before the first step) and receives those
+ * of the new positions.
+ */
+void stepLeapfrog(Vec4f* bodies, Vec4f* velocities, Vec4f* accelerations, size_t count, float timeStep,
+                  const NBodySettings& settings = NBodySettings());
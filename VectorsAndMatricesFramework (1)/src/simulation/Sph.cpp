@@ -0,0 +1,355 @@
+#include "Sph.h"
+#include "../math/FloatLanes.h"
+#include "../math/Parallel.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of particles which are processed by one task: */
+const size_t SPH_GRAIN_SIZE = 16384;
+
+/* The number of cells whose particles are processed by one task: */
+const size_t CELL_GRAIN_SIZE = 1024;
+
+/* Returns max(a, 0) and min(a, 0) without a comparison (which could keep
+   the lane loops of the kernels from being vectorized): */
+inline float clampToPositive(float a){
+    return (a + std::fabs(a)) * 0.5f;
+}
+
+inline float clampToNegative(float a){
+    return (a - std::fabs(a)) * 0.5f;
+}
+
+/* The position of the particles which pad a neighbour list (its distance
+   to every particle is far beyond the smoothing length): */
+const float FAR_AWAY = 1e10f;
+
+/* The arrays of a neighbour list: */
+enum NeighbourArray {
+    NEIGHBOUR_X, NEIGHBOUR_Y, NEIGHBOUR_Z, NEIGHBOUR_VX, NEIGHBOUR_VY, NEIGHBOUR_VZ, NEIGHBOUR_DENSITY,
+    NEIGHBOUR_PRESSURE, NEIGHBOUR_ARRAYS
+};
+
+/**
+ * The grid of the cell-linked list: cells of edge length h which cover the
+ * domain, numbered x first.
+ */
+struct CellGrid {
+    Vec4f origin;
+    float inverseCellSize;
+    int64_t size[3];
+
+    /* Returns the cell coordinate of the given position along one axis
+       (positions outside of the domain are moved into its border cells): */
+    int64_t getCoordinate(float position, int axis, float origin) const {
+        float c = (position - origin) * inverseCellSize;
+        if(!(c > 0.f))
+            return 0;
+        if(c >= float(size[axis]))
+            return size[axis] - 1;
+        return int64_t(c);
+    }
+
+    uint64_t getCell(float px, float py, float pz) const {
+        return uint64_t(getCoordinate(px, 0, origin.x)
+                        + size[0] * (getCoordinate(py, 1, origin.y) + size[1] * getCoordinate(pz, 2, origin.z)));
+    }
+};
+
+/**
+ * Copies the candidate neighbours of the particles of the given cell from
+ * the first 'arrayCount' sorted arrays into 'list' (see NeighbourArray): the
+ * particles of the three cells in x of the nine rows around the cell, which
+ * are nine contiguous ranges of the sorted particles. The list is padded
+ * with far away particles to a multiple of FLOAT_LANES, so the kernels need
+ * no masks for the last lanes.
+ */
+void collectNeighbours(const CellGrid& grid, const std::vector<uint32_t>& cellStarts, uint64_t cell,
+                       const float* const sorted[NEIGHBOUR_ARRAYS], int arrayCount,
+                       std::vector<float> list[NEIGHBOUR_ARRAYS]){
+    int64_t cx = int64_t(cell % uint64_t(grid.size[0]));
+    int64_t cy = int64_t(cell / uint64_t(grid.size[0]) % uint64_t(grid.size[1]));
+    int64_t cz = int64_t(cell / uint64_t(grid.size[0] * grid.size[1]));
+    int64_t x0 = std::max(cx - 1, int64_t(0)), x1 = std::min(cx + 1, grid.size[0] - 1);
+
+    for(int a=0; a < arrayCount; ++a)
+        list[a].clear();
+    for(int64_t z=std::max(cz - 1, int64_t(0)); z <= std::min(cz + 1, grid.size[2] - 1); ++z){
+        for(int64_t y=std::max(cy - 1, int64_t(0)); y <= std::min(cy + 1, grid.size[1] - 1); ++y){
+            int64_t row = grid.size[0] * (y + grid.size[1] * z);
+            uint32_t begin = cellStarts[row + x0], end = cellStarts[row + x1 + 1];
+            for(int a=0; a < arrayCount; ++a)
+                list[a].insert(list[a].end(), sorted[a] + begin, sorted[a] + end);
+        }
+    }
+    while(list[0].size() % FLOAT_LANES != 0){
+        for(int a=0; a < arrayCount; ++a)
+            list[a].push_back(a <= NEIGHBOUR_Z ? FAR_AWAY : a == NEIGHBOUR_DENSITY ? 1.f : 0.f);
+    }
+}
+
+/**
+ * Computes the sums of (h^2 - r^2)^3 over the neighbours in 'list' within
+ * the distance h of the sorted particles [begin, end) (the poly6 kernel
+ * without its factor) and stores them in 'sums'. Like all kernels, the
+ * inner loop handles FLOAT_LANES neighbours in one straight loop over the
+ * lanes, which the compiler vectorizes as a whole.
+ */
+void sumDensityKernels(const std::vector<float> list[NEIGHBOUR_ARRAYS], const float* const sorted[NEIGHBOUR_ARRAYS],
+                       uint32_t begin, uint32_t end, float hSquared, float* sums){
+    const float* x = list[NEIGHBOUR_X].data();
+    const float* y = list[NEIGHBOUR_Y].data();
+    const float* z = list[NEIGHBOUR_Z].data();
+    for(uint32_t i=begin; i < end; ++i){
+        float px = sorted[NEIGHBOUR_X][i], py = sorted[NEIGHBOUR_Y][i], pz = sorted[NEIGHBOUR_Z][i];
+        float sum[FLOAT_LANES] = {};
+        for(size_t j=0; j < list[NEIGHBOUR_X].size(); j += FLOAT_LANES){
+            for(int l=0; l < FLOAT_LANES; ++l){
+                float dx = x[j + l] - px, dy = y[j + l] - py, dz = z[j + l] - pz;
+                float difference = clampToPositive(hSquared - (dx * dx + dy * dy + dz * dz));
+                sum[l] += difference * difference * difference;
+            }
+        }
+        sums[i] = 0.f;
+        for(int l=0; l < FLOAT_LANES; ++l)
+            sums[i] += sum[l];
+    }
+}
+
+/**
+ * Computes the pressure and viscosity accelerations of the neighbours in
+ * 'list' on the sorted particles [begin, end) and stores them in
+ * 'accelerations', without the factor m times that of the spiky kernel:
+ *
+ *   sum_j (p_i / rho_i^2 + p_j / rho_j^2 + Pi_ij) (h - r)^2 x_ij / r
+ *
+ * with x_ij = x_i - x_j and Monaghan's artificial viscosity
+ * Pi_ij = -2 alpha h c min(v_ij . x_ij, 0) / ((rho_i + rho_j) (r^2 + 0.01 h^2)).
+ */
+void computeAccelerations(const std::vector<float> list[NEIGHBOUR_ARRAYS], const float* const sorted[NEIGHBOUR_ARRAYS],
+                          uint32_t begin, uint32_t end, float h, float viscosityFactor,
+                          float* const accelerations[3]){
+    const float* x = list[NEIGHBOUR_X].data();
+    const float* y = list[NEIGHBOUR_Y].data();
+    const float* z = list[NEIGHBOUR_Z].data();
+    const float* vx = list[NEIGHBOUR_VX].data();
+    const float* vy = list[NEIGHBOUR_VY].data();
+    const float* vz = list[NEIGHBOUR_VZ].data();
+    const float* density = list[NEIGHBOUR_DENSITY].data();
+    const float* pressure = list[NEIGHBOUR_PRESSURE].data();
+    const float epsilon = 0.01f * h * h, minimumDistance = 1e-4f * h;
+
+    for(uint32_t i=begin; i < end; ++i){
+        float px = sorted[NEIGHBOUR_X][i], py = sorted[NEIGHBOUR_Y][i], pz = sorted[NEIGHBOUR_Z][i];
+        float pvx = sorted[NEIGHBOUR_VX][i], pvy = sorted[NEIGHBOUR_VY][i], pvz = sorted[NEIGHBOUR_VZ][i];
+        float pDensity = sorted[NEIGHBOUR_DENSITY][i], pPressure = sorted[NEIGHBOUR_PRESSURE][i];
+
+        float ax[FLOAT_LANES] = {}, ay[FLOAT_LANES] = {}, az[FLOAT_LANES] = {};
+        for(size_t j=0; j < list[NEIGHBOUR_X].size(); j += FLOAT_LANES){
+            for(int l=0; l < FLOAT_LANES; ++l){
+                float dx = px - x[j + l], dy = py - y[j + l], dz = pz - z[j + l];
+                float distanceSquared = dx * dx + dy * dy + dz * dz;
+                float distance = std::sqrt(distanceSquared);
+
+                // h - r, which is zero for all particles beyond h (including the padding):
+                float difference = clampToPositive(h - distance);
+
+                // The artificial viscosity (only for approaching particles):
+                float approach = clampToNegative((pvx - vx[j + l]) * dx + (pvy - vy[j + l]) * dy
+                                                 + (pvz - vz[j + l]) * dz);
+                float artificial = -viscosityFactor * approach
+                                   / ((density[j + l] + pDensity) * (distanceSquared + epsilon));
+
+                float factor = (pressure[j + l] + pPressure + artificial) * difference * difference
+                               / (distance + minimumDistance);
+                ax[l] += factor * dx;
+                ay[l] += factor * dy;
+                az[l] += factor * dz;
+            }
+        }
+        accelerations[0][i] = 0.f;
+        accelerations[1][i] = 0.f;
+        accelerations[2][i] = 0.f;
+        for(int l=0; l < FLOAT_LANES; ++l){
+            accelerations[0][i] += ax[l];
+            accelerations[1][i] += ay[l];
+            accelerations[2][i] += az[l];
+        }
+    }
+}
+
+}
+
+SphSettings::SphSettings()
+    : smoothingLength(0.02f), particleMass(0.001f), restDensity(1000.f), speedOfSound(20.f), viscosity(0.05f),
+      gravity(0.f, -9.81f, 0.f, 0.f), domain(Vec4f(0.f, 0.f, 0.f), Vec4f(1.f, 1.f, 1.f))
+{
+}
+
+SphSolver::SphSolver(const SphSettings& settings)
+    : settings(settings)
+{
+}
+
+const SphSettings& SphSolver::getSettings() const {
+    return settings;
+}
+
+float SphSolver::getMaximumTimeStep() const {
+    return 0.4f * settings.smoothingLength / settings.speedOfSound;
+}
+
+const std::vector<float>& SphSolver::getDensities() const {
+    return densities;
+}
+
+void SphSolver::step(Vec4f* positions, Vec4f* velocities, size_t count, float timeStep){
+    const float h = settings.smoothingLength;
+    if(!(h > 0.f) || !(settings.particleMass > 0.f) || !(settings.restDensity > 0.f)
+       || !(settings.speedOfSound > 0.f) || !(settings.viscosity >= 0.f) || !(timeStep >= 0.f)
+       || settings.domain.isEmpty())
+        throw std::invalid_argument("SphSolver: invalid settings.");
+    if(count >= 0xffffffffu)
+        throw std::invalid_argument("SphSolver: too many particles.");
+
+    CellGrid grid;
+    grid.origin = settings.domain.min;
+    grid.inverseCellSize = 1.f / h;
+    float extent[3] = {settings.domain.max.x - settings.domain.min.x, settings.domain.max.y - settings.domain.min.y,
+                       settings.domain.max.z - settings.domain.min.z};
+    double cellCount = 1.0;
+    for(int axis=0; axis < 3; ++axis){
+        double size = std::max(std::ceil(double(extent[axis]) / double(h)), 1.0);
+        cellCount *= size;
+        if(cellCount >= 4294967295.0)
+            throw std::invalid_argument("SphSolver: the domain has too many cells.");
+        grid.size[axis] = int64_t(size);
+    }
+    size_t cellTotal = size_t(cellCount);
+
+    densities.resize(count);
+    if(count == 0)
+        return;
+
+    // 1. The cell-linked list: sort the particles by their cells.
+    cells.resize(count);
+    order.resize(count);
+    parallelFor(0, count, SPH_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            cells[i] = grid.getCell(positions[i].x, positions[i].y, positions[i].z);
+            order[i] = uint32_t(i);
+        }
+    });
+    int keyBits = 1;
+    while(keyBits < 64 && (uint64_t(1) << keyBits) < cellTotal)
+        keyBits++;
+    radixSort(cells, order, keyBits);
+
+    // The first particle of every cell (empty cells start at the next
+    // particle, so the particles of consecutive cells are one range):
+    cellStarts.resize(cellTotal + 1);
+    parallelFor(0, count, SPH_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            uint64_t first = i == 0 ? 0 : cells[i - 1] + 1;
+            for(uint64_t c=first; c <= cells[i]; ++c)
+                cellStarts[c] = uint32_t(i);
+        }
+    });
+    for(uint64_t c=cells[count - 1] + 1; c <= cellTotal; ++c)
+        cellStarts[c] = uint32_t(count);
+
+    // Copy the sorted particles into structure-of-arrays:
+    x.resize(count); y.resize(count); z.resize(count);
+    vx.resize(count); vy.resize(count); vz.resize(count);
+    sortedDensities.resize(count); pressureTerms.resize(count);
+    ax.resize(count); ay.resize(count); az.resize(count);
+    parallelFor(0, count, SPH_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            const Vec4f& p = positions[order[i]];
+            const Vec4f& v = velocities[order[i]];
+            x[i] = p.x; y[i] = p.y; z[i] = p.z;
+            vx[i] = v.x; vy[i] = v.y; vz[i] = v.z;
+        }
+    });
+    const float* const sorted[NEIGHBOUR_ARRAYS] = {x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(),
+                                                   sortedDensities.data(), pressureTerms.data()};
+    float* const accelerations[3] = {ax.data(), ay.data(), az.data()};
+
+    const float hSquared = h * h;
+    const float mass = settings.particleMass;
+    const double pi = 3.14159265358979;
+    const float poly6 = float(315.0 / (64.0 * pi * std::pow(double(h), 9.0)));
+    const float spiky = float(45.0 / (pi * std::pow(double(h), 6.0)));
+    const float stiffness = settings.restDensity * settings.speedOfSound * settings.speedOfSound / 7.f;
+    const float inverseRestDensity = 1.f / settings.restDensity;
+    const float viscosityFactor = 2.f * settings.viscosity * h * settings.speedOfSound;
+
+    // 2. The densities and pressures:
+    parallelFor(0, cellTotal, CELL_GRAIN_SIZE, [&](size_t begin, size_t end){
+        std::vector<float> list[NEIGHBOUR_ARRAYS];
+        for(size_t cell=begin; cell < end; ++cell){
+            if(cellStarts[cell] == cellStarts[cell + 1])
+                continue;
+            collectNeighbours(grid, cellStarts, cell, sorted, NEIGHBOUR_Z + 1, list);
+
+            sumDensityKernels(list, sorted, cellStarts[cell], cellStarts[cell + 1], hSquared, sortedDensities.data());
+            for(uint32_t i=cellStarts[cell]; i < cellStarts[cell + 1]; ++i){
+                float rho = sortedDensities[i] * mass * poly6;
+                float ratio = rho * inverseRestDensity;
+                float ratio3 = ratio * ratio * ratio;
+                float pressure = std::max(stiffness * (ratio3 * ratio3 * ratio - 1.f), 0.f);
+                sortedDensities[i] = rho;
+                pressureTerms[i] = pressure / (rho * rho);
+            }
+        }
+    });
+
+    // 3. The pressure and viscosity accelerations:
+    parallelFor(0, cellTotal, CELL_GRAIN_SIZE, [&](size_t begin, size_t end){
+        std::vector<float> list[NEIGHBOUR_ARRAYS];
+        for(size_t cell=begin; cell < end; ++cell){
+            if(cellStarts[cell] == cellStarts[cell + 1])
+                continue;
+            collectNeighbours(grid, cellStarts, cell, sorted, NEIGHBOUR_ARRAYS, list);
+
+            computeAccelerations(list, sorted, cellStarts[cell], cellStarts[cell + 1], h, viscosityFactor,
+                                 accelerations);
+        }
+    });
+
+    // 4. Integrate and write the particles back in the order of the caller:
+    const AABB& domain = settings.domain;
+    const float accelerationScale = mass * spiky;
+    parallelFor(0, count, SPH_GRAIN_SIZE, [&](size_t begin, size_t end){
+        for(size_t i=begin; i < end; ++i){
+            float position[3] = {x[i], y[i], z[i]};
+            float velocity[3] = {vx[i] + (ax[i] * accelerationScale + settings.gravity.x) * timeStep,
+                                 vy[i] + (ay[i] * accelerationScale + settings.gravity.y) * timeStep,
+                                 vz[i] + (az[i] * accelerationScale + settings.gravity.z) * timeStep};
+            const float minimumBound[3] = {domain.min.x, domain.min.y, domain.min.z};
+            const float maximumBound[3] = {domain.max.x, domain.max.y, domain.max.z};
+            for(int axis=0; axis < 3; ++axis){
+                position[axis] += velocity[axis] * timeStep;
+                if(position[axis] < minimumBound[axis]){
+                    position[axis] = minimumBound[axis];
+                    velocity[axis] = std::max(velocity[axis], 0.f);
+                }
+                else if(position[axis] > maximumBound[axis]){
+                    position[axis] = maximumBound[axis];
+                    velocity[axis] = std::min(velocity[axis], 0.f);
+                }
+            }
+
+            Vec4f& p = positions[order[i]];
+            Vec4f& v = velocities[order[i]];
+            p.x = position[0]; p.y = position[1]; p.z = position[2];
+            v.x = velocity[0]; v.y = velocity[1]; v.z = velocity[2];
+            densities[order[i]] = sortedDensities[i];
+        }
+    });
+}
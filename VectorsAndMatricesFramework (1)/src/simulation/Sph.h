@@ -0,0 +1,152 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our math classes: */
+#include "../math/Vec4f.h"
+#include "../math/AABB.h"
+
+/**
+ * The parameters of the SPH fluid (see SphSolver). The defaults describe
+ * water with particles on a grid of 1 cm spacing.
+ */
+
+class SphSettings
+{
+public:
+    /**
+     * The smoothing length h, which is the radius of the kernels and the
+     * edge length of the cells of the neighbour search (default 0.02, twice
+     * the particle spacing).
+     */
+    float smoothingLength;
+
+    /** The mass of every particle (default 0.001, the rest density times the cube of the spacing) */
+    float particleMass;
+
+    /** The rest density rho0 (default 1000) */
+    float restDensity;
+
+    /**
+     * The numerical speed of sound c of the Tait equation of state (default
+     * 20). The density deviates by about (|v| / c)^2 from the rest density,
+     * so c should be about ten times the largest velocity of the fluid.
+     */
+    float speedOfSound;
+
+    /** The artificial viscosity alpha (default 0.05) */
+    float viscosity;
+
+    /** The gravitational acceleration (default (0, -9.81, 0)) */
+    Vec4f gravity;
+
+    /**
+     * The box which contains the fluid (default [0, 1]^3): particles are
+     * kept inside and the neighbour grid covers it, so it should not be much
+     * larger than the space the fluid can reach.
+     */
+    AABB domain;
+
+    /**
+     * Constructs the default settings.
+     */
+    SphSettings();
+};
+
+/**
+ * A weakly compressible SPH fluid solver (WCSPH, Becker and Teschner,
+ * "Weakly compressible SPH for free surface flows", 2007). The state of the
+ * fluid are two arrays of Vec4f: the positions (x, y, z) and the velocities
+ * (x, y, z) of the particles. Every step(...)
+ *
+ *  1. sorts the particles by the cells of a grid with the cell size h (a
+ *     cell-linked list: the index of the first particle of every cell into
+ *     the sorted particles, which are copied into structure-of-arrays),
+ *  2. computes the density rho_i = sum_j m W(x_i - x_j) with the poly6
+ *     kernel and the pressure p_i = B ((rho_i / rho0)^7 - 1) with
+ *     B = rho0 c^2 / 7 (negative pressures are clamped to zero, which
+ *     avoids the tensile instability at the free surface),
+ *  3. computes the pressure and viscosity accelerations with the gradient
+ *     of the spiky kernel and the artificial viscosity of Monaghan,
+ *  4. integrates the velocities and positions with the symplectic Euler
+ *     method and keeps the particles inside of the domain (the velocity
+ *     into a wall is removed).
+ *
+ * The cells are ordered by x first, so the cells (x - 1, y, z) to
+ * (x + 1, y, z) are one contiguous range of the sorted particles: the
+ * candidate neighbours of a cell are copied from nine ranges into one list,
+ * which every particle of the cell walks FLOAT_LANES neighbours at a time.
+ * The cells are processed in parallel, and every cell only writes its own
+ * particles, so the result does not depend on the number of threads.
+ *
+ * The particles keep their order in the arrays of the caller. The memory of
+ * the solver (about 70 bytes per particle plus 4 bytes per cell) is reused
+ * by the following steps.
+ */
+
+class SphSolver
+{
+public:
+    /**
+     * Constructs a solver with the given settings.
+     */
+    SphSolver(const SphSettings& settings = SphSettings());
+
+    /**
+     * Returns the settings.
+     */
+    const SphSettings& getSettings() const;
+
+    /**
+     * Returns the largest stable time step by the CFL condition
+     * dt = 0.4 h / c.
+     */
+    float getMaximumTimeStep() const;
+
+    /**
+     * Advances the particles by one time step (see above). Throws
+     * std::invalid_argument for invalid settings, 2^32 or more particles, or
+     * a domain with 2^32 or more cells.
+     */
+    void step(Vec4f* positions, Vec4f* velocities, size_t count, float timeStep);
+
+    /**
+     * Returns the densities of the particles (in the order of the caller)
+     * which were computed by the last step(...).
+     */
+    const std::vector<float>& getDensities() const;
+
+private:
+    /** The settings */
+    SphSettings settings;
+
+    /** The cell of every particle, and then the sorted cells */
+    std::vector<uint64_t> cells;
+
+    /** The original index of every sorted particle */
+    std::vector<uint32_t> order;
+
+    /** The index of the first sorted particle of every cell (and the number of particles at the end) */
+    std::vector<uint32_t> cellStarts;
+
+    /** The sorted particles in structure-of-arrays layout */
+    std::vector<float> x, y, z, vx, vy, vz;
+
+    /** The densities and p / rho^2 of the sorted particles */
+    std::vector<float> sortedDensities, pressureTerms;
+
+    /** The accelerations of the sorted particles */
+    std::vector<float> ax, ay, az;
+
+    /** The densities in the order of the caller */
+    std::vector<float> densities;
+};
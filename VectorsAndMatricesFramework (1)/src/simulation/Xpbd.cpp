@@ -0,0 +1,565 @@
+#include "Xpbd.h"
+#include "../math/FloatLanes.h"
+#include "../math/Parallel.h"
+#include "../math/Sorting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/* The number of particles which are processed by one task: */
+const size_t PARTICLE_GRAIN_SIZE = 16384;
+
+/* The number of constraints of one color which are projected by one task
+   (a multiple of FLOAT_LANES): */
+const size_t CONSTRAINT_GRAIN_SIZE = 2048;
+
+/* The number of colors which are assigned by one pass over the constraints
+   (one bit of a mask per particle each): */
+const uint32_t COLORS_PER_PASS = 64;
+
+struct Vector3 {
+    float x, y, z;
+};
+
+inline Vector3 toVector3(const Vec4f& v){
+    Vector3 r = {v.x, v.y, v.z};
+    return r;
+}
+
+inline Vector3 operator-(const Vector3& a, const Vector3& b){
+    Vector3 r = {a.x - b.x, a.y - b.y, a.z - b.z};
+    return r;
+}
+
+inline Vector3 operator+(const Vector3& a, const Vector3& b){
+    Vector3 r = {a.x + b.x, a.y + b.y, a.z + b.z};
+    return r;
+}
+
+inline Vector3 operator*(float s, const Vector3& a){
+    Vector3 r = {s * a.x, s * a.y, s * a.z};
+    return r;
+}
+
+inline float dot(const Vector3& a, const Vector3& b){
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vector3 cross(const Vector3& a, const Vector3& b){
+    Vector3 r = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    return r;
+}
+
+/* Adds the given displacement to the position of a particle (keeping its
+   inverse mass): */
+inline void displace(Vec4f& position, const Vector3& displacement){
+    position.x += displacement.x;
+    position.y += displacement.y;
+    position.z += displacement.z;
+}
+
+/* Returns the dihedral angle of the bending constraint (a, b, c, d), which
+   is pi for two triangles in one plane (pi for degenerate triangles): */
+float dihedralAngle(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d){
+    Vector3 n1 = cross(b - a, c - a), n2 = cross(b - a, d - a);
+    float lengths = std::sqrt(dot(n1, n1) * dot(n2, n2));
+    if(!(lengths > 0.f))
+        return 3.14159265f;
+    return std::acos(std::max(-1.f, std::min(dot(n1, n2) / lengths, 1.f)));
+}
+
+/* Returns the signed volume of the tetrahedron (a, b, c, d): */
+float tetrahedronVolume(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d){
+    return dot(b - a, cross(c - a, d - a)) / 6.f;
+}
+
+/* Returns the key of the edge between the vertices a and b, which does not
+   depend on their order: */
+inline uint64_t edgeKey(uint32_t a, uint32_t b){
+    return (uint64_t(std::min(a, b)) << 32) | uint64_t(std::max(a, b));
+}
+
+/**
+ * Projects the distance constraints of every color, FLOAT_LANES constraints
+ * at a time: the lane loop computes the corrections of all lanes, which are
+ * then added to the particles one lane after another (the particles of a
+ * color are distinct, so no correction is lost). Unused lanes of the last
+ * group compute a zero correction of a dummy constraint.
+ */
+void projectDistances(XpbdConstraints& constraints, Vec4f* positions, float inverseTimeStepSquared){
+    const uint32_t* particlesA = constraints.particles[0].data();
+    const uint32_t* particlesB = constraints.particles[1].data();
+    const float* restLengths = constraints.restValues.data();
+    const float* compliances = constraints.compliances.data();
+    float* lambdas = constraints.lambdas.data();
+
+    for(size_t color=0; color + 1 < constraints.colorStarts.size(); ++color){
+        parallelFor(constraints.colorStarts[color], constraints.colorStarts[color + 1], CONSTRAINT_GRAIN_SIZE,
+                    [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; i += FLOAT_LANES){
+                int lanes = int(std::min(end - i, size_t(FLOAT_LANES)));
+                float ax[FLOAT_LANES], ay[FLOAT_LANES], az[FLOAT_LANES], aw[FLOAT_LANES];
+                float bx[FLOAT_LANES], by[FLOAT_LANES], bz[FLOAT_LANES], bw[FLOAT_LANES];
+                float rest[FLOAT_LANES], alpha[FLOAT_LANES], lambda[FLOAT_LANES];
+                for(int l=0; l < FLOAT_LANES; ++l){
+                    if(l < lanes){
+                        const Vec4f& a = positions[particlesA[i + l]];
+                        const Vec4f& b = positions[particlesB[i + l]];
+                        ax[l] = a.x; ay[l] = a.y; az[l] = a.z; aw[l] = a.w;
+                        bx[l] = b.x; by[l] = b.y; bz[l] = b.z; bw[l] = b.w;
+                        rest[l] = restLengths[i + l];
+                        alpha[l] = compliances[i + l] * inverseTimeStepSquared;
+                        lambda[l] = lambdas[i + l];
+                    }
+                    else {
+                        // A satisfied constraint of length 1 between fixed particles:
+                        ax[l] = 0.f; ay[l] = 0.f; az[l] = 0.f; aw[l] = 0.f;
+                        bx[l] = 1.f; by[l] = 0.f; bz[l] = 0.f; bw[l] = 0.f;
+                        rest[l] = 1.f;
+                        alpha[l] = 1.f;
+                        lambda[l] = 0.f;
+                    }
+                }
+
+                // dLambda = (-C - alpha lambda) / (w_a + w_b + alpha) with C = |a - b| - l,
+                // and the corrections w_a dLambda n and -w_b dLambda n with n = (a - b) / |a - b|:
+                float dx[FLOAT_LANES], dy[FLOAT_LANES], dz[FLOAT_LANES];
+                for(int l=0; l < FLOAT_LANES; ++l){
+                    float ex = ax[l] - bx[l], ey = ay[l] - by[l], ez = az[l] - bz[l];
+                    float length = std::sqrt(ex * ex + ey * ey + ez * ez);
+                    float deltaLambda = (rest[l] - length - alpha[l] * lambda[l])
+                                        / (aw[l] + bw[l] + alpha[l] + 1e-30f);
+                    lambda[l] += deltaLambda;
+                    float scale = deltaLambda / (length + 1e-30f);
+                    dx[l] = ex * scale;
+                    dy[l] = ey * scale;
+                    dz[l] = ez * scale;
+                }
+
+                for(int l=0; l < lanes; ++l){
+                    Vec4f& a = positions[particlesA[i + l]];
+                    Vec4f& b = positions[particlesB[i + l]];
+                    a.x += aw[l] * dx[l]; a.y += aw[l] * dy[l]; a.z += aw[l] * dz[l];
+                    b.x -= bw[l] * dx[l]; b.y -= bw[l] * dy[l]; b.z -= bw[l] * dz[l];
+                    lambdas[i + l] = lambda[l];
+                }
+            }
+        });
+    }
+}
+
+/**
+ * Projects the bending constraints of every color (Müller et al. 2007,
+ * appendix A): with a in the origin, q_i is the negated gradient of the
+ * cosine d = n1 . n2 of the dihedral angle by particle i, so the gradient
+ * of C = acos(d) - phi0 is q_i / sqrt(1 - d^2).
+ */
+void projectBendings(XpbdConstraints& constraints, Vec4f* positions, float inverseTimeStepSquared){
+    for(size_t color=0; color + 1 < constraints.colorStarts.size(); ++color){
+        parallelFor(constraints.colorStarts[color], constraints.colorStarts[color + 1], CONSTRAINT_GRAIN_SIZE,
+                    [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i){
+                Vec4f* p[4];
+                for(int k=0; k < 4; ++k)
+                    p[k] = &positions[constraints.particles[k][i]];
+                float w[4] = {p[0]->w, p[1]->w, p[2]->w, p[3]->w};
+                if(w[0] + w[1] + w[2] + w[3] == 0.f)
+                    continue;
+
+                Vector3 origin = toVector3(*p[0]);
+                Vector3 p2 = toVector3(*p[1]) - origin, p3 = toVector3(*p[2]) - origin, p4 = toVector3(*p[3]) - origin;
+                Vector3 c23 = cross(p2, p3), c24 = cross(p2, p4);
+                float length23 = std::sqrt(dot(c23, c23)), length24 = std::sqrt(dot(c24, c24));
+                if(!(length23 > 1e-12f) || !(length24 > 1e-12f))
+                    continue;
+                Vector3 n1 = (1.f / length23) * c23, n2 = (1.f / length24) * c24;
+                float d = std::max(-1.f, std::min(dot(n1, n2), 1.f));
+
+                Vector3 q[4];
+                q[2] = (1.f / length23) * (cross(p2, n2) + d * cross(n1, p2));
+                q[3] = (1.f / length24) * (cross(p2, n1) + d * cross(n2, p2));
+                q[1] = (-1.f / length23) * (cross(p3, n2) + d * cross(n1, p3))
+                       + (-1.f / length24) * (cross(p4, n1) + d * cross(n2, p4));
+                q[0] = -1.f * (q[1] + q[2] + q[3]);
+
+                float weightedSum = 0.f;
+                for(int k=0; k < 4; ++k)
+                    weightedSum += w[k] * dot(q[k], q[k]);
+                float s = std::sqrt(std::max(1.f - d * d, 0.f));
+                float alpha = constraints.compliances[i] * inverseTimeStepSquared;
+                float denominator = weightedSum + alpha * s * s;
+                if(!(denominator > 1e-20f))
+                    continue;
+
+                // dLambda = s^2 (-C - alpha lambda) / (sum w_i |q_i|^2 + alpha s^2) and
+                // dp_i = w_i q_i dLambda / s:
+                float& lambda = constraints.lambdas[i];
+                float numerator = -(std::acos(d) - constraints.restValues[i]) - alpha * lambda;
+                lambda += s * s * numerator / denominator;
+                float factor = s * numerator / denominator;
+                for(int k=0; k < 4; ++k)
+                    displace(*p[k], (w[k] * factor) * q[k]);
+            }
+        });
+    }
+}
+
+/**
+ * Projects the volume constraints of every color: the gradients of the
+ * volume by the particles b, c and d are the cross products of the other two
+ * edges from a over 6, and that by a is the negated sum of them.
+ */
+void projectVolumes(XpbdConstraints& constraints, Vec4f* positions, float inverseTimeStepSquared){
+    for(size_t color=0; color + 1 < constraints.colorStarts.size(); ++color){
+        parallelFor(constraints.colorStarts[color], constraints.colorStarts[color + 1], CONSTRAINT_GRAIN_SIZE,
+                    [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i){
+                Vec4f* p[4];
+                for(int k=0; k < 4; ++k)
+                    p[k] = &positions[constraints.particles[k][i]];
+                float w[4] = {p[0]->w, p[1]->w, p[2]->w, p[3]->w};
+
+                Vector3 a = toVector3(*p[0]);
+                Vector3 ab = toVector3(*p[1]) - a, ac = toVector3(*p[2]) - a, ad = toVector3(*p[3]) - a;
+                Vector3 gradients[4];
+                gradients[1] = (1.f / 6.f) * cross(ac, ad);
+                gradients[2] = (1.f / 6.f) * cross(ad, ab);
+                gradients[3] = (1.f / 6.f) * cross(ab, ac);
+                gradients[0] = -1.f * (gradients[1] + gradients[2] + gradients[3]);
+
+                float alpha = constraints.compliances[i] * inverseTimeStepSquared;
+                float denominator = alpha;
+                for(int k=0; k < 4; ++k)
+                    denominator += w[k] * dot(gradients[k], gradients[k]);
+                if(!(denominator > 1e-30f))
+                    continue;
+
+                float& lambda = constraints.lambdas[i];
+                float volume = dot(ab, gradients[1]);
+                float deltaLambda = (constraints.restValues[i] - volume - alpha * lambda) / denominator;
+                lambda += deltaLambda;
+                for(int k=0; k < 4; ++k)
+                    displace(*p[k], (w[k] * deltaLambda) * gradients[k]);
+            }
+        });
+    }
+}
+
+/**
+ * Moves a colliding particle by 'depth' along the unit normal out of a
+ * collider and reduces its tangential motion since the beginning of the
+ * substep by up to friction times the depth (Coulomb friction as a position
+ * correction, Macklin et al. 2014).
+ */
+void resolveContact(Vector3& position, const Vector3& previous, const Vector3& normal, float depth, float friction){
+    position = position + depth * normal;
+    Vector3 motion = position - previous;
+    Vector3 tangential = motion - dot(motion, normal) * normal;
+    float length = std::sqrt(dot(tangential, tangential));
+    if(length > 0.f)
+        position = position - std::min(friction * depth / length, 1.f) * tangential;
+}
+
+/**
+ * Keeps a particle outside of a signed distance field: its normal is the
+ * normalized gradient of the field.
+ */
+template<typename Field>
+void collideWithField(const Field& field, Vector3& position, const Vector3& previous, float margin, float friction){
+    Vec4f point(position.x, position.y, position.z);
+    float distance = field.sample(point) - margin;
+    if(!(distance < 0.f))
+        return;
+    Vec4f gradient = field.sampleGradient(point);
+    Vector3 normal = toVector3(gradient);
+    float length = std::sqrt(dot(normal, normal));
+    if(!(length > 0.f))
+        return;
+    resolveContact(position, previous, (1.f / length) * normal, -distance, friction);
+}
+
+}
+
+XpbdSettings::XpbdSettings()
+    : gravity(0.f, -9.81f, 0.f, 0.f), substeps(10), iterations(1), collisionMargin(0.005f), friction(0.3f)
+{
+}
+
+XpbdConstraints::XpbdConstraints(size_t particlesPerConstraint)
+    : particlesPerConstraint(particlesPerConstraint), usedParticleCount(0)
+{
+}
+
+size_t XpbdConstraints::getCount() const {
+    return restValues.size();
+}
+
+void XpbdConstraints::add(const uint32_t* indices, float restValue, float compliance){
+    for(size_t k=0; k < particlesPerConstraint; ++k){
+        particles[k].push_back(indices[k]);
+        usedParticleCount = std::max(usedParticleCount, size_t(indices[k]) + 1);
+    }
+    restValues.push_back(restValue);
+    compliances.push_back(compliance);
+    colorStarts.clear();
+}
+
+void XpbdConstraints::color(){
+    if(!colorStarts.empty())
+        return;
+
+    // Assign the colors greedily, COLORS_PER_PASS at a time: every particle
+    // has a mask of the colors of the pass which its constraints already
+    // use, and constraints for which all colors of the pass are used are
+    // left for the next pass.
+    size_t count = getCount();
+    std::vector<uint32_t> colors(count);
+    std::vector<uint32_t> pending(count), next;
+    for(size_t i=0; i < count; ++i)
+        pending[i] = uint32_t(i);
+    std::vector<uint64_t> masks(usedParticleCount);
+    uint32_t colorCount = 0;
+    for(uint32_t firstColor=0; !pending.empty(); firstColor += COLORS_PER_PASS){
+        std::fill(masks.begin(), masks.end(), uint64_t(0));
+        next.clear();
+        for(size_t j=0; j < pending.size(); ++j){
+            uint32_t i = pending[j];
+            uint64_t used = 0;
+            for(size_t k=0; k < particlesPerConstraint; ++k)
+                used |= masks[particles[k][i]];
+            if(used == ~uint64_t(0)){
+                next.push_back(i);
+                continue;
+            }
+            uint64_t bit = ~used & (used + 1);
+            for(size_t k=0; k < particlesPerConstraint; ++k)
+                masks[particles[k][i]] |= bit;
+            uint32_t color = firstColor;
+            while(bit >>= 1)
+                color++;
+            colors[i] = color;
+            colorCount = std::max(colorCount, color + 1);
+        }
+        pending.swap(next);
+    }
+
+    // Sort the constraints by color (stable, so the constraints of a color
+    // keep the order in which they were added):
+    colorStarts.assign(size_t(colorCount) + 1, 0);
+    for(size_t i=0; i < count; ++i)
+        colorStarts[colors[i] + 1]++;
+    for(uint32_t c=0; c < colorCount; ++c)
+        colorStarts[c + 1] += colorStarts[c];
+    std::vector<size_t> targets(colorStarts.begin(), colorStarts.end() - 1);
+    std::vector<size_t> order(count);
+    for(size_t i=0; i < count; ++i)
+        order[targets[colors[i]]++] = i;
+
+    std::vector<uint32_t> sortedParticles(count);
+    for(size_t k=0; k < particlesPerConstraint; ++k){
+        for(size_t i=0; i < count; ++i)
+            sortedParticles[i] = particles[k][order[i]];
+        particles[k].swap(sortedParticles);
+    }
+    std::vector<float> sortedValues(count);
+    for(size_t i=0; i < count; ++i)
+        sortedValues[i] = restValues[order[i]];
+    restValues.swap(sortedValues);
+    for(size_t i=0; i < count; ++i)
+        sortedValues[i] = compliances[order[i]];
+    compliances.swap(sortedValues);
+    lambdas.assign(count, 0.f);
+}
+
+XpbdSolver::XpbdSolver(const XpbdSettings& settings)
+    : settings(settings), distances(2), bendings(4), volumes(4)
+{
+}
+
+const XpbdSettings& XpbdSolver::getSettings() const {
+    return settings;
+}
+
+void XpbdSolver::addDistanceConstraint(uint32_t a, uint32_t b, float restLength, float compliance){
+    const uint32_t indices[2] = {a, b};
+    distances.add(indices, restLength, compliance);
+}
+
+void XpbdSolver::addBendingConstraint(uint32_t a, uint32_t b, uint32_t c, uint32_t d, float restAngle,
+                                      float compliance){
+    const uint32_t indices[4] = {a, b, c, d};
+    bendings.add(indices, restAngle, compliance);
+}
+
+void XpbdSolver::addVolumeConstraint(uint32_t a, uint32_t b, uint32_t c, uint32_t d, float restVolume,
+                                     float compliance){
+    const uint32_t indices[4] = {a, b, c, d};
+    volumes.add(indices, restVolume, compliance);
+}
+
+void XpbdSolver::addCloth(const Vec4f* positions, const uint32_t* indices, size_t triangleCount,
+                          float stretchCompliance, float bendingCompliance){
+    if(triangleCount >= 0xffffffffu / 3)
+        throw std::invalid_argument("XpbdSolver: too many triangles.");
+
+    // Sort the edges of all triangles (edge k of a triangle starts at its
+    // vertex k), so the two triangles of an inner edge are neighbours:
+    std::vector<uint64_t> keys(triangleCount * 3);
+    std::vector<uint32_t> edges(triangleCount * 3);
+    for(size_t t=0; t < triangleCount; ++t){
+        for(int k=0; k < 3; ++k){
+            keys[t * 3 + k] = edgeKey(indices[t * 3 + k], indices[t * 3 + (k + 1) % 3]);
+            edges[t * 3 + k] = uint32_t(t * 3 + k);
+        }
+    }
+    radixSort(keys, edges, 64);
+
+    for(size_t i=0; i < keys.size(); ){
+        size_t end = i + 1;
+        while(end < keys.size() && keys[end] == keys[i])
+            end++;
+
+        uint32_t first = edges[i], triangle = first / 3, k = first % 3;
+        uint32_t a = indices[triangle * 3 + k], b = indices[triangle * 3 + (k + 1) % 3];
+        uint32_t c = indices[triangle * 3 + (k + 2) % 3];
+        Vector3 pa = toVector3(positions[a]), pb = toVector3(positions[b]);
+        addDistanceConstraint(a, b, std::sqrt(dot(pb - pa, pb - pa)), stretchCompliance);
+
+        // Bend inner edges (non-manifold edges only between their first two triangles):
+        if(end - i >= 2){
+            uint32_t second = edges[i + 1];
+            uint32_t d = indices[(second / 3) * 3 + (second % 3 + 2) % 3];
+            float angle = dihedralAngle(pa, pb, toVector3(positions[c]), toVector3(positions[d]));
+            addBendingConstraint(a, b, c, d, angle, bendingCompliance);
+        }
+        i = end;
+    }
+}
+
+void XpbdSolver::addSoftBody(const Vec4f* positions, const uint32_t* indices, size_t tetrahedronCount,
+                             float edgeCompliance, float volumeCompliance){
+    if(tetrahedronCount >= 0xffffffffu / 6)
+        throw std::invalid_argument("XpbdSolver: too many tetrahedra.");
+
+    const int EDGES[6][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+    std::vector<uint64_t> keys(tetrahedronCount * 6);
+    std::vector<uint32_t> edges(tetrahedronCount * 6);
+    for(size_t t=0; t < tetrahedronCount; ++t){
+        const uint32_t* v = indices + t * 4;
+        for(int k=0; k < 6; ++k){
+            keys[t * 6 + k] = edgeKey(v[EDGES[k][0]], v[EDGES[k][1]]);
+            edges[t * 6 + k] = uint32_t(t * 6 + k);
+        }
+        addVolumeConstraint(v[0], v[1], v[2], v[3],
+                            tetrahedronVolume(toVector3(positions[v[0]]), toVector3(positions[v[1]]),
+                                              toVector3(positions[v[2]]), toVector3(positions[v[3]])),
+                            volumeCompliance);
+    }
+    radixSort(keys, edges, 64);
+
+    for(size_t i=0; i < keys.size(); ++i){
+        if(i > 0 && keys[i] == keys[i - 1])
+            continue;
+        uint32_t a = uint32_t(keys[i] >> 32), b = uint32_t(keys[i]);
+        Vector3 pa = toVector3(positions[a]), pb = toVector3(positions[b]);
+        addDistanceConstraint(a, b, std::sqrt(dot(pb - pa, pb - pa)), edgeCompliance);
+    }
+}
+
+void XpbdSolver::addCollisionPlane(const Vec4f& normal, float offset){
+    planes.push_back(Vec4f(normal.x, normal.y, normal.z, offset));
+}
+
+void XpbdSolver::addCollisionField(const SignedDistanceField& field){
+    fields.push_back(&field);
+}
+
+void XpbdSolver::addCollisionField(const SparseSignedDistanceField& field){
+    sparseFields.push_back(&field);
+}
+
+size_t XpbdSolver::getColorCount() const {
+    size_t count = 0;
+    const XpbdConstraints* sets[3] = {&distances, &bendings, &volumes};
+    for(int s=0; s < 3; ++s){
+        if(!sets[s]->colorStarts.empty())
+            count += sets[s]->colorStarts.size() - 1;
+    }
+    return count;
+}
+
+void XpbdSolver::step(Vec4f* positions, Vec4f* velocities, size_t count, float timeStep){
+    if(settings.substeps == 0 || settings.iterations == 0 || !(timeStep >= 0.f)
+       || !(settings.collisionMargin >= 0.f) || !(settings.friction >= 0.f))
+        throw std::invalid_argument("XpbdSolver: invalid settings.");
+    XpbdConstraints* sets[3] = {&distances, &bendings, &volumes};
+    for(int s=0; s < 3; ++s){
+        if(sets[s]->usedParticleCount > count)
+            throw std::invalid_argument("XpbdSolver: a constraint refers to a particle which does not exist.");
+    }
+    for(int s=0; s < 3; ++s)
+        sets[s]->color();
+    if(count == 0 || timeStep == 0.f)
+        return;
+
+    previousPositions.resize(count);
+    const float dt = timeStep / float(settings.substeps);
+    const float inverseTimeStep = 1.f / dt, inverseTimeStepSquared = inverseTimeStep * inverseTimeStep;
+    const Vec4f& gravity = settings.gravity;
+    const float margin = settings.collisionMargin, friction = settings.friction;
+
+    for(size_t substep=0; substep < settings.substeps; ++substep){
+        // Predict the positions of the free particles:
+        parallelFor(0, count, PARTICLE_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i){
+                Vec4f& p = positions[i];
+                Vec4f& v = velocities[i];
+                previousPositions[i] = p;
+                if(p.w > 0.f){
+                    v.x += gravity.x * dt; v.y += gravity.y * dt; v.z += gravity.z * dt;
+                    p.x += v.x * dt; p.y += v.y * dt; p.z += v.z * dt;
+                }
+            }
+        });
+
+        // Project the constraints color by color:
+        for(int s=0; s < 3; ++s)
+            std::fill(sets[s]->lambdas.begin(), sets[s]->lambdas.end(), 0.f);
+        for(size_t iteration=0; iteration < settings.iterations; ++iteration){
+            projectDistances(distances, positions, inverseTimeStepSquared);
+            projectBendings(bendings, positions, inverseTimeStepSquared);
+            projectVolumes(volumes, positions, inverseTimeStepSquared);
+        }
+
+        // Resolve the collisions and derive the velocities from the motion:
+        parallelFor(0, count, PARTICLE_GRAIN_SIZE, [&](size_t begin, size_t end){
+            for(size_t i=begin; i < end; ++i){
+                Vec4f& p = positions[i];
+                Vec4f& v = velocities[i];
+                if(!(p.w > 0.f)){
+                    v.x = 0.f; v.y = 0.f; v.z = 0.f;
+                    continue;
+                }
+                Vector3 position = toVector3(p), previous = toVector3(previousPositions[i]);
+                for(size_t j=0; j < planes.size(); ++j){
+                    Vector3 normal = toVector3(planes[j]);
+                    float distance = dot(normal, position) + planes[j].w - margin;
+                    if(distance < 0.f)
+                        resolveContact(position, previous, normal, -distance, friction);
+                }
+                for(size_t j=0; j < fields.size(); ++j)
+                    collideWithField(*fields[j], position, previous, margin, friction);
+                for(size_t j=0; j < sparseFields.size(); ++j)
+                    collideWithField(*sparseFields[j], position, previous, margin, friction);
+
+                p.x = position.x; p.y = position.y; p.z = position.z;
+                v.x = (position.x - previous.x) * inverseTimeStep;
+                v.y = (position.y - previous.y) * inverseTimeStep;
+                v.z = (position.z - previous.z) * inverseTimeStep;
+            }
+        });
+    }
+}
@@ -0,0 +1,245 @@
+// © 2022, CGVR (https://cgvr.informatik.uni-bremen.de/),
+// Author: Andre Mühlenbrock (muehlenb@uni-bremen.de)
+
+// Include this file only once when compiling:
+#pragma once
+
+/* Includes size_t and uint32_t: */
+#include <cstddef>
+#include <cstdint>
+
+/* Includes the std::vector class (which is NOT a mathematical vector): */
+#include <vector>
+
+/* Include our vectors and signed distance fields: */
+#include "../math/Vec4f.h"
+#include "../geometry/SignedDistanceField.h"
+
+/**
+ * The parameters of XpbdSolver.
+ */
+
+class XpbdSettings
+{
+public:
+    /** The gravitational acceleration (default (0, -9.81, 0)) */
+    Vec4f gravity;
+
+    /**
+     * The number of substeps per step (default 10). Every substep predicts
+     * the positions, projects all constraints once and handles the
+     * collisions ("Small steps in physics simulation", Macklin et al. 2019),
+     * which converges much faster than more iterations of one large step.
+     */
+    size_t substeps;
+
+    /** The number of projections of all constraints per substep (default 1) */
+    size_t iterations;
+
+    /**
+     * The distance which the particles keep from the collision planes and
+     * fields (default 0.005), for example the thickness of cloth.
+     */
+    float collisionMargin;
+
+    /**
+     * The friction coefficient of the collisions (default 0.3): the
+     * tangential motion of a colliding particle in a substep is reduced by
+     * up to this factor times its penetration depth.
+     */
+    float friction;
+
+    /**
+     * Constructs the default settings.
+     */
+    XpbdSettings();
+};
+
+/**
+ * The constraints of one type of XpbdSolver (with the same number of
+ * particles each) in structure-of-arrays layout.
+ */
+
+class XpbdConstraints
+{
+public:
+    /** The number of particles of every constraint (at most 4) */
+    size_t particlesPerConstraint;
+
+    /** The indices of the particles of the constraints (one array per particle of a constraint) */
+    std::vector<uint32_t> particles[4];
+
+    /** The rest length, angle or volume of every constraint */
+    std::vector<float> restValues;
+
+    /** The compliance of every constraint */
+    std::vector<float> compliances;
+
+    /** The Lagrange multiplier of every constraint in the current substep */
+    std::vector<float> lambdas;
+
+    /** The largest particle index of the constraints plus one (0 without constraints) */
+    size_t usedParticleCount;
+
+    /**
+     * The first constraint of every color and the number of constraints at
+     * the end (empty if the constraints are not colored yet).
+     */
+    std::vector<size_t> colorStarts;
+
+    /**
+     * Constructs an empty set of constraints with the given number of
+     * particles each.
+     */
+    XpbdConstraints(size_t particlesPerConstraint);
+
+    /**
+     * Returns the number of constraints.
+     */
+    size_t getCount() const;
+
+    /**
+     * Appends a constraint (which removes the coloring).
+     */
+    void add(const uint32_t* indices, float restValue, float compliance);
+
+    /**
+     * Colors the constraints greedily (see XpbdSolver) and sorts them by
+     * color, unless they are colored already.
+     */
+    void color();
+};
+
+/**
+ * An extended position based dynamics solver (XPBD, Macklin et al., "XPBD:
+ * position-based simulation of compliant constrained dynamics", 2016) for
+ * cloth and soft bodies. The particles are two arrays of Vec4f: the
+ * positions (x, y, z) with the inverse mass in w (0 for fixed particles) and
+ * the velocities (x, y, z). The constraints refer to the particles by index:
+ *  - distance constraints |x_a - x_b| = l (stretching, shearing),
+ *  - bending constraints on the dihedral angle between the triangles
+ *    (a, b, c) and (b, a, d) at their common edge (a, b) (Müller et al.,
+ *    "Position based dynamics", 2007),
+ *  - volume constraints on the signed volume of the tetrahedron (a, b, c, d)
+ *    (soft bodies).
+ * Every constraint has a compliance (the inverse stiffness, 0 is rigid),
+ * which XPBD makes independent of the time step and the iteration count.
+ * The particles collide with planes and signed distance fields.
+ *
+ * Before the first step (and after adding constraints), the constraints of
+ * every type are partitioned by graph coloring: no two constraints of a
+ * color share a particle, so all constraints of a color are projected in
+ * parallel (Jacobi across the color, Gauss-Seidel from color to color)
+ * without any atomics, and the result does not depend on the number of
+ * threads. The colors are assigned greedily in the order in which the
+ * constraints were added (colors 0 to 63 in the first pass over the
+ * constraints, 64 to 127 in the next pass for the rest, and so on), and the
+ * constraints are stored sorted by color in structure-of-arrays layout. The
+ * distance constraints, which are the bulk of a cloth, are projected
+ * FLOAT_LANES at a time.
+ *
+ * Many independent objects (for example a batch of garments) are best
+ * simulated by one solver with all of their particles: every color then
+ * contains constraints of all objects, which gives every thread enough
+ * work.
+ */
+
+class XpbdSolver
+{
+public:
+    /**
+     * Constructs a solver without constraints.
+     */
+    XpbdSolver(const XpbdSettings& settings = XpbdSettings());
+
+    /**
+     * Returns the settings.
+     */
+    const XpbdSettings& getSettings() const;
+
+    /**
+     * Adds a distance constraint between the particles a and b.
+     */
+    void addDistanceConstraint(uint32_t a, uint32_t b, float restLength, float compliance);
+
+    /**
+     * Adds a bending constraint on the dihedral angle (in [0, pi], where pi
+     * is flat) between the triangles (a, b, c) and (b, a, d).
+     */
+    void addBendingConstraint(uint32_t a, uint32_t b, uint32_t c, uint32_t d, float restAngle, float compliance);
+
+    /**
+     * Adds a volume constraint on the signed volume
+     * (b - a) . ((c - a) x (d - a)) / 6 of the tetrahedron (a, b, c, d).
+     */
+    void addVolumeConstraint(uint32_t a, uint32_t b, uint32_t c, uint32_t d, float restVolume, float compliance);
+
+    /**
+     * Adds the constraints of a cloth given as a triangle mesh (three
+     * indices per triangle, like TriangleMesh): a distance constraint for
+     * every edge and a bending constraint for every edge which is shared by
+     * two triangles. The rest lengths and angles are taken from the given
+     * positions.
+     */
+    void addCloth(const Vec4f* positions, const uint32_t* indices, size_t triangleCount, float stretchCompliance,
+                  float bendingCompliance);
+
+    /**
+     * Adds the constraints of a soft body given as a tetrahedral mesh (four
+     * indices per tetrahedron): a distance constraint for every edge and a
+     * volume constraint for every tetrahedron. The rest lengths and volumes
+     * are taken from the given positions.
+     */
+    void addSoftBody(const Vec4f* positions, const uint32_t* indices, size_t tetrahedronCount,
+                     float edgeCompliance, float volumeCompliance);
+
+    /**
+     * Adds a collision plane: the particles are kept on the side of the
+     * plane into which the normal points (n . x + offset >= margin, where
+     * the normal must be of unit length).
+     */
+    void addCollisionPlane(const Vec4f& normal, float offset);
+
+    /**
+     * Adds a signed distance field as a collider: the particles are kept
+     * outside of it. The field is not copied and must stay valid while the
+     * solver is used.
+     */
+    void addCollisionField(const SignedDistanceField& field);
+
+    /**
+     * Adds a sparse signed distance field as a collider (see above).
+     */
+    void addCollisionField(const SparseSignedDistanceField& field);
+
+    /**
+     * Returns the number of colors of the distance, bending and volume
+     * constraints (which are computed by the next step(...) if constraints
+     * were added since the last one).
+     */
+    size_t getColorCount() const;
+
+    /**
+     * Advances the particles by one time step (see above). Throws
+     * std::invalid_argument if a constraint refers to a particle which does
+     * not exist, or for invalid settings.
+     */
+    void step(Vec4f* positions, Vec4f* velocities, size_t count, float timeStep);
+
+private:
+    /** The settings */
+    XpbdSettings settings;
+
+    /** The constraints of every type */
+    XpbdConstraints distances, bendings, volumes;
+
+    /** The collision planes (normal in x, y, z and offset in w) */
+    std::vector<Vec4f> planes;
+
+    /** The collision fields */
+    std::vector<const SignedDistanceField*> fields;
+    std::vector<const SparseSignedDistanceField*> sparseFields;
+
+    /** The positions at the beginning of the substep */
+    std::vector<Vec4f> previousPositions;
+};